@@ -1,3 +1,7 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
 #include "buffer/buffer_pool_manager.h"
 
 namespace scudb {
@@ -5,36 +9,93 @@ using namespace std;
 /*
  * BufferPoolManager Constructor
  * When log_manager is nullptr, logging is disabled (for test purpose)
- * WARNING: Do Not Edit This Function
+ * num_instances splits the frames into that many independent instances,
+ * the default of one behaves exactly like a single global pool
+ * replacer_type picks the replacement policy used by every instance
  */
     BufferPoolManager::BufferPoolManager(size_t pool_size,
                                          DiskManager *disk_manager,
-                                         LogManager *log_manager)
-            : pool_size_(pool_size), disk_manager_(disk_manager),
-              log_manager_(log_manager) {
+                                         LogManager *log_manager,
+                                         size_t num_instances,
+                                         ReplacerType replacer_type)
+            : pool_size_(pool_size), page_data_(pool_size), disk_manager_(disk_manager),
+              log_manager_(log_manager), writer_thread_(nullptr),
+              writer_running_(false), writer_clean_ratio_(BG_WRITER_CLEAN_RATIO),
+              writer_batch_size_(BG_WRITER_BATCH_SIZE),
+              writer_interval_ms_(BG_WRITER_INTERVAL_MS), writer_rounds_(0),
+              writer_pages_written_(0), victim_writes_(0), prefetch_thread_(nullptr),
+              prefetch_running_(false), prefetch_busy_(false),
+              prefetch_depth_(PREFETCH_DEPTH), prefetch_reads_(0) {
         // a consecutive memory space for buffer pool
         pages_ = new Page[pool_size_];
-        page_table_ = new ExtendibleHash<page_id_t, Page *>(BUCKET_SIZE);
-        replacer_ = new LRUReplacer<Page *>;
-        free_list_ = new std::list<Page *>;
-
-        // put all the pages into free list
         for (size_t i = 0; i < pool_size_; ++i) {
-            free_list_->push_back(&pages_[i]);
+            pages_[i].data_ = page_data_.GetPage(i);
+        }
+
+        // every instance needs at least one frame
+        if (num_instances == 0) num_instances = 1;
+        if (num_instances > pool_size_ && pool_size_ > 0) num_instances = pool_size_;
+
+        // hand out the frames in consecutive runs, the first
+        // pool_size % num_instances instances get one extra frame
+        size_t start = 0;
+        for (size_t i = 0; i < num_instances; ++i) {
+            size_t size = pool_size_ / num_instances + (i < pool_size_ % num_instances ? 1 : 0);
+            instances_.push_back(new BufferPoolInstance(i, pages_ + start, size, replacer_type));
+            start += size;
         }
     }
 
 /*
  * BufferPoolManager Deconstructor
- * WARNING: Do Not Edit This Function
  */
     BufferPoolManager::~BufferPoolManager() {
+        StopWriterThread();
+        StopPrefetchThread();
+        for (auto instance : instances_) {
+            delete instance;
+        }
         delete[] pages_;
+    }
+
+    BufferPoolManager::BufferPoolInstance::BufferPoolInstance(size_t index, Page *pages,
+                                                              size_t pool_size,
+                                                              ReplacerType replacer_type)
+            : index_(index), pages_(pages), pool_size_(pool_size),
+              ring_owner_(pool_size, nullptr) {
+        page_table_ = new ExtendibleHash<page_id_t, Page *>(BUCKET_SIZE);
+        switch (replacer_type) {
+            case ReplacerType::CLOCK:
+                replacer_ = new ClockReplacer(pages_, pool_size_);
+                break;
+            case ReplacerType::LRU_K:
+                replacer_ = new LRUKReplacer(pages_, pool_size_);
+                break;
+            default:
+                replacer_ = new LRUReplacer<Page *>;
+                break;
+        }
+        free_list_ = new std::list<Page *>;
+
+        // put all the pages into free list
+        for (size_t i = 0; i < pool_size_; ++i) {
+            free_list_->push_back(&pages_[i]);
+        }
+    }
+
+    BufferPoolManager::BufferPoolInstance::~BufferPoolInstance() {
         delete page_table_;
         delete replacer_;
         delete free_list_;
     }
 
+/*
+ * A page id is always served by the same instance
+ */
+    BufferPoolManager::BufferPoolInstance &BufferPoolManager::GetInstance(page_id_t page_id) {
+        return *instances_[static_cast<size_t>(page_id) % instances_.size()];
+    }
+
 /**
  * 1. search hash table.
  *  1.1 if exist, pin the page and return immediately
@@ -47,31 +108,178 @@ using namespace std;
  * pointer
  *
  * This function must mark the Page as pinned and remove its entry from LRUReplacer before it is returned to the caller.
+ *
+ * The frame is claimed and published in the page table while the instance
+ * latch is held, but the write-back of step 2 and the read of step 4 run
+ * after dropping it. Both page ids stay in io_pending_ until the I/O is done,
+ * so anybody asking for them in the meantime waits instead of seeing a
+ * half-read frame or reading a stale copy from disk.
+ *
+ * With a ring, a miss recycles one of the ring's own frames (see
+ * GetRingVictimPage). Without one, a hit on a ring frame takes the page out
+ * of the ring since it is obviously wanted beyond the scan.
+ */
+    Page *BufferPoolManager::FetchPage(page_id_t page_id, BufferRing *ring) {
+        bool need_read = false;
+        page_id_t old_page_id = INVALID_PAGE_ID;
+        Page *tar = ClaimPage(page_id, ring, need_read, old_page_id);
+        if (tar == nullptr || !need_read) return tar;
+
+        if (old_page_id != INVALID_PAGE_ID) {
+            disk_manager_->WritePage(old_page_id,tar->data_);
+            NoteVictimWrite();
+        }
+        //4
+        disk_manager_->ReadPage(page_id,tar->data_);
+        FinishIO(GetInstance(page_id), page_id, old_page_id);
+
+        return tar;
+    }
+
+// ReadPages, false if any page could not get a frame
+    bool BufferPoolManager::FetchPages(const vector<page_id_t> &page_ids,
+                                       vector<Page *> &pages, BufferRing *ring) {
+        ReadPages(page_ids, pages, ring, false);
+        return find(pages.begin(), pages.end(), nullptr) == pages.end();
+    }
+
+/*
+ * Fetch several pages at once: the frames are claimed one after the other,
+ * then the write-backs of dirty victims go out as one asynchronous batch and,
+ * once they are done (the frames get reused), all the reads as another one.
+ * pages[i] is the pinned page_ids[i], or nullptr if its instance was full.
+ * The claims never wait for a page with I/O pending: that I/O may be our own
+ * (a page id that shows up again, or one a claimed frame is written back
+ * for) or belong to another batch waiting on our claims in turn. The I/O
+ * gathered so far is issued first, then the page is claimed again, waiting.
+ * A prefetch claims the pages as ClaimPage does for one.
+ * @return: the number of pages read from disk
  */
-    Page *BufferPoolManager::FetchPage(page_id_t page_id) {
-        lock_guard<mutex> lck(latch_);
+    size_t BufferPoolManager::ReadPages(const vector<page_id_t> &page_ids,
+                                        vector<Page *> &pages, BufferRing *ring,
+                                        bool prefetch) {
+        pages.assign(page_ids.size(), nullptr);
+        vector<pair<size_t, page_id_t>> misses; // index in page_ids, page written back
+        vector<AsyncIORequest> requests;
+        vector<uint64_t> tags;
+        auto issue = [&] {
+            requests.clear();
+            for (auto &miss : misses) {
+                if (miss.second != INVALID_PAGE_ID) {
+                    requests.push_back({true, miss.second, pages[miss.first]->data_, 0});
+                }
+            }
+            if (!requests.empty()) {
+                disk_manager_->SubmitBatch(requests);
+                tags.clear();
+                for (auto &request : requests) tags.push_back(request.tag_);
+                disk_manager_->WaitFor(tags);
+                victim_writes_ += requests.size();
+                writer_cv_.notify_one();
+            }
+            requests.clear();
+            for (auto &miss : misses) {
+                requests.push_back({false, page_ids[miss.first], pages[miss.first]->data_, 0});
+            }
+            if (!requests.empty()) {
+                disk_manager_->SubmitBatch(requests);
+                tags.clear();
+                for (auto &request : requests) tags.push_back(request.tag_);
+                disk_manager_->WaitFor(tags);
+            }
+            for (auto &miss : misses) {
+                page_id_t page_id = page_ids[miss.first];
+                FinishIO(GetInstance(page_id), page_id, miss.second);
+            }
+            misses.clear();
+        };
+
+        size_t reads = 0;
+        for (size_t i = 0; i < page_ids.size(); ++i) {
+            bool need_read = false;
+            bool pending = false;
+            page_id_t old_page_id = INVALID_PAGE_ID;
+            pages[i] = ClaimPage(page_ids[i], ring, need_read, old_page_id, prefetch, &pending);
+            if (pending) {
+                issue();
+                pages[i] = ClaimPage(page_ids[i], ring, need_read, old_page_id, prefetch);
+            }
+            if (pages[i] != nullptr && need_read) {
+                misses.push_back(make_pair(i, old_page_id));
+                reads++;
+            }
+        }
+        issue();
+        return reads;
+    }
+
+/*
+ * Steps 1 to 3 of FetchPage: pin page_id if cached, otherwise claim a frame
+ * and publish it. On a miss need_read is set, old_page_id is the dirty page
+ * that must be written back from the frame first (INVALID_PAGE_ID if none),
+ * and the caller has to do the I/O and call FinishIO.
+ * A prefetch is not counted as a hit or miss and leaves ring membership alone.
+ * With pending, instead of waiting for a read or write-back of page_id to
+ * finish, nothing is done and *pending is set.
+ */
+    Page *BufferPoolManager::ClaimPage(page_id_t page_id, BufferRing *ring,
+                                       bool &need_read, page_id_t &old_page_id,
+                                       bool prefetch, bool *pending) {
+        BufferPoolInstance &instance = GetInstance(page_id);
+        unique_lock<mutex> lck(instance.latch_);
         Page *tar = nullptr;
-        if (page_table_->Find(page_id,tar)) { //1.1
-            tar->pin_count_++;
-            replacer_->Erase(tar);
-            return tar;
+        while (true) {
+            if (pending != nullptr && instance.io_pending_.count(page_id) != 0) {
+                *pending = true;
+                return nullptr;
+            }
+            if (instance.page_table_->Find(page_id,tar)) { //1.1
+                if (prefetch) {
+                    // already there
+                } else if (ring != nullptr) {
+                    instance.num_hits_++;
+                    ring->hits_++;
+                } else {
+                    instance.num_hits_++;
+                    DetachFromRing(instance, tar);
+                }
+                tar->pin_count_++;
+                instance.replacer_->Erase(tar);
+                // somebody else may still be reading it in
+                WaitForIO(instance, lck, page_id);
+                need_read = false;
+                return tar;
+            }
+            // the page was just evicted and its write-back is still running
+            if (instance.io_pending_.count(page_id) == 0 &&
+                instance.bg_writes_.count(page_id) == 0) break;
+            instance.io_cv_.wait(lck);
         }
         //1.2
-        tar = GetVictimPage();
+        tar = ring != nullptr ? GetRingVictimPage(instance, *ring) : GetVictimPage(instance);
         if (tar == nullptr) return tar;
-        //2
-        if (tar->is_dirty_) {
-            disk_manager_->WritePage(tar->GetPageId(),tar->data_);
+        if (!prefetch) {
+            instance.num_misses_++;
+            if (ring != nullptr) ring->misses_++;
         }
+        //2
+        old_page_id = tar->GetPageId();
+        bool write_back = tar->is_dirty_;
         //3
-        page_table_->Remove(tar->GetPageId());
-        page_table_->Insert(page_id,tar);
-        //4
-        disk_manager_->ReadPage(page_id,tar->data_);
+        instance.page_table_->Remove(old_page_id);
+        instance.page_table_->Insert(page_id,tar);
         tar->pin_count_ = 1;
         tar->is_dirty_ = false;
         tar->page_id_= page_id;
-
+        instance.io_pending_.insert(page_id);
+        if (write_back) {
+            instance.io_pending_.insert(old_page_id);
+            // an older copy from the background writer must not land last
+            WaitForWriter(instance, lck, old_page_id);
+        } else {
+            old_page_id = INVALID_PAGE_ID;
+        }
+        need_read = true;
         return tar;
     }
 //Page *BufferPoolManager::find
@@ -83,9 +291,10 @@ using namespace std;
  * dirty flag of this page
  */
     bool BufferPoolManager::UnpinPage(page_id_t page_id, bool is_dirty) {
-        lock_guard<mutex> lck(latch_);
+        BufferPoolInstance &instance = GetInstance(page_id);
+        lock_guard<mutex> lck(instance.latch_);
         Page *tar = nullptr;
-        page_table_->Find(page_id,tar);
+        instance.page_table_->Find(page_id,tar);
         if (tar == nullptr) {
             return false;
         }
@@ -98,8 +307,8 @@ using namespace std;
         }
         ;
         //std::cout<<"page id :"<<page_id<<"pin count"<<tar->pin_count_<<endl;
-        if (--tar->pin_count_ == 0) {
-            replacer_->Insert(tar);
+        if (--tar->pin_count_ == 0 && instance.RingOwner(tar) == nullptr) {
+            instance.replacer_->Insert(tar);
         }
         return true;
     }
@@ -109,22 +318,166 @@ using namespace std;
  * write_page method of the disk manager
  * if page is not found in page table, return false
  * NOTE: make sure page_id != INVALID_PAGE_ID
+ * A dirty page is copied under its read latch and written from the copy,
+ * as a checkpoint does (see CopyForCheckpoint), and stays in bg_writes_
+ * until the write is done. A clean page may still have such a write, or one
+ * from the background writer, in flight, which has to land before returning.
  */
     bool BufferPoolManager::FlushPage(page_id_t page_id) {
-        lock_guard<mutex> lck(latch_);
+        {
+            BufferPoolInstance &instance = GetInstance(page_id);
+            unique_lock<mutex> lck(instance.latch_);
+            WaitForIO(instance, lck, page_id);
+            WaitForWriter(instance, lck, page_id);
+            Page *tar = nullptr;
+            instance.page_table_->Find(page_id,tar);
+            if (tar == nullptr || tar->page_id_ == INVALID_PAGE_ID) {
+                return false;
+            }
+            if (!tar->is_dirty_) {
+                return true;
+            }
+        }
+
+        // a write-back by an eviction in between is waited for by the copy
+        PageBuffer buffer(1);
+        bool pinned = false;
+        if (CopyForCheckpoint(page_id, buffer.GetData(), true, pinned)) {
+            disk_manager_->WritePage(page_id, buffer.GetData());
+            FinishCheckpointWrite(page_id);
+        }
+        return true;
+    }
+
+/*
+ * Fuzzy checkpoint:
+ * 1. collect the ids of the dirty pages, one instance at a time
+ * 2. sort them so the file is written front to back
+ * 3. per batch, copy each unpinned page (CopyForCheckpoint), then write
+ *    runs of consecutive page ids with one DiskManager::WritePages call each
+ * 4. copy and write the pinned pages one by one under their read latch. This
+ *    is done with no other copy in flight: a thread holding a write latch
+ *    may be waiting to fetch a page copied earlier in the batch.
+ * Pages dirtied after step 1 are left for the next checkpoint. A copied page
+ * sits in bg_writes_ until it is written, which orders it against evictions
+ * and FlushPage exactly like a background writer copy.
+ */
+    size_t BufferPoolManager::Checkpoint() {
+        vector<page_id_t> dirty;
+        for (auto instance : instances_) {
+            lock_guard<mutex> lck(instance->latch_);
+            for (size_t i = 0; i < instance->pool_size_; ++i) {
+                Page &frame = instance->pages_[i];
+                if (frame.is_dirty_ && frame.page_id_ != INVALID_PAGE_ID) {
+                    dirty.push_back(frame.page_id_);
+                }
+            }
+        }
+        sort(dirty.begin(), dirty.end());
+
+        PageBuffer buffer(CHECKPOINT_BATCH_SIZE);
+        vector<page_id_t> copied;
+        vector<page_id_t> pinned_pages;
+        size_t written = 0;
+        for (size_t start = 0; start < dirty.size(); start += CHECKPOINT_BATCH_SIZE) {
+            size_t end = min(dirty.size(), start + CHECKPOINT_BATCH_SIZE);
+            copied.clear();
+            for (size_t i = start; i < end; ++i) {
+                bool pinned = false;
+                if (CopyForCheckpoint(dirty[i], buffer.GetPage(copied.size()),
+                                      false, pinned)) {
+                    copied.push_back(dirty[i]);
+                } else if (pinned) {
+                    pinned_pages.push_back(dirty[i]);
+                }
+            }
+            // coalesce runs of consecutive page ids
+            for (size_t i = 0; i < copied.size();) {
+                size_t j = i + 1;
+                while (j < copied.size() && copied[j] == copied[j - 1] + 1) j++;
+                disk_manager_->WritePages(copied[i], buffer.GetPage(i),
+                                          static_cast<int>(j - i));
+                i = j;
+            }
+            for (page_id_t page_id : copied) {
+                FinishCheckpointWrite(page_id);
+            }
+            written += copied.size();
+        }
+
+        for (page_id_t page_id : pinned_pages) {
+            bool pinned = false;
+            if (CopyForCheckpoint(page_id, buffer.GetData(), true, pinned)) {
+                disk_manager_->WritePage(page_id, buffer.GetData());
+                FinishCheckpointWrite(page_id);
+                written++;
+            }
+        }
+        return written;
+    }
+
+    size_t BufferPoolManager::FlushAllPages() {
+        size_t written = 0;
+        size_t round;
+        while ((round = Checkpoint()) != 0) {
+            written += round;
+        }
+        return written;
+    }
+
+/*
+ * Copy page_id into buffer for the checkpoint if it is still cached and
+ * dirty, and mark it clean. An unpinned page is copied under the instance
+ * latch as nobody can be changing it. A pinned one is only taken when
+ * copy_pinned is set (pinned tells the caller otherwise): it is pinned once
+ * more, marked clean, and copied under its read latch after the instance
+ * latch is released. An update still running finishes before the copy, and
+ * any update after the copy marks the page dirty again when it is unpinned.
+ */
+    bool BufferPoolManager::CopyForCheckpoint(page_id_t page_id, char *buffer,
+                                              bool copy_pinned, bool &pinned) {
+        BufferPoolInstance &instance = GetInstance(page_id);
+        unique_lock<mutex> lck(instance.latch_);
+        WaitForIO(instance, lck, page_id);
+        WaitForWriter(instance, lck, page_id);
         Page *tar = nullptr;
-        page_table_->Find(page_id,tar);
-        if (tar == nullptr || tar->page_id_ == INVALID_PAGE_ID) {
+        instance.page_table_->Find(page_id,tar);
+        if (tar == nullptr || !tar->is_dirty_) {
             return false;
         }
-        if (tar->is_dirty_) {
-            disk_manager_->WritePage(page_id,tar->GetData());
-            tar->is_dirty_ = false;
+        pinned = tar->pin_count_ != 0;
+        if (pinned && !copy_pinned) {
+            return false;
+        }
+        tar->is_dirty_ = false;
+        instance.bg_writes_.insert(page_id);
+        if (!pinned) {
+            memcpy(buffer, tar->data_, PAGE_SIZE);
+            return true;
         }
+        tar->pin_count_++;
+        lck.unlock();
 
+        tar->RLatch();
+        memcpy(buffer, tar->data_, PAGE_SIZE);
+        tar->RUnlatch();
+
+        lck.lock();
+        if (--tar->pin_count_ == 0 && instance.RingOwner(tar) == nullptr) {
+            instance.replacer_->Insert(tar);
+        }
         return true;
     }
 
+    void BufferPoolManager::FinishCheckpointWrite(page_id_t page_id) {
+        BufferPoolInstance &instance = GetInstance(page_id);
+        {
+            lock_guard<mutex> lck(instance.latch_);
+            instance.bg_writes_.erase(page_id);
+        }
+        instance.io_cv_.notify_all();
+    }
+
 /**
  * User should call this method for deleting a page. This routine will call
  * disk manager to deallocate the page. First, if page is found within page
@@ -134,21 +487,23 @@ using namespace std;
  * the page is found within page table, but pin_count != 0, return false
  */
 bool BufferPoolManager::DeletePage(page_id_t page_id) {
-    lock_guard<mutex> lck(latch_);
+    BufferPoolInstance &instance = GetInstance(page_id);
+    lock_guard<mutex> lck(instance.latch_);
     Page *tar = nullptr;
-    page_table_->Find(page_id,tar);
+    instance.page_table_->Find(page_id,tar);
     if (tar != nullptr) {
         if (tar->GetPinCount() > 0) {
             //     cout<<"DeletePage error"<<tar->page_id_<<endl;
 //      assert(false);
             return false;
         }
-        replacer_->Erase(tar);
-        page_table_->Remove(page_id);
+        instance.replacer_->Erase(tar);
+        DetachFromRing(instance, tar);
+        instance.page_table_->Remove(page_id);
         tar->is_dirty_= false;
         tar->ResetMemory();
         tar->page_id_ = INVALID_PAGE_ID;
-        free_list_->push_back(tar);
+        instance.free_list_->push_back(tar);
     }
     disk_manager_->DeallocatePage(page_id);
     return true;
@@ -161,43 +516,106 @@ bool BufferPoolManager::DeletePage(page_id_t page_id) {
  * from free list or lru replacer(NOTE: always choose from free list first),
  * update new page's metadata, zero out memory and add corresponding entry
  * into page table. return nullptr if all the pages in pool are pinned
+ * The page id decides which instance hosts the page. An id whose instance has
+ * no victim is kept in spare_page_ids_ for a later call instead of being
+ * lost, and the next ids are tried until every instance has been asked, so
+ * the page goes to the first instance (in id order) with a frame to give.
  */
     Page *BufferPoolManager::NewPage(page_id_t &page_id) {
-        lock_guard<mutex> lck(latch_);
+        vector<page_id_t> candidates;
+        {
+            lock_guard<mutex> spare_lck(spare_latch_);
+            candidates.swap(spare_page_ids_);
+        }
+        vector<bool> asked(instances_.size(), false);
+        size_t not_asked = instances_.size();
+        vector<page_id_t> unused;
+        unique_lock<mutex> lck;
         Page *tar = nullptr;
-        tar = GetVictimPage();
+        page_id_t new_page_id = INVALID_PAGE_ID;
+        for (size_t i = 0; tar == nullptr; ++i) {
+            if (i < candidates.size()) {
+                new_page_id = candidates[i];
+            } else if (not_asked > 0) {
+                new_page_id = disk_manager_->AllocatePage();
+            } else {
+                break;
+            }
+            BufferPoolInstance &instance = GetInstance(new_page_id);
+            if (!asked[instance.index_]) {
+                lck = unique_lock<mutex>(instance.latch_);
+                tar = GetVictimPage(instance);
+                if (tar == nullptr) {
+                    lck.unlock();
+                    asked[instance.index_] = true;
+                    not_asked--;
+                }
+            }
+            if (tar == nullptr) {
+                unused.push_back(new_page_id);
+            } else {
+                unused.insert(unused.end(), candidates.begin() + min(i + 1, candidates.size()),
+                              candidates.end());
+            }
+        }
+        if (!unused.empty()) {
+            lock_guard<mutex> spare_lck(spare_latch_);
+            spare_page_ids_.insert(spare_page_ids_.end(), unused.begin(), unused.end());
+            sort(spare_page_ids_.begin(), spare_page_ids_.end());
+        }
         if (tar == nullptr) {
             return tar;
         }
 
-        page_id = disk_manager_->AllocatePage();
+        BufferPoolInstance &instance = GetInstance(new_page_id);
+        page_id = new_page_id;
         //2
-        if (tar->is_dirty_) {
-            disk_manager_->WritePage(tar->GetPageId(),tar->data_);
-        }
+        page_id_t old_page_id = tar->GetPageId();
+        bool write_back = tar->is_dirty_;
         //3
-        page_table_->Remove(tar->GetPageId());
-        page_table_->Insert(page_id,tar);
+        instance.page_table_->Remove(old_page_id);
+        instance.page_table_->Insert(page_id,tar);
 
         //4
         tar->page_id_ = page_id;
-        tar->ResetMemory();
         tar->is_dirty_ = false;
         tar->pin_count_ = 1;
+        instance.io_pending_.insert(page_id);
+        if (write_back) {
+            instance.io_pending_.insert(old_page_id);
+            // an older copy from the background writer must not land last
+            WaitForWriter(instance, lck, old_page_id);
+        }
+        lck.unlock();
+
+        if (write_back) {
+            disk_manager_->WritePage(old_page_id,tar->data_);
+            NoteVictimWrite();
+        }
+        tar->ResetMemory();
+        FinishIO(instance, page_id, write_back ? old_page_id : INVALID_PAGE_ID);
 
         return tar;
     }
 
-    Page *BufferPoolManager::GetVictimPage() {
+    Page *BufferPoolManager::GetVictimPage(BufferPoolInstance &instance) {
         Page *tar = nullptr;
-        if (free_list_->empty()) {
-            if (replacer_->Size() == 0) {
+        if (instance.free_list_->empty()) {
+            if (instance.replacer_->Size() == 0) {
+                // last resort: take an idle frame away from a scan ring
+                for (size_t i = 0; i < instance.pool_size_; ++i) {
+                    tar = &instance.pages_[i];
+                    if (instance.RingOwner(tar) != nullptr && tar->pin_count_ == 0) {
+                        DetachFromRing(instance, tar);
+                        return tar;
+                    }
+                }
                 return nullptr;
             }
-            replacer_->Victim(tar);
+            instance.replacer_->Victim(tar);
         } else {
-            tar = free_list_->front();
-            free_list_->pop_front();
+            tar = instance.free_list_->front();
+            instance.free_list_->pop_front();
             assert(tar->GetPageId() == INVALID_PAGE_ID);
         }
         if (tar != nullptr) {
@@ -206,6 +624,357 @@ bool BufferPoolManager::DeletePage(page_id_t page_id) {
         return tar;
     }
 
+/*
+ * Victim for a fetch through ring: once the ring holds its share of the
+ * instance's frames, it reuses its oldest one. If that frame is still pinned
+ * it leaves the ring (the replacer gets it on unpin) and an ordinary victim
+ * takes its place.
+ */
+    Page *BufferPoolManager::GetRingVictimPage(BufferPoolInstance &instance, BufferRing &ring) {
+        auto &frames = ring.frames_[instance.index_];
+        if (frames.size() >= GetRingCapacity(instance, ring)) {
+            Page *tar = frames.front();
+            frames.pop_front();
+            if (tar->pin_count_ == 0) {
+                frames.push_back(tar);
+                return tar;
+            }
+            instance.RingOwner(tar) = nullptr;
+        }
+        Page *tar = GetVictimPage(instance);
+        if (tar != nullptr) {
+            frames.push_back(tar);
+            instance.RingOwner(tar) = &ring;
+        }
+        return tar;
+    }
+
+/*
+ * Frames ring may own in instance: its share of the ring size, but no more
+ * than a quarter of the instance
+ */
+    size_t BufferPoolManager::GetRingCapacity(BufferPoolInstance &instance, BufferRing &ring) {
+        size_t share = (ring.ring_size_ + instances_.size() - 1) / instances_.size();
+        return max<size_t>(1, min(share, instance.pool_size_ / 4));
+    }
+
+/*
+ * Take frame out of its ring, if any. Whoever holds the last pin will hand it
+ * to the replacer.
+ */
+    void BufferPoolManager::DetachFromRing(BufferPoolInstance &instance, Page *frame) {
+        BufferRing *ring = instance.RingOwner(frame);
+        if (ring == nullptr) return;
+        auto &frames = ring->frames_[instance.index_];
+        frames.erase(find(frames.begin(), frames.end(), frame));
+        instance.RingOwner(frame) = nullptr;
+    }
+
+/*
+ * Called when a ring goes away: its idle frames that still hold a page go to
+ * the replacer like any other unpinned page
+ */
+    void BufferPoolManager::ReleaseRing(BufferRing *ring) {
+        for (auto instance : instances_) {
+            lock_guard<mutex> lck(instance->latch_);
+            for (Page *frame : ring->frames_[instance->index_]) {
+                instance->RingOwner(frame) = nullptr;
+                if (frame->pin_count_ == 0 && frame->page_id_ != INVALID_PAGE_ID) {
+                    instance->replacer_->Insert(frame);
+                }
+            }
+            ring->frames_[instance->index_].clear();
+        }
+    }
+
+/*
+ * Block (releasing the instance latch meanwhile) until no read or write-back
+ * of page_id is in flight. lck must hold the latch of instance.
+ */
+    void BufferPoolManager::WaitForIO(BufferPoolInstance &instance,
+                                      unique_lock<mutex> &lck, page_id_t page_id) {
+        instance.io_cv_.wait(lck, [&] { return instance.io_pending_.count(page_id) == 0; });
+    }
+
+/*
+ * Block (releasing the instance latch meanwhile) until the background writer
+ * is done writing its copy of page_id
+ */
+    void BufferPoolManager::WaitForWriter(BufferPoolInstance &instance,
+                                          unique_lock<mutex> &lck, page_id_t page_id) {
+        instance.io_cv_.wait(lck, [&] { return instance.bg_writes_.count(page_id) == 0; });
+    }
+
+/*
+ * Publish the end of the I/O started by FetchPage/NewPage and wake up the
+ * threads waiting for either page id
+ */
+    void BufferPoolManager::FinishIO(BufferPoolInstance &instance, page_id_t page_id,
+                                     page_id_t written_page_id) {
+        {
+            lock_guard<mutex> lck(instance.latch_);
+            instance.io_pending_.erase(page_id);
+            if (written_page_id != INVALID_PAGE_ID) {
+                instance.io_pending_.erase(written_page_id);
+            }
+        }
+        instance.io_cv_.notify_all();
+    }
+
+    size_t BufferPoolManager::GetHitCount() {
+        size_t hits = 0;
+        for (auto instance : instances_) {
+            lock_guard<mutex> lck(instance->latch_);
+            hits += instance->num_hits_;
+        }
+        return hits;
+    }
+
+    size_t BufferPoolManager::GetMissCount() {
+        size_t misses = 0;
+        for (auto instance : instances_) {
+            lock_guard<mutex> lck(instance->latch_);
+            misses += instance->num_misses_;
+        }
+        return misses;
+    }
+
+/*
+ * Spawn the background writer. Rounds run every writer interval, or earlier
+ * when a miss had to write a dirty victim itself.
+ */
+    void BufferPoolManager::RunWriterThread() {
+        lock_guard<mutex> lck(writer_latch_);
+        if (writer_running_) return;
+        writer_running_ = true;
+        writer_thread_ = new thread([this] {
+            unique_lock<mutex> lck(writer_latch_);
+            while (writer_running_) {
+                writer_cv_.wait_for(lck, chrono::milliseconds(writer_interval_ms_.load()));
+                if (!writer_running_) break;
+                lck.unlock();
+                WriterRound();
+                lck.lock();
+            }
+        });
+    }
+
+/*
+ * Stop and join the background writer
+ */
+    void BufferPoolManager::StopWriterThread() {
+        {
+            lock_guard<mutex> lck(writer_latch_);
+            if (!writer_running_) return;
+            writer_running_ = false;
+        }
+        writer_cv_.notify_one();
+        writer_thread_->join();
+        delete writer_thread_;
+        writer_thread_ = nullptr;
+    }
+
+    size_t BufferPoolManager::WriterRound() {
+        PageBuffer buffer;
+        size_t written = 0;
+        for (auto instance : instances_) {
+            written += WriterRound(*instance, buffer);
+        }
+        writer_rounds_++;
+        writer_pages_written_ += written;
+        return written;
+    }
+
+/*
+ * Count the frames of instance a miss could take without a write-back (free
+ * or unpinned and clean). Below the target, copy up to a batch of dirty
+ * unpinned pages, mark them clean and write the copies with the latch
+ * released. Copying is safe since nobody modifies an unpinned page. Until the
+ * write lands the page id stays in bg_writes_, so a refetch after a quick
+ * eviction waits instead of reading the old content.
+ * The sweep continues where the previous round stopped, like a clock hand.
+ */
+    size_t BufferPoolManager::WriterRound(BufferPoolInstance &instance, PageBuffer &buffer) {
+        vector<page_id_t> page_ids;
+        {
+            lock_guard<mutex> lck(instance.latch_);
+            size_t target = static_cast<size_t>(ceil(writer_clean_ratio_ * instance.pool_size_));
+            size_t clean = 0;
+            for (size_t i = 0; i < instance.pool_size_; ++i) {
+                Page &frame = instance.pages_[i];
+                if (frame.pin_count_ == 0 && !frame.is_dirty_) clean++;
+            }
+            if (clean >= target) return 0;
+            size_t batch = min(target - clean, writer_batch_size_.load());
+            buffer.Resize(batch);
+            for (size_t step = 0; step < instance.pool_size_ && page_ids.size() < batch; ++step) {
+                Page &frame = instance.pages_[instance.writer_cursor_];
+                instance.writer_cursor_ = (instance.writer_cursor_ + 1) % instance.pool_size_;
+                if (frame.pin_count_ != 0 || !frame.is_dirty_ ||
+                    instance.bg_writes_.count(frame.page_id_) != 0) {
+                    continue;
+                }
+                memcpy(buffer.GetPage(page_ids.size()), frame.data_, PAGE_SIZE);
+                frame.is_dirty_ = false;
+                instance.bg_writes_.insert(frame.page_id_);
+                page_ids.push_back(frame.page_id_);
+            }
+        }
+
+        for (size_t i = 0; i < page_ids.size(); ++i) {
+            disk_manager_->WritePage(page_ids[i], buffer.GetPage(i));
+        }
+
+        if (!page_ids.empty()) {
+            {
+                lock_guard<mutex> lck(instance.latch_);
+                for (page_id_t page_id : page_ids) {
+                    instance.bg_writes_.erase(page_id);
+                }
+            }
+            instance.io_cv_.notify_all();
+        }
+        return page_ids.size();
+    }
+
+/*
+ * Queue a chain for the prefetch thread
+ */
+    void BufferPoolManager::PrefetchChain(page_id_t page_id, size_t count,
+                                          NextPageIdFn next_page_id,
+                                          shared_ptr<BufferRing> ring) {
+        if (page_id == INVALID_PAGE_ID || count == 0) return;
+        QueuePrefetch({page_id, count, next_page_id, move(ring), {}});
+    }
+
+    void BufferPoolManager::PrefetchPages(vector<page_id_t> page_ids,
+                                          shared_ptr<BufferRing> ring) {
+        if (page_ids.empty()) return;
+        size_t count = page_ids.size();
+        QueuePrefetch({INVALID_PAGE_ID, count, nullptr, move(ring), move(page_ids)});
+    }
+
+/*
+ * Queue a request for the prefetch thread, starting the thread on first use
+ */
+    void BufferPoolManager::QueuePrefetch(PrefetchRequest request) {
+        {
+            lock_guard<mutex> lck(prefetch_latch_);
+            if (prefetch_queue_.size() >= PREFETCH_QUEUE_SIZE) return;
+            prefetch_queue_.push_back(move(request));
+            if (prefetch_thread_ == nullptr) {
+                prefetch_running_ = true;
+                prefetch_thread_ = new thread([this] {
+                    unique_lock<mutex> lck(prefetch_latch_);
+                    while (true) {
+                        prefetch_cv_.wait(lck, [this] {
+                            return !prefetch_running_ || !prefetch_queue_.empty();
+                        });
+                        if (!prefetch_running_) break;
+                        PrefetchRequest request = move(prefetch_queue_.front());
+                        prefetch_queue_.pop_front();
+                        prefetch_busy_ = true;
+                        lck.unlock();
+                        RunPrefetch(request);
+                        // may hold the last reference of the ring
+                        request.ring_.reset();
+                        lck.lock();
+                        prefetch_busy_ = false;
+                        prefetch_cv_.notify_all();
+                    }
+                });
+            }
+        }
+        prefetch_cv_.notify_all();
+    }
+
+    void BufferPoolManager::WaitForPrefetch() {
+        unique_lock<mutex> lck(prefetch_latch_);
+        prefetch_cv_.wait(lck, [this] {
+            return prefetch_thread_ == nullptr || (prefetch_queue_.empty() && !prefetch_busy_);
+        });
+    }
+
+/*
+ * Walk the chain like a scan would, reading the pages that are not cached.
+ * Each page is pinned just long enough to read its next page id. Named pages
+ * are fetched as one batch and unpinned right away. Through a ring, no more
+ * than half of the ring's frames are filled ahead, so the prefetched pages
+ * are not recycled before the scan gets to them.
+ */
+    void BufferPoolManager::RunPrefetch(PrefetchRequest &request) {
+        size_t count = request.count_;
+        if (request.ring_ != nullptr) {
+            size_t capacity = 0;
+            for (auto instance : instances_) {
+                lock_guard<mutex> lck(instance->latch_);
+                capacity += GetRingCapacity(*instance, *request.ring_);
+            }
+            count = min(count, capacity / 2);
+        }
+        if (!request.page_ids_.empty()) {
+            vector<page_id_t> &page_ids = request.page_ids_;
+            if (page_ids.size() > count) page_ids.resize(count);
+            vector<Page *> pages;
+            prefetch_reads_ += ReadPages(page_ids, pages, request.ring_.get(), true);
+            for (size_t i = 0; i < page_ids.size(); ++i) {
+                if (pages[i] != nullptr) UnpinPage(page_ids[i], false);
+            }
+            return;
+        }
+        page_id_t page_id = request.page_id_;
+        for (size_t i = 0; i < count && page_id != INVALID_PAGE_ID; ++i) {
+            bool need_read = false;
+            page_id_t old_page_id = INVALID_PAGE_ID;
+            Page *page = ClaimPage(page_id, request.ring_.get(), need_read, old_page_id, true);
+            // every frame is pinned
+            if (page == nullptr) return;
+            if (need_read) {
+                if (old_page_id != INVALID_PAGE_ID) {
+                    disk_manager_->WritePage(old_page_id, page->data_);
+                    NoteVictimWrite();
+                }
+                disk_manager_->ReadPage(page_id, page->data_);
+                FinishIO(GetInstance(page_id), page_id, old_page_id);
+                prefetch_reads_++;
+            }
+            page->RLatch();
+            page_id_t next_page_id = request.next_page_id_(page);
+            page->RUnlatch();
+            UnpinPage(page_id, false);
+            page_id = next_page_id;
+        }
+    }
+
+/*
+ * Stop and join the prefetch thread, dropping the requests still queued
+ */
+    void BufferPoolManager::StopPrefetchThread() {
+        deque<PrefetchRequest> dropped;
+        {
+            lock_guard<mutex> lck(prefetch_latch_);
+            if (prefetch_thread_ == nullptr) return;
+            prefetch_running_ = false;
+            dropped.swap(prefetch_queue_);
+        }
+        prefetch_cv_.notify_all();
+        prefetch_thread_->join();
+        delete prefetch_thread_;
+        prefetch_thread_ = nullptr;
+    }
+
+    WriterStats BufferPoolManager::GetWriterStats() const {
+        return WriterStats{writer_rounds_, writer_pages_written_, victim_writes_};
+    }
+
+/*
+ * A miss paid for a write-back: count it and let the writer catch up early
+ */
+    void BufferPoolManager::NoteVictimWrite() {
+        victim_writes_++;
+        writer_cv_.notify_one();
+    }
+
 //DEBUG
     bool BufferPoolManager::CheckAllUnpined() {
         bool res = true;
@@ -0,0 +1,17 @@
+/**
+ * buffer_ring.cpp
+ */
+#include "buffer/buffer_pool_manager.h"
+#include "buffer/buffer_ring.h"
+
+namespace scudb {
+
+    BufferRing::BufferRing(BufferPoolManager *buffer_pool_manager, size_t ring_size)
+            : buffer_pool_manager_(buffer_pool_manager), ring_size_(ring_size),
+              frames_(buffer_pool_manager->GetNumInstances()), hits_(0), misses_(0) {}
+
+    BufferRing::~BufferRing() {
+        buffer_pool_manager_->ReleaseRing(this);
+    }
+
+} // namespace scudb
@@ -0,0 +1,84 @@
+/**
+ * clock_replacer.cpp
+ */
+#include <cassert>
+
+#include "buffer/clock_replacer.h"
+
+namespace scudb {
+using namespace std;
+
+    ClockReplacer::ClockReplacer(Page *frames, size_t num_frames)
+            : frames_(frames), num_frames_(num_frames), ref_(num_frames, 0),
+              evictable_(num_frames, 0), hand_(0), size_(0) {}
+
+    ClockReplacer::~ClockReplacer() {}
+
+    size_t ClockReplacer::SlotOf(Page *value) const {
+        assert(value >= frames_ && value < frames_ + num_frames_);
+        return static_cast<size_t>(value - frames_);
+    }
+
+/*
+ * Make the frame a candidate for eviction and give it a second chance
+ */
+    void ClockReplacer::Insert(Page *const &value) {
+        lock_guard<mutex> lck(latch_);
+        size_t slot = SlotOf(value);
+        if (!evictable_[slot]) {
+            evictable_[slot] = 1;
+            size_++;
+        }
+        ref_[slot] = 1;
+    }
+
+/*
+ * Sweep the hand over the frames, clearing reference bits, until it reaches
+ * an evictable frame whose bit is already clear. Two full turns are enough
+ * since the first one clears every bit.
+ */
+    bool ClockReplacer::Victim(Page *&value) {
+        lock_guard<mutex> lck(latch_);
+        if (size_ == 0) {
+            return false;
+        }
+        for (size_t step = 0; step < 2 * num_frames_; step++) {
+            size_t slot = hand_;
+            hand_ = (hand_ + 1) % num_frames_;
+            if (!evictable_[slot]) {
+                continue;
+            }
+            if (ref_[slot]) {
+                ref_[slot] = 0;
+                continue;
+            }
+            evictable_[slot] = 0;
+            size_--;
+            value = frames_ + slot;
+            return true;
+        }
+        assert(false);
+        return false;
+    }
+
+/*
+ * Remove the frame from the candidates (it got pinned or deleted)
+ */
+    bool ClockReplacer::Erase(Page *const &value) {
+        lock_guard<mutex> lck(latch_);
+        size_t slot = SlotOf(value);
+        if (!evictable_[slot]) {
+            return false;
+        }
+        evictable_[slot] = 0;
+        ref_[slot] = 0;
+        size_--;
+        return true;
+    }
+
+    size_t ClockReplacer::Size() {
+        lock_guard<mutex> lck(latch_);
+        return size_;
+    }
+
+} // namespace scudb
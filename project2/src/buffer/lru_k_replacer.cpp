@@ -0,0 +1,96 @@
+/**
+ * lru_k_replacer.cpp
+ */
+#include <cassert>
+
+#include "buffer/lru_k_replacer.h"
+
+namespace scudb {
+using namespace std;
+
+    LRUKReplacer::LRUKReplacer(Page *frames, size_t num_frames, size_t k)
+            : frames_(frames), num_frames_(num_frames), k_(k == 0 ? 1 : k),
+              current_ts_(0), history_(num_frames * k_, 0), count_(num_frames, 0),
+              head_(num_frames, 0), evictable_(num_frames, 0), size_(0) {}
+
+    LRUKReplacer::~LRUKReplacer() {}
+
+    size_t LRUKReplacer::SlotOf(Page *value) const {
+        assert(value >= frames_ && value < frames_ + num_frames_);
+        return static_cast<size_t>(value - frames_);
+    }
+
+/*
+ * The buffer pool inserts a frame when its last pin is released, which is
+ * what counts as one access here
+ */
+    void LRUKReplacer::Insert(Page *const &value) {
+        lock_guard<mutex> lck(latch_);
+        size_t slot = SlotOf(value);
+        history_[slot * k_ + head_[slot]] = ++current_ts_;
+        head_[slot] = (head_[slot] + 1) % k_;
+        if (count_[slot] < k_) count_[slot]++;
+        if (!evictable_[slot]) {
+            evictable_[slot] = 1;
+            size_++;
+        }
+    }
+
+/*
+ * Pick the evictable frame with the largest backward K-distance. Frames with
+ * fewer than K accesses win over all the others; within each group the one
+ * whose oldest remembered access is the earliest goes first. The victim's
+ * history is dropped since the frame will hold another page from now on.
+ */
+    bool LRUKReplacer::Victim(Page *&value) {
+        lock_guard<mutex> lck(latch_);
+        if (size_ == 0) {
+            return false;
+        }
+        size_t best = num_frames_;
+        bool best_full = true;
+        uint64_t best_ts = UINT64_MAX;
+        for (size_t slot = 0; slot < num_frames_; slot++) {
+            if (!evictable_[slot]) {
+                continue;
+            }
+            bool full = count_[slot] == k_;
+            // once the ring is full head_ points at the oldest entry
+            uint64_t oldest = history_[slot * k_ + (full ? head_[slot] : 0)];
+            if (best == num_frames_ || (best_full && !full) ||
+                (best_full == full && oldest < best_ts)) {
+                best = slot;
+                best_full = full;
+                best_ts = oldest;
+            }
+        }
+        assert(best != num_frames_);
+        evictable_[best] = 0;
+        count_[best] = 0;
+        head_[best] = 0;
+        size_--;
+        value = frames_ + best;
+        return true;
+    }
+
+/*
+ * Remove the frame from the candidates (it got pinned or deleted), its access
+ * history is kept for when it is released again
+ */
+    bool LRUKReplacer::Erase(Page *const &value) {
+        lock_guard<mutex> lck(latch_);
+        size_t slot = SlotOf(value);
+        if (!evictable_[slot]) {
+            return false;
+        }
+        evictable_[slot] = 0;
+        size_--;
+        return true;
+    }
+
+    size_t LRUKReplacer::Size() {
+        lock_guard<mutex> lck(latch_);
+        return size_;
+    }
+
+} // namespace scudb
@@ -83,7 +83,7 @@ using namespace  std;
 
     template <typename T> size_t LRUReplacer<T>::Size() {
         lock_guard<mutex> lck(mLatch);
-        return 1;//mDataMap.size();
+        return mDataMap.size();
     }
 
     template class LRUReplacer<Page *>;
@@ -0,0 +1,30 @@
+/**
+ * read_ahead.cpp
+ */
+#include "buffer/buffer_pool_manager.h"
+#include "buffer/read_ahead.h"
+
+namespace scudb {
+
+/*
+ * Request a window of depth pages starting right after the current one, and
+ * a new window once half of it has been used up. The prefetcher finds the
+ * pages already read in the pool, so overlapping windows cost little. A
+ * window that can be named is read as one batch, otherwise as a chain.
+ */
+    void ReadAhead::Advance(page_id_t next_page_id, NextPageIdFn next_fn,
+                            const std::shared_ptr<BufferRing> &ring) {
+        if (ahead_ > 0) ahead_--;
+        if (++run_ < PREFETCH_TRIGGER) return;
+        size_t depth = buffer_pool_manager_->GetPrefetchDepth();
+        if (depth == 0 || next_page_id == INVALID_PAGE_ID || ahead_ > depth / 2) return;
+        std::vector<page_id_t> page_ids;
+        if (window_ && window_(next_page_id, depth, page_ids)) {
+            buffer_pool_manager_->PrefetchPages(std::move(page_ids), ring);
+        } else {
+            buffer_pool_manager_->PrefetchChain(next_page_id, depth, next_fn, ring);
+        }
+        ahead_ = depth;
+    }
+
+} // namespace scudb
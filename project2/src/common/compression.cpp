@@ -0,0 +1,105 @@
+/**
+ * compression.cpp
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "common/compression.h"
+
+namespace scudb {
+
+static const int LZ_MIN_MATCH = 3;
+static const int LZ_LONG_MATCH = 18;
+static const int LZ_MAX_MATCH = LZ_LONG_MATCH + 255;
+static const int LZ_MAX_DISTANCE = 4095;
+static const int LZ_HASH_BITS = 12;
+
+static inline uint32_t LzHash(const char *p) {
+  uint32_t v = 0;
+  memcpy(&v, p, 3);
+  v &= 0xffffff;
+  return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/*
+ * Matches are looked for at the last position the next three bytes hashed
+ * to, a group is only started when its worst case (all matches) fits.
+ */
+int LzCompress(const char *src, int size, char *dst, int capacity) {
+  int table[1 << LZ_HASH_BITS];
+  for (auto &position : table)
+    position = -1;
+  int ip = 0, op = 0;
+  while (ip < size) {
+    if (op + 1 + 8 * 3 > capacity)
+      return -1;
+    int control_pos = op++;
+    uint8_t control = 0;
+    for (int bit = 0; bit < 8 && ip < size; bit++) {
+      int length = 0, candidate = -1;
+      if (ip + LZ_MIN_MATCH <= size) {
+        uint32_t hash = LzHash(src + ip);
+        candidate = table[hash];
+        table[hash] = ip;
+        if (candidate >= 0 && ip - candidate <= LZ_MAX_DISTANCE &&
+            memcmp(src + candidate, src + ip, LZ_MIN_MATCH) == 0) {
+          length = LZ_MIN_MATCH;
+          while (length < LZ_MAX_MATCH && ip + length < size &&
+                 src[candidate + length] == src[ip + length])
+            length++;
+        }
+      }
+      if (length >= LZ_MIN_MATCH) {
+        int distance = ip - candidate;
+        int code = std::min(length, LZ_LONG_MATCH) - LZ_MIN_MATCH;
+        dst[op++] = static_cast<char>(distance >> 4);
+        dst[op++] = static_cast<char>(((distance & 0xf) << 4) | code);
+        if (length >= LZ_LONG_MATCH)
+          dst[op++] = static_cast<char>(length - LZ_LONG_MATCH);
+        control |= 1 << bit;
+        ip += length;
+      } else {
+        dst[op++] = src[ip++];
+      }
+    }
+    dst[control_pos] = static_cast<char>(control);
+  }
+  return op;
+}
+
+bool LzDecompress(const char *src, int size, char *dst, int raw_size) {
+  int ip = 0, op = 0;
+  while (ip < size) {
+    uint8_t control = static_cast<uint8_t>(src[ip++]);
+    for (int bit = 0; bit < 8 && ip < size; bit++) {
+      if (control & (1 << bit)) {
+        if (ip + 2 > size)
+          return false;
+        uint8_t high = static_cast<uint8_t>(src[ip]);
+        uint8_t low = static_cast<uint8_t>(src[ip + 1]);
+        ip += 2;
+        int distance = (high << 4) | (low >> 4);
+        int length = (low & 0xf) + LZ_MIN_MATCH;
+        if (length == LZ_LONG_MATCH) {
+          if (ip == size)
+            return false;
+          length += static_cast<uint8_t>(src[ip++]);
+        }
+        if (distance == 0 || distance > op || op + length > raw_size)
+          return false;
+        // byte by byte, a match may overlap what it copies
+        for (int i = 0; i < length; i++, op++)
+          dst[op] = dst[op - distance];
+      } else {
+        if (op == raw_size)
+          return false;
+        dst[op++] = src[ip++];
+      }
+    }
+  }
+  return op == raw_size;
+}
+
+} // namespace scudb
@@ -0,0 +1,95 @@
+/**
+ * rwlatch.cpp
+ */
+
+#include <climits>
+#include <thread>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "common/config.h"
+#include "common/rwlatch.h"
+
+namespace scudb {
+
+static inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#endif
+}
+
+/*
+ * A waiting writer is counted in the word from the start, which holds off
+ * new readers, and takes the latch once the current readers are gone.
+ */
+void RWLatch::WLockSlow() {
+  uint32_t state = state_.fetch_add(ONE_WAITING_WRITER, std::memory_order_relaxed);
+  for (int spins = 0;; spins++) {
+    if ((state & (WRITER | READERS)) == 0) {
+      if (state_.compare_exchange_weak(state,
+                                       (state - ONE_WAITING_WRITER) | WRITER,
+                                       std::memory_order_acquire))
+        return;
+      continue;
+    }
+    if (spins < LATCH_SPIN_COUNT) {
+      CpuRelax();
+    } else {
+      Park(state);
+    }
+    state = state_.load(std::memory_order_relaxed);
+  }
+}
+
+void RWLatch::RLockSlow() {
+  uint32_t state = state_.load(std::memory_order_relaxed);
+  for (int spins = 0;; spins++) {
+    if ((state & (WRITER | WAITING_WRITERS)) == 0 && (state & READERS) != READERS) {
+      if (state_.compare_exchange_weak(state, state + 1,
+                                       std::memory_order_acquire))
+        return;
+      continue;
+    }
+    if (spins < LATCH_SPIN_COUNT) {
+      CpuRelax();
+    } else {
+      Park(state);
+    }
+    state = state_.load(std::memory_order_relaxed);
+  }
+}
+
+/*
+ * The PARKED bit tells the unlocking thread to wake the word up. Any change
+ * of the word after state was read, an unlock included, makes the wait return
+ * at once, so no wake up is lost.
+ */
+void RWLatch::Park(uint32_t state) {
+  if (!(state & PARKED)) {
+    if (!state_.compare_exchange_strong(state, state | PARKED,
+                                        std::memory_order_relaxed))
+      return;
+    state |= PARKED;
+  }
+#ifdef __linux__
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&state_), FUTEX_WAIT_PRIVATE,
+          state, nullptr, nullptr, 0);
+#else
+  std::this_thread::yield();
+#endif
+}
+
+void RWLatch::Wake() {
+  if (!(state_.fetch_and(~PARKED, std::memory_order_relaxed) & PARKED))
+    return;
+#ifdef __linux__
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&state_), FUTEX_WAKE_PRIVATE,
+          INT_MAX, nullptr, nullptr, 0);
+#endif
+}
+
+} // namespace scudb
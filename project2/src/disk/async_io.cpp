@@ -0,0 +1,378 @@
+/**
+ * async_io.cpp
+ */
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define SCUDB_HAVE_IO_URING 1
+#endif
+#endif
+
+#include "common/logger.h"
+#include "disk/async_io.h"
+#include "disk/disk_manager.h"
+
+namespace scudb {
+
+/*****************************************************************************
+ * COMMON
+ *****************************************************************************/
+size_t AsyncIOEngine::PollCompletions(std::vector<uint64_t> &tags,
+                                      size_t min_complete) {
+  std::unique_lock<std::mutex> lck(latch_);
+  Reap(lck, false);
+  while (completed_.size() < min_complete) {
+    Reap(lck, true);
+  }
+  size_t count = completed_.size();
+  tags.insert(tags.end(), completed_.begin(), completed_.end());
+  completed_.clear();
+  return count;
+}
+
+void AsyncIOEngine::WaitFor(const std::vector<uint64_t> &tags) {
+  std::unique_lock<std::mutex> lck(latch_);
+  Reap(lck, false);
+  for (uint64_t tag : tags) {
+    while (completed_.count(tag) == 0) {
+      Reap(lck, true);
+    }
+    completed_.erase(tag);
+  }
+}
+
+/*****************************************************************************
+ * THREAD POOL
+ *****************************************************************************/
+ThreadPoolEngine::ThreadPoolEngine(DiskManager *disk_manager,
+                                   size_t num_threads)
+    : disk_manager_(disk_manager), stop_(false) {
+  for (size_t i = 0; i < std::max<size_t>(1, num_threads); ++i) {
+    threads_.push_back(std::thread(&ThreadPoolEngine::Work, this));
+  }
+}
+
+ThreadPoolEngine::~ThreadPoolEngine() {
+  {
+    std::lock_guard<std::mutex> lck(latch_);
+    stop_ = true;
+  }
+  queue_cv_.notify_all();
+  for (auto &thread : threads_) {
+    thread.join();
+  }
+}
+
+void ThreadPoolEngine::Submit(const std::vector<AsyncIORequest> &requests) {
+  {
+    std::lock_guard<std::mutex> lck(latch_);
+    queue_.insert(queue_.end(), requests.begin(), requests.end());
+  }
+  queue_cv_.notify_all();
+}
+
+void ThreadPoolEngine::Reap(std::unique_lock<std::mutex> &lck, bool wait) {
+  // workers publish completions themselves
+  if (wait) {
+    cv_.wait(lck);
+  }
+}
+
+// run queued requests until stopped, the queue is drained before leaving
+void ThreadPoolEngine::Work() {
+  std::unique_lock<std::mutex> lck(latch_);
+  while (true) {
+    queue_cv_.wait(lck, [this] { return stop_ || !queue_.empty(); });
+    if (queue_.empty()) {
+      return;
+    }
+    AsyncIORequest request = queue_.front();
+    queue_.pop_front();
+    lck.unlock();
+
+    if (request.is_write_) {
+      disk_manager_->WritePage(request.page_id_, request.data_);
+    } else {
+      disk_manager_->ReadPage(request.page_id_, request.data_);
+    }
+
+    lck.lock();
+    completed_.insert(request.tag_);
+    cv_.notify_all();
+  }
+}
+
+/*****************************************************************************
+ * IO_URING
+ *****************************************************************************/
+#ifdef SCUDB_HAVE_IO_URING
+
+static int IOUringEnter(int ring_fd, unsigned to_submit, unsigned min_complete,
+                        unsigned flags) {
+  int rc;
+  do {
+    rc = syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags,
+                 nullptr, 0);
+  } while (rc < 0 && errno == EINTR);
+  return rc;
+}
+
+IOUringEngine::IOUringEngine(DiskManager *disk_manager, int fd,
+                             unsigned entries)
+    : disk_manager_(disk_manager), fd_(fd), ring_fd_(-1), entries_(0),
+      sq_ring_(MAP_FAILED), sq_ring_size_(0), sqes_(MAP_FAILED), sqes_size_(0),
+      cq_ring_(MAP_FAILED), cq_ring_size_(0), reaping_(false) {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring_fd_ = syscall(__NR_io_uring_setup, entries, &params);
+  if (ring_fd_ < 0) {
+    LOG_DEBUG("io_uring is not available");
+    ring_fd_ = -1;
+    return;
+  }
+  entries_ = params.sq_entries;
+
+  // map the rings, newer kernels share one mapping for both
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) {
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+  }
+  sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (sq_ring_ != MAP_FAILED) {
+    cq_ring_ = single_mmap
+                   ? sq_ring_
+                   : mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, ring_fd_,
+                          IORING_OFF_CQ_RING);
+  }
+  sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  if (cq_ring_ != MAP_FAILED) {
+    sqes_ = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  }
+  if (sqes_ == MAP_FAILED) {
+    LOG_DEBUG("can't map io_uring rings");
+    Close();
+    return;
+  }
+
+  char *sq = static_cast<char *>(sq_ring_);
+  sq_head_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+  sq_mask_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+  char *cq = static_cast<char *>(cq_ring_);
+  cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+  cq_mask_ = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+  cqes_ = cq + params.cq_off.cqes;
+
+  slots_.resize(entries_);
+  iovecs_.resize(entries_);
+  for (unsigned i = 0; i < entries_; ++i) {
+    free_slots_.push_back(i);
+  }
+}
+
+IOUringEngine::~IOUringEngine() { Close(); }
+
+void IOUringEngine::Close() {
+  if (sqes_ != MAP_FAILED) {
+    munmap(sqes_, sqes_size_);
+  }
+  if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  if (sq_ring_ != MAP_FAILED) {
+    munmap(sq_ring_, sq_ring_size_);
+  }
+  if (ring_fd_ >= 0) {
+    close(ring_fd_);
+  }
+  ring_fd_ = -1;
+  sq_ring_ = cq_ring_ = sqes_ = MAP_FAILED;
+}
+
+/*
+ * Fill one sqe per request and hand them all to the kernel with a single
+ * io_uring_enter. When every slot is in flight, what is queued so far is
+ * submitted and we wait for completions to free slots up.
+ */
+void IOUringEngine::Submit(const std::vector<AsyncIORequest> &requests) {
+  std::unique_lock<std::mutex> lck(latch_);
+  unsigned tail = *sq_tail_;
+  unsigned pending = 0;
+  auto sqes = static_cast<struct io_uring_sqe *>(sqes_);
+  for (const AsyncIORequest &request : requests) {
+    while (free_slots_.empty()) {
+      if (pending != 0) {
+        __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+        SubmitQueued(lck);
+        pending = 0;
+      }
+      if (free_slots_.empty()) {
+        Reap(lck, true);
+      }
+      // the latch may have been let go of, another Submit moved the tail
+      tail = *sq_tail_;
+    }
+    unsigned idx = free_slots_.back();
+    free_slots_.pop_back();
+    slots_[idx].request_ = request;
+    iovecs_[idx].iov_base = request.data_;
+    iovecs_[idx].iov_len = PAGE_SIZE;
+
+    unsigned pos = tail & *sq_mask_;
+    struct io_uring_sqe *sqe = &sqes[pos];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = request.is_write_ ? IORING_OP_WRITEV : IORING_OP_READV;
+    sqe->fd = fd_;
+    sqe->addr = reinterpret_cast<uint64_t>(&iovecs_[idx]);
+    sqe->len = 1;
+    sqe->off = static_cast<uint64_t>(request.page_id_) * PAGE_SIZE;
+    sqe->user_data = idx;
+    sq_array_[pos] = pos;
+    tail++;
+    pending++;
+  }
+  if (pending != 0) {
+    __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+    SubmitQueued(lck);
+  }
+}
+
+/*
+ * The kernel may take fewer sqes than asked, the rest is entered again.
+ * EAGAIN/EBUSY mean it is short of resources or its completion queue is
+ * full: completions are reaped to make room, as long as some are to come.
+ * On any other error, or with nothing in flight, the sqes left are taken
+ * back out of the queue and their requests run synchronously instead, so
+ * that nobody waits for them forever.
+ */
+void IOUringEngine::SubmitQueued(std::unique_lock<std::mutex> &lck) {
+  while (true) {
+    unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    unsigned queued = *sq_tail_ - head;
+    if (queued == 0) {
+      return;
+    }
+    int rc = IOUringEnter(ring_fd_, queued, 0, 0);
+    if (rc > 0) {
+      continue;
+    }
+    unsigned in_flight = entries_ - free_slots_.size() - queued;
+    if ((rc == 0 || errno == EAGAIN || errno == EBUSY) && in_flight != 0) {
+      Reap(lck, true);
+      continue;
+    }
+    LOG_DEBUG("io_uring_enter failed, running the requests synchronously");
+    auto sqes = static_cast<struct io_uring_sqe *>(sqes_);
+    __atomic_store_n(sq_tail_, head, __ATOMIC_RELEASE);
+    for (unsigned i = 0; i < queued; ++i) {
+      unsigned idx =
+          static_cast<unsigned>(sqes[(head + i) & *sq_mask_].user_data);
+      const AsyncIORequest &request = slots_[idx].request_;
+      if (request.is_write_) {
+        disk_manager_->WritePage(request.page_id_, request.data_);
+      } else {
+        disk_manager_->ReadPage(request.page_id_, request.data_);
+      }
+      // the disk manager already took care of the file size and short reads
+      completed_.insert(request.tag_);
+      free_slots_.push_back(idx);
+    }
+    cv_.notify_all();
+    return;
+  }
+}
+
+/*
+ * Only one thread sleeps in io_uring_enter, the others wait for it to
+ * publish what it reaped
+ */
+void IOUringEngine::Reap(std::unique_lock<std::mutex> &lck, bool wait) {
+  if (ReapCompletionQueue() || !wait) {
+    return;
+  }
+  if (reaping_) {
+    cv_.wait(lck);
+    return;
+  }
+  reaping_ = true;
+  lck.unlock();
+  IOUringEnter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS);
+  lck.lock();
+  reaping_ = false;
+  ReapCompletionQueue();
+  cv_.notify_all();
+}
+
+// with latch_ held: move every cqe into completed_
+bool IOUringEngine::ReapCompletionQueue() {
+  unsigned head = *cq_head_;
+  unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+  if (head == tail) {
+    return false;
+  }
+  auto cqes = static_cast<struct io_uring_cqe *>(cqes_);
+  for (; head != tail; ++head) {
+    struct io_uring_cqe *cqe = &cqes[head & *cq_mask_];
+    unsigned idx = static_cast<unsigned>(cqe->user_data);
+    const AsyncIORequest &request = slots_[idx].request_;
+    int res = cqe->res;
+    if (request.is_write_) {
+      if (res != PAGE_SIZE) {
+        LOG_DEBUG("I/O error while writing");
+      } else {
+        disk_manager_->GrowFileSize(
+            static_cast<long long>(request.page_id_ + 1) * PAGE_SIZE);
+      }
+    } else {
+      // the file ends before the page does
+      if (res < 0) {
+        LOG_DEBUG("I/O error while reading");
+        res = 0;
+      }
+      if (res < PAGE_SIZE) {
+        memset(request.data_ + res, 0, PAGE_SIZE - res);
+      }
+    }
+    completed_.insert(request.tag_);
+    free_slots_.push_back(idx);
+  }
+  __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+  cv_.notify_all();
+  return true;
+}
+
+#else
+
+IOUringEngine::IOUringEngine(DiskManager *disk_manager, int fd,
+                             unsigned entries)
+    : disk_manager_(disk_manager), fd_(fd), ring_fd_(-1), entries_(entries),
+      reaping_(false) {}
+
+IOUringEngine::~IOUringEngine() {}
+
+void IOUringEngine::Close() {}
+
+void IOUringEngine::Submit(const std::vector<AsyncIORequest> &) {}
+
+void IOUringEngine::Reap(std::unique_lock<std::mutex> &, bool) {}
+
+bool IOUringEngine::ReapCompletionQueue() { return false; }
+
+#endif
+
+} // namespace scudb
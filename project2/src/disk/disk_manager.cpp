@@ -1,26 +1,101 @@
 /**
  * disk_manager.cpp
  */
+#include <algorithm>
 #include <assert.h>
+#include <cerrno>
 #include <cstring>
+#include <fcntl.h>
 #include <iostream>
 #include <sys/stat.h>
 #include <thread>
+#include <unistd.h>
 
 #include "common/logger.h"
 #include "disk/disk_manager.h"
+#include "disk/page_buffer.h"
+#include "page/header_page.h"
 
 namespace scudb {
 
 static char *buffer_used = nullptr;
 
+// disk managers that set PAGE_SIZE and are still open
+static std::mutex page_size_latch;
+static int page_size_users = 0;
+
+/**
+ * pwrite/pread may transfer less than asked for, keep going until done
+ * @return: bytes transferred, short only at end of file or on error
+ */
+static ssize_t PwriteAll(int fd, const char *data, size_t size, off_t offset) {
+  size_t done = 0;
+  while (done < size) {
+    ssize_t n = pwrite(fd, data + done, size - done, offset + done);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      break;
+    done += n;
+  }
+  return done;
+}
+
+static ssize_t PreadAll(int fd, char *data, size_t size, off_t offset) {
+  size_t done = 0;
+  while (done < size) {
+    ssize_t n = pread(fd, data + done, size - done, offset + done);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      break;
+    done += n;
+  }
+  return done;
+}
+
 /**
  * Constructor: open/create a single database file & log file
  * @input db_file: database file name
+ * @input io_mode: fstream, pread/pwrite or O_DIRECT access to the db file
+ * @input page_size: page size of a new db file, an existing one keeps the
+ * size recorded in its header page. Sets PAGE_SIZE, the file is not opened
+ * when other open files use another page size.
  */
-DiskManager::DiskManager(const std::string &db_file)
-    : file_name_(db_file), next_page_id_(0), num_flushes_(0), flush_log_(false),
+DiskManager::DiskManager(const std::string &db_file, DiskIOMode io_mode,
+                         int page_size)
+    : file_name_(db_file), io_mode_(io_mode), db_fd_(-1), db_file_size_(0),
+      direct_io_align_(1),
+      async_io_(nullptr), next_io_tag_(0),
+      next_page_id_(0), holds_page_size_(false), num_flushes_(0),
+      flush_log_(false),
       flush_log_f_(nullptr) {
+  char header[HeaderPage::STORED_PAGE_SIZE_END];
+  int fd = open(db_file.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    ssize_t read_count = PreadAll(fd, header, sizeof(header), 0);
+    int stored_page_size = HeaderPage::GetStoredPageSize(header, read_count);
+    if (IsValidPageSize(stored_page_size)) {
+      page_size = stored_page_size;
+    }
+    close(fd);
+  }
+  if (!IsValidPageSize(page_size)) {
+    LOG_DEBUG("invalid page size, using the default");
+    page_size = DEFAULT_PAGE_SIZE;
+  }
+  {
+    std::lock_guard<std::mutex> lock(page_size_latch);
+    if (page_size_users > 0 && page_size != PAGE_SIZE) {
+      // frames and pages of the open files are sized with PAGE_SIZE
+      LOG_DEBUG("page size differs from the open db files, not opening");
+      return;
+    }
+    PAGE_SIZE = page_size;
+    page_size_users++;
+    holds_page_size_ = true;
+  }
+
   std::string::size_type n = file_name_.find(".");
   if (n == std::string::npos) {
     LOG_DEBUG("wrong file format");
@@ -42,6 +117,24 @@ DiskManager::DiskManager(const std::string &db_file)
                                 std::ios::out);
   }
 
+  if (io_mode_ == DiskIOMode::DIRECT && !OpenDirect(db_file)) {
+    LOG_DEBUG("no direct I/O for db file, using pread/pwrite");
+    io_mode_ = DiskIOMode::POSITIONAL;
+  }
+  if (IsPositional()) {
+    if (db_fd_ < 0)
+      db_fd_ = open(db_file.c_str(), O_RDWR | O_CREAT, 0644);
+    if (db_fd_ < 0) {
+      LOG_DEBUG("can't open db file");
+      return;
+    }
+    struct stat stat_buf;
+    if (fstat(db_fd_, &stat_buf) == 0) {
+      db_file_size_ = stat_buf.st_size;
+    }
+    return;
+  }
+
   db_io_.open(db_file,
               std::ios::binary | std::ios::in | std::ios::out | std::ios::out);
   // directory or file does not exist
@@ -55,15 +148,77 @@ DiskManager::DiskManager(const std::string &db_file)
   }
 }
 
+/**
+ * Open the db file with O_DIRECT and learn the alignment it needs. Fails if
+ * the file system has no direct I/O, or if that alignment does not divide
+ * PAGE_SIZE: single pages could not be transferred directly then.
+ */
+bool DiskManager::OpenDirect(const std::string &db_file) {
+#ifdef O_DIRECT
+  db_fd_ = open(db_file.c_str(), O_RDWR | O_CREAT | O_DIRECT, 0644);
+  if (db_fd_ < 0)
+    return false;
+  // the traditional sector size when the kernel cannot tell
+  size_t mem_align = 512;
+  size_t offset_align = 512;
+#ifdef STATX_DIOALIGN
+  struct statx stx;
+  if (statx(db_fd_, "", AT_EMPTY_PATH, STATX_DIOALIGN, &stx) == 0 &&
+      (stx.stx_mask & STATX_DIOALIGN) != 0) {
+    mem_align = stx.stx_dio_mem_align;
+    offset_align = stx.stx_dio_offset_align;
+  }
+#endif
+  direct_io_align_ = std::max(mem_align, offset_align);
+  if (mem_align == 0 || PAGE_SIZE % direct_io_align_ != 0 ||
+      DIRECT_IO_ALIGNMENT % direct_io_align_ != 0) {
+    close(db_fd_);
+    db_fd_ = -1;
+    return false;
+  }
+  return true;
+#else
+  (void)db_file;
+  return false;
+#endif
+}
+
+bool DiskManager::IsValidPageSize(int page_size) {
+  return page_size >= MIN_PAGE_SIZE && page_size <= MAX_PAGE_SIZE &&
+         (page_size & (page_size - 1)) == 0;
+}
+
+bool DiskManager::IsAligned(const char *data) const {
+  return io_mode_ != DiskIOMode::DIRECT ||
+         reinterpret_cast<uintptr_t>(data) % direct_io_align_ == 0;
+}
+
 DiskManager::~DiskManager() {
+  delete async_io_;
+  if (db_fd_ >= 0) {
+    close(db_fd_);
+  }
   db_io_.close();
   log_io_.close();
+  if (holds_page_size_) {
+    std::lock_guard<std::mutex> lock(page_size_latch);
+    page_size_users--;
+  }
+}
+
+bool DiskManager::IsOpen() const {
+  return IsPositional() ? db_fd_ >= 0 : db_io_.is_open();
 }
 
 /**
  * Write the contents of the specified page into disk file
  */
 void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
+  if (IsPositional()) {
+    WritePages(page_id, page_data, 1);
+    return;
+  }
+  std::lock_guard<std::mutex> guard(db_io_latch_);
   size_t offset = page_id * PAGE_SIZE;
   // set write cursor to offset
   db_io_.seekp(offset);
@@ -77,10 +232,63 @@ void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
   db_io_.flush();
 }
 
+/**
+ * Write a run of consecutive pages with a single seek, write and flush
+ */
+void DiskManager::WritePages(page_id_t page_id, const char *pages_data,
+                             int num_pages) {
+  size_t offset = static_cast<size_t>(page_id) * PAGE_SIZE;
+  if (IsPositional()) {
+    size_t size = static_cast<size_t>(num_pages) * PAGE_SIZE;
+    if (!IsAligned(pages_data)) {
+      PageBuffer bounce(num_pages);
+      memcpy(bounce.GetData(), pages_data, size);
+      WritePages(page_id, bounce.GetData(), num_pages);
+      return;
+    }
+    if (PwriteAll(db_fd_, pages_data, size, offset) !=
+        static_cast<ssize_t>(size)) {
+      LOG_DEBUG("I/O error while writing");
+      return;
+    }
+    GrowFileSize(offset + size);
+    return;
+  }
+  std::lock_guard<std::mutex> guard(db_io_latch_);
+  db_io_.seekp(offset);
+  db_io_.write(pages_data, static_cast<std::streamsize>(num_pages) * PAGE_SIZE);
+  if (db_io_.bad()) {
+    LOG_DEBUG("I/O error while writing");
+    return;
+  }
+  db_io_.flush();
+}
+
 /**
  * Read the contents of the specified page into the given memory area
  */
 void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
+  if (IsPositional()) {
+    if (!IsAligned(page_data)) {
+      PageBuffer bounce(1);
+      ReadPage(page_id, bounce.GetData());
+      memcpy(page_data, bounce.GetData(), PAGE_SIZE);
+      return;
+    }
+    long long offset = static_cast<long long>(page_id) * PAGE_SIZE;
+    if (offset > db_file_size_) {
+      LOG_DEBUG("I/O error while reading");
+      return;
+    }
+    ssize_t read_count = PreadAll(db_fd_, page_data, PAGE_SIZE, offset);
+    // if file ends before reading PAGE_SIZE
+    if (read_count < PAGE_SIZE) {
+      LOG_DEBUG("Read less than a page");
+      memset(page_data + read_count, 0, PAGE_SIZE - read_count);
+    }
+    return;
+  }
+  std::lock_guard<std::mutex> guard(db_io_latch_);
   int offset = page_id * PAGE_SIZE;
   // check if read beyond file length
   if (offset > GetFileSize(file_name_)) {
@@ -100,6 +308,74 @@ void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
   }
 }
 
+uint64_t DiskManager::SubmitRead(page_id_t page_id, char *page_data) {
+  std::vector<AsyncIORequest> requests{{false, page_id, page_data, 0}};
+  SubmitBatch(requests);
+  return requests[0].tag_;
+}
+
+uint64_t DiskManager::SubmitWrite(page_id_t page_id, const char *page_data) {
+  std::vector<AsyncIORequest> requests{
+      {true, page_id, const_cast<char *>(page_data), 0}};
+  SubmitBatch(requests);
+  return requests[0].tag_;
+}
+
+/**
+ * Tag and submit all the requests in one go
+ */
+void DiskManager::SubmitBatch(std::vector<AsyncIORequest> &requests) {
+  for (auto &request : requests) {
+    assert(IsAligned(request.data_));
+    request.tag_ = next_io_tag_++;
+  }
+  GetAsyncIO()->Submit(requests);
+}
+
+size_t DiskManager::PollCompletions(std::vector<uint64_t> &tags,
+                                    size_t min_complete) {
+  return GetAsyncIO()->PollCompletions(tags, min_complete);
+}
+
+void DiskManager::WaitFor(const std::vector<uint64_t> &tags) {
+  GetAsyncIO()->WaitFor(tags);
+}
+
+const char *DiskManager::GetAsyncIOEngineName() {
+  return GetAsyncIO()->GetName();
+}
+
+/**
+ * io_uring needs the file descriptor of POSITIONAL/DIRECT mode, everything
+ * else goes to the thread pool. A STREAM disk manager serialises its I/O
+ * anyway, so one worker is enough there.
+ */
+AsyncIOEngine *DiskManager::GetAsyncIO() {
+  std::call_once(async_io_once_, [this] {
+    if (IsPositional() && db_fd_ >= 0) {
+      auto uring = new IOUringEngine(this, db_fd_, ASYNC_IO_QUEUE_DEPTH);
+      if (uring->IsOpen()) {
+        async_io_ = uring;
+        return;
+      }
+      delete uring;
+      async_io_ = new ThreadPoolEngine(this, ASYNC_IO_THREADS);
+    } else {
+      async_io_ = new ThreadPoolEngine(this, 1);
+    }
+  });
+  return async_io_;
+}
+
+/**
+ * Grow the cached file size, racing writers only ever make it larger
+ */
+void DiskManager::GrowFileSize(long long size) {
+  long long cur = db_file_size_;
+  while (cur < size && !db_file_size_.compare_exchange_weak(cur, size)) {
+  }
+}
+
 /**
  * Write the contents of the log into disk file
  * Only return when sync is done, and only perform sequence write
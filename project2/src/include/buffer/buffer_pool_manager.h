@@ -4,44 +4,215 @@
  * Functionality: The simplified Buffer Manager interface allows a client to
  * new/delete pages on disk, to read a disk page into the buffer pool and pin
  * it, also to unpin a page in the buffer pool.
+ *
+ * The pool can be split into several independent instances. A page_id is
+ * always served by the instance picked by hashing it, and every instance has
+ * its own page table, replacer, free list and latch, so threads working on
+ * different pages rarely contend with each other.
+ * The replacement policy (LRU list, CLOCK or LRU-K) is picked at construction.
+ * Sequential scans can fetch through a BufferRing to keep their pages out of
+ * the replacer.
+ * An optional background writer flushes dirty unpinned pages ahead of time so
+ * that misses mostly find clean victims and skip the write-back.
+ * Checkpoint/FlushAllPages write the dirty pages in page id order, merging
+ * neighbours into sequential runs.
+ * The data of all frames lives in one PageBuffer aligned for O_DIRECT, so a
+ * DIRECT mode disk manager reads and writes the frames in place.
+ * A prefetch thread, started on first use, reads page chains (linked through
+ * their next page ids) ahead of sequential scans, see ReadAhead. Pages a scan
+ * can name in advance are read as one batch, like FetchPages does.
  */
 
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <list>
+#include <memory>
 #include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
 
+#include "buffer/buffer_ring.h"
+#include "buffer/clock_replacer.h"
+#include "buffer/lru_k_replacer.h"
 #include "buffer/lru_replacer.h"
+#include "buffer/read_ahead.h"
 #include "disk/disk_manager.h"
+#include "disk/page_buffer.h"
 #include "hash/extendible_hash.h"
 #include "logging/log_manager.h"
 #include "page/page.h"
 
 namespace scudb {
+// counters of the background page writer
+struct WriterStats {
+    size_t rounds_;        // passes over the pool
+    size_t pages_written_; // dirty pages cleaned by the writer
+    size_t victim_writes_; // dirty victims FetchPage/NewPage still had to write
+};
+
 class BufferPoolManager {
+    friend class BufferRing;
+
 public:
     BufferPoolManager(size_t pool_size, DiskManager *disk_manager,
-                      LogManager *log_manager = nullptr);
+                      LogManager *log_manager = nullptr,
+                      size_t num_instances = 1,
+                      ReplacerType replacer_type = ReplacerType::CLOCK);
     ~BufferPoolManager();
-    Page *FetchPage(page_id_t page_id);
+    Page *FetchPage(page_id_t page_id, BufferRing *ring = nullptr);
+    // fetch (and pin) several pages, reading all the misses together
+    bool FetchPages(const std::vector<page_id_t> &page_ids,
+                    std::vector<Page *> &pages, BufferRing *ring = nullptr);
     bool UnpinPage(page_id_t page_id, bool is_dirty);
     bool FlushPage(page_id_t page_id);
+    // fuzzy checkpoint: write every page dirty when the call starts, returns
+    // the pages written. Fetches only wait while a single page is copied.
+    size_t Checkpoint();
+    // checkpoint until no dirty page is left, returns the pages written
+    size_t FlushAllPages();
     Page *NewPage(page_id_t &page_id);
     bool DeletePage(page_id_t page_id);
 
     bool CheckAllUnpined();
 
+    inline size_t GetPoolSize() const { return pool_size_; }
+    inline size_t GetNumInstances() const { return instances_.size(); }
+    // FetchPage calls served from the pool / that had to read from disk
+    size_t GetHitCount();
+    size_t GetMissCount();
+
+    // background page writer, wakes up every interval (or when a miss had
+    // to write a dirty victim) and runs one WriterRound
+    void RunWriterThread();
+    void StopWriterThread();
+    // clean, unpinned frames the writer tries to keep, as a share of the pool
+    inline void SetWriterTargetCleanRatio(double ratio) { writer_clean_ratio_ = ratio; }
+    // most pages written per instance and round
+    inline void SetWriterBatchSize(size_t batch_size) { writer_batch_size_ = batch_size; }
+    inline void SetWriterInterval(std::chrono::milliseconds interval) {
+        writer_interval_ms_ = interval.count();
+    }
+    // one pass of the writer over every instance, returns the pages written
+    size_t WriterRound();
+    WriterStats GetWriterStats() const;
+
+    // read up to count pages of the chain starting at page_id into the pool
+    // in the background, following the links returned by next_page_id.
+    // Dropped when too many requests are waiting already
+    void PrefetchChain(page_id_t page_id, size_t count, NextPageIdFn next_page_id,
+                       std::shared_ptr<BufferRing> ring = nullptr);
+    // read page_ids into the pool in the background, all the misses together
+    // as in FetchPages. Dropped like a chain when too many requests wait
+    void PrefetchPages(std::vector<page_id_t> page_ids,
+                       std::shared_ptr<BufferRing> ring = nullptr);
+    // block until every prefetch request is done
+    void WaitForPrefetch();
+    // pages ReadAhead keeps requested ahead of a scan, 0 turns it off
+    inline void SetPrefetchDepth(size_t depth) { prefetch_depth_ = depth; }
+    inline size_t GetPrefetchDepth() const { return prefetch_depth_; }
+    // pages read by the prefetcher
+    inline size_t GetPrefetchCount() const { return prefetch_reads_; }
+
 private:
-    Page *GetVictimPage() ;
+    // one independent slice of the buffer pool
+    struct BufferPoolInstance {
+        BufferPoolInstance(size_t index, Page *pages, size_t pool_size,
+                           ReplacerType replacer_type);
+        ~BufferPoolInstance();
+        // the scan ring a frame currently belongs to, nullptr if none
+        inline BufferRing *&RingOwner(Page *frame) { return ring_owner_[frame - pages_]; }
+
+        size_t index_;     // position in instances_
+
+        Page *pages_;      // first frame owned by this instance
+        size_t pool_size_; // number of frames owned by this instance
+        HashTable<page_id_t, Page *> *page_table_; // to keep track of pages
+        Replacer<Page *> *replacer_;   // to find an unpinned page for replacement
+        std::list<Page *> *free_list_; // to find a free page for replacement
+        std::mutex latch_;             // to protect shared data structure
+        // page ids whose disk read or write-back runs outside of latch_
+        std::unordered_set<page_id_t> io_pending_;
+        // clean page ids whose copy the background writer is still writing
+        std::unordered_set<page_id_t> bg_writes_;
+        size_t writer_cursor_ = 0; // frame the next writer round starts at
+        std::condition_variable io_cv_; // signalled when io_pending_ shrinks
+        size_t num_hits_ = 0;   // FetchPage found the page in the pool
+        size_t num_misses_ = 0; // FetchPage had to read the page
+        // per frame ring ownership, ring frames are never in the replacer
+        std::vector<BufferRing *> ring_owner_;
+    };
+
+    BufferPoolInstance &GetInstance(page_id_t page_id);
+    size_t ReadPages(const std::vector<page_id_t> &page_ids,
+                     std::vector<Page *> &pages, BufferRing *ring, bool prefetch);
+    Page *ClaimPage(page_id_t page_id, BufferRing *ring, bool &need_read,
+                    page_id_t &old_page_id, bool prefetch = false,
+                    bool *pending = nullptr);
+    Page *GetVictimPage(BufferPoolInstance &instance);
+    Page *GetRingVictimPage(BufferPoolInstance &instance, BufferRing &ring);
+    size_t GetRingCapacity(BufferPoolInstance &instance, BufferRing &ring);
+    void DetachFromRing(BufferPoolInstance &instance, Page *frame);
+    void ReleaseRing(BufferRing *ring);
+    size_t WriterRound(BufferPoolInstance &instance, PageBuffer &buffer);
+    bool CopyForCheckpoint(page_id_t page_id, char *buffer, bool copy_pinned,
+                           bool &pinned);
+    void FinishCheckpointWrite(page_id_t page_id);
+    void NoteVictimWrite();
+    void WaitForIO(BufferPoolInstance &instance,
+                   std::unique_lock<std::mutex> &lck, page_id_t page_id);
+    void WaitForWriter(BufferPoolInstance &instance,
+                       std::unique_lock<std::mutex> &lck, page_id_t page_id);
+    void FinishIO(BufferPoolInstance &instance, page_id_t page_id,
+                  page_id_t written_page_id);
+
+    // a chain to read ahead, or the pages page_ids_ when it has any
+    struct PrefetchRequest {
+        page_id_t page_id_;
+        size_t count_;
+        NextPageIdFn next_page_id_;
+        std::shared_ptr<BufferRing> ring_;
+        std::vector<page_id_t> page_ids_;
+    };
+    void QueuePrefetch(PrefetchRequest request);
+    void RunPrefetch(PrefetchRequest &request);
+    void StopPrefetchThread();
 
 private:
     size_t pool_size_; // number of pages in buffer pool
     Page *pages_;      // array of pages
+    PageBuffer page_data_; // data of the pages, one PAGE_SIZE slot each
     DiskManager *disk_manager_;
     LogManager *log_manager_;
-    HashTable<page_id_t, Page *> *page_table_; // to keep track of pages
-    Replacer<Page *> *replacer_;   // to find an unpinned page for replacement
-    std::list<Page *> *free_list_; // to find a free page for replacement
-    std::mutex latch_;             // to protect shared data structure
+    std::vector<BufferPoolInstance *> instances_;
+    // allocated page ids NewPage could not place yet, in order
+    std::mutex spare_latch_;
+    std::vector<page_id_t> spare_page_ids_;
+
+    // background writer
+    std::thread *writer_thread_;
+    std::mutex writer_latch_;
+    std::condition_variable writer_cv_;
+    bool writer_running_;
+    std::atomic<double> writer_clean_ratio_;
+    std::atomic<size_t> writer_batch_size_;
+    std::atomic<long long> writer_interval_ms_;
+    std::atomic<size_t> writer_rounds_;
+    std::atomic<size_t> writer_pages_written_;
+    std::atomic<size_t> victim_writes_;
+
+    // prefetcher
+    std::thread *prefetch_thread_;
+    std::mutex prefetch_latch_;
+    std::condition_variable prefetch_cv_;
+    std::deque<PrefetchRequest> prefetch_queue_;
+    bool prefetch_running_;
+    bool prefetch_busy_; // a request is being worked on
+    std::atomic<size_t> prefetch_depth_;
+    std::atomic<size_t> prefetch_reads_;
 
 };
 } // namespace scudb
@@ -0,0 +1,51 @@
+/**
+ * buffer_ring.h
+ *
+ * Functionality: access strategy for sequential scans. Pages fetched through
+ * a ring are read into a small private set of frames that the scan keeps
+ * recycling, instead of being handed to the replacer, so one pass over a big
+ * table or leaf chain does not push the hot working set out of the pool.
+ * A page that somebody fetches without the ring leaves it and becomes an
+ * ordinary page again. Destroying the ring gives its frames back, so it must
+ * not outlive its buffer pool manager.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <vector>
+
+#include "common/config.h"
+#include "page/page.h"
+
+namespace scudb {
+
+class BufferPoolManager;
+
+class BufferRing {
+    friend class BufferPoolManager;
+
+public:
+    // ring_size: number of frames the ring may keep over the whole pool
+    BufferRing(BufferPoolManager *buffer_pool_manager,
+               size_t ring_size = SCAN_RING_SIZE);
+
+    ~BufferRing();
+
+    inline size_t GetRingSize() const { return ring_size_; }
+    // fetches through this ring served from the pool / read from disk
+    inline size_t GetHitCount() const { return hits_; }
+    inline size_t GetMissCount() const { return misses_; }
+
+private:
+    BufferPoolManager *buffer_pool_manager_;
+    size_t ring_size_;
+    // frames owned in every pool instance, oldest first, guarded by the
+    // latch of that instance
+    std::vector<std::deque<Page *>> frames_;
+    std::atomic<size_t> hits_;
+    std::atomic<size_t> misses_;
+};
+
+} // namespace scudb
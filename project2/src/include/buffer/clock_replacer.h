@@ -0,0 +1,47 @@
+/**
+ * clock_replacer.h
+ *
+ * Functionality: CLOCK (second chance) approximation of LRU for the buffer
+ * pool frames. Every frame owns one slot in fixed size arrays (reference bit
+ * and "evictable" flag), indexed by the frame's offset in the buffer pool, so
+ * Insert/Erase/Victim never touch the heap.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include "buffer/replacer.h"
+#include "page/page.h"
+
+namespace scudb {
+
+class ClockReplacer : public Replacer<Page *> {
+public:
+    // frames: first frame managed by this replacer, num_frames: how many
+    ClockReplacer(Page *frames, size_t num_frames);
+
+    ~ClockReplacer();
+
+    void Insert(Page *const &value);
+
+    bool Victim(Page *&value);
+
+    bool Erase(Page *const &value);
+
+    size_t Size();
+
+private:
+    size_t SlotOf(Page *value) const;
+
+    Page *frames_;
+    size_t num_frames_;
+    std::vector<char> ref_;       // second chance bit of each slot
+    std::vector<char> evictable_; // slot currently tracked by the replacer
+    size_t hand_;                 // position of the clock hand
+    size_t size_;                 // number of evictable slots
+    std::mutex latch_;
+};
+
+} // namespace scudb
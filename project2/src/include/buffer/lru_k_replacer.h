@@ -0,0 +1,55 @@
+/**
+ * lru_k_replacer.h
+ *
+ * Functionality: LRU-K replacement for the buffer pool frames. Each frame
+ * remembers the timestamps of its last K releases (unpins) in a fixed size
+ * ring; the victim is the frame whose K-th most recent access is the oldest.
+ * Frames seen fewer than K times count as infinitely far back and are evicted
+ * first (oldest first), which keeps one-off scan pages from pushing out the
+ * frames that are hit again and again.
+ * All the state lives in arrays indexed by the frame's offset in the buffer
+ * pool, so no operation allocates.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "buffer/replacer.h"
+#include "page/page.h"
+
+namespace scudb {
+
+class LRUKReplacer : public Replacer<Page *> {
+public:
+    // frames: first frame managed by this replacer, num_frames: how many
+    LRUKReplacer(Page *frames, size_t num_frames, size_t k = 2);
+
+    ~LRUKReplacer();
+
+    void Insert(Page *const &value);
+
+    bool Victim(Page *&value);
+
+    bool Erase(Page *const &value);
+
+    size_t Size();
+
+private:
+    size_t SlotOf(Page *value) const;
+
+    Page *frames_;
+    size_t num_frames_;
+    size_t k_;
+    uint64_t current_ts_;           // logical clock, bumped on every access
+    std::vector<uint64_t> history_; // k_ timestamps per slot, used as a ring
+    std::vector<size_t> count_;     // recorded accesses of each slot (<= k_)
+    std::vector<size_t> head_;      // next ring position to overwrite
+    std::vector<char> evictable_;   // slot currently tracked by the replacer
+    size_t size_;                   // number of evictable slots
+    std::mutex latch_;
+};
+
+} // namespace scudb
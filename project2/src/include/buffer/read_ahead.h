@@ -0,0 +1,54 @@
+/**
+ * read_ahead.h
+ *
+ * Functionality: read-ahead for traversals that follow next page links (table
+ * heap page chains, B+ tree leaf chains). The pages of such a chain usually
+ * cannot be named in advance, so the buffer pool manager's prefetcher walks
+ * the links itself in the background. A traversal that can name them (a
+ * table heap, through its free space map) gives a PageWindowFn instead, and
+ * each window is read as one batch. A ReadAhead tracks one traversal: once
+ * it went PREFETCH_TRIGGER pages along the chain it counts as sequential, and
+ * from then on it keeps about GetPrefetchDepth() pages requested ahead of it.
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "common/config.h"
+
+namespace scudb {
+
+class BufferPoolManager;
+class BufferRing;
+class Page;
+
+// returns the next page id stored in a page of a chain
+typedef page_id_t (*NextPageIdFn)(Page *page);
+// fills in page_ids with up to count pages of a chain, page_id and the ones
+// after it in chain order. false if it cannot name them
+typedef std::function<bool(page_id_t page_id, size_t count,
+                           std::vector<page_id_t> &page_ids)> PageWindowFn;
+
+class ReadAhead {
+public:
+    explicit ReadAhead(BufferPoolManager *buffer_pool_manager,
+                       PageWindowFn window = nullptr)
+            : buffer_pool_manager_(buffer_pool_manager), window_(std::move(window)),
+              run_(0), ahead_(0) {}
+
+    // the traversal moved on to the next page of the chain, whose own next
+    // link is next_page_id
+    void Advance(page_id_t next_page_id, NextPageIdFn next_fn,
+                 const std::shared_ptr<BufferRing> &ring);
+
+private:
+    BufferPoolManager *buffer_pool_manager_;
+    PageWindowFn window_; // names the windows, if the traversal can
+    size_t run_;   // pages entered along the chain so far
+    size_t ahead_; // pages requested in front of the current one
+};
+
+} // namespace scudb
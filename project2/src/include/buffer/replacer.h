@@ -9,6 +9,9 @@
 
 namespace scudb {
 
+// replacement policies a BufferPoolManager can be built with
+enum class ReplacerType { LRU = 0, CLOCK, LRU_K };
+
 template <typename T> class Replacer {
 public:
   Replacer() {}
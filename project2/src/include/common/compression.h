@@ -0,0 +1,25 @@
+/**
+ * compression.h
+ *
+ * Small LZ77 compressor for values stored out of line (see OverflowStore),
+ * in the spirit of pglz: fast, no dictionary, and no use on short inputs.
+ *
+ * Format: a control byte, then up to 8 items, each a literal byte (control
+ * bit 0) or a match (control bit 1) of two bytes: 12 bits of distance back
+ * into the output and 4 bits of length - 3, for 3 to 17 bytes. A length of
+ * 15 is followed by a third byte, added to 18, for matches of up to 273.
+ */
+
+#pragma once
+
+namespace scudb {
+
+// compress size bytes of src into dst, of capacity bytes. Returns the
+// compressed size, -1 if it would not fit in capacity
+int LzCompress(const char *src, int size, char *dst, int capacity);
+
+// decompress size bytes of src into dst, which must become raw_size bytes.
+// false if src is corrupt
+bool LzDecompress(const char *src, int size, char *dst, int raw_size);
+
+} // namespace scudb
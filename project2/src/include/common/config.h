@@ -8,6 +8,7 @@
 
 #include <atomic>
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
 
 namespace scudb {
@@ -16,15 +17,42 @@ extern std::chrono::duration<long long int> LOG_TIMEOUT;
 
 extern std::atomic<bool> ENABLE_LOGGING;
 
+// size of a data page in byte. Fixed per db file when it is created and
+// recorded in its header page, set by DiskManager when it opens the file, so
+// all the databases open at the same time must use the same page size
+extern int PAGE_SIZE;
+// size of the buffer pool of the storage engine
+extern size_t BUFFER_POOL_SIZE;
+
 #define INVALID_PAGE_ID -1 // representing an invalid page id
 #define INVALID_TXN_ID -1  // representing an invalid txn id
 #define INVALID_LSN -1     // representing an invalid lsn
 #define HEADER_PAGE_ID 0   // the header page id
-#define PAGE_SIZE 512     // size of a data page in byte
+#define DEFAULT_PAGE_SIZE 4096 // page size of new db files
+#define MIN_PAGE_SIZE 512      // smallest page size
+#define MAX_PAGE_SIZE 65536    // largest page size, sizes are powers of two
 #define LOG_BUFFER_SIZE                                                            \
   ((BUFFER_POOL_SIZE + 1) * PAGE_SIZE) // size of a log buffer in byte
 #define BUCKET_SIZE 50                 // size of extendible hash bucket
-#define BUFFER_POOL_SIZE 10            // size of buffer pool
+#define SCAN_RING_SIZE 32              // frames recycled by a sequential scan
+#define BG_WRITER_CLEAN_RATIO 0.25     // share of frames the page writer keeps clean
+#define BG_WRITER_BATCH_SIZE 16        // pages written per instance and round
+#define BG_WRITER_INTERVAL_MS 50       // page writer wakeup interval
+#define CHECKPOINT_BATCH_SIZE 64       // pages a checkpoint copies before writing
+#define ASYNC_IO_QUEUE_DEPTH 64        // io_uring entries per disk manager
+#define ASYNC_IO_THREADS 4             // workers of the thread pool fallback
+#define DIRECT_IO_ALIGNMENT 4096       // alignment of page buffers, for O_DIRECT
+#define PREFETCH_DEPTH 8               // pages read ahead of a sequential scan
+#define PREFETCH_TRIGGER 2             // pages a scan crosses before reading ahead
+#define PREFETCH_QUEUE_SIZE 16         // prefetch requests waiting at most
+#define BULK_LOAD_FILL_FACTOR 0.9      // share of a page a B+ tree bulk load fills
+#define INDEX_SORT_MEMORY (16 << 20)   // bytes an index build sorts in memory
+#define OPTIMISTIC_READ_RETRIES 3      // unlatched B+ tree lookups before latching
+#define LATCH_SPIN_COUNT 64            // spins on a busy RWLatch before parking
+#define TABLE_HEAP_EXTEND_PAGES 16     // pages a batched insert adds to a heap at once
+#define VTAB_INSERT_BATCH_SIZE 1024    // rows a virtual table buffers for one insert
+#define TOAST_TUPLE_THRESHOLD (PAGE_SIZE / 4) // tuples larger move values out of line
+#define TOAST_COMPRESSION true         // compress values stored out of line
 
 typedef int32_t page_id_t; // page id type
 typedef int32_t txn_id_t;  // transaction id type
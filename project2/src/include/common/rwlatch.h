@@ -0,0 +1,94 @@
+/**
+ * rwlatch.h
+ *
+ * Reader-Writer latch in one 32-bit word
+ *
+ * Unlike RWMutex, taking the latch is a single compare and swap when nobody
+ * else holds it for writing, so readers of a page share one cache line and
+ * no mutex. A thread that can't get the latch spins for a while and then
+ * parks on the word (a futex on Linux) until an unlock wakes it. Writers are
+ * preferred: once a writer waits, no new reader gets the latch.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace scudb {
+
+class RWLatch {
+  // the word: held by a writer | someone parked | waiting writers | readers
+  static const uint32_t WRITER = 1u << 31;
+  static const uint32_t PARKED = 1u << 30;
+  static const uint32_t ONE_WAITING_WRITER = 1u << 20;
+  static const uint32_t WAITING_WRITERS = PARKED - ONE_WAITING_WRITER;
+  static const uint32_t READERS = ONE_WAITING_WRITER - 1;
+
+public:
+  RWLatch() : state_(0) {}
+
+  RWLatch(const RWLatch &) = delete;
+  RWLatch &operator=(const RWLatch &) = delete;
+
+  void WLock() {
+    uint32_t state = state_.load(std::memory_order_relaxed);
+    if ((state & (WRITER | WAITING_WRITERS | READERS)) != 0 ||
+        !state_.compare_exchange_strong(state, state | WRITER,
+                                        std::memory_order_acquire))
+      WLockSlow();
+  }
+
+  void WUnlock() {
+    uint32_t state = state_.fetch_and(~WRITER, std::memory_order_release);
+    if (state & PARKED)
+      Wake();
+  }
+
+  bool TryWLock() {
+    uint32_t state = state_.load(std::memory_order_relaxed);
+    while ((state & (WRITER | READERS)) == 0) {
+      if (state_.compare_exchange_weak(state, state | WRITER,
+                                       std::memory_order_acquire))
+        return true;
+    }
+    return false;
+  }
+
+  void RLock() {
+    uint32_t state = state_.load(std::memory_order_relaxed);
+    if ((state & (WRITER | WAITING_WRITERS)) != 0 || (state & READERS) == READERS ||
+        !state_.compare_exchange_strong(state, state + 1,
+                                        std::memory_order_acquire))
+      RLockSlow();
+  }
+
+  void RUnlock() {
+    uint32_t state = state_.fetch_sub(1, std::memory_order_release);
+    // the last reader lets a waiting writer in
+    if ((state & READERS) == 1 && (state & PARKED))
+      Wake();
+  }
+
+  bool TryRLock() {
+    uint32_t state = state_.load(std::memory_order_relaxed);
+    while ((state & (WRITER | WAITING_WRITERS)) == 0 &&
+           (state & READERS) != READERS) {
+      if (state_.compare_exchange_weak(state, state + 1,
+                                       std::memory_order_acquire))
+        return true;
+    }
+    return false;
+  }
+
+private:
+  void WLockSlow();
+  void RLockSlow();
+  // wait until the word is no longer state, or for a while
+  void Park(uint32_t state);
+  void Wake();
+
+  std::atomic<uint32_t> state_;
+};
+
+} // namespace scudb
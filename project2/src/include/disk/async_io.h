@@ -0,0 +1,136 @@
+/**
+ * async_io.h
+ *
+ * Asynchronous page I/O for DiskManager. Requests are submitted (one by one
+ * or as a batch) and tagged; their completion is picked up later with
+ * PollCompletions or WaitFor. Two engines implement it:
+ * - IOUringEngine: Linux io_uring on the db file descriptor, a batch costs one
+ *   io_uring_enter system call
+ * - ThreadPoolEngine: portable fallback, a few worker threads running the
+ *   synchronous DiskManager calls
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <sys/uio.h>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "common/config.h"
+
+namespace scudb {
+
+class DiskManager;
+
+// one page sized read or write
+struct AsyncIORequest {
+  bool is_write_;
+  page_id_t page_id_;
+  char *data_;    // PAGE_SIZE bytes, owned by the caller until completion
+  uint64_t tag_;  // filled in by DiskManager when submitted
+};
+
+class AsyncIOEngine {
+public:
+  AsyncIOEngine() {}
+  virtual ~AsyncIOEngine() {}
+
+  virtual void Submit(const std::vector<AsyncIORequest> &requests) = 0;
+
+  // hand out the tags of finished requests, waiting until at least
+  // min_complete of them are available
+  size_t PollCompletions(std::vector<uint64_t> &tags, size_t min_complete);
+
+  // block until every request in tags has finished (and forget them)
+  void WaitFor(const std::vector<uint64_t> &tags);
+
+  virtual const char *GetName() const = 0;
+
+protected:
+  // move finished requests into completed_, with latch_ held. wait: block
+  // until at least one more request finishes
+  virtual void Reap(std::unique_lock<std::mutex> &lck, bool wait) = 0;
+
+  std::mutex latch_;
+  std::condition_variable cv_; // signalled when completed_ grows
+  std::unordered_set<uint64_t> completed_;
+};
+
+class ThreadPoolEngine : public AsyncIOEngine {
+public:
+  ThreadPoolEngine(DiskManager *disk_manager, size_t num_threads);
+  ~ThreadPoolEngine();
+
+  void Submit(const std::vector<AsyncIORequest> &requests);
+  const char *GetName() const { return "thread pool"; }
+
+protected:
+  void Reap(std::unique_lock<std::mutex> &lck, bool wait);
+
+private:
+  void Work();
+
+  DiskManager *disk_manager_;
+  std::deque<AsyncIORequest> queue_;
+  std::condition_variable queue_cv_;
+  bool stop_;
+  std::vector<std::thread> threads_;
+};
+
+class IOUringEngine : public AsyncIOEngine {
+public:
+  // check IsOpen(): the kernel may not support io_uring
+  IOUringEngine(DiskManager *disk_manager, int fd, unsigned entries);
+  ~IOUringEngine();
+
+  inline bool IsOpen() const { return ring_fd_ >= 0; }
+  void Submit(const std::vector<AsyncIORequest> &requests);
+  const char *GetName() const { return "io_uring"; }
+
+protected:
+  void Reap(std::unique_lock<std::mutex> &lck, bool wait);
+
+private:
+  // an in flight request, user_data of its sqe is the slot index
+  struct Slot {
+    AsyncIORequest request_;
+  };
+
+  bool ReapCompletionQueue();
+  // hand every sqe in the submission queue to the kernel, with latch_ held
+  void SubmitQueued(std::unique_lock<std::mutex> &lck);
+  void Close();
+
+  DiskManager *disk_manager_;
+  int fd_;
+  int ring_fd_;
+  unsigned entries_;
+  // submission queue
+  void *sq_ring_;
+  size_t sq_ring_size_;
+  unsigned *sq_head_;
+  unsigned *sq_tail_;
+  unsigned *sq_mask_;
+  unsigned *sq_array_;
+  void *sqes_; // struct io_uring_sqe[entries_]
+  size_t sqes_size_;
+  // completion queue
+  void *cq_ring_;
+  size_t cq_ring_size_;
+  unsigned *cq_head_;
+  unsigned *cq_tail_;
+  unsigned *cq_mask_;
+  void *cqes_; // struct io_uring_cqe[]
+
+  std::vector<Slot> slots_;
+  std::vector<struct iovec> iovecs_;
+  std::vector<unsigned> free_slots_;
+  bool reaping_; // one thread at a time sleeps in io_uring_enter
+};
+
+} // namespace scudb
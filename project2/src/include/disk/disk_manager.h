@@ -5,29 +5,74 @@
  * database. It also performs read and write of pages to and from disk, and
  * provides a logical file layer within the context of a database management
  * system.
+ * The db file is either accessed through one shared fstream (STREAM, every
+ * page I/O takes a latch, seeks and flushes) or through a raw file descriptor
+ * with pread/pwrite (POSITIONAL), which lets any number of threads read and
+ * write pages at the same time.
+ * DIRECT is POSITIONAL on a file opened with O_DIRECT: pages bypass the OS
+ * page cache, so they are not cached twice (once in the buffer pool, once by
+ * the kernel). Page buffers should then be aligned like a PageBuffer, others
+ * are bounced through an aligned copy. When the file system refuses O_DIRECT
+ * or needs a larger alignment than PAGE_SIZE, the disk manager falls back to
+ * POSITIONAL (see GetIOMode).
+ * The page size is chosen when the db file is created and stays with it: an
+ * existing file is opened with the size recorded in its header page.
+ * PAGE_SIZE is shared by the whole process and sizes the buffer pools and
+ * pages of the open files, so a file of another page size is not opened
+ * (see IsOpen) while any other one is.
+ * Pages can also be read and written asynchronously (SubmitRead/SubmitWrite/
+ * SubmitBatch, then PollCompletions/WaitFor). POSITIONAL/DIRECT use io_uring
+ * when the kernel has it, otherwise a small thread pool runs the requests.
  */
 
 #pragma once
 #include <atomic>
 #include <fstream>
 #include <future>
+#include <mutex>
 #include <string>
 
 #include "common/config.h"
+#include "disk/async_io.h"
 
 namespace scudb {
 
+// how DiskManager accesses the db file
+enum class DiskIOMode { STREAM = 0, POSITIONAL, DIRECT };
+
 class DiskManager {
 public:
-  DiskManager(const std::string &db_file);
+  DiskManager(const std::string &db_file,
+              DiskIOMode io_mode = DiskIOMode::STREAM,
+              int page_size = DEFAULT_PAGE_SIZE);
   ~DiskManager();
 
   void WritePage(page_id_t page_id, const char *page_data);
+  // write num_pages consecutive pages starting at page_id in one go
+  void WritePages(page_id_t page_id, const char *pages_data, int num_pages);
   void ReadPage(page_id_t page_id, char *page_data);
 
+  // asynchronous page I/O, the buffers must stay valid until completion and
+  // be aligned in DIRECT mode.
+  // returns / fills in the tag identifying each request
+  uint64_t SubmitRead(page_id_t page_id, char *page_data);
+  uint64_t SubmitWrite(page_id_t page_id, const char *page_data);
+  void SubmitBatch(std::vector<AsyncIORequest> &requests);
+  // tags of finished requests, waiting for at least min_complete of them
+  size_t PollCompletions(std::vector<uint64_t> &tags, size_t min_complete = 0);
+  // block until all the given requests finished
+  void WaitFor(const std::vector<uint64_t> &tags);
+  const char *GetAsyncIOEngineName();
+
   void WriteLog(char *log_data, int size);
   bool ReadLog(char *log_data, int size, int offset);
 
+  inline DiskIOMode GetIOMode() const { return io_mode_; }
+  // false if the db file could not be opened
+  bool IsOpen() const;
+  // a power of two between MIN_PAGE_SIZE and MAX_PAGE_SIZE
+  static bool IsValidPageSize(int page_size);
+
   page_id_t AllocatePage();
   void DeallocatePage(page_id_t page_id);
 
@@ -37,14 +82,36 @@ public:
   inline bool HasFlushLogFuture() { return flush_log_f_ != nullptr; }
 
 private:
+  friend class IOUringEngine;
+
+  inline bool IsPositional() const { return io_mode_ != DiskIOMode::STREAM; }
+  bool IsAligned(const char *data) const;
+  bool OpenDirect(const std::string &db_file);
   int GetFileSize(const std::string &name);
+  void GrowFileSize(long long size);
+  AsyncIOEngine *GetAsyncIO();
   // stream to write log file
   std::fstream log_io_;
   std::string log_name_;
   // stream to write db file
   std::fstream db_io_;
+  // the stream has a single cursor, so concurrent page I/O must take turns
+  std::mutex db_io_latch_;
   std::string file_name_;
+  DiskIOMode io_mode_;
+  // POSITIONAL/DIRECT mode: db file descriptor and its size, kept up to date
+  // by the writes so reads do not need to stat the file
+  int db_fd_;
+  std::atomic<long long> db_file_size_;
+  // DIRECT mode: memory and file offset alignment the file system asks for
+  size_t direct_io_align_;
+  // asynchronous I/O engine, created on first use
+  std::once_flag async_io_once_;
+  AsyncIOEngine *async_io_;
+  std::atomic<uint64_t> next_io_tag_;
   std::atomic<page_id_t> next_page_id_;
+  // this file set PAGE_SIZE and is counted among the open ones
+  bool holds_page_size_;
   int num_flushes_;
   bool flush_log_;
   std::future<void> *flush_log_f_;
@@ -0,0 +1,52 @@
+/**
+ * page_buffer.h
+ *
+ * A zero filled memory area of whole pages, aligned to DIRECT_IO_ALIGNMENT so
+ * it can be handed to a DIRECT mode DiskManager without bouncing. Used for
+ * the frames of the buffer pool and for the staging buffers of the page writer
+ * and checkpoints.
+ */
+
+#pragma once
+
+#include <cstdlib>
+#include <cstring>
+
+#include "common/config.h"
+
+namespace scudb {
+
+class PageBuffer {
+public:
+  explicit PageBuffer(size_t num_pages = 0) : data_(nullptr), num_pages_(0) {
+    Resize(num_pages);
+  }
+  ~PageBuffer() { free(data_); }
+  PageBuffer(const PageBuffer &) = delete;
+  PageBuffer &operator=(const PageBuffer &) = delete;
+
+  // make room for num_pages, the old content is dropped when it grows
+  void Resize(size_t num_pages) {
+    if (num_pages <= num_pages_)
+      return;
+    free(data_);
+    data_ = nullptr;
+    num_pages_ = 0;
+    void *data;
+    if (posix_memalign(&data, DIRECT_IO_ALIGNMENT, num_pages * PAGE_SIZE) != 0)
+      return;
+    memset(data, 0, num_pages * PAGE_SIZE);
+    data_ = static_cast<char *>(data);
+    num_pages_ = num_pages;
+  }
+
+  inline char *GetData() { return data_; }
+  inline char *GetPage(size_t i) { return data_ + i * PAGE_SIZE; }
+  inline size_t GetNumPages() const { return num_pages_; }
+
+private:
+  char *data_;
+  size_t num_pages_;
+};
+
+} // namespace scudb
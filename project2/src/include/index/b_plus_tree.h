@@ -3,24 +3,38 @@
  *
  * Implementation of simple b+ tree data structure where internal pages direct
  * the search and leaf pages contain actual data.
- * (1) We only support unique key
+ * (1) Keys are unique, or with unique = false a key has a posting list of
+ * values
  * (2) support insert & remove
  * (3) The structure should shrink and grow dynamically
  * (4) Implement index iterator for range scan
  */
 #pragma once
 
+#include <cstdint>
+#include <functional>
 #include <queue>
+#include <utility>
 #include <vector>
 
 #include "concurrency/transaction.h"
 #include "index/index_iterator.h"
 #include "page/b_plus_tree_internal_page.h"
 #include "page/b_plus_tree_leaf_page.h"
+#include "page/b_plus_tree_posting_page.h"
 
 namespace scudb {
 
 #define BPLUSTREE_TYPE BPlusTree<KeyType, ValueType, KeyComparator>
+
+// Bounds of a range scan (see BPlusTree::ScanRange), a bound is open unless
+// it is set. Every batch of the scan moves low past the keys it returned.
+template <typename KeyType> struct KeyRange {
+    KeyType low, high;
+    bool has_low = false, low_inclusive = true;
+    bool has_high = false, high_inclusive = true;
+};
+
 // Main class providing the API for the Interactive B+ Tree.
     INDEX_TEMPLATE_ARGUMENTS
     class BPlusTree {
@@ -29,26 +43,58 @@ namespace scudb {
         explicit BPlusTree(const std::string &name,
                            BufferPoolManager *buffer_pool_manager,
                            const KeyComparator &comparator,
-                           page_id_t root_page_id = INVALID_PAGE_ID);
+                           page_id_t root_page_id = INVALID_PAGE_ID,
+                           bool unique = true);
 
         // Returns true if this B+ tree has no keys and values.
         bool IsEmpty() const;////
 
-        // Insert a key-value pair into this B+ tree.
+        // Whether a key has one value only. A non-unique tree keeps the
+        // values of a key in a posting list, ValueType must be RID
+        bool IsUnique() const { return unique_; }
+
+        // Insert a key-value pair into this B+ tree, false if the key (the
+        // pair for a non-unique tree) is there already.
         bool Insert(const KeyType &key, const ValueType &value,
                     Transaction *transaction = nullptr);
 
-        // Remove a key and its value from this B+ tree.
+        // Insert key & value pairs sorted by key. A leaf takes the pairs of
+        // its range one after the other under one latch.
+        // @return: the number of pairs inserted
+        size_t InsertBatch(const std::vector<std::pair<KeyType, ValueType>> &entries,
+                           Transaction *transaction = nullptr);
+
+        // Remove a key and its values from this B+ tree.
         void Remove(const KeyType &key, Transaction *transaction = nullptr);
 
-        // return the value associated with a given key
+        // Remove one value of a key, and the key with its last value.
+        void Remove(const KeyType &key, const ValueType &value,
+                    Transaction *transaction = nullptr);
+
+        // return the value associated with a given key, all the values of
+        // the key in order for a non-unique tree
         bool GetValue(const KeyType &key, std::vector<ValueType> &result,
                       Transaction *transaction = nullptr);
 
+        // Build an empty tree bottom up from key & value pairs in key order,
+        // which next returns until it returns false. Pages are filled to
+        // fill_factor, duplicate keys are skipped (collected into posting
+        // lists for a non-unique tree). Not safe against concurrent access
+        // to the tree.
+        bool BulkLoad(const std::function<bool(KeyType &, ValueType &)> &next,
+                      double fill_factor = BULK_LOAD_FILL_FACTOR);
+
         // index iterator
         INDEXITERATOR_TYPE Begin();
         INDEXITERATOR_TYPE Begin(const KeyType &key);
 
+        // Replace batch with the values of the keys in range of the next
+        // leaf, at most limit of them. No latch is held between batches.
+        // @return: false when the scan passed the upper bound or the last
+        // key, the batch can still hold values
+        bool ScanRange(KeyRange<KeyType> &range, std::vector<ValueType> &batch,
+                       size_t limit = SIZE_MAX);
+
         // Print this B+ tree to stdout using a simple command-line
         std::string ToString(bool verbose = false);
 
@@ -64,17 +110,50 @@ namespace scudb {
                                                  bool leftMost = false,
                                                  eOpType op = eOpType::READ,
                                                  Transaction *transaction = nullptr);
+        // layout of the keys in new pages. Prefix compression needs a
+        // comparator that orders keys like their bytes, key arrays one for
+        // integer keys, else pages fall back to key & value pairs
+        void SetKeyFormat(IndexKeyFormat key_format);
+
+        // look up keys without latching pages on the way down (on by
+        // default), turned off for benchmarks
+        void SetOptimisticReads(bool optimistic_reads) {
+            optimistic_reads_ = optimistic_reads;
+        }
+
+        // insert and remove with a write latch on the leaf only, unless it
+        // would split or underflow (on by default), turned off for benchmarks
+        void SetOptimisticWrites(bool optimistic_writes) {
+            optimistic_writes_ = optimistic_writes;
+        }
+
         // expose for test purpose
         bool Check(bool force = false);
         bool openCheck = true;
     private:
         BPlusTreePage *FetchPage(page_id_t page_id);
 
+        bool OptimisticGetValue(const KeyType &key, ValueType &value, bool &found);
+        Page *FindLeafPageToWrite(const KeyType &key);
+
         void StartNewTree(const KeyType &key, const ValueType &value);
 
         bool InsertIntoLeaf(const KeyType &key, const ValueType &value,
                             Transaction *transaction = nullptr);
 
+        bool InsertIntoPostingList(B_PLUS_TREE_LEAF_PAGE_TYPE *leaf,
+                                   const KeyType &key, const ValueType &old_value,
+                                   const ValueType &value);
+
+        void RemoveValue(const KeyType &key, const ValueType *value,
+                         Transaction *transaction);
+
+        bool RemoveFromPostingList(B_PLUS_TREE_LEAF_PAGE_TYPE *leaf,
+                                   const KeyType &key, const ValueType *value,
+                                   bool &dirty);
+
+        int RemoveEntry(B_PLUS_TREE_LEAF_PAGE_TYPE *leaf, const KeyType &key);
+
         void InsertIntoParent(BPlusTreePage *old_node, const KeyType &key,
                               BPlusTreePage *new_node,
                               Transaction *transaction = nullptr);
@@ -97,6 +176,17 @@ namespace scudb {
 
         bool AdjustRoot(BPlusTreePage *node);
 
+        template <typename N> N *NewBulkLoadPage(page_id_t parent_id);
+        int BulkLoadFillSize(BPlusTreePage *node, double fill_factor);
+        void BulkLoadIntoParent(std::vector<BPlusTreePage *> &right_pages,
+                                int level, BPlusTreePage *old_node,
+                                const KeyType &key, BPlusTreePage *new_node,
+                                double fill_factor);
+        template <typename N>
+        bool BulkLoadFixRightmost(N *node, B_PLUS_TREE_INTERNAL_PAGE *parent);
+        void BulkLoadPostingList(B_PLUS_TREE_LEAF_PAGE_TYPE *leaf, const KeyType &key,
+                                 std::vector<ValueType> &values);
+
         void UpdateRootPageId(int insert_record = false);
 
         ////my helper function begin
@@ -118,9 +208,13 @@ namespace scudb {
         page_id_t root_page_id_;
         BufferPoolManager *buffer_pool_manager_;
         KeyComparator comparator_;
+        IndexKeyFormat key_format_; ////新page的格式
+        bool optimistic_reads_; ////查找时先不加latch
+        bool optimistic_writes_; ////插入删除时先只给leaf加写latch
+        bool unique_; ////false时一个key的多个value存在posting list里
 
         ////my private membership
-        RWMutex mMutex_;
+        RWLatch mMutex_;
         static thread_local int mRootLockedCnt;
 
     };
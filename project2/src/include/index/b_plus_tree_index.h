@@ -15,6 +15,30 @@ namespace scudb {
 
 #define BPLUSTREE_INDEX_TYPE BPlusTreeIndex<KeyType, ValueType, KeyComparator>
 
+// range scan of a BPlusTreeIndex, one leaf per batch
+INDEX_TEMPLATE_ARGUMENTS
+class BPlusTreeRangeScan : public IndexRangeScan {
+public:
+  BPlusTreeRangeScan(BPlusTree<KeyType, ValueType, KeyComparator> *tree,
+                     const KeyRange<KeyType> &range, size_t limit)
+      : tree_(tree), range_(range), remaining_(limit), done_(false) {}
+
+  bool NextBatch(std::vector<RID> &batch) override {
+    batch.clear();
+    if (done_)
+      return false;
+    done_ = !tree_->ScanRange(range_, batch, remaining_);
+    remaining_ -= batch.size();
+    return !batch.empty();
+  }
+
+private:
+  BPlusTree<KeyType, ValueType, KeyComparator> *tree_;
+  KeyRange<KeyType> range_;
+  size_t remaining_;
+  bool done_;
+};
+
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeIndex : public Index {
 
@@ -28,13 +52,31 @@ public:
   void InsertEntry(const Tuple &key, RID rid,
                    Transaction *transaction = nullptr) override;
 
-  void DeleteEntry(const Tuple &key,
+  // sorted by key, see BPlusTree::InsertBatch
+  void InsertEntries(const std::vector<Tuple> &keys,
+                     const std::vector<RID> &rids,
+                     Transaction *transaction = nullptr) override;
+
+  void DeleteEntry(const Tuple &key, RID rid,
                    Transaction *transaction = nullptr) override;
 
   void ScanKey(const Tuple &key, std::vector<RID> &result,
                Transaction *transaction = nullptr) override;
 
+  std::unique_ptr<IndexRangeScan>
+  ScanRange(const Tuple *low, bool low_inclusive, const Tuple *high,
+            bool high_inclusive, size_t limit = SIZE_MAX,
+            Transaction *transaction = nullptr) override;
+
+  bool BulkLoad(TableHeap *table_heap, Schema *tuple_schema,
+                Transaction *transaction = nullptr) override;
+
 protected:
+  // build the tree key of a key tuple, false if it was cut (see KeyEncoder)
+  bool MakeKey(const Tuple &key, KeyType &index_key) const;
+
+  // keys are stored in their order preserving encoding, see KeyEncoder
+  bool normalized_keys_;
   // comparator for key
   KeyComparator comparator_;
   // container
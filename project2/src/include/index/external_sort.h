@@ -0,0 +1,65 @@
+/**
+ * external_sort.h
+ *
+ * Sort of the key & value pairs of an index build, for BPlusTree::BulkLoad.
+ * Pairs are collected in memory up to a memory limit; every time the limit is
+ * reached the buffer is sorted and written out as a run to a temporary file.
+ * Sort() then merges the runs with a heap, reading each run through a small
+ * buffer, so a table of any size is sorted in one pass over the runs. When
+ * all pairs fit in memory no file is written at all.
+ */
+
+#pragma once
+
+#include <cstdio>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "common/config.h"
+
+namespace scudb {
+
+#define EXTERNAL_SORT_TYPE ExternalSort<KeyType, ValueType, KeyComparator>
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+class ExternalSort {
+  using SortEntry = std::pair<KeyType, ValueType>;
+
+public:
+  explicit ExternalSort(const KeyComparator &comparator,
+                        size_t memory_limit = INDEX_SORT_MEMORY);
+  ~ExternalSort();
+
+  void Add(const KeyType &key, const ValueType &value);
+
+  // no more Add() after this, pairs are returned by Next() in key order
+  void Sort();
+
+  bool Next(KeyType &key, ValueType &value);
+
+  // runs written to disk, 0 when the input was sorted in memory
+  size_t GetRunCount() const { return runs_.size(); }
+
+private:
+  // one run on disk and the part of it read so far
+  struct Run {
+    FILE *file;
+    std::vector<SortEntry> buffer;
+    size_t pos;
+  };
+
+  void SpillRun();
+  bool FillRun(Run &run);
+  // heap order: the run with the smallest head at the top
+  bool RunGreater(size_t lhs, size_t rhs) const;
+
+  KeyComparator comparator_;
+  size_t max_pairs_;
+  std::vector<SortEntry> buffer_;
+  size_t buffer_pos_;
+  std::vector<Run> runs_;
+  std::vector<size_t> heap_;
+};
+
+} // namespace scudb
@@ -9,8 +9,10 @@
  */
 #pragma once
 
+#include <cassert>
 #include <cstring>
 
+#include "index/key_encoder.h"
 #include "table/tuple.h"
 #include "type/value.h"
 
@@ -23,6 +25,15 @@ public:
     memcpy(data, tuple.GetData(), tuple.GetLength());
   }
 
+  // store the order preserving encoding of the key instead of its tuple data,
+  // for comparators made by GenericComparator::Normalized. false if the key
+  // was cut, see KeyEncoder
+  inline bool SetFromNormalizedKey(const Tuple &tuple, Schema *key_schema) {
+    memset(data, 0, KeySize);
+    assert(KeyEncoder::GetEncodedLength(key_schema) <= KeySize);
+    return KeyEncoder::Encode(tuple, key_schema, data);
+  }
+
   // NOTE: for test purpose only
   inline void SetFromInteger(int64_t key) {
     memset(data, 0, KeySize);
@@ -62,11 +73,156 @@ public:
 
 /**
  * Function object returns true if lhs < rhs, used for trees
+ *
+ * The key schema is inspected once, when the comparator is bound to it. Keys
+ * made of inlined integer columns only (the common single int32/int64 key and
+ * composite integer keys) are compared on their raw bytes; any other schema
+ * falls back to materializing a Value per column. Keys set with
+ * SetFromNormalizedKey are compared by a comparator from Normalized(), with a
+ * single fixed length memcmp.
  */
 template <size_t KeySize> class GenericComparator {
 public:
   inline int operator()(const GenericKey<KeySize> &lhs,
                         const GenericKey<KeySize> &rhs) const {
+    switch (mode_) {
+    case CompareMode::MEMCMP:
+      // the encoding is zero padded to KeySize
+      return memcmp(lhs.data, rhs.data, KeySize);
+    case CompareMode::INTEGER:
+      return CompareInteger(lhs.data + offsets_[0], rhs.data + offsets_[0]);
+    case CompareMode::BIGINT:
+      return CompareBigint(lhs.data + offsets_[0], rhs.data + offsets_[0]);
+    case CompareMode::FIXED_INTEGERS:
+      return CompareFixedIntegers(lhs, rhs);
+    default:
+      return CompareValues(lhs, rhs);
+    }
+  }
+
+  GenericComparator(const GenericComparator &other) {
+    this->key_schema_ = other.key_schema_;
+    this->mode_ = other.mode_;
+    this->column_count_ = other.column_count_;
+    memcpy(this->types_, other.types_, sizeof(types_));
+    memcpy(this->offsets_, other.offsets_, sizeof(offsets_));
+  }
+
+  // constructor, specialize = false keeps the Value path for every schema
+  GenericComparator(Schema *key_schema, bool specialize = true)
+      : key_schema_(key_schema), mode_(CompareMode::VALUES),
+        column_count_(0) {
+    memset(types_, 0, sizeof(types_));
+    memset(offsets_, 0, sizeof(offsets_));
+    if (specialize)
+      Bind();
+  }
+
+  // comparator for keys set with SetFromNormalizedKey
+  static GenericComparator Normalized(Schema *key_schema) {
+    GenericComparator comparator(key_schema, false);
+    comparator.mode_ = CompareMode::MEMCMP;
+    return comparator;
+  }
+
+  // true when keys are compared without building Values
+  inline bool IsSpecialized() const { return mode_ != CompareMode::VALUES; }
+
+  // true when keys order like their bytes, so index pages may share prefixes
+  inline bool IsNormalized() const { return mode_ == CompareMode::MEMCMP; }
+
+  // true when keys are one int32 or int64 filling the whole key, so index
+  // pages may search them as plain integers
+  inline bool IsIntegerKey() const {
+    return (mode_ == CompareMode::INTEGER && KeySize == sizeof(int32_t)) ||
+           (mode_ == CompareMode::BIGINT && KeySize == sizeof(int64_t));
+  }
+
+private:
+  enum class CompareMode {
+    VALUES = 0,
+    INTEGER,
+    BIGINT,
+    FIXED_INTEGERS,
+    MEMCMP
+  };
+
+  // choose the compare mode for key_schema_
+  void Bind() {
+    int column_count = key_schema_->GetColumnCount();
+    if (column_count == 0 || column_count > static_cast<int>(KeySize))
+      return;
+    for (int i = 0; i < column_count; i++) {
+      TypeId type = key_schema_->GetType(i);
+      if (!key_schema_->IsInlined(i) ||
+          (type != TypeId::TINYINT && type != TypeId::SMALLINT &&
+           type != TypeId::INTEGER && type != TypeId::BIGINT))
+        return;
+      int32_t offset = key_schema_->GetOffset(i);
+      if (offset + static_cast<int32_t>(Type::GetTypeSize(type)) >
+          static_cast<int32_t>(KeySize))
+        return;
+      types_[i] = type;
+      offsets_[i] = static_cast<uint8_t>(offset);
+    }
+    column_count_ = column_count;
+    if (column_count == 1 && types_[0] == TypeId::INTEGER)
+      mode_ = CompareMode::INTEGER;
+    else if (column_count == 1 && types_[0] == TypeId::BIGINT)
+      mode_ = CompareMode::BIGINT;
+    else
+      mode_ = CompareMode::FIXED_INTEGERS;
+  }
+
+  // keys may be unaligned inside a page, so the values are copied out. NULL
+  // is neither less nor greater than anything, as with Value comparisons
+  template <typename T>
+  static inline int CompareRaw(const char *lhs, const char *rhs, T null) {
+    T l, r;
+    memcpy(&l, lhs, sizeof(T));
+    memcpy(&r, rhs, sizeof(T));
+    if (l == null || r == null)
+      return 0;
+    return (l > r) - (l < r);
+  }
+
+  static inline int CompareInteger(const char *lhs, const char *rhs) {
+    return CompareRaw<int32_t>(lhs, rhs, PELOTON_INT32_NULL);
+  }
+
+  static inline int CompareBigint(const char *lhs, const char *rhs) {
+    return CompareRaw<int64_t>(lhs, rhs, PELOTON_INT64_NULL);
+  }
+
+  inline int CompareFixedIntegers(const GenericKey<KeySize> &lhs,
+                                  const GenericKey<KeySize> &rhs) const {
+    for (int i = 0; i < column_count_; i++) {
+      const char *l = lhs.data + offsets_[i];
+      const char *r = rhs.data + offsets_[i];
+      int cmp;
+      switch (types_[i]) {
+      case TypeId::TINYINT:
+        cmp = CompareRaw<int8_t>(l, r, PELOTON_INT8_NULL);
+        break;
+      case TypeId::SMALLINT:
+        cmp = CompareRaw<int16_t>(l, r, PELOTON_INT16_NULL);
+        break;
+      case TypeId::INTEGER:
+        cmp = CompareInteger(l, r);
+        break;
+      default:
+        cmp = CompareBigint(l, r);
+        break;
+      }
+      if (cmp != 0)
+        return cmp;
+    }
+    // equals
+    return 0;
+  }
+
+  inline int CompareValues(const GenericKey<KeySize> &lhs,
+                           const GenericKey<KeySize> &rhs) const {
     int column_count = key_schema_->GetColumnCount();
 
     for (int i = 0; i < column_count; i++) {
@@ -83,15 +239,12 @@ public:
     return 0;
   }
 
-  GenericComparator(const GenericComparator &other) {
-    this->key_schema_ = other.key_schema_;
-  }
-
-  // constructor
-  GenericComparator(Schema *key_schema) : key_schema_(key_schema) {}
-
-private:
   Schema *key_schema_;
+  CompareMode mode_;
+  int column_count_;
+  // type and offset of each key column, for the integer modes
+  TypeId types_[KeySize];
+  uint8_t offsets_[KeySize];
 };
 
 } // namespace scudb
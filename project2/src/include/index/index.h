@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -23,13 +24,16 @@ namespace scudb {
  * mapping relation and does the conversion between tuple key and index key
  */
 class Transaction;
+class TableHeap;
 class IndexMetadata {
   IndexMetadata() = delete;
 
 public:
   IndexMetadata(std::string index_name, std::string table_name,
-                const Schema *tuple_schema, const std::vector<int> &key_attrs)
-      : name_(index_name), table_name_(table_name), key_attrs_(key_attrs) {
+                const Schema *tuple_schema, const std::vector<int> &key_attrs,
+                bool is_unique = true)
+      : name_(index_name), table_name_(table_name), key_attrs_(key_attrs),
+        is_unique_(is_unique) {
     key_schema_ = Schema::CopySchema(tuple_schema, key_attrs_);
   }
 
@@ -51,6 +55,9 @@ public:
   //  columns
   inline const std::vector<int> &GetKeyAttrs() const { return key_attrs_; }
 
+  // whether a key maps to a single tuple, else to a list of tuples
+  inline bool IsUnique() const { return is_unique_; }
+
   // Get a string representation for debugging
   const std::string ToString() const {
     std::stringstream os;
@@ -58,6 +65,7 @@ public:
     os << "IndexMetadata["
        << "Name = " << name_ << ", "
        << "Type = B+Tree, "
+       << "Unique = " << is_unique_ << ", "
        << "Table name = " << table_name_ << "] :: ";
     os << key_schema_->ToString();
 
@@ -69,10 +77,25 @@ private:
   std::string table_name_;
   // The mapping relation between key schema and tuple schema
   const std::vector<int> key_attrs_;
+  bool is_unique_;
   // schema of the indexed key
   Schema *key_schema_;
 };
 
+/**
+ * class IndexRangeScan - Scan of the keys in a range, see Index::ScanRange
+ *
+ * The rids come in batches, one leaf worth at a time for a B+ tree, and no
+ * latch is held between batches, so the index may change in between.
+ */
+class IndexRangeScan {
+public:
+  virtual ~IndexRangeScan() {}
+
+  // replace batch with the next rids, false once the range is exhausted
+  virtual bool NextBatch(std::vector<RID> &batch) = 0;
+};
+
 /////////////////////////////////////////////////////////////////////
 // Index class definition
 /////////////////////////////////////////////////////////////////////
@@ -126,13 +149,30 @@ public:
   virtual void InsertEntry(const Tuple &key, RID rid,
                            Transaction *transaction = nullptr) = 0;
 
+  // insert the entries of a batch of keys, keys[i] pointing to rids[i]
+  virtual void InsertEntries(const std::vector<Tuple> &keys,
+                             const std::vector<RID> &rids,
+                             Transaction *transaction = nullptr) = 0;
+
   // delete the index entry linked to given tuple
-  virtual void DeleteEntry(const Tuple &key,
+  virtual void DeleteEntry(const Tuple &key, RID rid,
                            Transaction *transaction = nullptr) = 0;
 
+  // the rids of key. Keys cut by KeyEncoder may bring rows of other keys too
   virtual void ScanKey(const Tuple &key, std::vector<RID> &result,
                        Transaction *transaction = nullptr) = 0;
 
+  // scan the keys from low to high, a nullptr bound is open, for at most
+  // limit rids. Keys cut by KeyEncoder may bring rows just outside the range
+  virtual std::unique_ptr<IndexRangeScan>
+  ScanRange(const Tuple *low, bool low_inclusive, const Tuple *high,
+            bool high_inclusive, size_t limit = SIZE_MAX,
+            Transaction *transaction = nullptr) = 0;
+
+  // build the still empty index from all tuples of a table
+  virtual bool BulkLoad(TableHeap *table_heap, Schema *tuple_schema,
+                        Transaction *transaction = nullptr) = 0;
+
 private:
   //===--------------------------------------------------------------------===//
   //  Data members
@@ -1,9 +1,18 @@
 /**
  * index_iterator.h
  * For range scan of b+ tree
+ * Leaves after the first one are fetched through a BufferRing and read ahead
+ * along the leaf chain
+ * A key with a posting list is returned once for each of its values
  */
 #pragma once
+#include <memory>
+#include <vector>
+
+#include "buffer/buffer_ring.h"
+#include "buffer/read_ahead.h"
 #include "page/b_plus_tree_leaf_page.h"
+#include "page/b_plus_tree_posting_page.h"
 
 namespace scudb {
 
@@ -14,7 +23,8 @@ namespace scudb {
     class IndexIterator {
     public:
         // you may define your own constructor based on your member variables
-        IndexIterator(B_PLUS_TREE_LEAF_PAGE_TYPE *leaf, int index, BufferPoolManager *buf_pool_manager);
+        IndexIterator(B_PLUS_TREE_LEAF_PAGE_TYPE *leaf, int index, BufferPoolManager *buf_pool_manager,
+                      std::shared_ptr<BufferRing> ring = nullptr);
         ~IndexIterator();
 
 
@@ -29,12 +39,19 @@ namespace scudb {
     private:////function
         // add your own private member variables here
         void UnlockAndUnPin();
+        static page_id_t NextLeafPageId(Page *page);
+        bool LoadPostingList();
 
     private:////membership
 
         int mIndex_;
         B_PLUS_TREE_LEAF_PAGE_TYPE *mLeafPage_;
         BufferPoolManager *mBufferPoolManager_;
+        std::shared_ptr<BufferRing> mRing_; ////scan ring shared by the copies
+        ReadAhead mReadAhead_;
+        MappingType mItem_; ////operator*返回的当前键值对
+        std::vector<ValueType> mPostings_; ////当前key的posting list
+        size_t mPosting_; ////当前value在posting list中的位置
     };
 
 } // namespace scudb
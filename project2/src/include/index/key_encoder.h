@@ -0,0 +1,47 @@
+/**
+ * key_encoder.h
+ *
+ * Order preserving encoding of index keys. A key tuple is turned into a byte
+ * string whose memcmp order is the SQL order of the key columns, so a B+ tree
+ * over encoded keys compares them with a single memcmp and never looks at the
+ * key schema again.
+ *
+ * Column encodings, all big-endian:
+ * - signed integers: two's complement with the sign bit flipped
+ * - BOOLEAN: as TINYINT, TIMESTAMP: unsigned, plus one
+ * - DECIMAL: IEEE bits, all bits flipped when negative, else the sign bit
+ * - VARCHAR: the first VARCHAR_LENGTH bytes zero padded, then one byte of
+ *   length + 1 (at most VARCHAR_LENGTH + 2). Longer strings that start with
+ *   the same VARCHAR_LENGTH bytes encode the same, such a key is cut. An
+ *   index with cut keys keeps their rows in posting lists, and widens a range
+ *   bound that was cut to include it; the caller rechecks the rows
+ * NULL encodes as the smallest value of the column, so NULLs sort first.
+ */
+
+#pragma once
+
+#include "catalog/schema.h"
+#include "table/tuple.h"
+
+namespace scudb {
+
+class KeyEncoder {
+public:
+  // varchar bytes kept in an encoded key
+  static const uint32_t VARCHAR_LENGTH = 16;
+
+  // true when every column of the schema has an encoding
+  static bool IsEncodable(Schema *key_schema);
+
+  // true when keys of the schema may be cut, it has a varchar column
+  static bool IsLossy(Schema *key_schema);
+
+  // bytes of an encoded key of the schema
+  static size_t GetEncodedLength(Schema *key_schema);
+
+  // encode key into storage, which must hold GetEncodedLength() bytes.
+  // false if the key was cut
+  static bool Encode(const Tuple &key, Schema *key_schema, char *storage);
+};
+
+} // namespace scudb
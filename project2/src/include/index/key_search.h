@@ -0,0 +1,53 @@
+/**
+ * key_search.h
+ *
+ * Search of a sorted array of integer keys, for B+ tree pages that store
+ * their keys in an array of their own (see IndexKeyFormat::KEY_ARRAY).
+ *
+ * A branch free binary search narrows the range down to a block of a few
+ * vectors of keys, and the keys of the block less than the key are counted
+ * with SIMD compares, without branches either. AVX2 is used when the CPU has
+ * it, otherwise int32 keys use SSE2 and int64 keys the scalar search.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+namespace scudb {
+
+class KeySearch {
+public:
+  // number of keys[0, n) less than key
+  static int CountLess(const int32_t *keys, int n, int32_t key);
+  static int CountLess(const int64_t *keys, int n, int64_t key);
+
+  // number of keys[0, n) less than or equal to key
+  template <typename T>
+  static inline int CountLessEqual(const T *keys, int n, T key) {
+    if (key == std::numeric_limits<T>::max())
+      return n;
+    return CountLess(keys, n, static_cast<T>(key + 1));
+  }
+
+  // branch free binary search, used without SIMD support
+  template <typename T>
+  static inline int ScalarCountLess(const T *keys, int n, T key) {
+    if (n == 0)
+      return 0;
+    const T *base = keys;
+    while (n > 1) {
+      int half = n / 2;
+      base = (base[half] < key) ? base + half : base;
+      n -= half;
+    }
+    return static_cast<int>(base - keys) + (*base < key);
+  }
+
+  // turn the SIMD search on or off, for benchmarks
+  static void EnableSimd(bool enable);
+  static bool IsSimdEnabled();
+};
+
+} // namespace scudb
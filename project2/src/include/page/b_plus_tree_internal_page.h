@@ -12,6 +12,21 @@
  *  --------------------------------------------------------------------------
  * | HEADER | KEY(1)+PAGE_ID(1) | KEY(2)+PAGE_ID(2) | ... | KEY(n)+PAGE_ID(n) |
  *  --------------------------------------------------------------------------
+ *
+ * Compressed internal pages fence their key range with LOW and HIGH like
+ * compressed leaf pages, and keep only the key bytes after the common prefix
+ * of the fences:
+ *  --------------------------------------------------------------------------
+ * | HEADER | LOW | HIGH | SUFFIX(1)+PAGE_ID(1) | ... | SUFFIX(n)+PAGE_ID(n) |
+ *  --------------------------------------------------------------------------
+ * KEY(1) of such a page is its LOW fence, except in the leftmost page of a
+ * level where it is not used.
+ *
+ * Key array internal pages, for int32 and int64 keys, keep the keys and the
+ * child pointers of their n = MaxSize + 1 entries in two arrays:
+ *  --------------------------------------------------------------------------
+ * | HEADER | KEY(1) | ... | KEY(n) | PAGE_ID(1) | ... | PAGE_ID(n) |
+ *  --------------------------------------------------------------------------
  */
 
 #pragma once
@@ -33,7 +48,8 @@ namespace scudb {
 class BPlusTreeInternalPage : public BPlusTreePage {
 public:
   // must call initialize method after "create" a new node
-  void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID);
+  void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID,
+            IndexKeyFormat key_format = IndexKeyFormat::PAIRS);
 
   KeyType KeyAt(int index) const;
   void SetKeyAt(int index, const KeyType &key);
@@ -41,6 +57,17 @@ public:
   ValueType ValueAt(int index) const;
 
   ValueType Lookup(const KeyType &key, const KeyComparator &comparator) const;
+  // lookup among the first size entries, for a page read without its latch
+  // whose size was kept within the page (see BPlusTree::OptimisticGetValue)
+  ValueType Lookup(const KeyType &key, const KeyComparator &comparator,
+                   int size) const;
+
+  // key range of a compressed page
+  KeyType GetLowFence() const;
+  KeyType GetHighFence() const;
+  void SetFences(const KeyType &low, const KeyType &high);
+  // max size of this page merged with its sibling
+  int GetMaxSizeAfterMerge(const BPlusTreeInternalPage *sibling) const;
   void PopulateNewRoot(const ValueType &old_value, const KeyType &new_key,
                        const ValueType &new_value);
   int InsertNodeAfter(const ValueType &old_value, const KeyType &new_key,
@@ -63,6 +90,19 @@ public:
                        BufferPoolManager *buffer_pool_manager);
 
 private:
+  // entry access for both page formats
+  int MaxSizeFor(int prefix_size) const;
+  int EntrySize() const;
+  char *EntryAt(int index);
+  const char *EntryAt(int index) const;
+  void SetEntryAt(int index, const KeyType &key, const ValueType &value);
+  void SetValueAt(int index, const ValueType &value);
+  void MoveEntries(int to, int from, int count);
+  char *KeyArrayAt(int index);
+  const char *KeyArrayAt(int index) const;
+  char *ValueArrayAt(int index);
+  const char *ValueArrayAt(int index) const;
+
   void CopyHalfFrom(MappingType *items, int size,
                     BufferPoolManager *buffer_pool_manager);
   void CopyAllFrom(MappingType *items, int size,
@@ -3,20 +3,43 @@
  *
  * Store indexed key and record id(record id = page id combined with slot id,
  * see include/common/rid.h for detailed implementation) together within leaf
- * page. Only support unique key.
+ * page. Keys are unique, a non-unique B+ tree keeps the record ids of a key
+ * in a posting list the value of its entry refers to (see
+ * b_plus_tree_posting_page.h).
 
  * Leaf page format (keys are stored in order):
  *  ----------------------------------------------------------------------
  * | HEADER | KEY(1) + RID(1) | KEY(2) + RID(2) | ... | KEY(n) + RID(n)
  *  ----------------------------------------------------------------------
  *
- *  Header format (size in byte, 24 bytes in total):
+ *  Header format (size in byte, 32 bytes in total):
  *  ---------------------------------------------------------------------
- * | PageType (4) | CurrentSize (4) | MaxSize (4) | ParentPageId (4) |
+ * | PageType (4) | LSN (4) | CurrentSize (4) | MaxSize (4) |
  *  ---------------------------------------------------------------------
- *  ------------------------------
- * | PageId (4) | NextPageId (4)
- *  ------------------------------
+ *  ---------------------------------------------------------------------
+ * | ParentPageId (4) | PageId (4) | KeyFormat (1) | PrefixSize (1) |
+ *  ---------------------------------------------------------------------
+ *  --------------------------------
+ * | MinSize (2) | NextPageId (4)
+ *  --------------------------------
+ *
+ * Compressed leaf page format, for memcmp comparable keys (see
+ * GenericComparator::Normalized):
+ *  ----------------------------------------------------------------------
+ * | HEADER | LOW | HIGH | SUFFIX(1) + RID(1) | ... | SUFFIX(n) + RID(n)
+ *  ----------------------------------------------------------------------
+ * LOW and HIGH are whole keys fencing the keys the page can hold, LOW <= key
+ * < HIGH (<= for the all 0xFF key of the rightmost page). Every such key
+ * starts with the PrefixSize bytes LOW and HIGH have in common, so entries
+ * only store the rest of their key. The fences move with splits, merges and
+ * redistributions, and the entries are rewritten when the prefix changes.
+ *
+ * Key array leaf page format, for int32 and int64 keys (see
+ * GenericComparator::IsIntegerKey), with room for n = MaxSize + 1 entries:
+ *  ----------------------------------------------------------------------
+ * | HEADER | KEY(1) | ... | KEY(n) | RID(1) | ... | RID(n)
+ *  ----------------------------------------------------------------------
+ * The keys are searched with SIMD instructions, see KeySearch.
  */
 #pragma once
 #include <utility>
@@ -34,19 +57,37 @@ class BPlusTreeLeafPage : public BPlusTreePage {
 public:
   // After creating a new leaf page from buffer pool, must call initialize
   // method to set default values
-  void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID);
+  void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID,
+            IndexKeyFormat key_format = IndexKeyFormat::PAIRS);
   // helper methods
   page_id_t GetNextPageId() const;
   void SetNextPageId(page_id_t next_page_id);
   KeyType KeyAt(int index) const;
   int KeyIndex(const KeyType &key, const KeyComparator &comparator) const;
-  const MappingType &GetItem(int index);
+  int KeyIndex(const KeyType &key, const KeyComparator &comparator,
+               int size) const;
+  MappingType GetItem(int index) const;
+  ValueType ValueAt(int index) const;
+
+  // key range of a compressed page
+  KeyType GetLowFence() const;
+  KeyType GetHighFence() const;
+  void SetFences(const KeyType &low, const KeyType &high);
+  // max size of this page merged with its sibling
+  int GetMaxSizeAfterMerge(const BPlusTreeLeafPage *sibling) const;
 
   // insert and delete methods
   int Insert(const KeyType &key, const ValueType &value,
              const KeyComparator &comparator);
   bool Lookup(const KeyType &key, ValueType &value,
               const KeyComparator &comparator) const;
+  // lookup among the first size entries, for a page read without its latch
+  // whose size was kept within the page (see BPlusTree::OptimisticGetValue)
+  bool Lookup(const KeyType &key, ValueType &value,
+              const KeyComparator &comparator, int size) const;
+  // replace the value of a key, false if the key is not there
+  bool Update(const KeyType &key, const ValueType &value,
+              const KeyComparator &comparator);
   int RemoveAndDeleteRecord(const KeyType &key,
                             const KeyComparator &comparator);
   // Split and Merge utility methods
@@ -62,6 +103,18 @@ public:
   std::string ToString(bool verbose = false) const;
 
 private:
+  // entry access for both page formats
+  int MaxSizeFor(int prefix_size) const;
+  int EntrySize() const;
+  char *EntryAt(int index);
+  const char *EntryAt(int index) const;
+  void SetEntryAt(int index, const KeyType &key, const ValueType &value);
+  void MoveEntries(int to, int from, int count);
+  bool KeyEquals(int index, const KeyType &key) const;
+  char *KeyArrayAt(int index);
+  const char *KeyArrayAt(int index) const;
+  const char *ValueArrayAt(int index) const;
+
   void CopyHalfFrom(MappingType *items, int size);
   void CopyAllFrom(MappingType *items, int size);
   void CopyLastFrom(const MappingType &item);
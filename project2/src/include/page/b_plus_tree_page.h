@@ -6,12 +6,19 @@
  * It actually serves as a header part for each B+ tree page and
  * contains information shared by both leaf page and internal page.
  *
- * Header format (size in byte, 20 bytes in total):
+ * Header format (size in byte, 28 bytes in total):
  * ----------------------------------------------------------------------------
  * | PageType (4) | LSN (4) | CurrentSize (4) | MaxSize (4) |
  * ----------------------------------------------------------------------------
- * | ParentPageId (4) | PageId(4) |
+ * | ParentPageId (4) | PageId(4) | KeyFormat (1) | PrefixSize (1) |
  * ----------------------------------------------------------------------------
+ * | MinSize (2) |
+ * ---------------
+ *
+ * KeyFormat tells how the entries are laid out, see IndexKeyFormat and the
+ * leaf and internal page formats. Pages with key prefix compression keep the
+ * length of the key prefix shared by all their entries in PrefixSize, and
+ * since their max size changes with it, their min size is kept separately.
  */
 
 #pragma once
@@ -34,6 +41,10 @@ namespace scudb {
 // define page type enum
 enum class IndexPageType { INVALID_INDEX_PAGE = 0, LEAF_PAGE, INTERNAL_PAGE };
 enum class eOpType { READ = 0, INSERT, DELETE };
+// PAIRS: key & value pairs
+// PREFIX_COMPRESSED: key suffixes after a common prefix, for memcmp keys
+// KEY_ARRAY: all keys, then all values, for integer keys searched with SIMD
+enum class IndexKeyFormat : uint8_t { PAIRS = 0, PREFIX_COMPRESSED, KEY_ARRAY };
 
 // Abstract class.
 class BPlusTreePage {
@@ -58,6 +69,27 @@ public:
 
   void SetLSN(lsn_t lsn = INVALID_LSN);
 
+  inline IndexKeyFormat GetKeyFormat() const { return key_format_; }
+  void SetKeyFormat(IndexKeyFormat key_format);
+  inline bool IsKeyArray() const {
+    return key_format_ == IndexKeyFormat::KEY_ARRAY;
+  }
+
+  // key prefix compression
+  inline bool IsCompressed() const {
+    return key_format_ == IndexKeyFormat::PREFIX_COMPRESSED;
+  }
+  inline int GetPrefixSize() const { return prefix_size_; }
+  void SetPrefixSize(int prefix_size);
+  void SetMinSize(int min_size);
+  // length of the common prefix of two keys of key_size bytes
+  static int CommonPrefixSize(const char *lhs, const char *rhs, int key_size);
+
+  // number of the n integer keys of key_size bytes at keys that are less
+  // than key (or equal to it, with or_equal), see KeySearch
+  static int CountKeysLess(const char *keys, int key_size, int n,
+                           const char *key, bool or_equal);
+
   //扩展函数，判断当前的index是否合法安全
   bool isSafe(eOpType op);
 
@@ -69,8 +101,9 @@ private:
   int max_size_;
   page_id_t parent_page_id_;
   page_id_t page_id_;
-
-
+  IndexKeyFormat key_format_;
+  int8_t prefix_size_;
+  int16_t min_size_;
 };
 
 } // namespace scudb
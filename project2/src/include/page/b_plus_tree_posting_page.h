@@ -0,0 +1,90 @@
+/**
+ * b_plus_tree_posting_page.h
+ *
+ * Posting list of a key of a non-unique B+ tree (see BPlusTree::IsUnique).
+ * A key with a single record id keeps it in its leaf entry as usual. Once a
+ * second one comes along, the leaf entry refers to a posting list instead: a
+ * chain of posting pages holding the record ids of the key in sorted order,
+ * every rid of a page less than those of the next page. A posting reference
+ * is a RID whose slot number is POSTING_LIST_SLOT and whose page id is the
+ * first page of the chain, which stays the same for the life of the list.
+ *
+ * Posting pages are only reached through their leaf entry, and are read and
+ * written under the latch of that leaf.
+ *
+ * Posting page format (size in byte, rids are stored in order):
+ *  ----------------------------------------------------------------------
+ * | PageId (4) | NextPageId (4) | Size (4) | RID(1) | RID(2) | ... | RID(n)
+ *  ----------------------------------------------------------------------
+ */
+#pragma once
+
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "common/rid.h"
+
+namespace scudb {
+
+// slot number of a posting reference, real slots are >= 0
+#define POSTING_LIST_SLOT -2
+
+class BPlusTreePostingPage {
+public:
+  void Init(page_id_t page_id);
+  page_id_t GetPageId() const { return page_id_; }
+  page_id_t GetNextPageId() const { return next_page_id_; }
+  void SetNextPageId(page_id_t next_page_id) { next_page_id_ = next_page_id; }
+  int GetSize() const { return size_; }
+  // rids a page holds at most
+  static int GetMaxSize();
+  const RID &RidAt(int index) const { return array[index]; }
+
+  // insert and delete keep the rids sorted, false if the rid was (not) there
+  bool Insert(const RID &rid);
+  bool Remove(const RID &rid);
+  void MoveHalfTo(BPlusTreePostingPage *recipient);
+
+  // order of the rids of a posting list
+  static bool RidLess(const RID &lhs, const RID &rhs) {
+    return lhs.GetPageId() < rhs.GetPageId() ||
+           (lhs.GetPageId() == rhs.GetPageId() &&
+            lhs.GetSlotNum() < rhs.GetSlotNum());
+  }
+
+  /**
+   * Posting lists, given by the value of their leaf entry
+   */
+  static bool IsPostingList(const RID &value) {
+    return value.GetSlotNum() == POSTING_LIST_SLOT;
+  }
+  // new list of count sorted, distinct rids, returns its reference
+  static RID CreateList(BufferPoolManager *buffer_pool_manager,
+                        const RID *rids, int count);
+  // false if rid is in the list already
+  static bool InsertIntoList(BufferPoolManager *buffer_pool_manager,
+                             const RID &list, const RID &rid);
+  // false if rid is not in the list. When one rid is left, the list is
+  // deleted and value becomes that rid, to go back into the leaf entry
+  static bool RemoveFromList(BufferPoolManager *buffer_pool_manager,
+                             RID &value, const RID &rid);
+  // appends the rids of the list to result
+  static void GetList(BufferPoolManager *buffer_pool_manager, const RID &list,
+                      std::vector<RID> &result);
+  static void DeleteList(BufferPoolManager *buffer_pool_manager,
+                         const RID &list);
+
+private:
+  int LowerBound(const RID &rid) const;
+  static BPlusTreePostingPage *NewPostingPage(
+      BufferPoolManager *buffer_pool_manager);
+  static BPlusTreePostingPage *FetchPostingPage(
+      BufferPoolManager *buffer_pool_manager, page_id_t page_id);
+
+  page_id_t page_id_;
+  page_id_t next_page_id_;
+  int size_;
+  RID array[0];
+};
+
+} // namespace scudb
@@ -0,0 +1,63 @@
+/**
+ * free_space_map_page.h
+ *
+ * Page of the free space map of a table heap (see FreeSpaceMap). It has an
+ * entry for each of a run of heap pages: the id of the heap page and the
+ * category of its free space, one byte. The pages of a map form a chain, and
+ * heap pages are added to the last one in the order the heap grows. The
+ * first page also keeps the head of the list of free overflow pages.
+ *
+ * Format (size in byte, n = GetMaxSize()):
+ *  ---------------------------------------------------------
+ * | PageId (4) | NextPageId (4) | Size (4) | FreePageId (4) |
+ *  ---------------------------------------------------------
+ *  -----------------------------------------------
+ * | HeapPageId(1) (4) | ... | HeapPageId(n) (4) |
+ *  -----------------------------------------------
+ *  -----------------------------------------
+ * | Category(1) (1) | ... | Category(n) (1) |
+ *  -----------------------------------------
+ */
+#pragma once
+
+#include <cstdint>
+
+#include "common/config.h"
+
+namespace scudb {
+
+class FreeSpaceMapPage {
+public:
+  void Init(page_id_t page_id);
+  page_id_t GetPageId() const { return page_id_; }
+  page_id_t GetNextPageId() const { return next_page_id_; }
+  void SetNextPageId(page_id_t next_page_id) { next_page_id_ = next_page_id; }
+  int GetSize() const { return size_; }
+  // first free overflow page of the heap, in the first map page
+  page_id_t GetFreePageId() const { return free_page_id_; }
+  void SetFreePageId(page_id_t free_page_id) { free_page_id_ = free_page_id; }
+  // heap pages a map page holds at most
+  static int GetMaxSize();
+
+  page_id_t HeapPageIdAt(int index) const { return heap_page_ids_[index]; }
+  uint8_t CategoryAt(int index) const { return GetCategories()[index]; }
+  void SetCategory(int index, uint8_t category) {
+    GetCategories()[index] = category;
+  }
+  // false if the page is full
+  bool Append(page_id_t heap_page_id, uint8_t category);
+
+private:
+  uint8_t *GetCategories() const {
+    return reinterpret_cast<uint8_t *>(
+        const_cast<page_id_t *>(heap_page_ids_) + GetMaxSize());
+  }
+
+  page_id_t page_id_;
+  page_id_t next_page_id_;
+  int size_;
+  page_id_t free_page_id_;
+  page_id_t heap_page_ids_[0];
+};
+
+} // namespace scudb
@@ -4,11 +4,15 @@
  * Database use the first page (page_id = 0) as header page to store metadata, in
  * our case, we will contain information about table/index name (length less than
  * 32 bytes) and their corresponding root_id
+ * It also records the page size of the db file, at a fixed offset so that
+ * DiskManager can read it before it knows the page size.
  *
  * Format (size in byte):
- *  -----------------------------------------------------------------
- * | RecordCount (4) | Entry_1 name (32) | Entry_1 root_id (4) | ... |
- *  -----------------------------------------------------------------
+ *  ---------------------------------------------------------------------
+ * | RecordCount (4) | LSN (4) | Magic (4) | PageSize (4) | Entry_1 name (32)
+ *  ---------------------------------------------------------------------
+ * | Entry_1 root_id (4) | ... |
+ *  ---------------------------
  */
 
 #pragma once
@@ -21,7 +25,12 @@ namespace scudb {
 
 class HeaderPage : public Page {
 public:
-  void Init() { SetRecordCount(0); }
+  // also stamps the page size of the db file
+  void Init();
+  // page size recorded in the first bytes of a db file, 0 if there is none
+  static int GetStoredPageSize(const char *header_data, size_t size);
+  // bytes of the file start GetStoredPageSize needs
+  static const size_t STORED_PAGE_SIZE_END = 16;
   /**
    * Record related
    */
@@ -0,0 +1,41 @@
+/**
+ * overflow_page.h
+ *
+ * Page of a value stored out of line (see OverflowStore). A value that is
+ * larger than one page is split over a chain of them, in order.
+ *
+ * Format (size in byte):
+ *  ---------------------------------------------------
+ * | PageId (4) | NextPageId (4) | Size (4) | DATA ... |
+ *  ---------------------------------------------------
+ */
+#pragma once
+
+#include <cstdint>
+
+#include "common/config.h"
+
+namespace scudb {
+
+class OverflowPage {
+public:
+  void Init(page_id_t page_id);
+  page_id_t GetPageId() const { return page_id_; }
+  page_id_t GetNextPageId() const { return next_page_id_; }
+  void SetNextPageId(page_id_t next_page_id) { next_page_id_ = next_page_id; }
+  // bytes of the value in this page
+  int GetSize() const { return size_; }
+  void SetSize(int size) { size_ = size; }
+  // bytes of a value a page holds at most
+  static int GetMaxSize();
+
+  char *GetData() { return data_; }
+
+private:
+  page_id_t page_id_;
+  page_id_t next_page_id_;
+  int size_;
+  char data_[0];
+};
+
+} // namespace scudb
@@ -3,16 +3,19 @@
  *
  * Wrapper around actual data page in main memory and also contains bookkeeping
  * information used by buffer pool manager like pin_count/dirty_flag/page_id.
+ * The data area is not owned by the page, the buffer pool manager points it
+ * into one aligned arena holding the data of every frame.
  * Use page as a basic unit within the database system
  */
 
 #pragma once
 
+#include <atomic>
 #include <cstring>
 #include <iostream>
 
 #include "common/config.h"
-#include "common/rwmutex.h"
+#include "common/rwlatch.h"
 
 namespace scudb {
 
@@ -20,7 +23,7 @@ class Page {
   friend class BufferPoolManager;
 
 public:
-  Page() { ResetMemory(); }
+  Page() {}
   ~Page(){};
   // get actual data page content
   inline char *GetData() { return data_; }
@@ -28,12 +31,30 @@ public:
   inline page_id_t GetPageId() { return page_id_; }
   // get page pin count
   inline int GetPinCount() { return pin_count_; }
-  // method use to latch/unlatch page content
-  inline void WUnlatch() { rwlatch_.WUnlock(); }
-  inline void WLatch() { rwlatch_.WLock(); }
+  // method use to latch/unlatch page content, the write latch bumps the
+  // version when it is taken and again when it is released
+  inline void WUnlatch() {
+    version_.fetch_add(1, std::memory_order_release);
+    rwlatch_.WUnlock();
+  }
+  inline void WLatch() {
+    rwlatch_.WLock();
+    version_.fetch_add(1, std::memory_order_acq_rel);
+  }
   inline void RUnlatch() { rwlatch_.RUnlock(); }
   inline void RLatch() { rwlatch_.RLock(); }
 
+  // for readers that don't latch: read the version before reading the page,
+  // the content read is good if the version was even (no writer) and is
+  // still the same afterwards
+  inline uint64_t GetVersion() {
+    return version_.load(std::memory_order_acquire);
+  }
+  inline bool ValidateVersion(uint64_t version) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return version_.load(std::memory_order_relaxed) == version;
+  }
+
   inline lsn_t GetLSN() { return *reinterpret_cast<lsn_t *>(GetData() + 4); }
   inline void SetLSN(lsn_t lsn) { memcpy(GetData() + 4, &lsn, 4); }
 
@@ -41,11 +62,12 @@ private:
   // method used by buffer pool manager
   inline void ResetMemory() { memset(data_, 0, PAGE_SIZE); }
   // members
-  char data_[PAGE_SIZE]; // actual data
+  char *data_ = nullptr; // actual data, PAGE_SIZE bytes
   page_id_t page_id_ = INVALID_PAGE_ID;
   int pin_count_ = 0;
   bool is_dirty_ = false;
-  RWMutex rwlatch_;
+  RWLatch rwlatch_;
+  std::atomic<uint64_t> version_{0};
 };
 
 } // namespace scudb
@@ -0,0 +1,145 @@
+/**
+ * pax_page.h
+ *
+ * Columnar table page, in the way of PAX (Partition Attributes Across): the
+ * tuples of the page are split by column, and the values of a column are
+ * kept together in a minipage, so a scan of a few columns only reads their
+ * minipages and copies them out as column vectors.
+ *
+ * PAX page format:
+ *  --------------------------------------------------------------------
+ * | HEADER | ROW STATES | MINIPAGE_1 | ... | MINIPAGE_n | FREE | VARLEN |
+ *  --------------------------------------------------------------------
+ *                                                              ^
+ *                                                   free space pointer
+ *
+ *  The header is the TablePage header, followed by:
+ *  ---------------------------------
+ * | ColumnCount (4) | Capacity (4) |
+ *  ---------------------------------
+ *  -------------------------------------------------------------------------
+ * | Minipage_1 offset (4) | Column_1 width (2) | Column_1 inlined (2) | ... |
+ *  -------------------------------------------------------------------------
+ *
+ * A page holds up to Capacity tuples, the row of a tuple is its slot number.
+ * Minipage i has a value of width bytes for each row, the bytes of column i
+ * in the tuple format: the value of an inlined column, and for a
+ * varied-sized one the offset of its length and bytes in the varlen area at
+ * the end of the page. The row state of a tuple is one byte.
+ *
+ * Capacity is decided when a tuple goes into a page with no rows in use,
+ * from the size of that tuple, and the minipages are laid out then.
+ * TupleCount is the number of rows in use, empty ones among them included.
+ * The varlen area is kept like the tuples of a TablePage: deletes leave
+ * fragments (FragmentedSize), and Compact moves the values together again.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "page/table_page.h"
+#include "table/column_batch.h"
+
+namespace scudb {
+
+#define PAX_PAGE_HEADER_SIZE (TABLE_PAGE_HEADER_SIZE + 8)
+#define PAX_PAGE_COLUMN_SIZE 8
+
+// row states
+#define PAX_ROW_EMPTY 0
+#define PAX_ROW_LIVE 1
+#define PAX_ROW_DELETED 2 // marked deleted, not applied yet
+
+class PaxPage : public TablePage {
+public:
+  /**
+   * Header related
+   */
+  // the columns of schema give the minipages of the page
+  void Init(page_id_t page_id, size_t page_size, page_id_t prev_page_id,
+            Schema *schema, LogManager *log_manager, Transaction *txn);
+  // bytes for the varlen area, and for the fixed-size part of a tuple while
+  // there is an empty row. 0 if there is none
+  int32_t GetFreeSpaceSize();
+  // move the varlen values to the end of the page, and drop the empty rows
+  // at the end
+  void Compact();
+
+  /**
+   * Tuple related, as in TablePage
+   */
+  bool InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn,
+                   LockManager *lock_manager, LogManager *log_manager);
+  int InsertTuples(const Tuple *tuples, int count, RID *rids, Transaction *txn,
+                   LockManager *lock_manager, LogManager *log_manager);
+  bool MarkDelete(const RID &rid, Transaction *txn, LockManager *lock_manager,
+                  LogManager *log_manager);
+  bool UpdateTuple(const Tuple &new_tuple, Tuple &old_tuple, const RID &rid,
+                   Transaction *txn, LockManager *lock_manager,
+                   LogManager *log_manager);
+  void ApplyDelete(const RID &rid, Transaction *txn, LogManager *log_manager,
+                   Tuple *deleted_tuple = nullptr);
+  void RollbackDelete(const RID &rid, Transaction *txn,
+                      LogManager *log_manager);
+  // the tuple put together from its columns
+  bool GetTuple(const RID &rid, Tuple &tuple, Transaction *txn,
+                LockManager *lock_manager);
+
+  /**
+   * Tuple iterator
+   */
+  bool GetFirstTupleRid(RID &first_rid);
+  bool GetNextTupleRid(const RID &cur_rid, RID &next_rid);
+  // append the tuples of the page to batch, the values of column
+  // column_ids[i] to batch.columns[i]
+  void GetColumns(const std::vector<int> &column_ids, ColumnBatch &batch,
+                  Transaction *txn, LockManager *lock_manager);
+
+private:
+  /**
+   * helper functions
+   */
+  // lay the minipages out for tuples of about the size of tuple, false if
+  // not even one fits
+  bool Layout(const Tuple &tuple);
+  void InsertTupleAt(int row, const Tuple &tuple, RID &rid, Transaction *txn,
+                     LockManager *lock_manager);
+  // copy the varlen values of tuple to the varlen area, their offsets to
+  // the minipages
+  void WriteVarlenValues(int row, const Tuple &tuple);
+  // count the varlen values of a row as fragments
+  void FreeVarlenValues(int row);
+  // put the tuple of a row together, in the tuple format
+  void CopyTuple(int row, Tuple &tuple);
+  // bytes of the varlen values of a row / of a tuple
+  int32_t GetVarlenSize(int row);
+  int32_t GetVarlenSize(const Tuple &tuple);
+  // bytes of a tuple without its varlen values
+  int32_t GetFixedSize();
+  // an empty row, -1 if there is none
+  int GetEmptyRow();
+  // lock a row exclusively for a delete or an update, shared for a read
+  bool LockRow(const RID &rid, Transaction *txn, LockManager *lock_manager);
+  bool LockShared(const RID &rid, Transaction *txn, LockManager *lock_manager);
+
+  int GetColumnCount();
+  void SetColumnCount(int column_count);
+  int GetCapacity();
+  void SetCapacity(int capacity);
+  int32_t GetMinipageOffset(int column);
+  void SetMinipageOffset(int column, int32_t offset);
+  int GetColumnWidth(int column);
+  bool IsColumnInlined(int column);
+  // value of a column in a row
+  char *GetValuePtr(int column, int row);
+  int32_t GetRowStatesOffset();
+  uint8_t GetRowState(int row);
+  void SetRowState(int row, uint8_t state);
+  // where the varlen area begins, after the last minipage
+  int32_t GetVarlenAreaStart();
+  // bytes between the last minipage and the varlen values
+  int32_t GetContiguousFreeSpaceSize();
+};
+
+} // namespace scudb
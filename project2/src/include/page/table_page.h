@@ -12,9 +12,27 @@
  *  --------------------------------------------------------------------------
  * | PageId (4)| LSN (4)| PrevPageId (4)| NextPageId (4)| FreeSpacePointer(4) |
  *  --------------------------------------------------------------------------
- *  --------------------------------------------------------------
- * | TupleCount (4) | Tuple_1 offset (4) | Tuple_1 size (4) | ... |
- *  --------------------------------------------------------------
+ *  ---------------------------------------------------------------------
+ * | TupleCount (4) | FsmPageId (4) | FreeSlotHead (4) | FragmentedSize (4) |
+ *  ---------------------------------------------------------------------
+ *  ------------
+ * | Layout (4) |
+ *  ------------
+ *  -------------------------------------------
+ * | Tuple_1 offset (4) | Tuple_1 size (4) | ... |
+ *  -------------------------------------------
+ *
+ * FsmPageId is only set in the first page of a table heap, where it points
+ * to the free space map of the heap (see FreeSpaceMap).
+ *
+ * Empty slots are chained from FreeSlotHead through their offset field, so an
+ * insert takes one without searching the slot array. ApplyDelete leaves the
+ * room of the deleted tuple where it is and only counts it in FragmentedSize;
+ * Compact moves the tuples together again when an insert or update needs the
+ * room.
+ *
+ * Layout is PageLayout::PAX in the pages of a heap created with the columnar
+ * layout, which are PaxPage. The tuple related methods go to PaxPage then.
  *
  */
 
@@ -30,6 +48,16 @@
 
 namespace scudb {
 
+class PaxPage;
+
+#define TABLE_PAGE_HEADER_SIZE 40
+#define TABLE_PAGE_SLOT_SIZE 8
+// end of the empty slot chain
+#define INVALID_SLOT_NUM -1
+
+// how the tuples of a page are stored: slotted rows, or grouped by column
+enum class PageLayout : int32_t { ROW = 0, PAX };
+
 class TablePage : public Page {
 public:
   /**
@@ -42,6 +70,17 @@ public:
   page_id_t GetNextPageId();
   void SetPrevPageId(page_id_t prev_page_id);
   void SetNextPageId(page_id_t next_page_id);
+  page_id_t GetFsmPageId();
+  void SetFsmPageId(page_id_t fsm_page_id);
+  PageLayout GetLayout();
+  // this page, when its layout is PAX
+  PaxPage *AsPaxPage();
+  // bytes for tuples and slots, the fragments left by deletes included
+  int32_t GetFreeSpaceSize();
+  // move the tuples to the end of the page, so that all free space is
+  // between the slot array and the tuples, and drop the empty slots at the
+  // end of the slot array
+  void Compact();
 
   /**
    * Tuple related
@@ -49,6 +88,10 @@ public:
   bool InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn,
                    LockManager *lock_manager,
                    LogManager *log_manager); // return rid if success
+  // insert tuples in order while they fit, under the caller's one latch.
+  // returns how many were inserted, their rids in rids
+  int InsertTuples(const Tuple *tuples, int count, RID *rids, Transaction *txn,
+                   LockManager *lock_manager, LogManager *log_manager);
   bool MarkDelete(const RID &rid, Transaction *txn, LockManager *lock_manager,
                   LogManager *log_manager); // delete
   bool UpdateTuple(const Tuple &new_tuple, Tuple &old_tuple, const RID &rid,
@@ -56,8 +99,9 @@ public:
                    LogManager *log_manager);
 
   // commit/abort time
-  void ApplyDelete(const RID &rid, Transaction *txn,
-                   LogManager *log_manager); // when commit success
+  // deleted_tuple, if given, returns the tuple as it was stored
+  void ApplyDelete(const RID &rid, Transaction *txn, LogManager *log_manager,
+                   Tuple *deleted_tuple = nullptr); // when commit success
   void RollbackDelete(const RID &rid, Transaction *txn,
                       LogManager *log_manager); // when commit abort
 
@@ -71,19 +115,30 @@ public:
   bool GetFirstTupleRid(RID &first_rid);
   bool GetNextTupleRid(const RID &cur_rid, RID &next_rid);
 
+protected:
+  void SetLayout(PageLayout layout);
+  int32_t GetFreeSpacePointer(); // offset of the beginning of free space
+  void SetFreeSpacePointer(int32_t free_space_pointer);
+  int32_t GetFragmentedSize(); // bytes of deleted tuples among the tuples
+  void SetFragmentedSize(int32_t fragmented_size);
+  int32_t GetTupleCount(); // Note that this tuple count may be larger than # of
+                           // actual tuples because some slots may be empty
+  void SetTupleCount(int32_t tuple_count);
+
 private:
   /**
    * helper functions
    */
+  void InsertTupleAt(int slot_num, const Tuple &tuple, RID &rid,
+                     Transaction *txn, LockManager *lock_manager,
+                     LogManager *log_manager);
   int32_t GetTupleOffset(int slot_num);
   int32_t GetTupleSize(int slot_num);
   void SetTupleOffset(int slot_num, int32_t offset);
   void SetTupleSize(int slot_num, int32_t offset);
-  int32_t GetFreeSpacePointer(); // offset of the beginning of free space
-  void SetFreeSpacePointer(int32_t free_space_pointer);
-  int32_t GetTupleCount(); // Note that this tuple count may be larger than # of
-                           // actual tuples because some slots may be empty
-  void SetTupleCount(int32_t tuple_count);
-  int32_t GetFreeSpaceSize();
+  // bytes between the slot array and the tuples
+  int32_t GetContiguousFreeSpaceSize();
+  int GetFreeSlotHead(); // first empty slot, INVALID_SLOT_NUM if none
+  void SetFreeSlotHead(int slot_num);
 };
 } // namespace scudb
@@ -0,0 +1,63 @@
+/**
+ * column_batch.h
+ *
+ * Column vectors of the tuples of one page, as a columnar scan returns them
+ * (see ColumnIterator). The values of a fixed-size column are packed one
+ * after the other in their storage format, so an aggregate reads them as a
+ * plain array. A varied-sized value is kept as its length and bytes, the
+ * way Value::DeserializeFrom reads it.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "common/rid.h"
+#include "type/value.h"
+
+namespace scudb {
+
+class ColumnVector {
+public:
+  // width: bytes of a value of an inlined column
+  ColumnVector(TypeId type, bool is_inlined, int32_t width)
+      : type_(type), is_inlined_(is_inlined), width_(width) {}
+
+  inline TypeId GetType() const { return type_; }
+  inline bool IsInlined() const { return is_inlined_; }
+  inline int32_t GetWidth() const { return width_; }
+  // number of values
+  inline int GetSize() const { return size_; }
+  // values of an inlined column, GetWidth() bytes apart
+  inline const char *GetData() const { return data_.data(); }
+
+  Value GetValue(int row) const;
+  // where the value of a row is stored, in its storage format
+  const char *GetValueData(int row) const;
+
+  // append one value, in its storage format
+  void Append(const char *value);
+  // append count values of an inlined column, packed
+  void Append(const char *values, int count);
+  void Clear();
+
+  // bytes of a varied-sized value stored at value, its length included
+  static uint32_t GetVarlenSize(const char *value);
+
+private:
+  TypeId type_;
+  bool is_inlined_;
+  int32_t width_;
+  int size_ = 0;
+  std::vector<char> data_;
+  // where each varied-sized value starts in data_
+  std::vector<size_t> offsets_;
+};
+
+// the tuples of a page: their rids, and a vector for each column scanned
+struct ColumnBatch {
+  std::vector<RID> rids;
+  std::vector<ColumnVector> columns;
+};
+
+} // namespace scudb
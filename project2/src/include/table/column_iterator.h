@@ -0,0 +1,52 @@
+/**
+ * column_iterator.h
+ *
+ * Columnar scan of a table heap: the tuples of one page at a time, as a
+ * ColumnBatch with a vector for each column scanned. The minipages of a PAX
+ * page are copied out as they are, the tuples of a row page are split into
+ * their columns one by one. Varchar values stored out of line are read back
+ * into the batch.
+ * As in a full scan, the pages are fetched through a BufferRing and read
+ * ahead along the page chain.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "buffer/read_ahead.h"
+#include "table/column_batch.h"
+
+namespace scudb {
+
+class BufferRing;
+class TableHeap;
+class TablePage;
+class Transaction;
+
+class ColumnIterator {
+public:
+  ColumnIterator(TableHeap *table_heap, std::vector<int> column_ids,
+                 Transaction *txn, std::shared_ptr<BufferRing> ring);
+
+  // the tuples of the next page that has any, false at the end of the heap.
+  // batch.columns[i] has the values of column column_ids[i]
+  bool NextBatch(ColumnBatch &batch);
+
+private:
+  // split the tuples of a row page into batch
+  void GetColumns(TablePage *page, ColumnBatch &batch);
+  // replace the values of vector stored out of line by the values
+  void ReadToastedValues(ColumnVector &vector);
+
+  TableHeap *table_heap_;
+  std::vector<int> column_ids_;
+  Transaction *txn_;
+  std::shared_ptr<BufferRing> ring_;
+  ReadAhead read_ahead_;
+  // page the next batch is read from
+  page_id_t next_page_id_;
+};
+
+} // namespace scudb
@@ -0,0 +1,94 @@
+/**
+ * free_space_map.h
+ *
+ * Free space map of a table heap, so that an insert goes straight to a page
+ * with room for the tuple instead of trying the pages of the heap in turn.
+ *
+ * The free space of every heap page is kept as a category of one byte, the
+ * number of PAGE_SIZE / FSM_CATEGORIES byte units it has free, rounded down:
+ * a page has at least as much room as its category says. The map is stored
+ * in its own chain of FreeSpaceMapPage, whose first page id is kept in the
+ * first page of the heap, and is read into memory when the heap is opened.
+ * Searches only use the copy in memory, updates are written through to the
+ * map pages.
+ *
+ * A category may claim more room than the page has when a concurrent insert
+ * got there first. The insert then fails, and the caller records the actual
+ * free space and searches again.
+ *
+ * The map also keeps the head of the list of overflow pages the heap freed
+ * (see OverflowStore), so that they are reused by the next values stored out
+ * of line instead of growing the file.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "page/free_space_map_page.h"
+
+namespace scudb {
+
+// free space categories of a heap page, one byte
+#define FSM_CATEGORIES 256
+
+class FreeSpaceMap {
+public:
+  explicit FreeSpaceMap(BufferPoolManager *buffer_pool_manager)
+      : buffer_pool_manager_(buffer_pool_manager) {}
+
+  // new empty map, false if no page could be allocated
+  bool Create();
+  // read the map starting at first_page_id
+  void Open(page_id_t first_page_id);
+  page_id_t GetFirstPageId() const { return first_page_id_; }
+
+  // a heap page with at least size bytes free, INVALID_PAGE_ID if there is
+  // none
+  page_id_t FindPage(int size);
+  // record the free space of a heap page, adding it if the map doesn't have
+  // it yet. false if a new map page could not be allocated
+  bool Update(page_id_t page_id, int free_space);
+  // the heap page added last, the end of the heap
+  page_id_t GetLastPageId();
+  // number of heap pages in the map
+  size_t GetPageCount();
+  // up to count heap pages, page_id and the ones after it. Pages are added
+  // in the order the heap grows, so this is their order in the heap's chain.
+  // false if the map doesn't have page_id
+  bool GetPageIds(page_id_t page_id, size_t count,
+                  std::vector<page_id_t> &page_ids);
+  // head of the list of free overflow pages, written through to the first
+  // map page
+  page_id_t GetFreePageId();
+  void SetFreePageId(page_id_t free_page_id);
+
+  // category of free_space bytes, and the one a page needs to have size bytes
+  static uint8_t ToCategory(int free_space);
+  static uint8_t ToRequiredCategory(int size);
+
+private:
+  void SetCategory(size_t index, uint8_t category);
+  bool Append(page_id_t page_id, uint8_t category);
+
+  BufferPoolManager *buffer_pool_manager_;
+  page_id_t first_page_id_ = INVALID_PAGE_ID;
+  std::mutex latch_;
+  // map pages, in chain order
+  std::vector<page_id_t> map_pages_;
+  // heap pages and their categories, in map order
+  std::vector<page_id_t> heap_pages_;
+  std::vector<uint8_t> categories_;
+  // largest category of the heap pages of each map page
+  std::vector<uint8_t> max_categories_;
+  // position of a heap page in heap_pages_
+  std::unordered_map<page_id_t, size_t> positions_;
+  // page the last search found, tried first by the next one
+  size_t hint_ = 0;
+  page_id_t free_page_id_ = INVALID_PAGE_ID;
+};
+
+} // namespace scudb
@@ -0,0 +1,75 @@
+/**
+ * overflow_store.h
+ *
+ * Out of line storage of large varchar values, in the way of TOAST. When a
+ * tuple is larger than TOAST_TUPLE_THRESHOLD its largest varchar values are
+ * moved to chains of OverflowPage, compressed when TOAST_COMPRESSION is set
+ * and that makes them smaller, until the tuple is no larger than the
+ * threshold. The tuple keeps a ToastPointer in place of each value.
+ *
+ * The values are only read back when one is asked for, so a scan that does
+ * not read those columns never fetches an overflow page. A chain is written
+ * once and freed when no version of a tuple points to it anymore. Freed
+ * pages are linked into a list whose head the free space map of the heap
+ * keeps, and new chains take their pages from it before asking the buffer
+ * pool for new ones: the disk manager never reuses a page id, so the file
+ * does not shrink, but it only grows when the list is empty.
+ */
+
+#pragma once
+
+#include <mutex>
+
+#include "buffer/buffer_pool_manager.h"
+#include "page/overflow_page.h"
+#include "table/free_space_map.h"
+#include "table/tuple.h"
+
+namespace scudb {
+
+// payload of a varchar value stored out of line
+struct ToastPointer {
+  page_id_t first_page_id;
+  uint32_t raw_length;    // length of the value
+  uint32_t stored_length; // bytes in the chain, less when compressed
+};
+
+class OverflowStore {
+public:
+  // free pages are listed in free_space_map, which is not owned
+  OverflowStore(BufferPoolManager *buffer_pool_manager,
+                FreeSpaceMap *free_space_map)
+      : buffer_pool_manager_(buffer_pool_manager),
+        free_space_map_(free_space_map) {}
+
+  // does tuple have to be toasted before it is stored
+  static bool NeedsToast(const Tuple &tuple, Schema *schema);
+
+  // toasted is tuple with its largest varchar values moved out of line.
+  // false if no page could be allocated, nothing is kept then
+  bool Toast(const Tuple &tuple, Schema *schema, Tuple &toasted);
+  // value of a column, read back from its overflow pages if it was toasted
+  Value GetValue(const Tuple &tuple, Schema *schema, int column_id);
+  // read back a value stored out of line, from its length field and
+  // ToastPointer at data. buffer returns its length and bytes, the way
+  // Value::DeserializeFrom reads them
+  void ReadValue(const char *data, std::vector<char> &buffer);
+  // free the overflow pages the values of tuple are stored in
+  void Delete(const Tuple &tuple, Schema *schema);
+
+private:
+  // write a value to a new chain
+  bool WriteValue(const char *data, uint32_t length, ToastPointer &pointer);
+  // a free page, or a new one when there is none. nullptr if the buffer pool
+  // has no frame
+  Page *NewPage(page_id_t &page_id);
+  // put the pages of a chain on the free list
+  void DeleteChain(page_id_t page_id);
+
+  BufferPoolManager *buffer_pool_manager_;
+  FreeSpaceMap *free_space_map_;
+  // the free list is taken from and added to by one thread at a time
+  std::mutex free_latch_;
+};
+
+} // namespace scudb
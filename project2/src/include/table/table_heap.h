@@ -6,9 +6,16 @@
 
 #pragma once
 
+#include <memory>
+#include <mutex>
+#include <vector>
+
 #include "buffer/buffer_pool_manager.h"
 #include "logging/log_manager.h"
-#include "page/table_page.h"
+#include "page/pax_page.h"
+#include "table/column_iterator.h"
+#include "table/free_space_map.h"
+#include "table/overflow_store.h"
 #include "table/table_iterator.h"
 #include "table/tuple.h"
 
@@ -16,21 +23,36 @@ namespace scudb {
 
 class TableHeap {
   friend class TableIterator;
+  friend class ColumnIterator;
 
 public:
   ~TableHeap() {}
 
-  // open a table heap
+  // open a table heap. With the schema of its tuples, large varchar values
+  // are stored out of line (see OverflowStore), the schema is not owned. The
+  // heap keeps the page layout it was created with
   TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_manager,
-            LogManager *log_manager, page_id_t first_page_id);
+            LogManager *log_manager, page_id_t first_page_id,
+            Schema *schema = nullptr);
 
-  // create table heap
+  // create table heap. Its pages are PaxPage with PageLayout::PAX, which
+  // needs the schema
   TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_manager,
-            LogManager *log_manager, Transaction *txn);
+            LogManager *log_manager, Transaction *txn,
+            Schema *schema = nullptr, PageLayout layout = PageLayout::ROW);
 
-  // for insert, if tuple is too large (>~page_size), return false
+  // for insert, if tuple is too large (>~page_size) after its varchar values
+  // are moved out of line, return false. The free space map picks the page,
+  // the heap grows when no page has room
   bool InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn);
 
+  // insert a batch, rids returns their rids in order. Each page is filled
+  // with as many tuples as fit under one latch, and the heap grows by up to
+  // TABLE_HEAP_EXTEND_PAGES pages at once. false if any tuple was not
+  // inserted, its rid is left invalid; the others may still have been
+  bool InsertTuples(const std::vector<Tuple> &tuples, std::vector<RID> &rids,
+                    Transaction *txn);
+
   bool MarkDelete(const RID &rid, Transaction *txn); // for delete
 
   // if the new tuple is too large to fit in the old page, return false (will
@@ -41,18 +63,48 @@ public:
   void ApplyDelete(const RID &rid,
                    Transaction *txn); // when commit delete or rollback insert
   void RollbackDelete(const RID &rid, Transaction *txn); // when rollback delete
+  // when commit update, old_tuple is the version the update replaced
+  void ApplyUpdate(const Tuple &old_tuple, Transaction *txn);
+
+  // ring: scan ring to fetch the page through, if any
+  bool GetTuple(const RID &rid, Tuple &tuple, Transaction *txn,
+                BufferRing *ring = nullptr);
 
-  bool GetTuple(const RID &rid, Tuple &tuple, Transaction *txn);
+  // value of a column of a tuple of the heap, its overflow pages are only
+  // read when it is stored out of line
+  Value GetValue(const Tuple &tuple, Schema *schema, int column_id);
 
   bool DeleteTableHeap();
 
+  // full scan, its pages cycle through a private BufferRing
   TableIterator begin(Transaction *txn);
 
   TableIterator end();
 
+  // columnar scan of the columns column_ids, a page at a time. The pages
+  // cycle through a private BufferRing as in a full scan
+  std::unique_ptr<ColumnIterator>
+  ScanColumns(const std::vector<int> &column_ids, Transaction *txn);
+
   inline page_id_t GetFirstPageId() const { return first_page_id_; }
 
+  inline PageLayout GetLayout() const { return layout_; }
+
 private:
+  // insert tuples as they are stored. StoreTuples returns how many were
+  // inserted, the rids of the others are left invalid
+  bool StoreTuple(const Tuple &tuple, RID &rid, Transaction *txn);
+  size_t StoreTuples(const std::vector<Tuple> &tuples, std::vector<RID> &rids,
+                     Transaction *txn);
+
+  // count new pages at the end of the heap, the first one returned write
+  // latched. Fewer may be added when the buffer pool runs out of frames
+  TablePage *AppendPages(int count, Transaction *txn);
+  void InitPage(TablePage *page, page_id_t page_id, page_id_t prev_page_id,
+                Transaction *txn);
+  // names the pages ahead of a scan, from the free space map
+  PageWindowFn GetPageWindow();
+
   /**
    * Members
    */
@@ -60,6 +112,13 @@ private:
   LockManager *lock_manager_;
   LogManager *log_manager_;
   page_id_t first_page_id_;
+  FreeSpaceMap free_space_map_;
+  // nullptr if values are never stored out of line
+  Schema *schema_;
+  OverflowStore overflow_store_;
+  PageLayout layout_;
+  // one page is appended at a time
+  std::mutex append_latch_;
 };
 
 } // namespace scudb
@@ -2,24 +2,30 @@
  * table_iterator.h
  *
  * For seq scan of table heap
+ * The pages of a full scan are fetched through a BufferRing shared by all
+ * the copies of the iterator, and read ahead along the page chain.
  */
 
 #pragma once
 
 #include <cassert>
+#include <memory>
 
+#include "buffer/read_ahead.h"
 #include "common/rid.h"
 #include "table/tuple.h"
 
 namespace scudb {
 
+class BufferRing;
 class TableHeap;
 
 class TableIterator {
   friend class Cursor;
 
 public:
-  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn);
+  TableIterator(TableHeap *table_heap, RID rid, Transaction *txn,
+                std::shared_ptr<BufferRing> ring = nullptr);
 
   ~TableIterator() { delete tuple_; }
 
@@ -43,6 +49,8 @@ private:
   TableHeap *table_heap_;
   Tuple *tuple_;
   Transaction *txn_;
+  std::shared_ptr<BufferRing> ring_;
+  ReadAhead read_ahead_;
 };
 
 } // namespace scudb
\ No newline at end of file
@@ -5,6 +5,10 @@
  *  ------------------------------------------------------------------
  * | FIXED-SIZE or VARIED-SIZED OFFSET | PAYLOAD OF VARIED-SIZED FIELD|
  *  ------------------------------------------------------------------
+ *
+ * A varied-sized value may be stored out of line by its table heap (see
+ * OverflowStore). Its length field then has TOAST_POINTER_FLAG set, and the
+ * payload is the pointer to the value instead of the value.
  */
 
 #pragma once
@@ -15,9 +19,16 @@
 
 namespace scudb {
 
+// length flag of a varied-sized value stored out of line
+#define TOAST_POINTER_FLAG 0x80000000u
+
 class Tuple {
   friend class TablePage;
 
+  friend class PaxPage;
+
+  friend class OverflowStore;
+
   friend class TableHeap;
 
   friend class TableIterator;
@@ -60,9 +71,13 @@ public:
   inline int32_t GetLength() const { return size_; }
 
   // Get the value of a specified column (const)
-  // checks the schema to see how to return the Value.
+  // checks the schema to see how to return the Value. A value stored out of
+  // line is read through TableHeap::GetValue instead
   Value GetValue(Schema *schema, const int column_id) const;
 
+  // Is the column value stored out of line ?
+  bool IsToasted(Schema *schema, const int column_id) const;
+
   // Is the column value null ?
   inline bool IsNull(Schema *schema, const int column_id) const {
     Value value = GetValue(schema, column_id);
@@ -22,6 +22,11 @@ IndexMetadata *ParseIndexStatement(std::string &sql,
                                    const std::string &table_name,
                                    Schema *schema);
 
+// the arguments after the schema: the index of the table, and 'pax' for the
+// columnar page layout, which is returned
+PageLayout ParseTableOptions(int argc, const char *const *argv,
+                             std::string &index_string);
+
 Tuple ConstructTuple(Schema *schema, sqlite3_value **argv);
 
 Index *ConstructIndex(IndexMetadata *metadata,
@@ -55,18 +60,24 @@ int VtabColumn(sqlite3_vtab_cursor *cur, sqlite3_context *ctx, int i);
 
 int VtabRowid(sqlite3_vtab_cursor *cur, sqlite3_int64 *pRowid);
 
+int VtabSync(sqlite3_vtab *pVTab);
+
 int VtabCommit(sqlite3_vtab *pVTab);
 
+int VtabRollback(sqlite3_vtab *pVTab);
+
 int VtabBegin(sqlite3_vtab *pVTab);
 
 // storage engine
 class StorageEngine {
 public:
-  StorageEngine(std::string db_file_name) {
+  // page_size only applies when the db file is created
+  StorageEngine(std::string db_file_name, int page_size = DEFAULT_PAGE_SIZE) {
     ENABLE_LOGGING = false;
 
     // storage related
-    disk_manager_ = new DiskManager(db_file_name);
+    disk_manager_ =
+        new DiskManager(db_file_name, DiskIOMode::STREAM, page_size);
 
     // log related
     log_manager_ = new LogManager(disk_manager_);
@@ -104,19 +115,21 @@ class VirtualTable {
   friend class Cursor;
 
 public:
+  // layout only applies when the table is created
   VirtualTable(Schema *schema, BufferPoolManager *buffer_pool_manager,
                LockManager *lock_manager, LogManager *log_manager, Index *index,
-               page_id_t first_page_id = INVALID_PAGE_ID)
+               page_id_t first_page_id = INVALID_PAGE_ID,
+               PageLayout layout = PageLayout::ROW)
       : schema_(schema), index_(index) {
     if (first_page_id != INVALID_PAGE_ID) {
       // reopen an exist table
       table_heap_ = new TableHeap(buffer_pool_manager, lock_manager,
-                                  log_manager, first_page_id);
+                                  log_manager, first_page_id, schema);
     } else {
       // create table for the first time
       Transaction *txn = storage_engine_->transaction_manager_->Begin();
-      table_heap_ =
-          new TableHeap(buffer_pool_manager, lock_manager, log_manager, txn);
+      table_heap_ = new TableHeap(buffer_pool_manager, lock_manager,
+                                  log_manager, txn, schema, layout);
       storage_engine_->transaction_manager_->Commit(txn);
     }
   }
@@ -136,15 +149,66 @@ public:
   inline void InsertEntry(const Tuple &tuple, const RID &rid) {
     if (index_ == nullptr)
       return;
-    // construct indexed key tuple
-    std::vector<Value> key_values;
+    index_->InsertEntry(GetKey(tuple), rid, GetTransaction());
+  }
 
+  // insert the row of a tuple the table heap already has into index, when
+  // the transaction that deleted or updated it is rolled back
+  inline void InsertEntry(const RID &rid) {
+    if (index_ == nullptr)
+      return;
+    Tuple tuple(rid);
+    if (!table_heap_->GetTuple(rid, tuple, GetTransaction()))
+      return;
+    std::vector<Value> key_values;
     for (auto &i : index_->GetKeyAttrs())
-      key_values.push_back(tuple.GetValue(schema_, i));
-    Tuple key(key_values, index_->GetKeySchema());
-    index_->InsertEntry(key, rid, GetTransaction());
+      key_values.push_back(table_heap_->GetValue(tuple, schema_, i));
+    index_->InsertEntry(Tuple(key_values, index_->GetKeySchema()), rid,
+                        GetTransaction());
+  }
+
+  // insert a batch into table heap and index. The rows that went into the
+  // table heap are indexed even when others did not, false then
+  inline bool InsertTuples(const std::vector<Tuple> &tuples) {
+    std::vector<RID> rids;
+    bool inserted = table_heap_->InsertTuples(tuples, rids, GetTransaction());
+    if (index_ == nullptr)
+      return inserted;
+    std::vector<Tuple> keys;
+    std::vector<RID> stored_rids;
+    keys.reserve(tuples.size());
+    stored_rids.reserve(tuples.size());
+    for (size_t i = 0; i < tuples.size(); i++) {
+      if (rids[i].GetPageId() == INVALID_PAGE_ID)
+        continue;
+      keys.push_back(GetKey(tuples[i]));
+      stored_rids.push_back(rids[i]);
+    }
+    index_->InsertEntries(keys, stored_rids, GetTransaction());
+    return inserted;
+  }
+
+  // keep a row for InsertTuples, a full batch is inserted right away. false
+  // if that failed
+  inline bool BufferInsert(const Tuple &tuple) {
+    pending_inserts_.push_back(tuple);
+    if (pending_inserts_.size() == VTAB_INSERT_BATCH_SIZE)
+      return FlushInserts();
+    return true;
+  }
+
+  // insert the rows kept by BufferInsert, false if any of them failed
+  inline bool FlushInserts() {
+    if (pending_inserts_.empty())
+      return true;
+    bool inserted = InsertTuples(pending_inserts_);
+    pending_inserts_.clear();
+    return inserted;
   }
 
+  // drop the rows kept by BufferInsert, the transaction is rolled back
+  inline void DiscardInserts() { pending_inserts_.clear(); }
+
   // delete from table heap
   // TODO: call makrdelete method from heaptable
   inline bool DeleteTuple(const RID &rid) {
@@ -161,9 +225,9 @@ public:
     std::vector<Value> key_values;
 
     for (auto &i : index_->GetKeyAttrs())
-      key_values.push_back(deleted_tuple.GetValue(schema_, i));
+      key_values.push_back(table_heap_->GetValue(deleted_tuple, schema_, i));
     Tuple key(key_values, index_->GetKeySchema());
-    index_->DeleteEntry(key, GetTransaction());
+    index_->DeleteEntry(key, rid, GetTransaction());
   }
 
   // update table heap tuple
@@ -176,6 +240,17 @@ public:
 
   inline TableIterator end() { return table_heap_->end(); }
 
+  // fill a newly declared index with the tuples already in the table,
+  // bottom up from the sorted keys instead of one insert per tuple
+  inline bool BuildIndex() {
+    if (index_ == nullptr)
+      return false;
+    Transaction *txn = storage_engine_->transaction_manager_->Begin();
+    bool built = index_->BulkLoad(table_heap_, schema_, txn);
+    storage_engine_->transaction_manager_->Commit(txn);
+    return built;
+  }
+
   inline Schema *GetSchema() { return schema_; }
 
   inline Index *GetIndex() { return index_; }
@@ -184,7 +259,21 @@ public:
 
   inline page_id_t GetFirstPageId() { return table_heap_->GetFirstPageId(); }
 
+  // are full scans columnar, the table has the PAX layout
+  inline bool IsColumnar() {
+    return table_heap_->GetLayout() == PageLayout::PAX;
+  }
+
 private:
+  // construct indexed key tuple
+  inline Tuple GetKey(const Tuple &tuple) {
+    std::vector<Value> key_values;
+
+    for (auto &i : index_->GetKeyAttrs())
+      key_values.push_back(tuple.GetValue(schema_, i));
+    return Tuple(key_values, index_->GetKeySchema());
+  }
+
   sqlite3_vtab base_;
   // virtual table schema
   Schema *schema_;
@@ -192,13 +281,16 @@ private:
   TableHeap *table_heap_;
   // to insert/delete index entry
   Index *index_ = nullptr;
+  // rows inserted by VtabUpdate that are not in the table heap yet
+  std::vector<Tuple> pending_inserts_;
 };
 
 class Cursor {
 public:
   Cursor(VirtualTable *virtual_table)
-      : table_iterator_(virtual_table->begin()), virtual_table_(virtual_table) {
-  }
+      : table_iterator_(virtual_table->IsColumnar() ? virtual_table->end()
+                                                    : virtual_table->begin()),
+        virtual_table_(virtual_table) {}
 
   inline void SetScanFlag(bool is_index_scan) {
     is_index_scan_ = is_index_scan;
@@ -215,27 +307,45 @@ public:
   inline int64_t GetCurrentRid() {
     if (is_index_scan_)
       return results[offset_].Get();
+    else if (column_scan_ != nullptr)
+      return batch_.rids[row_].Get();
     else
       return (*table_iterator_).GetRid().Get();
   }
 
-  // return tuple at which cursor is currently pointed
+  // return tuple at which cursor is currently pointed. Only the columns
+  // asked for are read from overflow pages
   inline Value GetCurrentValue(Schema *schema, int column) {
-    if (is_index_scan_) {
-      RID rid = results[offset_];
+    TableHeap *table_heap = virtual_table_->table_heap_;
+    if (!is_index_scan_ && column_scan_ != nullptr &&
+        column_positions_[column] != -1) {
+      return batch_.columns[column_positions_[column]].GetValue(row_);
+    } else if (is_index_scan_ || column_scan_ != nullptr) {
+      // a column the columnar scan was not asked for is read from the tuple
+      RID rid = is_index_scan_ ? results[offset_] : batch_.rids[row_];
       Tuple tuple(rid);
-      virtual_table_->table_heap_->GetTuple(rid, tuple, GetTransaction());
-      return tuple.GetValue(schema, column);
+      table_heap->GetTuple(rid, tuple, GetTransaction());
+      return table_heap->GetValue(tuple, schema, column);
     } else {
-      return table_iterator_->GetValue(schema, column);
+      return table_heap->GetValue(*table_iterator_, schema, column);
     }
   }
 
   // move cursor up to next
   Cursor &operator++() {
-    if (is_index_scan_)
-      ++offset_;
-    else
+    if (is_index_scan_) {
+      // a range scan goes on with its next batch
+      if (++offset_ == static_cast<int>(results.size()) &&
+          range_scan_ != nullptr) {
+        range_scan_->NextBatch(results);
+        offset_ = 0;
+      }
+    } else if (column_scan_ != nullptr) {
+      if (++row_ == static_cast<int>(batch_.rids.size())) {
+        column_scan_->NextBatch(batch_);
+        row_ = 0;
+      }
+    } else
       ++table_iterator_;
     return *this;
   }
@@ -243,22 +353,55 @@ public:
   inline bool isEof() {
     if (is_index_scan_)
       return offset_ == static_cast<int>(results.size());
+    else if (column_scan_ != nullptr)
+      return row_ == static_cast<int>(batch_.rids.size());
     else
       return table_iterator_ == virtual_table_->end();
   }
 
   // wrapper around poit scan methods
   inline void ScanKey(const Tuple &key) {
+    range_scan_.reset();
+    offset_ = 0;
     virtual_table_->index_->ScanKey(key, results);
   }
 
+  // the rows of the keys from low to high, a nullptr bound is open
+  inline void ScanRange(const Tuple *low, bool low_inclusive,
+                        const Tuple *high, bool high_inclusive) {
+    range_scan_ = virtual_table_->index_->ScanRange(
+        low, low_inclusive, high, high_inclusive, SIZE_MAX, GetTransaction());
+    offset_ = 0;
+    range_scan_->NextBatch(results);
+  }
+
+  // full scan of a columnar table, that reads the columns column_ids a page
+  // at a time
+  inline void ScanColumns(const std::vector<int> &column_ids) {
+    column_scan_ = virtual_table_->table_heap_->ScanColumns(column_ids,
+                                                            GetTransaction());
+    column_positions_.assign(virtual_table_->schema_->GetColumnCount(), -1);
+    for (size_t i = 0; i < column_ids.size(); i++)
+      column_positions_[column_ids[i]] = i;
+    row_ = 0;
+    column_scan_->NextBatch(batch_);
+  }
+
 private:
   sqlite3_vtab_cursor base_; /* Base class - must be first */
   // for index scan
   std::vector<RID> results;
   int offset_ = 0;
+  // batches of a range scan
+  std::unique_ptr<IndexRangeScan> range_scan_;
   // for sequential scan
   TableIterator table_iterator_;
+  // for columnar scan, the batch of the current page and the row in it
+  std::unique_ptr<ColumnIterator> column_scan_;
+  ColumnBatch batch_;
+  int row_ = 0;
+  // position of a column in the batch, -1 if it is not scanned
+  std::vector<int> column_positions_;
   // flag to indicate which scan method is currently used
   bool is_index_scan_ = false;
   VirtualTable *virtual_table_;
@@ -1,6 +1,7 @@
 /**
  * b_plus_tree.cpp
  */
+#include <algorithm>
 #include <iostream>
 #include <string>
 
@@ -17,9 +18,31 @@ namespace scudb {
     BPLUSTREE_TYPE::BPlusTree(const std::string &name, ////B+tree‘s name
                               BufferPoolManager *buffer_pool_manager, ////缓冲池
                               const KeyComparator &comparator,
-                              page_id_t root_page_id) ////tree rootpage号
+                              page_id_t root_page_id, ////tree rootpage号
+                              bool unique)
             : index_name_(name), root_page_id_(root_page_id),
-              buffer_pool_manager_(buffer_pool_manager), comparator_(comparator) {}
+              buffer_pool_manager_(buffer_pool_manager), comparator_(comparator),
+              key_format_(IndexKeyFormat::PAIRS), optimistic_reads_(true),
+              optimistic_writes_(true), unique_(unique) {
+        ////按comparator选择最合适的page格式
+        if (comparator.IsNormalized()) {
+            key_format_ = IndexKeyFormat::PREFIX_COMPRESSED;
+        } else if (comparator.IsIntegerKey()) {
+            key_format_ = IndexKeyFormat::KEY_ARRAY;
+        }
+    }
+
+    ////设置新page的格式，comparator不支持的格式退回键值对格式，已有的page保持原格式
+    INDEX_TEMPLATE_ARGUMENTS
+    void BPLUSTREE_TYPE::SetKeyFormat(IndexKeyFormat key_format) {
+        if ((key_format == IndexKeyFormat::PREFIX_COMPRESSED &&
+             !comparator_.IsNormalized()) ||
+            (key_format == IndexKeyFormat::KEY_ARRAY &&
+             !comparator_.IsIntegerKey())) {
+            key_format = IndexKeyFormat::PAIRS;
+        }
+        key_format_ = key_format;
+    }
 
 /*
  * Helper function to decide whether current b+tree is empty
@@ -40,17 +63,51 @@ namespace scudb {
 /*
  * Return the only value that associated with input key
  * This method is used for point query
+ * A non-unique tree returns all values of the key, read from its posting list
+ * while the leaf is latched, in the one visit of the leaf
  * @return : true means key exists
  */
     INDEX_TEMPLATE_ARGUMENTS
     bool BPLUSTREE_TYPE::GetValue(const KeyType &key,
                                   std::vector<ValueType> &result,
                                   Transaction *transaction) {
+        ////先不加latch查找，被writer打断几次后再按crabbing加latch
+        if (optimistic_reads_ && key_format_ != IndexKeyFormat::PREFIX_COMPRESSED) {
+            ValueType value;
+            bool found;
+            for (int i = 0; i < OPTIMISTIC_READ_RETRIES; i++) {
+                if (OptimisticGetValue(key, value, found)) {
+                    ////posting list要在leaf的latch下读
+                    if (found && BPlusTreePostingPage::IsPostingList(value)) break;
+                    if (unique_) {
+                        result.resize(1);
+                        if (found) result[0] = value;
+                    } else {
+                        result.clear();
+                        if (found) result.push_back(value);
+                    }
+                    return found;
+                }
+                if (IsEmpty()) break;
+            }
+        }
 
         ////B+树中value都存储在叶子节点，故先找到它
         B_PLUS_TREE_LEAF_PAGE_TYPE *tar_page = FindLeafPage(key,false,eOpType::READ,transaction);
         if (tar_page == nullptr)
             return false;
+        else if (!unique_) {
+            result.clear();
+            ValueType value;
+            auto ret_val = tar_page->Lookup(key,value,comparator_);
+            if (ret_val && BPlusTreePostingPage::IsPostingList(value)) {
+                BPlusTreePostingPage::GetList(buffer_pool_manager_, value, result);
+            } else if (ret_val) {
+                result.push_back(value);
+            }
+            FreePagesInTransaction(false,transaction,tar_page->GetPageId());
+            return ret_val;
+        }
         else {////正确找到
             //find value
             result.resize(1);
@@ -64,6 +121,66 @@ namespace scudb {
 
     }
 
+/*
+ * Optimistic lock coupling: go down to the leaf without latching any page.
+ * The version of every page is read before using the page and checked again
+ * before going on to the child (and, for the leaf, after the lookup), so a
+ * page that a writer latched in between is noticed. The child is pinned
+ * before its parent is checked the last time, so it can't be dropped from
+ * the tree and its frame reused while it is read.
+ * Prefix compressed pages are not read this way, their entry width changes
+ * with the prefix, and a header read while a writer changes it could send the
+ * lookup past the page.
+ * @return : false means a writer got in the way or the tree is empty, found
+ * and value are unset
+ */
+    INDEX_TEMPLATE_ARGUMENTS
+    bool BPLUSTREE_TYPE::OptimisticGetValue(const KeyType &key, ValueType &value,
+                                            bool &found) {
+        page_id_t page_id = __atomic_load_n(&root_page_id_, __ATOMIC_ACQUIRE);
+        if (page_id == INVALID_PAGE_ID) return false; ////空树交给加latch的查找
+        Page *page = buffer_pool_manager_->FetchPage(page_id);
+        if (page == nullptr) return false;
+        uint64_t version = page->GetVersion();
+        ////版本号为奇数说明writer持有latch；读到版本号后root不能变
+        if ((version & 1) ||
+            page_id != __atomic_load_n(&root_page_id_, __ATOMIC_ACQUIRE)) {
+            buffer_pool_manager_->UnpinPage(page_id, false);
+            return false;
+        }
+        auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+        while (!node->IsLeafPage() && !node->IsCompressed()) {
+            ////未验证的size可能是写了一半的，限制在page之内再查找
+            int size = std::max(1, std::min(node->GetSize(), node->GetMaxSize() + 1));
+            page_id_t child_id =
+                    static_cast<B_PLUS_TREE_INTERNAL_PAGE *>(node)->Lookup(
+                            key, comparator_, size);
+            Page *child = page->ValidateVersion(version) ?
+                          buffer_pool_manager_->FetchPage(child_id) : nullptr;
+            uint64_t child_version = child != nullptr ? child->GetVersion() : 1;
+            ////pin住child后parent仍未变，child才确实是它的孩子
+            bool valid = !(child_version & 1) && page->ValidateVersion(version);
+            buffer_pool_manager_->UnpinPage(page_id, false);
+            if (!valid) {
+                if (child != nullptr) buffer_pool_manager_->UnpinPage(child_id, false);
+                return false;
+            }
+            page = child;
+            page_id = child_id;
+            version = child_version;
+            node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+        }
+        bool valid = node->IsLeafPage() && !node->IsCompressed();
+        if (valid) {
+            int size = std::max(0, std::min(node->GetSize(), node->GetMaxSize() + 1));
+            found = static_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(node)->Lookup(
+                    key, value, comparator_, size);
+            valid = page->ValidateVersion(version);
+        }
+        buffer_pool_manager_->UnpinPage(page_id, false);
+        return valid;
+    }
+
 /*****************************************************************************
  * INSERTION
  *****************************************************************************/
@@ -71,12 +188,32 @@ namespace scudb {
  * Insert constant key & value pair into b+ tree
  * if current tree is empty, start new tree, update root page id and insert
  * entry, otherwise insert into leaf page.
- * @return: since we only support unique key, if user try to insert duplicate
- * keys return false, otherwise return true.
+ * @return: for unique keys, if user try to insert duplicate keys return false,
+ * otherwise return true. A non-unique tree returns false for a duplicate key &
+ * value pair only.
  */
 INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value,
                             Transaction *transaction) {
+    ////先只给leaf加写latch，leaf会分裂时再从根部加写latch重来
+    if (optimistic_writes_) {
+        Page *page = FindLeafPageToWrite(key);
+        if (page != nullptr) {
+            auto *leaf = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
+            ValueType v;
+            bool exist = leaf->Lookup(key,v,comparator_);
+            ////key已存在时只改posting list，leaf的大小不变
+            bool inserted = exist && !unique_ && InsertIntoPostingList(leaf,key,v,value);
+            bool safe = !exist && leaf->isSafe(eOpType::INSERT);
+            if (safe) {
+                leaf->Insert(key,value,comparator_);
+                inserted = true;
+            }
+            page->WUnlatch();
+            buffer_pool_manager_->UnpinPage(page->GetPageId(), inserted);
+            if (exist || safe) return inserted;
+        }
+    }
     ////insert从根部寻找插入index
     LockRootPageId(true);////先找到根的page_id
     if (IsEmpty()) {////树为空，则创建新树
@@ -90,6 +227,54 @@ bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value,
         return is_success;
     }
 }
+
+/*
+ * The leaf of the first key of a run is write latched like for Insert. The
+ * keys after it belong to the same leaf as long as they are not past its
+ * last key, or the leaf is the last one. A run stops at a key outside the
+ * leaf, or one that would split it, which goes through Insert.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+size_t BPLUSTREE_TYPE::InsertBatch(const std::vector<std::pair<KeyType, ValueType>> &entries,
+                                   Transaction *transaction) {
+    size_t inserted = 0;
+    size_t i = 0;
+    while (i < entries.size()) {
+        Page *page = optimistic_writes_ ? FindLeafPageToWrite(entries[i].first) : nullptr;
+        size_t start = i;
+        if (page != nullptr) {
+            auto *leaf = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
+            bool dirty = false;
+            for (; i < entries.size(); i++) {
+                const KeyType &key = entries[i].first;
+                ////key超出leaf的范围，run到此为止
+                if (i > start && leaf->GetNextPageId() != INVALID_PAGE_ID &&
+                    comparator_(key, leaf->KeyAt(leaf->GetSize() - 1)) > 0) break;
+                ValueType v;
+                if (leaf->Lookup(key,v,comparator_)) {
+                    if (!unique_ && InsertIntoPostingList(leaf,key,v,entries[i].second)) {
+                        inserted++;
+                        dirty = true;
+                    }
+                } else if (leaf->isSafe(eOpType::INSERT)) {
+                    leaf->Insert(key,entries[i].second,comparator_);
+                    inserted++;
+                    dirty = true;
+                } else {
+                    break;////leaf要分裂
+                }
+            }
+            page->WUnlatch();
+            buffer_pool_manager_->UnpinPage(page->GetPageId(), dirty);
+        }
+        ////空树或第一个key就要分裂leaf，走普通insert
+        if (i == start) {
+            inserted += Insert(entries[i].first, entries[i].second, transaction);
+            i++;
+        }
+    }
+    return inserted;
+}
 /*
  * Insert constant key & value pair into an empty tree
  * User needs to first ask for new page from buffer pool manager(NOTICE: throw
@@ -106,14 +291,15 @@ bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value,
         //// 构建B+tree root
         auto *root = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(root_page->GetData());
 
-        ////更新B+数根部的page——id
-        root->Init(id,INVALID_PAGE_ID);////调用init函数初始化B+树的leaf——page
-        root_page_id_ = id;
-        UpdateRootPageId(true);//调用函数，更新
+        root->Init(id,INVALID_PAGE_ID,key_format_);////调用init函数初始化B+树的leaf——page
 
         ////调用insert函数，插入要加到新tree中的键值对
         root->Insert(key,value,comparator_);
 
+        ////更新B+数根部的page——id，root写好后才发布给不加latch的reader
+        __atomic_store_n(&root_page_id_, id, __ATOMIC_RELEASE);
+        UpdateRootPageId(true);//调用函数，更新
+
         ////unpin，接触封锁
         buffer_pool_manager_->UnpinPage(id,true);
     }
@@ -123,8 +309,8 @@ bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value,
  * User needs to first find the right leaf page as insertion target, then look
  * through leaf page to see whether insert key exist or not. If exist, return
  * immdiately, otherwise insert entry. Remember to deal with split if necessary.
- * @return: since we only support unique key, if user try to insert duplicate
- * keys return false, otherwise return true.
+ * @return: for unique keys, if user try to insert duplicate keys return false,
+ * otherwise return true.
  */
     ////函数作用：向leaf中插入键值对
     INDEX_TEMPLATE_ARGUMENTS
@@ -135,9 +321,10 @@ bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value,
         ValueType v;
         ////查看是否存在此键值对
         bool exist = leaf_page->Lookup(key,v,comparator_);
-        if (exist) {////存在此键值对，插入失败
+        if (exist) {////存在此key，unique的树插入失败，否则加到posting list
+            bool inserted = !unique_ && InsertIntoPostingList(leaf_page,key,v,value);
             FreePagesInTransaction(true,transaction);
-            return false;
+            return inserted;
         } else { ////不存在，可以插入
             ////调用函数插入此键值对
             leaf_page->Insert(key,value,comparator_);
@@ -156,6 +343,28 @@ bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value,
 
     }
 
+/*
+ * Add value to a key of a non-unique tree that the write latched leaf holds
+ * already with old_value. The second value of a key turns the leaf entry into
+ * a reference to a new posting list.
+ * @return: false means the key has the value already
+ */
+    INDEX_TEMPLATE_ARGUMENTS
+    bool BPLUSTREE_TYPE::InsertIntoPostingList(B_PLUS_TREE_LEAF_PAGE_TYPE *leaf,
+                                               const KeyType &key,
+                                               const ValueType &old_value,
+                                               const ValueType &value) {
+        if (BPlusTreePostingPage::IsPostingList(old_value)) {
+            return BPlusTreePostingPage::InsertIntoList(buffer_pool_manager_, old_value, value);
+        }
+        if (old_value == value) return false;
+        ValueType values[2] = {old_value, value};
+        if (BPlusTreePostingPage::RidLess(value, old_value)) std::swap(values[0], values[1]);
+        leaf->Update(key, BPlusTreePostingPage::CreateList(buffer_pool_manager_, values, 2),
+                     comparator_);
+        return true;
+    }
+
 /*
  * Split input page and return newly created page.
  * Using template N to represent either internal page or leaf page.
@@ -178,7 +387,7 @@ bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value,
         ////分裂，
         ////初始化新的节点，并将原来的page中中间往后的放在新的page中
         N *new_node = reinterpret_cast<N *>(new_page->GetData());
-        new_node->Init(new_page_id, node->GetParentPageId());
+        new_node->Init(new_page_id, node->GetParentPageId(), node->GetKeyFormat());
         node->MoveHalfTo(new_node, buffer_pool_manager_);
 
         ////返回新创建的node
@@ -201,16 +410,18 @@ bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value,
                                           Transaction *transaction) {
         ////插入键值对到parent，在insert和分裂时使用
         if (old_node->IsRootPage()) {////元节点是父节点
-            Page* const new_page = buffer_pool_manager_->NewPage(root_page_id_);
+            page_id_t new_root_id;
+            Page* const new_page = buffer_pool_manager_->NewPage(new_root_id);
 
             ////群殴那个球新page，然后初始化并构造root节点
             auto *new_root = reinterpret_cast<B_PLUS_TREE_INTERNAL_PAGE *>(new_page->GetData());
-            new_root->Init(root_page_id_);
+            new_root->Init(new_root_id, INVALID_PAGE_ID, old_node->GetKeyFormat());
             new_root->PopulateNewRoot(old_node->GetPageId(),key,new_node->GetPageId());
 
-            ////更新相关数据
-            old_node->SetParentPageId(root_page_id_);
-            new_node->SetParentPageId(root_page_id_);
+            ////更新相关数据，新root写好后才发布给不加latch的reader
+            old_node->SetParentPageId(new_root_id);
+            new_node->SetParentPageId(new_root_id);
+            __atomic_store_n(&root_page_id_, new_root_id, __ATOMIC_RELEASE);
             UpdateRootPageId();
 
             //buffer_pool unpin
@@ -246,20 +457,96 @@ bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value,
  */
     INDEX_TEMPLATE_ARGUMENTS
     void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {
+        RemoveValue(key, nullptr, transaction);
+    }
+
+/*
+ * Delete one value of the key. The key & value pair of a unique tree is
+ * deleted only if the key has that value.
+ */
+    INDEX_TEMPLATE_ARGUMENTS
+    void BPLUSTREE_TYPE::Remove(const KeyType &key, const ValueType &value,
+                                Transaction *transaction) {
+        RemoveValue(key, &value, transaction);
+    }
+
+    ////value为nullptr时删除key和它所有的value
+    INDEX_TEMPLATE_ARGUMENTS
+    void BPLUSTREE_TYPE::RemoveValue(const KeyType &key, const ValueType *value,
+                                     Transaction *transaction) {
         if (IsEmpty()) return;///空则直接return
-        else{
+        ////先只给leaf加写latch，leaf会低于min size时再从根部加写latch重来
+        if (optimistic_writes_) {
+            Page *page = FindLeafPageToWrite(key);
+            if (page != nullptr) {
+                auto *leaf = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
+                bool dirty = false;
+                bool done = RemoveFromPostingList(leaf,key,value,dirty);
+                if (!done && leaf->isSafe(eOpType::DELETE)) {
+                    RemoveEntry(leaf,key);
+                    done = dirty = true;
+                }
+                page->WUnlatch();
+                buffer_pool_manager_->UnpinPage(page->GetPageId(), dirty);
+                if (done) return;
+            }
+        }
+        {
             ////以Delete模式寻找target page
             auto *tar = FindLeafPage(key,false,eOpType::DELETE,transaction);
+            bool dirty;
             ////remove
-            int cur_size = tar->RemoveAndDeleteRecord(key,comparator_);
-            if (cur_size < tar->GetMinSize()) {////不满足B+树的最小键值对数量要求，则需要合并or再分配
-                CoalesceOrRedistribute(tar,transaction);
+            if (!RemoveFromPostingList(tar,key,value,dirty)) {
+                int cur_size = RemoveEntry(tar,key);
+                if (cur_size < tar->GetMinSize()) {////不满足B+树的最小键值对数量要求，则需要合并or再分配
+                    CoalesceOrRedistribute(tar,transaction);
+                }
             }
             FreePagesInTransaction(true,transaction);
         }
 
     }
 
+/*
+ * Delete value (all values for nullptr) of the key in the write latched leaf
+ * short of deleting the leaf entry, which is left to the caller as it may
+ * underflow the leaf.
+ * @return: true means the entry stays (the key is not there, keeps other
+ * values or doesn't have the value), false means it has to be deleted
+ */
+    INDEX_TEMPLATE_ARGUMENTS
+    bool BPLUSTREE_TYPE::RemoveFromPostingList(B_PLUS_TREE_LEAF_PAGE_TYPE *leaf,
+                                               const KeyType &key,
+                                               const ValueType *value, bool &dirty) {
+        dirty = false;
+        if (unique_ && value == nullptr) return false;
+        ValueType v;
+        if (!leaf->Lookup(key,v,comparator_)) return true;
+        if (!BPlusTreePostingPage::IsPostingList(v)) {
+            return value != nullptr && !(v == *value);
+        }
+        if (value == nullptr) return false;
+        ////posting list至少有两个value，删掉一个后key还在
+        if (BPlusTreePostingPage::RemoveFromList(buffer_pool_manager_, v, *value) &&
+            !BPlusTreePostingPage::IsPostingList(v)) {
+            ////只剩一个value时放回leaf
+            leaf->Update(key,v,comparator_);
+            dirty = true;
+        }
+        return true;
+    }
+
+    ////删除leaf的条目，连同它的posting list，返回leaf的新大小
+    INDEX_TEMPLATE_ARGUMENTS
+    int BPLUSTREE_TYPE::RemoveEntry(B_PLUS_TREE_LEAF_PAGE_TYPE *leaf, const KeyType &key) {
+        ValueType v;
+        if (!unique_ && leaf->Lookup(key,v,comparator_) &&
+            BPlusTreePostingPage::IsPostingList(v)) {
+            BPlusTreePostingPage::DeleteList(buffer_pool_manager_, v);
+        }
+        return leaf->RemoveAndDeleteRecord(key,comparator_);
+    }
+
 /*
  * User needs to first find the sibling of input page. If sibling's size + input
  * page's size > page's max size, then redistribute. Otherwise, merge.
@@ -283,7 +570,7 @@ bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value,
         auto *parent_page = static_cast<B_PLUS_TREE_INTERNAL_PAGE *>(parent);
 
         ////N和N2中的条目可以放在单个节点中
-        if (node->GetSize() + node2->GetSize() <= node->GetMaxSize()) {
+        if (node->GetSize() + node2->GetSize() <= node->GetMaxSizeAfterMerge(node2)) {
             if (is_r_sibling) {swap(node,node2);} ////假设node在node2之后
             int remove_index = parent_page->ValueIndex(node->GetPageId());
             ////调用合并函数，合并node和node2(分裂后保证B+树的要求的调整策略)
@@ -383,14 +670,14 @@ bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value,
     bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) {
         ////更新root节点
         if (old_root_node->IsLeafPage()) {// case 2
-            root_page_id_ = INVALID_PAGE_ID;
+            __atomic_store_n(&root_page_id_, INVALID_PAGE_ID, __ATOMIC_RELEASE);
             UpdateRootPageId();
             return true;
         }
         if (old_root_node->GetSize() == 1) {// case 1
             auto *root = reinterpret_cast<B_PLUS_TREE_INTERNAL_PAGE *>(old_root_node);
             const page_id_t newRootId = root->RemoveAndReturnOnlyChild();
-            root_page_id_ = newRootId;
+            __atomic_store_n(&root_page_id_, newRootId, __ATOMIC_RELEASE);
             UpdateRootPageId();
             Page *page = buffer_pool_manager_->FetchPage(newRootId);
             assert(page != nullptr);
@@ -403,6 +690,207 @@ bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value,
         return false;
     }
 
+/*****************************************************************************
+ * BULK LOAD
+ *****************************************************************************/
+/*
+ * Fill leaves left to right and push the first key of every new page into
+ * its parent, so each level is built as the level below grows. Only the
+ * rightmost page of every level is written to, and it stays pinned until
+ * the end. When a parent is full, its new right sibling starts with the
+ * last child of the parent and the new page, so the last page of a level
+ * always has a left sibling under the same parent. The last pages, which
+ * may be left below min size, are then merged with or refilled from it.
+ */
+    INDEX_TEMPLATE_ARGUMENTS
+    bool BPLUSTREE_TYPE::BulkLoad(
+            const std::function<bool(KeyType &, ValueType &)> &next,
+            double fill_factor) {
+        if (!IsEmpty()) return false;
+        ////每层最右边的page，第0层是叶子
+        std::vector<BPlusTreePage *> right_pages;
+        B_PLUS_TREE_LEAF_PAGE_TYPE *leaf = nullptr;
+        KeyType key, last_key;
+        ValueType value;
+        std::vector<ValueType> values; ////非unique的树里last key的所有value
+        while (next(key, value)) {
+            if (leaf != nullptr && comparator_(last_key, key) >= 0) {
+                assert(comparator_(last_key, key) == 0);////输入必须有序
+                if (!unique_) values.push_back(value);
+                continue;
+            }
+            ////last key的value收齐了
+            BulkLoadPostingList(leaf, last_key, values);
+            if (leaf == nullptr) {
+                leaf = NewBulkLoadPage<B_PLUS_TREE_LEAF_PAGE_TYPE>(INVALID_PAGE_ID);
+                right_pages.push_back(leaf);
+            } else if (leaf->GetSize() >= BulkLoadFillSize(leaf, fill_factor)) {
+                ////叶子满了，key成为新叶子的第一个key
+                auto *new_leaf = NewBulkLoadPage<B_PLUS_TREE_LEAF_PAGE_TYPE>(
+                        leaf->GetParentPageId());
+                KeyType high = leaf->GetHighFence();
+                leaf->SetFences(leaf->GetLowFence(), key);
+                new_leaf->SetFences(key, high);
+                leaf->SetNextPageId(new_leaf->GetPageId());
+                BulkLoadIntoParent(right_pages, 0, leaf, key, new_leaf, fill_factor);
+                buffer_pool_manager_->UnpinPage(leaf->GetPageId(), true);
+                right_pages[0] = leaf = new_leaf;
+            }
+            leaf->Insert(key, value, comparator_);
+            last_key = key;
+            if (!unique_) values.assign(1, value);
+        }
+        if (leaf == nullptr) return true;
+        BulkLoadPostingList(leaf, last_key, values);
+
+        ////自底向上修正每层最右边不足min size的page
+        for (size_t level = 0; level + 1 < right_pages.size(); level++) {
+            auto *parent = reinterpret_cast<B_PLUS_TREE_INTERNAL_PAGE *>(
+                    right_pages[level + 1]);
+            bool merged = level == 0 ?
+                    BulkLoadFixRightmost(
+                            reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(right_pages[0]),
+                            parent) :
+                    BulkLoadFixRightmost(
+                            reinterpret_cast<B_PLUS_TREE_INTERNAL_PAGE *>(right_pages[level]),
+                            parent);
+            if (merged) {
+                ////被合并的page已删除，左兄弟成为最右的page
+                right_pages[level] = nullptr;
+            }
+        }
+        ////root只剩一个孩子时由孩子做root
+        while (right_pages.size() > 1 && right_pages.back()->GetSize() == 1) {
+            BPlusTreePage *old_root = right_pages.back();
+            right_pages.pop_back();
+            page_id_t child_id =
+                    reinterpret_cast<B_PLUS_TREE_INTERNAL_PAGE *>(old_root)->ValueAt(0);
+            if (right_pages.back() == nullptr) {
+                right_pages.back() = FetchPage(child_id);
+            }
+            right_pages.back()->SetParentPageId(INVALID_PAGE_ID);
+            buffer_pool_manager_->UnpinPage(old_root->GetPageId(), true);
+            buffer_pool_manager_->DeletePage(old_root->GetPageId());
+        }
+        __atomic_store_n(&root_page_id_, right_pages.back()->GetPageId(),
+                         __ATOMIC_RELEASE);
+        UpdateRootPageId(true);
+        for (auto *node : right_pages) {
+            if (node != nullptr) {
+                buffer_pool_manager_->UnpinPage(node->GetPageId(), true);
+            }
+        }
+        return true;
+    }
+
+    ////申请并初始化一个新page，保持pin
+    INDEX_TEMPLATE_ARGUMENTS
+    template <typename N>
+    N *BPLUSTREE_TYPE::NewBulkLoadPage(page_id_t parent_id) {
+        page_id_t page_id;
+        Page *page = buffer_pool_manager_->NewPage(page_id);
+        if (page == nullptr) {
+            throw Exception(EXCEPTION_TYPE_INDEX,
+                            "all page are pinned while bulk loading");
+        }
+        auto *node = reinterpret_cast<N *>(page->GetData());
+        node->Init(page_id, parent_id, key_format_);
+        return node;
+    }
+
+    ////page装到多少个条目算满，至少比min size多一个，分给新parent一个孩子后也不会不足
+    INDEX_TEMPLATE_ARGUMENTS
+    int BPLUSTREE_TYPE::BulkLoadFillSize(BPlusTreePage *node, double fill_factor) {
+        int max_size = node->GetMaxSize();
+        int fill_size = std::max(static_cast<int>(fill_factor * max_size),
+                                 max_size / 2 + 1);
+        return std::min(fill_size, max_size);
+    }
+
+    INDEX_TEMPLATE_ARGUMENTS
+    void BPLUSTREE_TYPE::BulkLoadIntoParent(std::vector<BPlusTreePage *> &right_pages,
+                                            int level, BPlusTreePage *old_node,
+                                            const KeyType &key, BPlusTreePage *new_node,
+                                            double fill_factor) {
+        if (level + 1 == static_cast<int>(right_pages.size())) {
+            ////old node是目前的root，建新root
+            auto *root = NewBulkLoadPage<B_PLUS_TREE_INTERNAL_PAGE>(INVALID_PAGE_ID);
+            root->PopulateNewRoot(old_node->GetPageId(), key, new_node->GetPageId());
+            old_node->SetParentPageId(root->GetPageId());
+            new_node->SetParentPageId(root->GetPageId());
+            right_pages.push_back(root);
+            return;
+        }
+        auto *parent = reinterpret_cast<B_PLUS_TREE_INTERNAL_PAGE *>(right_pages[level + 1]);
+        if (parent->GetSize() < BulkLoadFillSize(parent, fill_factor)) {
+            parent->InsertNodeAfter(old_node->GetPageId(), key, new_node->GetPageId());
+            new_node->SetParentPageId(parent->GetPageId());
+            return;
+        }
+        ////parent满了，新parent从old node和new node开始
+        int last_index = parent->GetSize() - 1;
+        assert(parent->ValueAt(last_index) == old_node->GetPageId());
+        KeyType middle_key = parent->KeyAt(last_index);
+        auto *new_parent = NewBulkLoadPage<B_PLUS_TREE_INTERNAL_PAGE>(
+                parent->GetParentPageId());
+        KeyType high = parent->GetHighFence();
+        parent->Remove(last_index);
+        parent->SetFences(parent->GetLowFence(), middle_key);
+        new_parent->SetFences(middle_key, high);
+        new_parent->PopulateNewRoot(old_node->GetPageId(), key, new_node->GetPageId());
+        new_parent->SetKeyAt(0, middle_key);
+        old_node->SetParentPageId(new_parent->GetPageId());
+        new_node->SetParentPageId(new_parent->GetPageId());
+        BulkLoadIntoParent(right_pages, level + 1, parent, middle_key, new_parent,
+                           fill_factor);
+        buffer_pool_manager_->UnpinPage(parent->GetPageId(), true);
+        right_pages[level + 1] = new_parent;
+    }
+
+    ////key有多个value时，排好序去重后放进posting list
+    INDEX_TEMPLATE_ARGUMENTS
+    void BPLUSTREE_TYPE::BulkLoadPostingList(B_PLUS_TREE_LEAF_PAGE_TYPE *leaf,
+                                             const KeyType &key,
+                                             std::vector<ValueType> &values) {
+        if (values.size() < 2) return;
+        std::sort(values.begin(), values.end(), BPlusTreePostingPage::RidLess);
+        values.erase(std::unique(values.begin(), values.end()), values.end());
+        if (values.size() > 1) {
+            leaf->Update(key, BPlusTreePostingPage::CreateList(
+                    buffer_pool_manager_, values.data(), static_cast<int>(values.size())),
+                         comparator_);
+        }
+        values.clear();
+    }
+
+/*
+ * Bring the last page of a level up to min size with its left sibling, which
+ * is under the same parent
+ * @return: true means node was merged into its sibling and deleted
+ */
+    INDEX_TEMPLATE_ARGUMENTS
+    template <typename N>
+    bool BPLUSTREE_TYPE::BulkLoadFixRightmost(N *node, B_PLUS_TREE_INTERNAL_PAGE *parent) {
+        if (node->GetSize() >= node->GetMinSize()) return false;
+        int index = parent->ValueIndex(node->GetPageId());
+        assert(index > 0);
+        page_id_t sibling_id = parent->ValueAt(index - 1);
+        auto *sibling = reinterpret_cast<N *>(FetchPage(sibling_id));
+        if (node->GetSize() + sibling->GetSize() <= sibling->GetMaxSizeAfterMerge(node)) {
+            node->MoveAllTo(sibling, index, buffer_pool_manager_);
+            parent->Remove(index);
+            buffer_pool_manager_->UnpinPage(sibling_id, true);
+            buffer_pool_manager_->UnpinPage(node->GetPageId(), true);
+            buffer_pool_manager_->DeletePage(node->GetPageId());
+            return true;
+        }
+        while (node->GetSize() < node->GetMinSize()) {
+            sibling->MoveLastToFrontOf(node, index, buffer_pool_manager_);
+        }
+        buffer_pool_manager_->UnpinPage(sibling_id, true);
+        return false;
+    }
+
 /*****************************************************************************
  * INDEX ITERATOR
  *****************************************************************************/
@@ -416,7 +904,8 @@ bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value,
         KeyType unuse{};
         auto start_leaf = FindLeafPage(unuse, true);
         TryUnlockRootPageId(false);
-        return INDEXITERATOR_TYPE(start_leaf, 0, buffer_pool_manager_);
+        return INDEXITERATOR_TYPE(start_leaf, 0, buffer_pool_manager_,
+                                  make_shared<BufferRing>(buffer_pool_manager_));
     }
 
 /*
@@ -433,7 +922,80 @@ bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value,
             return INDEXITERATOR_TYPE(start_leaf, 0, buffer_pool_manager_);
         }
         int idx = start_leaf->KeyIndex(key,comparator_); ////找到了，构造idx的index iterator
-        return INDEXITERATOR_TYPE(start_leaf, idx, buffer_pool_manager_);//return
+        return INDEXITERATOR_TYPE(start_leaf, idx, buffer_pool_manager_,
+                                  make_shared<BufferRing>(buffer_pool_manager_));//return
+    }
+
+/*
+ * Go down to the leaf of the low bound, and return the values of its keys up
+ * to the high bound. Leaves without keys in range are passed on to the next
+ * leaf, which is latched after the current one is released, like the index
+ * iterator does. The first key of the next leaf becomes the low bound of the
+ * next batch, so that batch goes right down to it.
+ */
+    INDEX_TEMPLATE_ARGUMENTS
+    bool BPLUSTREE_TYPE::ScanRange(KeyRange<KeyType> &range,
+                                   std::vector<ValueType> &batch, size_t limit) {
+        batch.clear();
+        if (limit == 0) return false;
+        auto *leaf = FindLeafPage(range.low, !range.has_low);
+        TryUnlockRootPageId(false);
+        if (leaf == nullptr) return false;
+        ////key超过上界时停止
+        auto past_high = [&](const KeyType &key) {
+            if (!range.has_high) return false;
+            int cmp = comparator_(key, range.high);
+            return cmp > 0 || (cmp == 0 && !range.high_inclusive);
+        };
+        int index = 0;
+        if (range.has_low) {
+            index = leaf->KeyIndex(range.low, comparator_);
+            if (!range.low_inclusive && index < leaf->GetSize() &&
+                comparator_(leaf->KeyAt(index), range.low) == 0) {
+                index++;
+            }
+        }
+        bool more = true;
+        while (true) {
+            for (; more && index < leaf->GetSize(); index++) {
+                KeyType key = leaf->KeyAt(index);
+                if (past_high(key)) {
+                    more = false;
+                    break;
+                }
+                ValueType value = leaf->ValueAt(index);
+                if (BPlusTreePostingPage::IsPostingList(value)) {
+                    BPlusTreePostingPage::GetList(buffer_pool_manager_, value, batch);
+                } else {
+                    batch.push_back(value);
+                }
+                range.low = key;
+                range.has_low = true;
+                range.low_inclusive = false;
+                if (batch.size() >= limit) {
+                    batch.resize(limit);
+                    more = false;
+                }
+            }
+            page_id_t next = leaf->GetNextPageId();
+            FreePagesInTransaction(false, nullptr, leaf->GetPageId());
+            if (!more || next == INVALID_PAGE_ID) return false;
+            Page *page = buffer_pool_manager_->FetchPage(next);
+            page->RLatch();
+            leaf = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
+            index = 0;
+            if (!batch.empty()) {
+                ////下一批从下一个leaf的第一个key开始
+                if (leaf->GetSize() > 0) {
+                    range.low = leaf->KeyAt(0);
+                    range.low_inclusive = true;
+                    more = !past_high(range.low);
+                }
+                page->RUnlatch();
+                buffer_pool_manager_->UnpinPage(next, false);
+                return more;
+            }
+        }
     }
 
 /*****************************************************************************
@@ -468,6 +1030,39 @@ bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value,
         }
         return static_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(pointer);
     }
+/*
+ * Go down like a lookup, read latching one page at a time, but write latch
+ * the leaf. The type of a page is fixed, and the read latch on the parent
+ * keeps the child in the tree, so the child's type tells which latch it
+ * needs before it is latched.
+ * @return : the write latched and pinned leaf page, nullptr for an empty tree
+ */
+    INDEX_TEMPLATE_ARGUMENTS
+    Page *BPLUSTREE_TYPE::FindLeafPageToWrite(const KeyType &key) {
+        LockRootPageId(false);
+        if (IsEmpty()) {
+            TryUnlockRootPageId(false);
+            return nullptr;
+        }
+        Page *page = buffer_pool_manager_->FetchPage(root_page_id_);
+        auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+        Lock(node->IsLeafPage(), page);
+        ////root已加latch，不会再被换掉
+        TryUnlockRootPageId(false);
+        while (!node->IsLeafPage()) {
+            page_id_t child_id =
+                    static_cast<B_PLUS_TREE_INTERNAL_PAGE *>(node)->Lookup(key, comparator_);
+            Page *child = buffer_pool_manager_->FetchPage(child_id);
+            auto *child_node = reinterpret_cast<BPlusTreePage *>(child->GetData());
+            Lock(child_node->IsLeafPage(), child);
+            page->RUnlatch();
+            buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+            page = child;
+            node = child_node;
+        }
+        return page;
+    }
+
     INDEX_TEMPLATE_ARGUMENTS
     BPlusTreePage *BPLUSTREE_TYPE::FetchPage(page_id_t page_id) {
         auto page = buffer_pool_manager_->FetchPage(page_id);
@@ -524,8 +1119,10 @@ bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value,
         auto *header_page = static_cast<HeaderPage *>(
                 buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
         if (insert_record){////需要插入一条新记录
-            ////在header_page中创建新记录<index_name+root_page_id>
-            header_page->InsertRecord(index_name_, root_page_id_);
+            ////在header_page中创建新记录<index_name+root_page_id>，树曾被删空时记录已存在，改为更新
+            if (!header_page->InsertRecord(index_name_, root_page_id_)) {
+                header_page->UpdateRecord(index_name_, root_page_id_);
+            }
         } else{////一般为false
             ////更新header_page中的root_page_id
             header_page->UpdateRecord(index_name_, root_page_id_);
@@ -544,12 +1141,12 @@ bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value,
         }
         std::queue<BPlusTreePage *> todo, tmp;
         std::stringstream tree;
-        auto node = reinterpret_cast<BPlusTreePage *>(
-                buffer_pool_manager_->FetchPage(root_page_id_));
-        if (node == nullptr) {
+        Page *root = buffer_pool_manager_->FetchPage(root_page_id_);
+        if (root == nullptr) {
             throw Exception(EXCEPTION_TYPE_INDEX,
                             "all page are pinned while printing");
         }
+        auto node = reinterpret_cast<BPlusTreePage *>(root->GetData());
         todo.push(node);
         bool first = true;
         while (!todo.empty()) {
@@ -623,7 +1220,7 @@ bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value,
     int BPLUSTREE_TYPE::isBalanced(page_id_t pid) {
         if (IsEmpty()) return true;
         ////通过pid获取目标page
-        auto node = reinterpret_cast<BPlusTreePage *>(buffer_pool_manager_->FetchPage(pid));
+        auto node = reinterpret_cast<BPlusTreePage *>(buffer_pool_manager_->FetchPage(pid)->GetData());
         int ret = 0;
         if (!node->IsLeafPage())  {////不是叶子节点，则进行向下走判断
             ////得到节点的page
@@ -651,7 +1248,7 @@ bool BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value,
     bool BPLUSTREE_TYPE::isPageCorr(page_id_t pid,pair<KeyType,KeyType> &out) {
         if (IsEmpty()) return true;
         else{
-            auto node = reinterpret_cast<BPlusTreePage *>(buffer_pool_manager_->FetchPage(pid));
+            auto node = reinterpret_cast<BPlusTreePage *>(buffer_pool_manager_->FetchPage(pid)->GetData());
             if (node == nullptr) {
                 throw Exception(EXCEPTION_TYPE_INDEX,"all page are pinned while isPageCorr");
             }
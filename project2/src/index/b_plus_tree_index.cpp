@@ -2,7 +2,12 @@
  * b_plus_tree_index.cpp
  */
 
+#include <algorithm>
+#include <cassert>
+
 #include "index/b_plus_tree_index.h"
+#include "index/external_sort.h"
+#include "table/table_heap.h"
 
 namespace scudb {
 /*
@@ -12,28 +17,65 @@ INDEX_TEMPLATE_ARGUMENTS
 BPLUSTREE_INDEX_TYPE::BPlusTreeIndex(IndexMetadata *metadata,
                                      BufferPoolManager *buffer_pool_manager,
                                      page_id_t root_page_id)
-    : Index(metadata), comparator_(metadata->GetKeySchema()),
+    : Index(metadata),
+      normalized_keys_(
+          KeyEncoder::IsEncodable(metadata->GetKeySchema()) &&
+          KeyEncoder::GetEncodedLength(metadata->GetKeySchema()) <=
+              sizeof(KeyType)),
+      comparator_(normalized_keys_
+                      ? KeyComparator::Normalized(metadata->GetKeySchema())
+                      : KeyComparator(metadata->GetKeySchema())),
       container_(metadata->GetName(), buffer_pool_manager, comparator_,
-                 root_page_id) {}
+                 root_page_id,
+                 // rows whose keys are cut to the same bytes share them
+                 metadata->IsUnique() &&
+                     !(normalized_keys_ &&
+                       KeyEncoder::IsLossy(metadata->GetKeySchema()))) {}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_INDEX_TYPE::MakeKey(const Tuple &key, KeyType &index_key) const {
+  if (normalized_keys_)
+    return index_key.SetFromNormalizedKey(key, GetKeySchema());
+  index_key.SetFromKey(key);
+  return true;
+}
 
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::InsertEntry(const Tuple &key, RID rid,
                                        Transaction *transaction) {
   // construct insert index key
   KeyType index_key;
-  index_key.SetFromKey(key);
+  MakeKey(key, index_key);
 
   container_.Insert(index_key, rid, transaction);
 }
 
 INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_INDEX_TYPE::DeleteEntry(const Tuple &key,
+void BPLUSTREE_INDEX_TYPE::InsertEntries(const std::vector<Tuple> &keys,
+                                         const std::vector<RID> &rids,
+                                         Transaction *transaction) {
+  assert(keys.size() == rids.size());
+  std::vector<std::pair<KeyType, ValueType>> entries(keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    MakeKey(keys[i], entries[i].first);
+    entries[i].second = rids[i];
+  }
+  std::stable_sort(entries.begin(), entries.end(),
+                   [this](const std::pair<KeyType, ValueType> &lhs,
+                          const std::pair<KeyType, ValueType> &rhs) {
+                     return comparator_(lhs.first, rhs.first) < 0;
+                   });
+  container_.InsertBatch(entries, transaction);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::DeleteEntry(const Tuple &key, RID rid,
                                        Transaction *transaction) {
   // construct delete index key
   KeyType index_key;
-  index_key.SetFromKey(key);
+  MakeKey(key, index_key);
 
-  container_.Remove(index_key, transaction);
+  container_.Remove(index_key, rid, transaction);
 }
 
 INDEX_TEMPLATE_ARGUMENTS
@@ -41,10 +83,58 @@ void BPLUSTREE_INDEX_TYPE::ScanKey(const Tuple &key, std::vector<RID> &result,
                                    Transaction *transaction) {
   // construct scan index key
   KeyType index_key;
-  index_key.SetFromKey(key);
+  MakeKey(key, index_key);
 
   container_.GetValue(index_key, result, transaction);
 }
+
+INDEX_TEMPLATE_ARGUMENTS
+std::unique_ptr<IndexRangeScan>
+BPLUSTREE_INDEX_TYPE::ScanRange(const Tuple *low, bool low_inclusive,
+                                const Tuple *high, bool high_inclusive,
+                                size_t limit, Transaction *) {
+  // a cut bound encodes like every value that shares its prefix, include
+  // them all
+  KeyRange<KeyType> range;
+  if (low != nullptr) {
+    range.has_low = true;
+    range.low_inclusive = !MakeKey(*low, range.low) || low_inclusive;
+  }
+  if (high != nullptr) {
+    range.has_high = true;
+    range.high_inclusive = !MakeKey(*high, range.high) || high_inclusive;
+  }
+  return std::unique_ptr<IndexRangeScan>(
+      new BPlusTreeRangeScan<KeyType, ValueType, KeyComparator>(&container_,
+                                                                range, limit));
+}
+
+/*
+ * Sort the keys of all tuples, spilling to disk past INDEX_SORT_MEMORY, and
+ * build the tree bottom up from the sorted keys
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_INDEX_TYPE::BulkLoad(TableHeap *table_heap, Schema *tuple_schema,
+                                    Transaction *transaction) {
+  if (!container_.IsEmpty())
+    return false;
+  ExternalSort<KeyType, ValueType, KeyComparator> sorter(comparator_);
+  KeyType index_key;
+  for (auto iter = table_heap->begin(transaction); iter != table_heap->end();
+       ++iter) {
+    // construct indexed key tuple
+    std::vector<Value> key_values;
+    for (auto &i : GetKeyAttrs())
+      key_values.push_back(table_heap->GetValue(*iter, tuple_schema, i));
+    Tuple key(key_values, GetKeySchema());
+    MakeKey(key, index_key);
+    sorter.Add(index_key, iter->GetRid());
+  }
+  sorter.Sort();
+  return container_.BulkLoad([&sorter](KeyType &key, ValueType &value) {
+    return sorter.Next(key, value);
+  });
+}
 template class BPlusTreeIndex<GenericKey<4>, RID, GenericComparator<4>>;
 template class BPlusTreeIndex<GenericKey<8>, RID, GenericComparator<8>>;
 template class BPlusTreeIndex<GenericKey<16>, RID, GenericComparator<16>>;
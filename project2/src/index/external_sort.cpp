@@ -0,0 +1,125 @@
+/**
+ * external_sort.cpp
+ */
+
+#include <algorithm>
+
+#include "common/exception.h"
+#include "common/rid.h"
+#include "index/external_sort.h"
+#include "index/generic_key.h"
+
+namespace scudb {
+
+// pairs a run reads from its file at a time
+static const size_t RUN_BUFFER_PAIRS = 1024;
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+EXTERNAL_SORT_TYPE::ExternalSort(const KeyComparator &comparator,
+                                 size_t memory_limit)
+    : comparator_(comparator),
+      max_pairs_(std::max<size_t>(memory_limit / sizeof(SortEntry), 1)),
+      buffer_pos_(0) {}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+EXTERNAL_SORT_TYPE::~ExternalSort() {
+  for (auto &run : runs_)
+    fclose(run.file);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void EXTERNAL_SORT_TYPE::Add(const KeyType &key, const ValueType &value) {
+  if (buffer_.size() >= max_pairs_)
+    SpillRun();
+  buffer_.emplace_back(key, value);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void EXTERNAL_SORT_TYPE::Sort() {
+  auto less = [this](const SortEntry &lhs, const SortEntry &rhs) {
+    return comparator_(lhs.first, rhs.first) < 0;
+  };
+  if (runs_.empty()) {
+    std::stable_sort(buffer_.begin(), buffer_.end(), less);
+    return;
+  }
+  if (!buffer_.empty())
+    SpillRun();
+  std::vector<SortEntry>().swap(buffer_);
+
+  auto greater = [this](size_t lhs, size_t rhs) { return RunGreater(lhs, rhs); };
+  for (size_t i = 0; i < runs_.size(); i++) {
+    rewind(runs_[i].file);
+    if (FillRun(runs_[i]))
+      heap_.push_back(i);
+  }
+  std::make_heap(heap_.begin(), heap_.end(), greater);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool EXTERNAL_SORT_TYPE::Next(KeyType &key, ValueType &value) {
+  if (runs_.empty()) {
+    if (buffer_pos_ >= buffer_.size())
+      return false;
+    key = buffer_[buffer_pos_].first;
+    value = buffer_[buffer_pos_].second;
+    buffer_pos_++;
+    return true;
+  }
+  if (heap_.empty())
+    return false;
+  auto greater = [this](size_t lhs, size_t rhs) { return RunGreater(lhs, rhs); };
+  std::pop_heap(heap_.begin(), heap_.end(), greater);
+  Run &run = runs_[heap_.back()];
+  key = run.buffer[run.pos].first;
+  value = run.buffer[run.pos].second;
+  if (++run.pos < run.buffer.size() || FillRun(run))
+    std::push_heap(heap_.begin(), heap_.end(), greater);
+  else
+    heap_.pop_back();
+  return true;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void EXTERNAL_SORT_TYPE::SpillRun() {
+  std::stable_sort(buffer_.begin(), buffer_.end(),
+                   [this](const SortEntry &lhs, const SortEntry &rhs) {
+                     return comparator_(lhs.first, rhs.first) < 0;
+                   });
+  FILE *file = tmpfile();
+  if (file == nullptr)
+    throw Exception(EXCEPTION_TYPE_INDEX, "can't create sort run file");
+  runs_.push_back(Run{file, std::vector<SortEntry>(), 0});
+  if (fwrite(buffer_.data(), sizeof(SortEntry), buffer_.size(), file) !=
+      buffer_.size())
+    throw Exception(EXCEPTION_TYPE_INDEX, "can't write sort run file");
+  buffer_.clear();
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool EXTERNAL_SORT_TYPE::FillRun(Run &run) {
+  run.buffer.resize(RUN_BUFFER_PAIRS);
+  size_t count =
+      fread(run.buffer.data(), sizeof(SortEntry), RUN_BUFFER_PAIRS, run.file);
+  if (count < RUN_BUFFER_PAIRS && ferror(run.file))
+    throw Exception(EXCEPTION_TYPE_INDEX, "can't read sort run file");
+  run.buffer.resize(count);
+  run.pos = 0;
+  return count > 0;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+bool EXTERNAL_SORT_TYPE::RunGreater(size_t lhs, size_t rhs) const {
+  int cmp = comparator_(runs_[lhs].buffer[runs_[lhs].pos].first,
+                        runs_[rhs].buffer[runs_[rhs].pos].first);
+  // equal keys come out in the order they were added
+  return cmp > 0 || (cmp == 0 && lhs > rhs);
+}
+
+template class ExternalSort<GenericKey<4>, RID, GenericComparator<4>>;
+template class ExternalSort<GenericKey<8>, RID, GenericComparator<8>>;
+template class ExternalSort<GenericKey<16>, RID, GenericComparator<16>>;
+template class ExternalSort<GenericKey<32>, RID, GenericComparator<32>>;
+template class ExternalSort<GenericKey<64>, RID, GenericComparator<64>>;
+
+} // namespace scudb
@@ -19,10 +19,13 @@ namespace scudb {
      * @param leaf
      * @param index
      * @param buf_pool_manager
+     * @param ring : 顺序扫描用的buffer ring
      */
     INDEX_TEMPLATE_ARGUMENTS
-    INDEXITERATOR_TYPE::IndexIterator(B_PLUS_TREE_LEAF_PAGE_TYPE *leaf, int index, BufferPoolManager *buf_pool_manager)
-            : mIndex_(index),mLeafPage_(leaf), mBufferPoolManager_(buf_pool_manager){}
+    INDEXITERATOR_TYPE::IndexIterator(B_PLUS_TREE_LEAF_PAGE_TYPE *leaf, int index, BufferPoolManager *buf_pool_manager,
+                                      std::shared_ptr<BufferRing> ring)
+            : mIndex_(index),mLeafPage_(leaf), mBufferPoolManager_(buf_pool_manager), mRing_(std::move(ring)),
+              mReadAhead_(buf_pool_manager), mPosting_(0){}
 
             ////析构函数
     INDEX_TEMPLATE_ARGUMENTS
@@ -37,11 +40,29 @@ namespace scudb {
      */
     INDEX_TEMPLATE_ARGUMENTS
     void INDEXITERATOR_TYPE::UnlockAndUnPin() {
-        mBufferPoolManager_->FetchPage(mLeafPage_->GetPageId())->RUnlatch();
+        mBufferPoolManager_->FetchPage(mLeafPage_->GetPageId(), mRing_.get())->RUnlatch();
         mBufferPoolManager_->UnpinPage(mLeafPage_->GetPageId(), false);
         mBufferPoolManager_->UnpinPage(mLeafPage_->GetPageId(), false);
     }
 
+    ////预读时取叶子链的下一页
+    INDEX_TEMPLATE_ARGUMENTS
+    page_id_t INDEXITERATOR_TYPE::NextLeafPageId(Page *page) {
+        return reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData())->GetNextPageId();
+    }
+
+    ////当前条目是posting list的引用时读出它的value，leaf的latch保护着posting list
+    INDEX_TEMPLATE_ARGUMENTS
+    bool INDEXITERATOR_TYPE::LoadPostingList() {
+        if (mPostings_.empty() && mIndex_ < mLeafPage_->GetSize()) {
+            ValueType value = mLeafPage_->ValueAt(mIndex_);
+            if (BPlusTreePostingPage::IsPostingList(value)) {
+                BPlusTreePostingPage::GetList(mBufferPoolManager_, value, mPostings_);
+            }
+        }
+        return !mPostings_.empty();
+    }
+
     INDEX_TEMPLATE_ARGUMENTS
     bool INDEXITERATOR_TYPE::isEnd(){
         if (mLeafPage_ == nullptr){
@@ -54,23 +75,35 @@ namespace scudb {
     ////地址解析符*重载
     INDEX_TEMPLATE_ARGUMENTS
     const MappingType & INDEXITERATOR_TYPE::operator*() {
-        return mLeafPage_->GetItem(mIndex_);
+        ////压缩页里的key要先拼回完整的key
+        mItem_ = mLeafPage_->GetItem(mIndex_);
+        if (LoadPostingList()) {
+            mItem_.second = mPostings_[mPosting_];
+        }
+        return mItem_;
     }
 
 
     INDEX_TEMPLATE_ARGUMENTS
     INDEXITERATOR_TYPE& INDEXITERATOR_TYPE::operator++() {
+        if (LoadPostingList() && ++mPosting_ < mPostings_.size()) {
+            return *this;
+        }
+        mPostings_.clear();
+        mPosting_ = 0;
         mIndex_++;
         if (mIndex_ >= mLeafPage_->GetSize()) {
             page_id_t next = mLeafPage_->GetNextPageId();
             UnlockAndUnPin();
             if (next == INVALID_PAGE_ID) {
                 mLeafPage_ = nullptr;
+                mRing_.reset(); ////扫描结束，归还ring的frame
             } else {
-                Page *page = mBufferPoolManager_->FetchPage(next);
+                Page *page = mBufferPoolManager_->FetchPage(next, mRing_.get());
                 page->RLatch();
                 mLeafPage_ = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
                 mIndex_ = 0;
+                mReadAhead_.Advance(mLeafPage_->GetNextPageId(), NextLeafPageId, mRing_);
             }
         }
         return *this;
@@ -0,0 +1,148 @@
+/**
+ * key_encoder.cpp
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "index/key_encoder.h"
+#include "type/limits.h"
+
+namespace scudb {
+
+const uint32_t KeyEncoder::VARCHAR_LENGTH;
+
+// store the low bytes bytes of value, most significant first
+static inline void EncodeBigEndian(uint64_t value, int bytes, char *storage) {
+  for (int i = bytes - 1; i >= 0; i--) {
+    storage[i] = static_cast<char>(value & 0xFF);
+    value >>= 8;
+  }
+}
+
+// raw two's complement value of a signed column, read unaligned
+template <typename T> static inline uint64_t ReadSigned(const char *data) {
+  T value;
+  memcpy(&value, data, sizeof(T));
+  return static_cast<uint64_t>(static_cast<int64_t>(value));
+}
+
+// start of a column in the tuple data, varchars are stored behind an offset
+static inline const char *ColumnData(const Tuple &key, Schema *key_schema,
+                                     int column_id) {
+  const char *data = key.GetData() + key_schema->GetOffset(column_id);
+  if (key_schema->IsInlined(column_id))
+    return data;
+  int32_t offset;
+  memcpy(&offset, data, sizeof(int32_t));
+  return key.GetData() + offset;
+}
+
+bool KeyEncoder::IsEncodable(Schema *key_schema) {
+  for (int i = 0; i < key_schema->GetColumnCount(); i++) {
+    switch (key_schema->GetType(i)) {
+    case TypeId::BOOLEAN:
+    case TypeId::TINYINT:
+    case TypeId::SMALLINT:
+    case TypeId::INTEGER:
+    case TypeId::BIGINT:
+    case TypeId::DECIMAL:
+    case TypeId::TIMESTAMP:
+    case TypeId::VARCHAR:
+      break;
+    default:
+      return false;
+    }
+  }
+  return key_schema->GetColumnCount() > 0;
+}
+
+bool KeyEncoder::IsLossy(Schema *key_schema) {
+  for (int i = 0; i < key_schema->GetColumnCount(); i++) {
+    if (key_schema->GetType(i) == TypeId::VARCHAR)
+      return true;
+  }
+  return false;
+}
+
+size_t KeyEncoder::GetEncodedLength(Schema *key_schema) {
+  size_t length = 0;
+  for (int i = 0; i < key_schema->GetColumnCount(); i++) {
+    TypeId type = key_schema->GetType(i);
+    if (type == TypeId::VARCHAR)
+      length += VARCHAR_LENGTH + 1;
+    else
+      length += Type::GetTypeSize(type);
+  }
+  return length;
+}
+
+bool KeyEncoder::Encode(const Tuple &key, Schema *key_schema, char *storage) {
+  bool whole = true;
+  for (int i = 0; i < key_schema->GetColumnCount(); i++) {
+    const TypeId type = key_schema->GetType(i);
+    const char *data = ColumnData(key, key_schema, i);
+    switch (type) {
+    case TypeId::BOOLEAN:
+    case TypeId::TINYINT:
+      EncodeBigEndian(ReadSigned<int8_t>(data) ^ 0x80, 1, storage);
+      storage += 1;
+      break;
+    case TypeId::SMALLINT:
+      EncodeBigEndian(ReadSigned<int16_t>(data) ^ 0x8000, 2, storage);
+      storage += 2;
+      break;
+    case TypeId::INTEGER:
+      EncodeBigEndian(ReadSigned<int32_t>(data) ^ 0x80000000, 4, storage);
+      storage += 4;
+      break;
+    case TypeId::BIGINT:
+      EncodeBigEndian(ReadSigned<int64_t>(data) ^ (1ULL << 63), 8, storage);
+      storage += 8;
+      break;
+    case TypeId::TIMESTAMP: {
+      uint64_t value;
+      memcpy(&value, data, sizeof(uint64_t));
+      // the NULL sentinel is the largest value, move it below all others
+      value = value == PELOTON_TIMESTAMP_NULL ? 0 : value + 1;
+      EncodeBigEndian(value, 8, storage);
+      storage += 8;
+      break;
+    }
+    case TypeId::DECIMAL: {
+      double d;
+      memcpy(&d, data, sizeof(double));
+      if (d == 0)
+        d = 0; // -0.0 equals 0.0
+      uint64_t bits;
+      memcpy(&bits, &d, sizeof(uint64_t));
+      bits = (bits & (1ULL << 63)) ? ~bits : bits ^ (1ULL << 63);
+      EncodeBigEndian(bits, 8, storage);
+      storage += 8;
+      break;
+    }
+    case TypeId::VARCHAR: {
+      uint32_t len;
+      memcpy(&len, data, sizeof(uint32_t));
+      memset(storage, 0, VARCHAR_LENGTH + 1);
+      if (len != PELOTON_VALUE_NULL) {
+        // the stored length counts the terminating '\0'
+        uint32_t str_len = len > 0 ? len - 1 : 0;
+        uint32_t copy_len = std::min(str_len, VARCHAR_LENGTH);
+        memcpy(storage, data + sizeof(uint32_t), copy_len);
+        whole = whole && str_len <= VARCHAR_LENGTH;
+        storage[VARCHAR_LENGTH] =
+            static_cast<char>(std::min(str_len, VARCHAR_LENGTH + 1) + 1);
+      }
+      storage += VARCHAR_LENGTH + 1;
+      break;
+    }
+    default:
+      assert(false);
+    }
+  }
+  return whole;
+}
+
+} // namespace scudb
@@ -0,0 +1,120 @@
+/**
+ * key_search.cpp
+ */
+
+#include "index/key_search.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define KEY_SEARCH_X86
+#include <immintrin.h>
+#endif
+
+namespace scudb {
+
+static bool simd_enabled = true;
+
+#ifdef KEY_SEARCH_X86
+
+static bool HasAvx2() {
+  static const bool has_avx2 =
+      (__builtin_cpu_init(), __builtin_cpu_supports("avx2"));
+  return has_avx2;
+}
+
+/*
+ * The range is first narrowed to a block of at most BLOCK keys by the branch
+ * free binary search, whose loads stay in the L1 cache of a page. The keys
+ * of the block less than key are then counted a vector at a time, adding up
+ * the all ones lanes of the compare results.
+ */
+template <typename T>
+static inline const T *NarrowToBlock(const T *keys, int &n, T key, int block) {
+  while (n > block) {
+    int half = n / 2;
+    keys = (keys[half] < key) ? keys + half : keys;
+    n -= half;
+  }
+  return keys;
+}
+
+__attribute__((target("avx2"))) static int
+Avx2CountLess(const int64_t *keys, int n, int64_t key) {
+  const int64_t *block = NarrowToBlock(keys, n, key, 16);
+  const __m256i needle = _mm256_set1_epi64x(key);
+  __m256i less = _mm256_setzero_si256();
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + i));
+    less = _mm256_sub_epi64(less, _mm256_cmpgt_epi64(needle, v));
+  }
+  __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(less),
+                              _mm256_extracti128_si256(less, 1));
+  int count = static_cast<int>(_mm_cvtsi128_si64(sum) +
+                               _mm_cvtsi128_si64(_mm_unpackhi_epi64(sum, sum)));
+  for (; i < n; i++)
+    count += block[i] < key;
+  return static_cast<int>(block - keys) + count;
+}
+
+__attribute__((target("avx2"))) static int
+Avx2CountLess(const int32_t *keys, int n, int32_t key) {
+  const int32_t *block = NarrowToBlock(keys, n, key, 32);
+  const __m256i needle = _mm256_set1_epi32(key);
+  __m256i less = _mm256_setzero_si256();
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + i));
+    less = _mm256_sub_epi32(less, _mm256_cmpgt_epi32(needle, v));
+  }
+  __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(less),
+                              _mm256_extracti128_si256(less, 1));
+  sum = _mm_add_epi32(sum, _mm_unpackhi_epi64(sum, sum));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 1));
+  int count = _mm_cvtsi128_si32(sum);
+  for (; i < n; i++)
+    count += block[i] < key;
+  return static_cast<int>(block - keys) + count;
+}
+
+// SSE2 is part of x86-64, so int32 keys always have a SIMD search
+static int Sse2CountLess(const int32_t *keys, int n, int32_t key) {
+  const int32_t *block = NarrowToBlock(keys, n, key, 16);
+  const __m128i needle = _mm_set1_epi32(key);
+  __m128i less = _mm_setzero_si128();
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + i));
+    less = _mm_sub_epi32(less, _mm_cmpgt_epi32(needle, v));
+  }
+  less = _mm_add_epi32(less, _mm_unpackhi_epi64(less, less));
+  less = _mm_add_epi32(less, _mm_shuffle_epi32(less, 1));
+  int count = _mm_cvtsi128_si32(less);
+  for (; i < n; i++)
+    count += block[i] < key;
+  return static_cast<int>(block - keys) + count;
+}
+
+#endif
+
+int KeySearch::CountLess(const int32_t *keys, int n, int32_t key) {
+#ifdef KEY_SEARCH_X86
+  if (simd_enabled)
+    return HasAvx2() ? Avx2CountLess(keys, n, key)
+                     : Sse2CountLess(keys, n, key);
+#endif
+  return ScalarCountLess(keys, n, key);
+}
+
+int KeySearch::CountLess(const int64_t *keys, int n, int64_t key) {
+#ifdef KEY_SEARCH_X86
+  if (simd_enabled && HasAvx2())
+    return Avx2CountLess(keys, n, key);
+#endif
+  return ScalarCountLess(keys, n, key);
+}
+
+void KeySearch::EnableSimd(bool enable) { simd_enabled = enable; }
+
+bool KeySearch::IsSimdEnabled() { return simd_enabled; }
+
+} // namespace scudb
@@ -1,6 +1,8 @@
 /**
  * b_plus_tree_internal_page.cpp
  */
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 
@@ -18,15 +20,199 @@ namespace scudb {
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Init(page_id_t page_id,
-                                          page_id_t parent_id) {
+                                          page_id_t parent_id,
+                                          IndexKeyFormat key_format) {
     ////使用构造函数参数初始化类成员变量
     SetSize(0);
     SetPageId(page_id);
     SetParentPageId(parent_id);
     SetPageType(IndexPageType::INTERNAL_PAGE);
-    int max_size =  (PAGE_SIZE- sizeof(BPlusTreeInternalPage))/sizeof(MappingType);
-    ////留一个无效的key，方便分裂和调整
-    SetMaxSize(max_size - 1);
+    SetKeyFormat(key_format);
+    if (key_format != IndexKeyFormat::PREFIX_COMPRESSED) {
+        assert(key_format == IndexKeyFormat::PAIRS ||
+               sizeof(KeyType) == 4 || sizeof(KeyType) == 8);
+        SetPrefixSize(0);
+        SetMinSize(0);
+        int max_size =  (PAGE_SIZE- sizeof(BPlusTreeInternalPage))/
+                        (sizeof(KeyType) + sizeof(ValueType));
+        ////留一个无效的key，方便分裂和调整
+        SetMaxSize(max_size - 1);
+        return;
+    }
+    ////压缩页: 初始键范围为整个键空间，没有公共前缀
+    char *fences = reinterpret_cast<char *>(array);
+    memset(fences, 0, sizeof(KeyType));
+    memset(fences + sizeof(KeyType), 0xFF, sizeof(KeyType));
+    SetPrefixSize(0);
+    SetMaxSize(MaxSizeFor(0));
+    SetMinSize(MaxSizeFor(0) / 2);
+}
+
+/*
+ * Helper methods for the entries of all page formats
+ */
+INDEX_TEMPLATE_ARGUMENTS
+char *B_PLUS_TREE_INTERNAL_PAGE_TYPE::KeyArrayAt(int index) {
+    return reinterpret_cast<char *>(array) + index * sizeof(KeyType);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+const char *B_PLUS_TREE_INTERNAL_PAGE_TYPE::KeyArrayAt(int index) const {
+    return reinterpret_cast<const char *>(array) + index * sizeof(KeyType);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+char *B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueArrayAt(int index) {
+    ////page id数组在max size + 1个key之后
+    return KeyArrayAt(GetMaxSize() + 1) + index * sizeof(ValueType);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+const char *B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueArrayAt(int index) const {
+    return const_cast<BPlusTreeInternalPage *>(this)->ValueArrayAt(index);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_INTERNAL_PAGE_TYPE::MaxSizeFor(int prefix_size) const {
+    int space = PAGE_SIZE - sizeof(BPlusTreeInternalPage) - 2 * sizeof(KeyType);
+    int entry_size = sizeof(KeyType) - prefix_size + sizeof(ValueType);
+    return space / entry_size - 1;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_INTERNAL_PAGE_TYPE::EntrySize() const {
+    if (!IsCompressed()) {
+        return sizeof(MappingType);
+    }
+    return sizeof(KeyType) - GetPrefixSize() + sizeof(ValueType);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+char *B_PLUS_TREE_INTERNAL_PAGE_TYPE::EntryAt(int index) {
+    if (!IsCompressed()) {
+        return reinterpret_cast<char *>(array + index);
+    }
+    return reinterpret_cast<char *>(array) + 2 * sizeof(KeyType) +
+           index * EntrySize();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+const char *B_PLUS_TREE_INTERNAL_PAGE_TYPE::EntryAt(int index) const {
+    return const_cast<BPlusTreeInternalPage *>(this)->EntryAt(index);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetEntryAt(int index, const KeyType &key,
+                                                const ValueType &value) {
+    if (IsKeyArray()) {
+        memcpy(KeyArrayAt(index), &key, sizeof(KeyType));
+        memcpy(ValueArrayAt(index), &value, sizeof(ValueType));
+        return;
+    }
+    if (!IsCompressed()) {
+        array[index].first = key;
+        array[index].second = value;
+        return;
+    }
+    int prefix_size = GetPrefixSize();
+    int suffix_size = sizeof(KeyType) - prefix_size;
+    char *entry = EntryAt(index);
+    memcpy(entry, reinterpret_cast<const char *>(&key) + prefix_size, suffix_size);
+    memcpy(entry + suffix_size, &value, sizeof(ValueType));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetValueAt(int index,
+                                                const ValueType &value) {
+    if (IsKeyArray()) {
+        memcpy(ValueArrayAt(index), &value, sizeof(ValueType));
+        return;
+    }
+    if (!IsCompressed()) {
+        array[index].second = value;
+        return;
+    }
+    memcpy(EntryAt(index) + sizeof(KeyType) - GetPrefixSize(), &value,
+           sizeof(ValueType));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveEntries(int to, int from, int count) {
+    if (IsKeyArray()) {
+        memmove(KeyArrayAt(to), KeyArrayAt(from), count * sizeof(KeyType));
+        memmove(ValueArrayAt(to), ValueArrayAt(from), count * sizeof(ValueType));
+        return;
+    }
+    memmove(EntryAt(to), EntryAt(from), static_cast<size_t>(count * EntrySize()));
+}
+
+/*
+ * Helper methods to get/set the key range of a compressed page. Setting it
+ * rewrites the entries when the common prefix of the fences changes
+ */
+INDEX_TEMPLATE_ARGUMENTS
+KeyType B_PLUS_TREE_INTERNAL_PAGE_TYPE::GetLowFence() const {
+    KeyType key;
+    memcpy(&key, array, sizeof(KeyType));
+    return key;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+KeyType B_PLUS_TREE_INTERNAL_PAGE_TYPE::GetHighFence() const {
+    KeyType key;
+    memcpy(&key, reinterpret_cast<const char *>(array) + sizeof(KeyType),
+           sizeof(KeyType));
+    return key;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetFences(const KeyType &low,
+                                               const KeyType &high) {
+    if (!IsCompressed()) {
+        return;
+    }
+    int old_prefix = GetPrefixSize();
+    int old_size = EntrySize();
+    int new_prefix = CommonPrefixSize(reinterpret_cast<const char *>(&low),
+                                      reinterpret_cast<const char *>(&high),
+                                      sizeof(KeyType));
+    int new_size = sizeof(KeyType) - new_prefix + sizeof(ValueType);
+    char *fences = reinterpret_cast<char *>(array);
+    char *base = fences + 2 * sizeof(KeyType);
+    if (new_prefix > old_prefix) {
+        ////前缀变长，条目变短
+        for (int i = 0; i < GetSize(); i++) {
+            memmove(base + i * new_size,
+                    base + i * old_size + (new_prefix - old_prefix), new_size);
+        }
+    } else if (new_prefix < old_prefix) {
+        ////前缀变短，条目变长，从后往前补回旧前缀的字节
+        assert(GetSize() <= MaxSizeFor(new_prefix) + 1);
+        for (int i = GetSize() - 1; i >= 0; i--) {
+            memmove(base + i * new_size + (old_prefix - new_prefix),
+                    base + i * old_size, old_size);
+            memcpy(base + i * new_size, fences + new_prefix,
+                   old_prefix - new_prefix);
+        }
+    }
+    memcpy(fences, &low, sizeof(KeyType));
+    memcpy(fences + sizeof(KeyType), &high, sizeof(KeyType));
+    SetPrefixSize(new_prefix);
+    SetMaxSize(MaxSizeFor(new_prefix));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_INTERNAL_PAGE_TYPE::GetMaxSizeAfterMerge(
+    const BPlusTreeInternalPage *sibling) const {
+    if (!IsCompressed()) {
+        return GetMaxSize();
+    }
+    int prefix_size = CommonPrefixSize(
+        reinterpret_cast<const char *>(array),
+        reinterpret_cast<const char *>(sibling->array), sizeof(KeyType));
+    prefix_size = std::min(prefix_size, GetPrefixSize());
+    prefix_size = std::min(prefix_size, sibling->GetPrefixSize());
+    return MaxSizeFor(prefix_size);
 }
 /*
  * Helper method to get/set the key associated with input "index"(a.k.a
@@ -39,14 +225,36 @@ KeyType B_PLUS_TREE_INTERNAL_PAGE_TYPE::KeyAt(int index) const {
       assert(false);
   }
   ////返回key value的index
-  return array[index].first;
+  KeyType key;
+  if (IsKeyArray()) {
+      memcpy(&key, KeyArrayAt(index), sizeof(KeyType));
+      return key;
+  }
+  if (!IsCompressed()) {
+      return array[index].first;
+  }
+  int prefix_size = GetPrefixSize();
+  memcpy(&key, array, prefix_size);
+  memcpy(reinterpret_cast<char *>(&key) + prefix_size, EntryAt(index),
+         sizeof(KeyType) - prefix_size);
+  return key;
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetKeyAt(int index, const KeyType &key) {
     assert(index >= 0 && index < GetSize());
     //通过index设置key value
-    array[index].first = key;
+    if (IsKeyArray()) {
+        memcpy(KeyArrayAt(index), &key, sizeof(KeyType));
+        return;
+    }
+    if (!IsCompressed()) {
+        array[index].first = key;
+        return;
+    }
+    int prefix_size = GetPrefixSize();
+    memcpy(EntryAt(index), reinterpret_cast<const char *>(&key) + prefix_size,
+           sizeof(KeyType) - prefix_size);
 }
 
 /*
@@ -71,7 +279,17 @@ INDEX_TEMPLATE_ARGUMENTS
 ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueAt(int index) const {
     assert(index >= 0 && index < GetSize());
     ////返回值
-    return array[index].second;
+    ValueType value;
+    if (IsKeyArray()) {
+        memcpy(&value, ValueArrayAt(index), sizeof(ValueType));
+        return value;
+    }
+    if (!IsCompressed()) {
+        return array[index].second;
+    }
+    memcpy(&value, EntryAt(index) + sizeof(KeyType) - GetPrefixSize(),
+           sizeof(ValueType));
+    return value;
 }
 
 /*****************************************************************************
@@ -88,9 +306,47 @@ B_PLUS_TREE_INTERNAL_PAGE_TYPE::Lookup(const KeyType &key,
                                        const KeyComparator &comparator) const {
 
     assert(GetSize() > 1);////assert错误参数
+    return Lookup(key, comparator, GetSize());
+}
+
+////只看前size个entry；不加latch的读者传入的size已限制在page之内，这里不能再读GetSize()
+INDEX_TEMPLATE_ARGUMENTS
+ValueType
+B_PLUS_TREE_INTERNAL_PAGE_TYPE::Lookup(const KeyType &key,
+                                       const KeyComparator &comparator,
+                                       int size) const {
     ////init value
     int begin = 1;
-    int end = GetSize() -1;
+    int end = size -1;
+
+    if (IsKeyArray()) {
+        ////key array页: SIMD查找第一个key之后不大于key的个数
+        int index = CountKeysLess(KeyArrayAt(1), sizeof(KeyType), size - 1,
+                                  reinterpret_cast<const char *>(&key), true);
+        ValueType value;
+        memcpy(&value, ValueArrayAt(index), sizeof(ValueType));
+        return value;
+    }
+    if (IsCompressed()) {
+        ////压缩页: 先比较公共前缀，再按memcmp二分查找后缀
+        const char *key_data = reinterpret_cast<const char *>(&key);
+        int prefix_size = GetPrefixSize();
+        int cmp = memcmp(key_data, array, prefix_size);
+        if (cmp != 0) {
+            return ValueAt(cmp < 0 ? 0 : size - 1);
+        }
+        key_data += prefix_size;
+        size_t suffix_size = sizeof(KeyType) - prefix_size;
+        while (begin <= end) {
+            int mid = (end - begin) / 2 + begin;
+            if (memcmp(EntryAt(mid), key_data, suffix_size) <= 0) {
+                begin = mid + 1;
+            } else {
+                end = mid - 1;
+            }
+        }
+        return ValueAt(begin - 1);
+    }
 
     ////经典二分查找
     while (begin <= end){
@@ -121,9 +377,8 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::PopulateNewRoot(
     const ValueType &old_value, const KeyType &new_key,
     const ValueType &new_value) {
 
-    array[0].second = old_value;
-    array[1].first = new_key;
-    array[1].second = new_value;
+    SetValueAt(0, old_value);
+    SetEntryAt(1, new_key, new_value);
 
     SetSize(2);
 }
@@ -145,13 +400,9 @@ int B_PLUS_TREE_INTERNAL_PAGE_TYPE::InsertNodeAfter(
     int cur_size = GetSize();
 
     ////更新节点位置,统一向后移动
-    for (int i = cur_size - 1; i > index; i--) {
-        array[i].first = array[i - 1].first;
-        array[i].second = array[i - 1].second;
-    }
+    MoveEntries(index + 1, index, cur_size - 1 - index);
     ////插入new node
-    array[index].first = new_key;
-    array[index].second = new_value;
+    SetEntryAt(index, new_key, new_value);
     return cur_size;
 }
 
@@ -171,20 +422,24 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveHalfTo(
     int mid_index = (total)/2;
     page_id_t recipPageId = recipient->GetPageId();
     assert(GetSize() == total);
+    ////分隔键同时是两页新的键范围边界
+    KeyType middle_key = KeyAt(mid_index);
+    recipient->SetFences(middle_key, GetHighFence());
     for (int i = mid_index; i < total; i++) {
         ////将array的后一半键值对移动到BPlusTreeInternalPage中
-        recipient->array[i - mid_index].first = array[i].first;
-        recipient->array[i - mid_index].second = array[i].second;
+        page_id_t child_id = ValueAt(i);
+        recipient->SetEntryAt(i - mid_index, KeyAt(i), child_id);
 
         ////更新孩子page的parent page
-        auto childRawPage = buffer_pool_manager->FetchPage(array[i].second);
+        auto childRawPage = buffer_pool_manager->FetchPage(child_id);
         auto *childTreePage = reinterpret_cast<BPlusTreePage *>(childRawPage->GetData());
         childTreePage->SetParentPageId(recipPageId);
-        buffer_pool_manager->UnpinPage(array[i].second,true);
+        buffer_pool_manager->UnpinPage(child_id,true);
     }
     //set page‘ size
     SetSize(mid_index);
     recipient->SetSize(total - mid_index);
+    SetFences(GetLowFence(), middle_key);
 }
 
 INDEX_TEMPLATE_ARGUMENTS
@@ -203,9 +458,7 @@ INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Remove(int index) {
     assert(index >= 0 && index < GetSize());
     ////从index开始之后的所有page向前移动一个单位
-    for (int i = index + 1; i < GetSize(); i++) {
-        array[i - 1] = array[i];
-    }
+    MoveEntries(index, index + 1, GetSize() - index - 1);
     IncreaseSize(-1);
 }
 
@@ -246,16 +499,18 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveAllTo(
     ////buffer pool 释放page
     buffer_pool_manager->UnpinPage(parent->GetPageId(), false);
 
+    ////合并后的页覆盖两页的键范围
+    recipient->SetFences(recipient->GetLowFence(), GetHighFence());
     for (int i = 0; i < GetSize(); ++i) {
         ////逐个全部移动
-        recipient->array[start + i].first = array[i].first;
-        recipient->array[start + i].second = array[i].second;
+        page_id_t child_id = ValueAt(i);
+        recipient->SetEntryAt(start + i, KeyAt(i), child_id);
 
         ////更新孩子page的父page
-        auto childRawPage = buffer_pool_manager->FetchPage(array[i].second);
+        auto childRawPage = buffer_pool_manager->FetchPage(child_id);
         auto *childTreePage = reinterpret_cast<BPlusTreePage *>(childRawPage->GetData());
         childTreePage->SetParentPageId(recip_pageid);
-        buffer_pool_manager->UnpinPage(array[i].second,true);
+        buffer_pool_manager->UnpinPage(child_id,true);
     }
     ////更新parent page
     recipient->SetSize(start + GetSize());
@@ -282,7 +537,11 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveFirstToEndOf(
     ////函数功能:array的first移动到recipient的end
     MappingType pair{KeyAt(0), ValueAt(0)};
     IncreaseSize(-1);
-    memmove(array, array + 1, static_cast<size_t>(GetSize()*sizeof(MappingType)));
+    MoveEntries(0, 1, GetSize());
+    ////两页的分界移到新的第一个key
+    KeyType middle_key = KeyAt(0);
+    recipient->SetFences(recipient->GetLowFence(), middle_key);
+    SetFences(middle_key, GetHighFence());
     recipient->CopyLastFrom(pair, buffer_pool_manager);
 
     //// 更新子父页id
@@ -297,7 +556,7 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveFirstToEndOf(
     //// 更新parent‘spage中的相关键值对
     page = buffer_pool_manager->FetchPage(GetParentPageId());
     auto *parent = reinterpret_cast<B_PLUS_TREE_INTERNAL_PAGE *>(page->GetData());
-    parent->SetKeyAt(parent->ValueIndex(GetPageId()), array[0].first);
+    parent->SetKeyAt(parent->ValueIndex(GetPageId()), middle_key);
     buffer_pool_manager->UnpinPage(GetParentPageId(), true);
 }
 
@@ -305,7 +564,7 @@ INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyLastFrom(
     const MappingType &pair, BufferPoolManager *buffer_pool_manager) {
     assert(GetSize() + 1 <= GetMaxSize());
-    array[GetSize()] = pair;
+    SetEntryAt(GetSize(), pair.first, pair.second);
     IncreaseSize(1);
 }
 
@@ -321,6 +580,9 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveLastToFrontOf(
 
     MappingType pair {KeyAt(GetSize() - 1),ValueAt(GetSize() - 1)};
     IncreaseSize(-1);
+    ////两页的分界移到移动的key
+    SetFences(GetLowFence(), pair.first);
+    recipient->SetFences(pair.first, recipient->GetHighFence());
     recipient->CopyFirstFrom(pair, parent_index, buffer_pool_manager);
 }
 
@@ -331,9 +593,9 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyFirstFrom(
 
     ////类似，先移动腾出位置再链接
     assert(GetSize() + 1 < GetMaxSize());
-    memmove(array + 1, array, GetSize()*sizeof(MappingType));
+    MoveEntries(1, 0, GetSize());
     IncreaseSize(1);
-    array[0] = pair;
+    SetEntryAt(0, pair.first, pair.second);
     // update child parent page id
     page_id_t childPageId = pair.second;
     Page *page = buffer_pool_manager->FetchPage(childPageId);
@@ -346,7 +608,7 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyFirstFrom(
     //// 更新parent‘spage中的相关键值对
     page = buffer_pool_manager->FetchPage(GetParentPageId());
     auto *parent = reinterpret_cast<B_PLUS_TREE_INTERNAL_PAGE *>(page->GetData());
-    parent->SetKeyAt(parent_index, array[0].first);
+    parent->SetKeyAt(parent_index, pair.first);
     buffer_pool_manager->UnpinPage(GetParentPageId(), true);
 
 }
@@ -359,7 +621,7 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::QueueUpChildren(
     std::queue<BPlusTreePage *> *queue,
     BufferPoolManager *buffer_pool_manager) {
   for (int i = 0; i < GetSize(); i++) {
-    auto *page = buffer_pool_manager->FetchPage(array[i].second);
+    auto *page = buffer_pool_manager->FetchPage(ValueAt(i));
     if (page == nullptr)
       throw Exception(EXCEPTION_TYPE_INDEX,
                       "all page are pinned while printing");
@@ -389,9 +651,9 @@ std::string B_PLUS_TREE_INTERNAL_PAGE_TYPE::ToString(bool verbose) const {
     } else {
       os << " ";
     }
-    os << std::dec << array[entry].first.ToString();
+    os << std::dec << KeyAt(entry).ToString();
     if (verbose) {
-      os << "(" << array[entry].second << ")";
+      os << "(" << ValueAt(entry) << ")";
     }
     ++entry;
   }
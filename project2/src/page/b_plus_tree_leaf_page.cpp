@@ -2,6 +2,8 @@
  * b_plus_tree_leaf_page.cpp
  */
 
+#include <algorithm>
+#include <cstring>
 #include <sstream>
 
 #include "common/exception.h"
@@ -21,17 +23,214 @@ namespace scudb {
  * next page id and set max size
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id) {
+void B_PLUS_TREE_LEAF_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id,
+                                      IndexKeyFormat key_format) {
     SetPageType(IndexPageType::LEAF_PAGE);////叶子节点
 
     ////init membership value
     SetSize(0);
-    assert(sizeof(BPlusTreeLeafPage) == 28);
+    assert(sizeof(BPlusTreeLeafPage) == 32);
     SetPageId(page_id);
     SetParentPageId(parent_id);
     SetNextPageId(INVALID_PAGE_ID);
-    int max_size = (PAGE_SIZE - sizeof(BPlusTreeLeafPage))/sizeof(MappingType);
-    SetMaxSize(max_size - 1);
+    SetKeyFormat(key_format);
+    if (key_format != IndexKeyFormat::PREFIX_COMPRESSED) {
+        ////key array页的key和value分开存放，容量和键值对页相同
+        assert(key_format == IndexKeyFormat::PAIRS ||
+               sizeof(KeyType) == 4 || sizeof(KeyType) == 8);
+        SetPrefixSize(0);
+        SetMinSize(0);
+        int max_size = (PAGE_SIZE - sizeof(BPlusTreeLeafPage))/
+                       (sizeof(KeyType) + sizeof(ValueType));
+        SetMaxSize(max_size - 1);
+        return;
+    }
+    ////压缩页: 初始键范围为整个键空间，没有公共前缀
+    char *fences = reinterpret_cast<char *>(array);
+    memset(fences, 0, sizeof(KeyType));
+    memset(fences + sizeof(KeyType), 0xFF, sizeof(KeyType));
+    SetPrefixSize(0);
+    SetMaxSize(MaxSizeFor(0));
+    ////前缀变短时max size会变小，min size按无前缀的容量取，保证重新分配后放得下
+    SetMinSize(MaxSizeFor(0) / 2);
+}
+
+/*
+ * Helper methods for the entries of all page formats
+ */
+INDEX_TEMPLATE_ARGUMENTS
+char *B_PLUS_TREE_LEAF_PAGE_TYPE::KeyArrayAt(int index) {
+    return reinterpret_cast<char *>(array) + index * sizeof(KeyType);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+const char *B_PLUS_TREE_LEAF_PAGE_TYPE::KeyArrayAt(int index) const {
+    return reinterpret_cast<const char *>(array) + index * sizeof(KeyType);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+const char *B_PLUS_TREE_LEAF_PAGE_TYPE::ValueArrayAt(int index) const {
+    ////value数组在max size + 1个key之后
+    return KeyArrayAt(GetMaxSize() + 1) + index * sizeof(ValueType);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_LEAF_PAGE_TYPE::MaxSizeFor(int prefix_size) const {
+    int space = PAGE_SIZE - sizeof(BPlusTreeLeafPage) - 2 * sizeof(KeyType);
+    int entry_size = sizeof(KeyType) - prefix_size + sizeof(ValueType);
+    return space / entry_size - 1;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_LEAF_PAGE_TYPE::EntrySize() const {
+    if (!IsCompressed()) {
+        return sizeof(MappingType);
+    }
+    return sizeof(KeyType) - GetPrefixSize() + sizeof(ValueType);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+char *B_PLUS_TREE_LEAF_PAGE_TYPE::EntryAt(int index) {
+    if (!IsCompressed()) {
+        return reinterpret_cast<char *>(array + index);
+    }
+    return reinterpret_cast<char *>(array) + 2 * sizeof(KeyType) +
+           index * EntrySize();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+const char *B_PLUS_TREE_LEAF_PAGE_TYPE::EntryAt(int index) const {
+    return const_cast<BPlusTreeLeafPage *>(this)->EntryAt(index);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+ValueType B_PLUS_TREE_LEAF_PAGE_TYPE::ValueAt(int index) const {
+    ValueType value;
+    if (IsKeyArray()) {
+        memcpy(&value, ValueArrayAt(index), sizeof(ValueType));
+        return value;
+    }
+    if (!IsCompressed()) {
+        return array[index].second;
+    }
+    memcpy(&value, EntryAt(index) + sizeof(KeyType) - GetPrefixSize(),
+           sizeof(ValueType));
+    return value;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::SetEntryAt(int index, const KeyType &key,
+                                            const ValueType &value) {
+    if (IsKeyArray()) {
+        memcpy(KeyArrayAt(index), &key, sizeof(KeyType));
+        memcpy(const_cast<char *>(ValueArrayAt(index)), &value,
+               sizeof(ValueType));
+        return;
+    }
+    if (!IsCompressed()) {
+        array[index].first = key;
+        array[index].second = value;
+        return;
+    }
+    ////只保存前缀之后的部分
+    int prefix_size = GetPrefixSize();
+    int suffix_size = sizeof(KeyType) - prefix_size;
+    char *entry = EntryAt(index);
+    memcpy(entry, reinterpret_cast<const char *>(&key) + prefix_size, suffix_size);
+    memcpy(entry + suffix_size, &value, sizeof(ValueType));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveEntries(int to, int from, int count) {
+    if (IsKeyArray()) {
+        memmove(KeyArrayAt(to), KeyArrayAt(from), count * sizeof(KeyType));
+        memmove(const_cast<char *>(ValueArrayAt(to)), ValueArrayAt(from),
+                count * sizeof(ValueType));
+        return;
+    }
+    memmove(EntryAt(to), EntryAt(from), static_cast<size_t>(count * EntrySize()));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_LEAF_PAGE_TYPE::KeyEquals(int index, const KeyType &key) const {
+    const char *key_data = reinterpret_cast<const char *>(&key);
+    int prefix_size = GetPrefixSize();
+    return memcmp(array, key_data, prefix_size) == 0 &&
+           memcmp(EntryAt(index), key_data + prefix_size,
+                  sizeof(KeyType) - prefix_size) == 0;
+}
+
+/*
+ * Helper methods to get/set the key range of a compressed page. Setting it
+ * rewrites the entries when the common prefix of the fences changes
+ */
+INDEX_TEMPLATE_ARGUMENTS
+KeyType B_PLUS_TREE_LEAF_PAGE_TYPE::GetLowFence() const {
+    KeyType key;
+    memcpy(&key, array, sizeof(KeyType));
+    return key;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+KeyType B_PLUS_TREE_LEAF_PAGE_TYPE::GetHighFence() const {
+    KeyType key;
+    memcpy(&key, reinterpret_cast<const char *>(array) + sizeof(KeyType),
+           sizeof(KeyType));
+    return key;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::SetFences(const KeyType &low,
+                                           const KeyType &high) {
+    if (!IsCompressed()) {
+        return;
+    }
+    int old_prefix = GetPrefixSize();
+    int old_size = EntrySize();
+    int new_prefix = CommonPrefixSize(reinterpret_cast<const char *>(&low),
+                                      reinterpret_cast<const char *>(&high),
+                                      sizeof(KeyType));
+    int new_size = sizeof(KeyType) - new_prefix + sizeof(ValueType);
+    char *fences = reinterpret_cast<char *>(array);
+    char *base = fences + 2 * sizeof(KeyType);
+    if (new_prefix > old_prefix) {
+        ////前缀变长，条目变短，从前往后去掉多出的前缀字节
+        for (int i = 0; i < GetSize(); i++) {
+            memmove(base + i * new_size,
+                    base + i * old_size + (new_prefix - old_prefix), new_size);
+        }
+    } else if (new_prefix < old_prefix) {
+        ////前缀变短，条目变长，从后往前把旧前缀的字节补回条目
+        assert(GetSize() <= MaxSizeFor(new_prefix) + 1);
+        for (int i = GetSize() - 1; i >= 0; i--) {
+            memmove(base + i * new_size + (old_prefix - new_prefix),
+                    base + i * old_size, old_size);
+            memcpy(base + i * new_size, fences + new_prefix,
+                   old_prefix - new_prefix);
+        }
+    }
+    memcpy(fences, &low, sizeof(KeyType));
+    memcpy(fences + sizeof(KeyType), &high, sizeof(KeyType));
+    SetPrefixSize(new_prefix);
+    SetMaxSize(MaxSizeFor(new_prefix));
+}
+
+/*
+ * The merged page covers the key ranges of both, its prefix is what all four
+ * fences have in common
+ */
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_LEAF_PAGE_TYPE::GetMaxSizeAfterMerge(
+        const BPlusTreeLeafPage *sibling) const {
+    if (!IsCompressed()) {
+        return GetMaxSize();
+    }
+    int prefix_size = CommonPrefixSize(
+            reinterpret_cast<const char *>(array),
+            reinterpret_cast<const char *>(sibling->array), sizeof(KeyType));
+    prefix_size = std::min(prefix_size, GetPrefixSize());
+    prefix_size = std::min(prefix_size, sibling->GetPrefixSize());
+    return MaxSizeFor(prefix_size);
 }
 
 /**
@@ -54,8 +253,40 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::SetNextPageId(page_id_t next_page_id) {
 INDEX_TEMPLATE_ARGUMENTS
 int B_PLUS_TREE_LEAF_PAGE_TYPE::KeyIndex(
     const KeyType &key, const KeyComparator &comparator) const {
+    return KeyIndex(key, comparator, GetSize());
+}
+
+////只在前size个entry里找
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_LEAF_PAGE_TYPE::KeyIndex(
+    const KeyType &key, const KeyComparator &comparator, int size) const {
 
-    int begin= 0, end = GetSize() - 1;
+    int begin= 0, end = size - 1;
+    if (IsKeyArray()) {
+        ////key array页: SIMD查找
+        return CountKeysLess(KeyArrayAt(0), sizeof(KeyType), size,
+                             reinterpret_cast<const char *>(&key), false);
+    }
+    if (IsCompressed()) {
+        ////压缩页: 先比较公共前缀，再按memcmp二分查找后缀
+        const char *key_data = reinterpret_cast<const char *>(&key);
+        int prefix_size = GetPrefixSize();
+        int cmp = memcmp(key_data, array, prefix_size);
+        if (cmp != 0) {
+            return cmp < 0 ? 0 : size;
+        }
+        key_data += prefix_size;
+        size_t suffix_size = sizeof(KeyType) - prefix_size;
+        while (begin <= end) {
+            int mid = (end - begin) / 2 + begin;
+            if (memcmp(EntryAt(mid), key_data, suffix_size) >= 0) {
+                end = mid - 1;
+            } else {
+                begin = mid + 1;
+            }
+        }
+        return end + 1;
+    }
     ////二分查找 因为B+树是一个平衡树！！
     while (begin <= end) {
         int mid = (end - begin) / 2 + begin;
@@ -76,7 +307,20 @@ int B_PLUS_TREE_LEAF_PAGE_TYPE::KeyIndex(
 INDEX_TEMPLATE_ARGUMENTS
 KeyType B_PLUS_TREE_LEAF_PAGE_TYPE::KeyAt(int index) const {
     assert(index >= 0 && index < GetSize());
-    return array[index].first;
+    KeyType key;
+    if (IsKeyArray()) {
+        memcpy(&key, KeyArrayAt(index), sizeof(KeyType));
+        return key;
+    }
+    if (!IsCompressed()) {
+        return array[index].first;
+    }
+    ////前缀加后缀拼出完整的key
+    int prefix_size = GetPrefixSize();
+    memcpy(&key, array, prefix_size);
+    memcpy(reinterpret_cast<char *>(&key) + prefix_size, EntryAt(index),
+           sizeof(KeyType) - prefix_size);
+    return key;
 }
 
 /*
@@ -84,9 +328,11 @@ KeyType B_PLUS_TREE_LEAF_PAGE_TYPE::KeyAt(int index) const {
  * "index"(a.k.a array offset)
  */
 INDEX_TEMPLATE_ARGUMENTS
-const MappingType &B_PLUS_TREE_LEAF_PAGE_TYPE::GetItem(int index) {
-    // replace with your own code
-    return array[index];////返回数据，pair类型的重载[]
+MappingType B_PLUS_TREE_LEAF_PAGE_TYPE::GetItem(int index) const {
+    if (GetKeyFormat() == IndexKeyFormat::PAIRS) {
+        return array[index];////返回数据，pair类型的重载[]
+    }
+    return MappingType(KeyAt(index), ValueAt(index));
 }
 
 /*****************************************************************************
@@ -105,13 +351,9 @@ int B_PLUS_TREE_LEAF_PAGE_TYPE::Insert(const KeyType &key,
     IncreaseSize(1);
     int cur_size = GetSize();
     ////向后移动腾出位置
-    for (int i = cur_size - 1; i > index; i--) {
-        array[i].first = array[i - 1].first;
-        array[i].second = array[i - 1].second;
-    }
+    MoveEntries(index + 1, index, cur_size - 1 - index);
     ////插入新键值对
-    array[index].first = key;
-    array[index].second = value;
+    SetEntryAt(index, key, value);
     return cur_size;
 }
 
@@ -129,11 +371,13 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveHalfTo(
 
     ////复制后一半，ceil(total) + 1
     int mid_index = (total)/2;
+    ////分隔键同时是两页新的键范围边界
+    KeyType middle_key = KeyAt(mid_index);
+    recipient->SetFences(middle_key, GetHighFence());
 
     ////复制array的后一般到recipient中
     for (int i = mid_index; i < total; i++) {
-        recipient->array[i - mid_index].first = array[i].first;
-        recipient->array[i - mid_index].second = array[i].second;
+        recipient->SetEntryAt(i - mid_index, KeyAt(i), ValueAt(i));
     }
     ////设置相关的指针变化
     recipient->SetNextPageId(GetNextPageId());
@@ -141,6 +385,7 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveHalfTo(
 
     SetSize(mid_index);
     recipient->SetSize(total - mid_index);
+    SetFences(GetLowFence(), middle_key);
 
 }
 
@@ -158,12 +403,43 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyHalfFrom(MappingType *items, int size) {}
 INDEX_TEMPLATE_ARGUMENTS
 bool B_PLUS_TREE_LEAF_PAGE_TYPE::Lookup(const KeyType &key, ValueType &value,
                                         const KeyComparator &comparator) const {
+    return Lookup(key, value, comparator, GetSize());
+}
+
+////只看前size个entry；不加latch的读者传入的size已限制在page之内，这里不能再读GetSize()
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_LEAF_PAGE_TYPE::Lookup(const KeyType &key, ValueType &value,
+                                        const KeyComparator &comparator,
+                                        int size) const {
+    int index = KeyIndex(key, comparator, size);
+    if (index >= size) {
+        return false;
+    }
+    if (IsCompressed()) {
+        if (!KeyEquals(index, key)) return false;
+    } else {
+        ////KeyAt会对GetSize()做assert
+        KeyType stored;
+        memcpy(&stored, IsKeyArray() ? KeyArrayAt(index) : EntryAt(index),
+               sizeof(KeyType));
+        if (comparator(stored, key) != 0) return false;
+    }
+    value = ValueAt(index);
+    return true;
+}
+
+////替换key对应的value，非unique的树在key有多个value时换成posting list的引用
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_LEAF_PAGE_TYPE::Update(const KeyType &key, const ValueType &value,
+                                        const KeyComparator &comparator) {
     int index = KeyIndex(key,comparator);
-    if (index < GetSize() && comparator(array[index].first, key) == 0) {
-        value = array[index].second;
-        return true;
+    if (index >= GetSize() ||
+        !(IsCompressed() ? KeyEquals(index, key)
+                         : comparator(KeyAt(index), key) == 0)) {
+        return false;
     }
-    return false;
+    SetEntryAt(index, key, value);
+    return true;
 }
 
 /*****************************************************************************
@@ -188,8 +464,7 @@ int B_PLUS_TREE_LEAF_PAGE_TYPE::RemoveAndDeleteRecord(
         //quick deletion
         int tar_index = tar_key;
         ////直接使用内存复制函数，将后续数据直接向前移动覆盖掉tar_index的数据
-        memmove(array + tar_index, array + tar_index + 1,
-                static_cast<size_t>((GetSize() - tar_index - 1)*sizeof(MappingType)));
+        MoveEntries(tar_index, tar_index + 1, GetSize() - tar_index - 1);
         IncreaseSize(-1); // remove size--
         return GetSize();
     }
@@ -206,11 +481,12 @@ int B_PLUS_TREE_LEAF_PAGE_TYPE::RemoveAndDeleteRecord(
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveAllTo(BPlusTreeLeafPage *recipient,
                                            int, BufferPoolManager *) {
+    ////合并后的页覆盖两页的键范围
+    recipient->SetFences(recipient->GetLowFence(), GetHighFence());
     ////复制所有的数据到recipient
     int start_index = recipient->GetSize();
     for (int i = 0; i < GetSize(); i++) {
-        recipient->array[start_index + i].first = array[i].first;
-        recipient->array[start_index + i].second = array[i].second;
+        recipient->SetEntryAt(start_index + i, KeyAt(i), ValueAt(i));
     }
     ////链接指针
     recipient->SetNextPageId(GetNextPageId());
@@ -236,19 +512,23 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveFirstToEndOf(
     MappingType pair = GetItem(0);
     IncreaseSize(-1);
     ////内存拷贝，快速移动数据
-    memmove(array, array + 1, static_cast<size_t>(GetSize()*sizeof(MappingType)));
+    MoveEntries(0, 1, GetSize());
+    ////两页的分界移到新的第一个key
+    KeyType middle_key = KeyAt(0);
+    recipient->SetFences(recipient->GetLowFence(), middle_key);
+    SetFences(middle_key, GetHighFence());
     recipient->CopyLastFrom(pair);
 
     ////更新parent page中相关的键值对
     Page *page = buffer_pool_manager->FetchPage(GetParentPageId());
     auto *parent = reinterpret_cast<B_PLUS_TREE_INTERNAL_PAGE *>(page->GetData());
-    parent->SetKeyAt(parent->ValueIndex(GetPageId()), array[0].first);
+    parent->SetKeyAt(parent->ValueIndex(GetPageId()), middle_key);
     buffer_pool_manager->UnpinPage(GetParentPageId(), true);
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyLastFrom(const MappingType &item) {
-    array[GetSize()] = item;
+    SetEntryAt(GetSize(), item.first, item.second);
     IncreaseSize(1);
 }
 /*
@@ -261,6 +541,9 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveLastToFrontOf(
         BufferPoolManager *buffer_pool_manager) {
     MappingType pair = GetItem(GetSize() - 1);////得到最后一个pair键值对
     IncreaseSize(-1);
+    ////两页的分界移到移动的key
+    SetFences(GetLowFence(), pair.first);
+    recipient->SetFences(pair.first, recipient->GetHighFence());
     ////pair拼接到recopient的头
     recipient->CopyFirstFrom(pair, parentIndex, buffer_pool_manager);
 }
@@ -271,14 +554,14 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyFirstFrom(
         BufferPoolManager *buffer_pool_manager) {
 
     ////内存移动，快速删除
-    memmove(array + 1, array, GetSize()*sizeof(MappingType));
+    MoveEntries(1, 0, GetSize());
     IncreaseSize(1);////++
-    array[0] = item;
+    SetEntryAt(0, item.first, item.second);
 
     ////更新parent相关的键值对
     Page *page = buffer_pool_manager->FetchPage(GetParentPageId());
     auto *parent = reinterpret_cast<B_PLUS_TREE_INTERNAL_PAGE *>(page->GetData());
-    parent->SetKeyAt(parentIndex, array[0].first);
+    parent->SetKeyAt(parentIndex, item.first);
     buffer_pool_manager->UnpinPage(GetParentPageId(), true);
 }
 
@@ -305,9 +588,9 @@ std::string B_PLUS_TREE_LEAF_PAGE_TYPE::ToString(bool verbose) const {
         } else {
             stream << " ";
         }
-        stream << std::dec << array[entry].first;
+        stream << std::dec << KeyAt(entry);
         if (verbose) {
-            stream << "(" << array[entry].second << ")";
+            stream << "(" << ValueAt(entry) << ")";
         }
         ++entry;
     }
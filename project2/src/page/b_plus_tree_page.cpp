@@ -1,6 +1,9 @@
 /**
  * b_plus_tree_page.cpp
  */
+#include <cstring>
+
+#include "index/key_search.h"
 #include "page/b_plus_tree_page.h"
 
 namespace scudb {
@@ -69,9 +72,57 @@ int BPlusTreePage::GetMinSize() const {
     if (IsRootPage()) {
         return IsLeafPage() ? 1: 2;
     }
+    ////压缩页的max size随前缀变化，min size单独保存
+    if (min_size_ > 0) {
+        return min_size_;
+    }
     return (max_size_ ) / 2;
 }
 
+void BPlusTreePage::SetMinSize(int min_size) {
+    min_size_ = static_cast<int16_t>(min_size);
+}
+
+void BPlusTreePage::SetKeyFormat(IndexKeyFormat key_format) {
+    key_format_ = key_format;
+}
+
+/*
+ * Helper methods for key prefix compression
+ */
+void BPlusTreePage::SetPrefixSize(int prefix_size) {
+    prefix_size_ = static_cast<int8_t>(prefix_size);
+}
+
+int BPlusTreePage::CommonPrefixSize(const char *lhs, const char *rhs,
+                                    int key_size) {
+    int i = 0;
+    while (i < key_size && lhs[i] == rhs[i]) {
+        i++;
+    }
+    return i;
+}
+
+/*
+ * Helper method for key array pages, whose keys are int32 or int64
+ */
+int BPlusTreePage::CountKeysLess(const char *keys, int key_size, int n,
+                                 const char *key, bool or_equal) {
+    if (key_size == sizeof(int32_t)) {
+        int32_t value;
+        memcpy(&value, key, sizeof(value));
+        auto *values = reinterpret_cast<const int32_t *>(keys);
+        return or_equal ? KeySearch::CountLessEqual(values, n, value)
+                        : KeySearch::CountLess(values, n, value);
+    }
+    assert(key_size == sizeof(int64_t));
+    int64_t value;
+    memcpy(&value, key, sizeof(value));
+    auto *values = reinterpret_cast<const int64_t *>(keys);
+    return or_equal ? KeySearch::CountLessEqual(values, n, value)
+                    : KeySearch::CountLess(values, n, value);
+}
+
 /*
  * Helper methods to get/set parent page id
  */
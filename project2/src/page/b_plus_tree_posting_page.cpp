@@ -0,0 +1,217 @@
+/**
+ * b_plus_tree_posting_page.cpp
+ */
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "common/exception.h"
+#include "page/b_plus_tree_posting_page.h"
+
+namespace scudb {
+
+void BPlusTreePostingPage::Init(page_id_t page_id) {
+  page_id_ = page_id;
+  next_page_id_ = INVALID_PAGE_ID;
+  size_ = 0;
+}
+
+int BPlusTreePostingPage::GetMaxSize() {
+  return (PAGE_SIZE - sizeof(BPlusTreePostingPage)) / sizeof(RID);
+}
+
+int BPlusTreePostingPage::LowerBound(const RID &rid) const {
+  return static_cast<int>(std::lower_bound(array, array + size_, rid, RidLess) -
+                          array);
+}
+
+bool BPlusTreePostingPage::Insert(const RID &rid) {
+  int index = LowerBound(rid);
+  if (index < size_ && array[index] == rid)
+    return false;
+  assert(size_ < GetMaxSize());
+  memmove(array + index + 1, array + index, (size_ - index) * sizeof(RID));
+  array[index] = rid;
+  size_++;
+  return true;
+}
+
+bool BPlusTreePostingPage::Remove(const RID &rid) {
+  int index = LowerBound(rid);
+  if (index == size_ || !(array[index] == rid))
+    return false;
+  memmove(array + index, array + index + 1, (size_ - index - 1) * sizeof(RID));
+  size_--;
+  return true;
+}
+
+void BPlusTreePostingPage::MoveHalfTo(BPlusTreePostingPage *recipient) {
+  assert(recipient->size_ == 0);
+  int half = size_ / 2;
+  memcpy(recipient->array, array + half, (size_ - half) * sizeof(RID));
+  recipient->size_ = size_ - half;
+  size_ = half;
+}
+
+BPlusTreePostingPage *
+BPlusTreePostingPage::NewPostingPage(BufferPoolManager *buffer_pool_manager) {
+  page_id_t page_id;
+  Page *page = buffer_pool_manager->NewPage(page_id);
+  if (page == nullptr)
+    throw Exception(EXCEPTION_TYPE_INDEX,
+                    "all page are pinned while writing a posting list");
+  auto *posting_page = reinterpret_cast<BPlusTreePostingPage *>(page->GetData());
+  posting_page->Init(page_id);
+  return posting_page;
+}
+
+BPlusTreePostingPage *
+BPlusTreePostingPage::FetchPostingPage(BufferPoolManager *buffer_pool_manager,
+                                       page_id_t page_id) {
+  Page *page = buffer_pool_manager->FetchPage(page_id);
+  if (page == nullptr)
+    throw Exception(EXCEPTION_TYPE_INDEX,
+                    "all page are pinned while reading a posting list");
+  return reinterpret_cast<BPlusTreePostingPage *>(page->GetData());
+}
+
+/*
+ * Pages are filled up, a list built in one go is as short as it can be
+ */
+RID BPlusTreePostingPage::CreateList(BufferPoolManager *buffer_pool_manager,
+                                     const RID *rids, int count) {
+  assert(count > 1);
+  auto *page = NewPostingPage(buffer_pool_manager);
+  page_id_t head_id = page->GetPageId();
+  int max_size = GetMaxSize();
+  for (int i = 0; i < count; i++) {
+    if (page->size_ == max_size) {
+      auto *next = NewPostingPage(buffer_pool_manager);
+      page->SetNextPageId(next->GetPageId());
+      buffer_pool_manager->UnpinPage(page->GetPageId(), true);
+      page = next;
+    }
+    page->array[page->size_++] = rids[i];
+  }
+  buffer_pool_manager->UnpinPage(page->GetPageId(), true);
+  return RID(head_id, POSTING_LIST_SLOT);
+}
+
+/*
+ * The rid goes to the first page whose last rid isn't less than it, or to
+ * the last page. A full page is split in half, except when the rid is the
+ * largest of the list: rows are mostly added in rid order, so then the rid
+ * starts a new last page and the full page stays full.
+ */
+bool BPlusTreePostingPage::InsertIntoList(
+    BufferPoolManager *buffer_pool_manager, const RID &list, const RID &rid) {
+  auto *page = FetchPostingPage(buffer_pool_manager, list.GetPageId());
+  while (page->GetNextPageId() != INVALID_PAGE_ID &&
+         RidLess(page->RidAt(page->GetSize() - 1), rid)) {
+    page_id_t next_page_id = page->GetNextPageId();
+    buffer_pool_manager->UnpinPage(page->GetPageId(), false);
+    page = FetchPostingPage(buffer_pool_manager, next_page_id);
+  }
+  int index = page->LowerBound(rid);
+  if (index < page->GetSize() && page->RidAt(index) == rid) {
+    buffer_pool_manager->UnpinPage(page->GetPageId(), false);
+    return false;
+  }
+  if (page->GetSize() == GetMaxSize()) {
+    auto *new_page = NewPostingPage(buffer_pool_manager);
+    new_page->SetNextPageId(page->GetNextPageId());
+    page->SetNextPageId(new_page->GetPageId());
+    if (index < page->GetSize()) {
+      page->MoveHalfTo(new_page);
+    }
+    if (new_page->GetSize() == 0 || !RidLess(rid, new_page->RidAt(0))) {
+      new_page->Insert(rid);
+    } else {
+      page->Insert(rid);
+    }
+    buffer_pool_manager->UnpinPage(new_page->GetPageId(), true);
+  } else {
+    page->Insert(rid);
+  }
+  buffer_pool_manager->UnpinPage(page->GetPageId(), true);
+  return true;
+}
+
+/*
+ * Pages never stay empty. An empty page is unlinked, or for the first page,
+ * whose id is the reference in the leaf, takes over the content of the next
+ * page.
+ */
+bool BPlusTreePostingPage::RemoveFromList(
+    BufferPoolManager *buffer_pool_manager, RID &value, const RID &rid) {
+  page_id_t head_id = value.GetPageId();
+  page_id_t prev_id = INVALID_PAGE_ID;
+  auto *page = FetchPostingPage(buffer_pool_manager, head_id);
+  while (page->GetNextPageId() != INVALID_PAGE_ID &&
+         RidLess(page->RidAt(page->GetSize() - 1), rid)) {
+    prev_id = page->GetPageId();
+    page_id_t next_page_id = page->GetNextPageId();
+    buffer_pool_manager->UnpinPage(prev_id, false);
+    page = FetchPostingPage(buffer_pool_manager, next_page_id);
+  }
+  page_id_t page_id = page->GetPageId();
+  if (!page->Remove(rid)) {
+    buffer_pool_manager->UnpinPage(page_id, false);
+    return false;
+  }
+  if (page->GetSize() > 0) {
+    buffer_pool_manager->UnpinPage(page_id, true);
+  } else if (prev_id != INVALID_PAGE_ID) {
+    auto *prev = FetchPostingPage(buffer_pool_manager, prev_id);
+    prev->SetNextPageId(page->GetNextPageId());
+    buffer_pool_manager->UnpinPage(prev_id, true);
+    buffer_pool_manager->UnpinPage(page_id, false);
+    buffer_pool_manager->DeletePage(page_id);
+  } else {
+    // a list holds two rids at least, so the first page has a next page
+    page_id_t next_page_id = page->GetNextPageId();
+    assert(next_page_id != INVALID_PAGE_ID);
+    auto *next = FetchPostingPage(buffer_pool_manager, next_page_id);
+    page->next_page_id_ = next->next_page_id_;
+    page->size_ = next->size_;
+    memcpy(page->array, next->array, next->size_ * sizeof(RID));
+    buffer_pool_manager->UnpinPage(next_page_id, false);
+    buffer_pool_manager->DeletePage(next_page_id);
+    buffer_pool_manager->UnpinPage(page_id, true);
+  }
+
+  auto *head = FetchPostingPage(buffer_pool_manager, head_id);
+  bool single = head->GetSize() == 1 && head->GetNextPageId() == INVALID_PAGE_ID;
+  if (single)
+    value = head->RidAt(0);
+  buffer_pool_manager->UnpinPage(head_id, false);
+  if (single)
+    buffer_pool_manager->DeletePage(head_id);
+  return true;
+}
+
+void BPlusTreePostingPage::GetList(BufferPoolManager *buffer_pool_manager,
+                                   const RID &list, std::vector<RID> &result) {
+  page_id_t page_id = list.GetPageId();
+  while (page_id != INVALID_PAGE_ID) {
+    auto *page = FetchPostingPage(buffer_pool_manager, page_id);
+    result.insert(result.end(), page->array, page->array + page->size_);
+    page_id_t next_page_id = page->GetNextPageId();
+    buffer_pool_manager->UnpinPage(page_id, false);
+    page_id = next_page_id;
+  }
+}
+
+void BPlusTreePostingPage::DeleteList(BufferPoolManager *buffer_pool_manager,
+                                      const RID &list) {
+  page_id_t page_id = list.GetPageId();
+  while (page_id != INVALID_PAGE_ID) {
+    auto *page = FetchPostingPage(buffer_pool_manager, page_id);
+    page_id_t next_page_id = page->GetNextPageId();
+    buffer_pool_manager->UnpinPage(page_id, false);
+    buffer_pool_manager->DeletePage(page_id);
+    page_id = next_page_id;
+  }
+}
+
+} // namespace scudb
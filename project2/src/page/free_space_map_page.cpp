@@ -0,0 +1,29 @@
+/**
+ * free_space_map_page.cpp
+ */
+#include "page/free_space_map_page.h"
+
+namespace scudb {
+
+void FreeSpaceMapPage::Init(page_id_t page_id) {
+  page_id_ = page_id;
+  next_page_id_ = INVALID_PAGE_ID;
+  size_ = 0;
+  free_page_id_ = INVALID_PAGE_ID;
+}
+
+int FreeSpaceMapPage::GetMaxSize() {
+  return (PAGE_SIZE - sizeof(FreeSpaceMapPage)) /
+         (sizeof(page_id_t) + sizeof(uint8_t));
+}
+
+bool FreeSpaceMapPage::Append(page_id_t heap_page_id, uint8_t category) {
+  if (size_ == GetMaxSize())
+    return false;
+  heap_page_ids_[size_] = heap_page_id;
+  SetCategory(size_, category);
+  size_++;
+  return true;
+}
+
+} // namespace scudb
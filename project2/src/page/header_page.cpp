@@ -8,6 +8,27 @@
 
 namespace scudb {
 
+// marks a header page that carries the page size of its db file
+static const int HEADER_MAGIC = 0x53435544;
+static const int MAGIC_OFFSET = 8;
+static const int PAGE_SIZE_OFFSET = 12;
+// where the records start
+static const int RECORD_OFFSET = 16;
+
+void HeaderPage::Init() {
+  SetRecordCount(0);
+  memcpy(GetData() + MAGIC_OFFSET, &HEADER_MAGIC, 4);
+  memcpy(GetData() + PAGE_SIZE_OFFSET, &PAGE_SIZE, 4);
+}
+
+int HeaderPage::GetStoredPageSize(const char *header_data, size_t size) {
+  if (size < STORED_PAGE_SIZE_END ||
+      *reinterpret_cast<const int *>(header_data + MAGIC_OFFSET) !=
+          HEADER_MAGIC)
+    return 0;
+  return *reinterpret_cast<const int *>(header_data + PAGE_SIZE_OFFSET);
+}
+
 /**
  * Record related
  */
@@ -17,7 +38,10 @@ bool HeaderPage::InsertRecord(const std::string &name,
   assert(root_id > INVALID_PAGE_ID);
 
   int record_num = GetRecordCount();
-  int offset = 4 + record_num * 36;
+  int offset = RECORD_OFFSET + record_num * 36;
+  // the page is full
+  if (offset + 36 > PAGE_SIZE)
+    return false;
   // check for duplicate name
   if (FindRecord(name) != -1)
     return false;
@@ -37,7 +61,7 @@ bool HeaderPage::DeleteRecord(const std::string &name) {
   // record does not exsit
   if (index == -1)
     return false;
-  int offset = index * 36 + 4;
+  int offset = index * 36 + RECORD_OFFSET;
   memmove(GetData() + offset, GetData() + offset + 36,
           (record_num - index - 1) * 36);
 
@@ -53,7 +77,7 @@ bool HeaderPage::UpdateRecord(const std::string &name,
   // record does not exsit
   if (index == -1)
     return false;
-  int offset = index * 36 + 4;
+  int offset = index * 36 + RECORD_OFFSET;
   // update record content, only root_id
   memcpy((GetData() + offset + 32), &root_id, 4);
 
@@ -67,7 +91,7 @@ bool HeaderPage::GetRootId(const std::string &name, page_id_t &root_id) {
   // record does not exsit
   if (index == -1)
     return false;
-  int offset = (index + 1) * 36;
+  int offset = index * 36 + RECORD_OFFSET + 32;
   root_id = *reinterpret_cast<page_id_t *>(GetData() + offset);
 
   return true;
@@ -87,7 +111,8 @@ int HeaderPage::FindRecord(const std::string &name) {
   int record_num = GetRecordCount();
 
   for (int i = 0; i < record_num; i++) {
-    char *raw_name = reinterpret_cast<char *>(GetData() + (4 + i * 36));
+    char *raw_name =
+        reinterpret_cast<char *>(GetData() + (RECORD_OFFSET + i * 36));
     if (strcmp(raw_name, name.c_str()) == 0)
       return i;
   }
@@ -0,0 +1,16 @@
+/**
+ * overflow_page.cpp
+ */
+#include "page/overflow_page.h"
+
+namespace scudb {
+
+void OverflowPage::Init(page_id_t page_id) {
+  page_id_ = page_id;
+  next_page_id_ = INVALID_PAGE_ID;
+  size_ = 0;
+}
+
+int OverflowPage::GetMaxSize() { return PAGE_SIZE - sizeof(OverflowPage); }
+
+} // namespace scudb
@@ -0,0 +1,547 @@
+/**
+ * pax_page.cpp
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <utility>
+
+#include "page/pax_page.h"
+
+namespace scudb {
+/**
+ * Header related
+ */
+void PaxPage::Init(page_id_t page_id, size_t page_size,
+                   page_id_t prev_page_id, Schema *schema,
+                   LogManager *log_manager, Transaction *txn) {
+  TablePage::Init(page_id, page_size, prev_page_id, log_manager, txn);
+  SetLayout(PageLayout::PAX);
+  SetColumnCount(schema->GetColumnCount());
+  SetCapacity(0);
+  for (int i = 0; i < schema->GetColumnCount(); i++) {
+    int16_t column[2] = {static_cast<int16_t>(schema->GetLength(i)),
+                         static_cast<int16_t>(schema->IsInlined(i))};
+    SetMinipageOffset(i, 0);
+    memcpy(GetData() + PAX_PAGE_HEADER_SIZE + PAX_PAGE_COLUMN_SIZE * i + 4,
+           column, 4);
+  }
+}
+
+int32_t PaxPage::GetFreeSpaceSize() {
+  if (GetTupleCount() == 0) // laid out again for the next tuple
+    return PAGE_SIZE - GetRowStatesOffset() - 1;
+  if (GetEmptyRow() == -1)
+    return 0;
+  return GetContiguousFreeSpaceSize() + GetFragmentedSize() + GetFixedSize();
+}
+
+/*
+ * As TablePage::Compact, the values are moved from the highest offset down.
+ * The values of a row being updated have offset 0 and are skipped.
+ */
+void PaxPage::Compact() {
+  // offset, row * column count + column
+  std::vector<std::pair<int32_t, int>> values;
+  for (int row = 0; row < GetTupleCount(); row++) {
+    if (GetRowState(row) == PAX_ROW_EMPTY)
+      continue;
+    for (int i = 0; i < GetColumnCount(); i++) {
+      if (IsColumnInlined(i))
+        continue;
+      int32_t offset = *reinterpret_cast<int32_t *>(GetValuePtr(i, row));
+      if (offset != 0)
+        values.emplace_back(offset, row * GetColumnCount() + i);
+    }
+  }
+  std::sort(values.begin(), values.end(),
+            std::greater<std::pair<int32_t, int>>());
+  int32_t free_space_pointer = PAGE_SIZE;
+  for (auto &value : values) {
+    int32_t size = ColumnVector::GetVarlenSize(GetData() + value.first);
+    free_space_pointer -= size;
+    if (free_space_pointer != value.first) {
+      memmove(GetData() + free_space_pointer, GetData() + value.first, size);
+      memcpy(GetValuePtr(value.second % GetColumnCount(),
+                         value.second / GetColumnCount()),
+             &free_space_pointer, 4);
+    }
+  }
+  SetFreeSpacePointer(free_space_pointer);
+  SetFragmentedSize(0);
+
+  int tuple_count = GetTupleCount();
+  while (tuple_count > 0 && GetRowState(tuple_count - 1) == PAX_ROW_EMPTY) {
+    --tuple_count;
+  }
+  SetTupleCount(tuple_count);
+}
+
+/**
+ * Tuple related
+ */
+bool PaxPage::InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn,
+                          LockManager *lock_manager,
+                          LogManager *log_manager) {
+  return InsertTuples(&tuple, 1, &rid, txn, lock_manager, log_manager) == 1;
+}
+
+int PaxPage::InsertTuples(const Tuple *tuples, int count, RID *rids,
+                          Transaction *txn, LockManager *lock_manager,
+                          LogManager *log_manager) {
+  int inserted;
+  for (inserted = 0; inserted < count; ++inserted) {
+    const Tuple &tuple = tuples[inserted];
+    if (GetTupleCount() == 0 && !Layout(tuple)) {
+      break; // larger than the page
+    }
+    int row = GetEmptyRow();
+    int32_t varlen_size = GetVarlenSize(tuple);
+    if (row == -1 ||
+        GetContiguousFreeSpaceSize() + GetFragmentedSize() < varlen_size) {
+      break; // not enough space
+    }
+    if (GetContiguousFreeSpaceSize() < varlen_size) {
+      Compact();
+      // the empty rows at the end are gone
+      row = GetEmptyRow();
+    }
+    InsertTupleAt(row, tuple, rids[inserted], txn, lock_manager);
+  }
+  return inserted;
+}
+
+bool PaxPage::MarkDelete(const RID &rid, Transaction *txn,
+                         LockManager *lock_manager, LogManager *log_manager) {
+  int row = rid.GetSlotNum();
+  if (row >= GetTupleCount() || GetRowState(row) != PAX_ROW_LIVE) {
+    if (ENABLE_LOGGING) {
+      txn->SetState(TransactionState::ABORTED);
+    }
+    return false;
+  }
+
+  if (ENABLE_LOGGING) {
+    if (!LockRow(rid, txn, lock_manager))
+      return false;
+    // TODO: add your logging logic here
+  }
+
+  SetRowState(row, PAX_ROW_DELETED);
+  return true;
+}
+
+/*
+ * The fixed-size values are overwritten in place, the varlen values of the
+ * old tuple become fragments and the new ones are added to the varlen area.
+ */
+bool PaxPage::UpdateTuple(const Tuple &new_tuple, Tuple &old_tuple,
+                          const RID &rid, Transaction *txn,
+                          LockManager *lock_manager, LogManager *log_manager) {
+  int row = rid.GetSlotNum();
+  if (row >= GetTupleCount() || GetRowState(row) != PAX_ROW_LIVE) {
+    if (ENABLE_LOGGING) {
+      txn->SetState(TransactionState::ABORTED);
+    }
+    return false;
+  }
+  int32_t varlen_size = GetVarlenSize(new_tuple);
+  if (GetContiguousFreeSpaceSize() + GetFragmentedSize() <
+      varlen_size - GetVarlenSize(row)) {
+    // should delete/insert because not enough space
+    return false;
+  }
+
+  // copy out old value
+  CopyTuple(row, old_tuple);
+  old_tuple.rid_ = rid;
+
+  if (ENABLE_LOGGING) {
+    if (!LockRow(rid, txn, lock_manager))
+      return false;
+    // TODO: add your logging logic here
+  }
+
+  // update
+  FreeVarlenValues(row);
+  if (GetContiguousFreeSpaceSize() < varlen_size) {
+    Compact();
+  }
+  int32_t offset = 0;
+  for (int i = 0; i < GetColumnCount(); i++) {
+    if (IsColumnInlined(i))
+      memcpy(GetValuePtr(i, row), new_tuple.GetData() + offset,
+             GetColumnWidth(i));
+    offset += GetColumnWidth(i);
+  }
+  WriteVarlenValues(row, new_tuple);
+  return true;
+}
+
+void PaxPage::ApplyDelete(const RID &rid, Transaction *txn,
+                          LogManager *log_manager, Tuple *deleted_tuple) {
+  int row = rid.GetSlotNum();
+  assert(row < GetTupleCount() && GetRowState(row) != PAX_ROW_EMPTY);
+  if (deleted_tuple != nullptr) {
+    CopyTuple(row, *deleted_tuple);
+    deleted_tuple->rid_ = rid;
+  }
+
+  if (ENABLE_LOGGING) {
+    // must already grab the exclusive lock
+    assert(txn->GetExclusiveLockSet()->find(rid) !=
+           txn->GetExclusiveLockSet()->end());
+    // TODO: add your logging logic here
+  }
+
+  FreeVarlenValues(row);
+  SetRowState(row, PAX_ROW_EMPTY);
+  int tuple_count = GetTupleCount();
+  while (tuple_count > 0 && GetRowState(tuple_count - 1) == PAX_ROW_EMPTY) {
+    --tuple_count;
+  }
+  SetTupleCount(tuple_count);
+}
+
+void PaxPage::RollbackDelete(const RID &rid, Transaction *txn,
+                             LogManager *log_manager) {
+  if (ENABLE_LOGGING) {
+    // must have already grab the exclusive lock
+    assert(txn->GetExclusiveLockSet()->find(rid) !=
+           txn->GetExclusiveLockSet()->end());
+
+    // TODO: add your logging logic here
+  }
+
+  int row = rid.GetSlotNum();
+  assert(row < GetTupleCount());
+  if (GetRowState(row) == PAX_ROW_DELETED)
+    SetRowState(row, PAX_ROW_LIVE);
+}
+
+bool PaxPage::GetTuple(const RID &rid, Tuple &tuple, Transaction *txn,
+                       LockManager *lock_manager) {
+  int row = rid.GetSlotNum();
+  if (row >= GetTupleCount() || GetRowState(row) != PAX_ROW_LIVE) {
+    if (ENABLE_LOGGING)
+      txn->SetState(TransactionState::ABORTED);
+    return false;
+  }
+
+  if (ENABLE_LOGGING && !LockShared(rid, txn, lock_manager)) {
+    return false;
+  }
+
+  CopyTuple(row, tuple);
+  tuple.rid_ = rid;
+  return true;
+}
+
+/**
+ * Tuple iterator
+ */
+bool PaxPage::GetFirstTupleRid(RID &first_rid) {
+  for (int row = 0; row < GetTupleCount(); ++row) {
+    if (GetRowState(row) == PAX_ROW_LIVE) {
+      first_rid.Set(GetPageId(), row);
+      return true;
+    }
+  }
+  // there is no tuple within current page
+  first_rid.Set(INVALID_PAGE_ID, -1);
+  return false;
+}
+
+bool PaxPage::GetNextTupleRid(const RID &cur_rid, RID &next_rid) {
+  assert(cur_rid.GetPageId() == GetPageId());
+  for (auto row = cur_rid.GetSlotNum() + 1; row < GetTupleCount(); ++row) {
+    if (GetRowState(row) == PAX_ROW_LIVE) {
+      next_rid.Set(GetPageId(), row);
+      return true;
+    }
+  }
+  return false; // End of last tuple
+}
+
+/*
+ * When every row in use holds a tuple, the fixed-size values of a column are
+ * copied out of its minipage at once.
+ */
+void PaxPage::GetColumns(const std::vector<int> &column_ids,
+                         ColumnBatch &batch, Transaction *txn,
+                         LockManager *lock_manager) {
+  std::vector<int> rows;
+  for (int row = 0; row < GetTupleCount(); ++row) {
+    if (GetRowState(row) != PAX_ROW_LIVE)
+      continue;
+    RID rid(GetPageId(), row);
+    if (ENABLE_LOGGING && !LockShared(rid, txn, lock_manager))
+      continue;
+    rows.push_back(row);
+    batch.rids.push_back(rid);
+  }
+  bool all_rows = static_cast<int>(rows.size()) == GetTupleCount();
+  for (size_t i = 0; i < column_ids.size(); i++) {
+    int column = column_ids[i];
+    ColumnVector &vector = batch.columns[i];
+    if (IsColumnInlined(column) && all_rows) {
+      vector.Append(GetValuePtr(column, 0), GetTupleCount());
+      continue;
+    }
+    for (int row : rows) {
+      if (IsColumnInlined(column))
+        vector.Append(GetValuePtr(column, row));
+      else
+        vector.Append(GetData() +
+                      *reinterpret_cast<int32_t *>(GetValuePtr(column, row)));
+    }
+  }
+}
+
+/**
+ * helper functions
+ */
+
+// the tuple and its row state take up size + 1 bytes of the page
+bool PaxPage::Layout(const Tuple &tuple) {
+  int32_t states_offset = GetRowStatesOffset();
+  int capacity = (PAGE_SIZE - states_offset) /
+                 (GetFixedSize() + GetVarlenSize(tuple) + 1);
+  if (capacity == 0)
+    return false;
+  SetCapacity(capacity);
+  memset(GetData() + states_offset, PAX_ROW_EMPTY, capacity);
+  int32_t offset = states_offset + capacity;
+  for (int i = 0; i < GetColumnCount(); i++) {
+    SetMinipageOffset(i, offset);
+    offset += capacity * GetColumnWidth(i);
+  }
+  SetFreeSpacePointer(PAGE_SIZE);
+  SetFragmentedSize(0);
+  return true;
+}
+
+void PaxPage::InsertTupleAt(int row, const Tuple &tuple, RID &rid,
+                            Transaction *txn, LockManager *lock_manager) {
+  rid.Set(GetPageId(), row);
+  if (ENABLE_LOGGING && row < GetTupleCount()) {
+    assert(txn->GetSharedLockSet()->find(rid) ==
+               txn->GetSharedLockSet()->end() &&
+           txn->GetExclusiveLockSet()->find(rid) ==
+               txn->GetExclusiveLockSet()->end());
+  }
+
+  int32_t offset = 0;
+  for (int i = 0; i < GetColumnCount(); i++) {
+    memcpy(GetValuePtr(i, row), tuple.GetData() + offset, GetColumnWidth(i));
+    offset += GetColumnWidth(i);
+  }
+  WriteVarlenValues(row, tuple);
+  SetRowState(row, PAX_ROW_LIVE);
+  if (row >= GetTupleCount()) {
+    SetTupleCount(row + 1);
+  }
+  // write the log after set rid
+  if (ENABLE_LOGGING) {
+    // acquire the exclusive lock
+    assert(lock_manager->LockExclusive(txn, rid.Get()));
+    // TODO: add your logging logic here
+  }
+}
+
+// the fixed-size part of the tuple is in the minipages already
+void PaxPage::WriteVarlenValues(int row, const Tuple &tuple) {
+  int32_t offset = 0;
+  for (int i = 0; i < GetColumnCount(); i++) {
+    if (!IsColumnInlined(i)) {
+      const char *value = tuple.GetData() + *reinterpret_cast<int32_t *>(
+                                                tuple.GetData() + offset);
+      int32_t size = ColumnVector::GetVarlenSize(value);
+      SetFreeSpacePointer(GetFreeSpacePointer() - size);
+      memcpy(GetData() + GetFreeSpacePointer(), value, size);
+      int32_t value_offset = GetFreeSpacePointer();
+      memcpy(GetValuePtr(i, row), &value_offset, 4);
+    }
+    offset += GetColumnWidth(i);
+  }
+}
+
+// the last column's value is the lowest, a row inserted last gives its room
+// back to the free space pointer
+void PaxPage::FreeVarlenValues(int row) {
+  for (int i = GetColumnCount() - 1; i >= 0; i--) {
+    if (IsColumnInlined(i))
+      continue;
+    int32_t value_offset = *reinterpret_cast<int32_t *>(GetValuePtr(i, row));
+    if (value_offset == 0)
+      continue;
+    int32_t size = ColumnVector::GetVarlenSize(GetData() + value_offset);
+    if (value_offset == GetFreeSpacePointer())
+      SetFreeSpacePointer(value_offset + size);
+    else
+      SetFragmentedSize(GetFragmentedSize() + size);
+    value_offset = 0;
+    memcpy(GetValuePtr(i, row), &value_offset, 4);
+  }
+}
+
+// fixed-size part first, then the varlen values in column order, as the
+// Tuple constructor puts them
+void PaxPage::CopyTuple(int row, Tuple &tuple) {
+  int32_t fixed_size = GetFixedSize();
+  if (tuple.allocated_)
+    delete[] tuple.data_;
+  tuple.size_ = fixed_size + GetVarlenSize(row);
+  tuple.data_ = new char[tuple.size_];
+  tuple.allocated_ = true;
+  int32_t offset = 0;
+  int32_t varlen_offset = fixed_size;
+  for (int i = 0; i < GetColumnCount(); i++) {
+    if (IsColumnInlined(i)) {
+      memcpy(tuple.data_ + offset, GetValuePtr(i, row), GetColumnWidth(i));
+    } else {
+      const char *value =
+          GetData() + *reinterpret_cast<int32_t *>(GetValuePtr(i, row));
+      int32_t size = ColumnVector::GetVarlenSize(value);
+      memcpy(tuple.data_ + offset, &varlen_offset, 4);
+      memcpy(tuple.data_ + varlen_offset, value, size);
+      varlen_offset += size;
+    }
+    offset += GetColumnWidth(i);
+  }
+}
+
+int32_t PaxPage::GetVarlenSize(int row) {
+  int32_t size = 0;
+  for (int i = 0; i < GetColumnCount(); i++) {
+    if (IsColumnInlined(i))
+      continue;
+    int32_t value_offset = *reinterpret_cast<int32_t *>(GetValuePtr(i, row));
+    if (value_offset != 0)
+      size += ColumnVector::GetVarlenSize(GetData() + value_offset);
+  }
+  return size;
+}
+
+int32_t PaxPage::GetVarlenSize(const Tuple &tuple) {
+  int32_t size = 0;
+  int32_t offset = 0;
+  for (int i = 0; i < GetColumnCount(); i++) {
+    if (!IsColumnInlined(i))
+      size += ColumnVector::GetVarlenSize(
+          tuple.GetData() +
+          *reinterpret_cast<int32_t *>(tuple.GetData() + offset));
+    offset += GetColumnWidth(i);
+  }
+  return size;
+}
+
+int32_t PaxPage::GetFixedSize() {
+  int32_t size = 0;
+  for (int i = 0; i < GetColumnCount(); i++)
+    size += GetColumnWidth(i);
+  return size;
+}
+
+// the empty rows in use first, then a new one
+int PaxPage::GetEmptyRow() {
+  int tuple_count = GetTupleCount();
+  const char *states = GetData() + GetRowStatesOffset();
+  auto empty = static_cast<const char *>(
+      memchr(states, PAX_ROW_EMPTY, tuple_count));
+  if (empty != nullptr)
+    return empty - states;
+  return tuple_count < GetCapacity() ? tuple_count : -1;
+}
+
+bool PaxPage::LockRow(const RID &rid, Transaction *txn,
+                      LockManager *lock_manager) {
+  // acquire exclusive lock
+  // if has shared lock
+  if (txn->GetSharedLockSet()->find(rid) != txn->GetSharedLockSet()->end())
+    return lock_manager->LockUpgrade(txn, rid);
+  return txn->GetExclusiveLockSet()->find(rid) !=
+             txn->GetExclusiveLockSet()->end() ||
+         lock_manager->LockExclusive(txn, rid); // no shared lock
+}
+
+bool PaxPage::LockShared(const RID &rid, Transaction *txn,
+                         LockManager *lock_manager) {
+  return txn->GetExclusiveLockSet()->find(rid) !=
+             txn->GetExclusiveLockSet()->end() ||
+         txn->GetSharedLockSet()->find(rid) !=
+             txn->GetSharedLockSet()->end() ||
+         lock_manager->LockShared(txn, rid);
+}
+
+// columns
+int PaxPage::GetColumnCount() {
+  return *reinterpret_cast<int32_t *>(GetData() + TABLE_PAGE_HEADER_SIZE);
+}
+
+void PaxPage::SetColumnCount(int column_count) {
+  int32_t count = column_count;
+  memcpy(GetData() + TABLE_PAGE_HEADER_SIZE, &count, 4);
+}
+
+int PaxPage::GetCapacity() {
+  return *reinterpret_cast<int32_t *>(GetData() + TABLE_PAGE_HEADER_SIZE + 4);
+}
+
+void PaxPage::SetCapacity(int capacity) {
+  int32_t rows = capacity;
+  memcpy(GetData() + TABLE_PAGE_HEADER_SIZE + 4, &rows, 4);
+}
+
+int32_t PaxPage::GetMinipageOffset(int column) {
+  return *reinterpret_cast<int32_t *>(GetData() + PAX_PAGE_HEADER_SIZE +
+                                      PAX_PAGE_COLUMN_SIZE * column);
+}
+
+void PaxPage::SetMinipageOffset(int column, int32_t offset) {
+  memcpy(GetData() + PAX_PAGE_HEADER_SIZE + PAX_PAGE_COLUMN_SIZE * column,
+         &offset, 4);
+}
+
+int PaxPage::GetColumnWidth(int column) {
+  return *reinterpret_cast<int16_t *>(GetData() + PAX_PAGE_HEADER_SIZE +
+                                      PAX_PAGE_COLUMN_SIZE * column + 4);
+}
+
+bool PaxPage::IsColumnInlined(int column) {
+  return *reinterpret_cast<int16_t *>(GetData() + PAX_PAGE_HEADER_SIZE +
+                                      PAX_PAGE_COLUMN_SIZE * column + 6) != 0;
+}
+
+char *PaxPage::GetValuePtr(int column, int row) {
+  return GetData() + GetMinipageOffset(column) + row * GetColumnWidth(column);
+}
+
+// row states
+int32_t PaxPage::GetRowStatesOffset() {
+  return PAX_PAGE_HEADER_SIZE + PAX_PAGE_COLUMN_SIZE * GetColumnCount();
+}
+
+uint8_t PaxPage::GetRowState(int row) {
+  return *reinterpret_cast<uint8_t *>(GetData() + GetRowStatesOffset() + row);
+}
+
+void PaxPage::SetRowState(int row, uint8_t state) {
+  *reinterpret_cast<uint8_t *>(GetData() + GetRowStatesOffset() + row) = state;
+}
+
+// for free space calculation
+int32_t PaxPage::GetVarlenAreaStart() {
+  int column_count = GetColumnCount();
+  if (column_count == 0)
+    return GetRowStatesOffset() + GetCapacity();
+  return GetMinipageOffset(column_count - 1) +
+         GetCapacity() * GetColumnWidth(column_count - 1);
+}
+
+int32_t PaxPage::GetContiguousFreeSpaceSize() {
+  return GetFreeSpacePointer() - GetVarlenAreaStart();
+}
+
+} // namespace scudb
@@ -2,8 +2,14 @@
  * header_page.cpp
  */
 
+#include <algorithm>
 #include <cassert>
+#include <cstdlib>
+#include <functional>
+#include <utility>
+#include <vector>
 
+#include "page/pax_page.h"
 #include "page/table_page.h"
 
 namespace scudb {
@@ -21,6 +27,10 @@ void TablePage::Init(page_id_t page_id, size_t page_size,
   SetNextPageId(INVALID_PAGE_ID);
   SetFreeSpacePointer(page_size);
   SetTupleCount(0);
+  SetFsmPageId(INVALID_PAGE_ID);
+  SetFreeSlotHead(INVALID_SLOT_NUM);
+  SetFragmentedSize(0);
+  SetLayout(PageLayout::ROW);
 }
 
 page_id_t TablePage::GetPageId() {
@@ -43,54 +53,67 @@ void TablePage::SetNextPageId(page_id_t next_page_id) {
   memcpy(GetData() + 12, &next_page_id, 4);
 }
 
+page_id_t TablePage::GetFsmPageId() {
+  return *reinterpret_cast<page_id_t *>(GetData() + 24);
+}
+
+void TablePage::SetFsmPageId(page_id_t fsm_page_id) {
+  memcpy(GetData() + 24, &fsm_page_id, 4);
+}
+
+PaxPage *TablePage::AsPaxPage() { return static_cast<PaxPage *>(this); }
+
+PageLayout TablePage::GetLayout() {
+  return *reinterpret_cast<PageLayout *>(GetData() + 36);
+}
+
+void TablePage::SetLayout(PageLayout layout) {
+  memcpy(GetData() + 36, &layout, 4);
+}
+
 /**
  * Tuple related
  */
 bool TablePage::InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn,
                             LockManager *lock_manager,
                             LogManager *log_manager) {
-  assert(tuple.size_ > 0);
-  if (GetFreeSpaceSize() < tuple.size_) {
-    return false; // not enough space
-  }
+  return InsertTuples(&tuple, 1, &rid, txn, lock_manager, log_manager) == 1;
+}
 
-  // try to reuse a free slot first
-  int i;
-  for (i = 0; i < GetTupleCount(); ++i) {
-    rid.Set(GetPageId(), i);
-    if (GetTupleSize(i) == 0) { // empty slot
-      if (ENABLE_LOGGING) {
-        assert(txn->GetSharedLockSet()->find(rid) ==
-                   txn->GetSharedLockSet()->end() &&
-               txn->GetExclusiveLockSet()->find(rid) ==
-                   txn->GetExclusiveLockSet()->end());
-      }
-      break;
+/*
+ * An empty slot is reused first, from the head of the chain, otherwise a new
+ * one is added. The page is compacted once the tuple only fits in the
+ * fragments left by deletes.
+ */
+int TablePage::InsertTuples(const Tuple *tuples, int count, RID *rids,
+                            Transaction *txn, LockManager *lock_manager,
+                            LogManager *log_manager) {
+  if (GetLayout() == PageLayout::PAX)
+    return AsPaxPage()->InsertTuples(tuples, count, rids, txn, lock_manager,
+                                     log_manager);
+  int inserted;
+  for (inserted = 0; inserted < count; ++inserted) {
+    const Tuple &tuple = tuples[inserted];
+    assert(tuple.size_ > 0);
+    int slot_num = GetFreeSlotHead();
+    int32_t size = tuple.size_;
+    if (slot_num == INVALID_SLOT_NUM) { // no free slot left
+      slot_num = GetTupleCount();
+      size += TABLE_PAGE_SLOT_SIZE;
     }
+    if (GetFreeSpaceSize() < size) {
+      break; // not enough space
+    }
+    if (GetContiguousFreeSpaceSize() < size) {
+      Compact();
+      // the empty slots at the end are gone
+      slot_num = GetFreeSlotHead() == INVALID_SLOT_NUM ? GetTupleCount()
+                                                       : GetFreeSlotHead();
+    }
+    InsertTupleAt(slot_num, tuple, rids[inserted], txn, lock_manager,
+                  log_manager);
   }
-
-  // no free slot left
-  if (i == GetTupleCount() && GetFreeSpaceSize() < tuple.size_ + 8) {
-    return false; // not enough space
-  }
-
-  SetFreeSpacePointer(GetFreeSpacePointer() -
-                      tuple.size_); // update free space pointer first
-  memcpy(GetData() + GetFreeSpacePointer(), tuple.data_, tuple.size_);
-  SetTupleOffset(i, GetFreeSpacePointer());
-  SetTupleSize(i, tuple.size_);
-  if (i == GetTupleCount()) {
-    rid.Set(GetPageId(), i);
-    SetTupleCount(GetTupleCount() + 1);
-  }
-  // write the log after set rid
-  if (ENABLE_LOGGING) {
-    // acquire the exclusive lock
-    assert(lock_manager->LockExclusive(txn, rid.Get()));
-    // TODO: add your logging logic here
-  }
-  // LOG_DEBUG("Tuple inserted");
-  return true;
+  return inserted;
 }
 
 /*
@@ -101,6 +124,8 @@ bool TablePage::InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn,
  */
 bool TablePage::MarkDelete(const RID &rid, Transaction *txn,
                            LockManager *lock_manager, LogManager *log_manager) {
+  if (GetLayout() == PageLayout::PAX)
+    return AsPaxPage()->MarkDelete(rid, txn, lock_manager, log_manager);
   int slot_num = rid.GetSlotNum();
   if (slot_num >= GetTupleCount()) {
     if (ENABLE_LOGGING) {
@@ -141,6 +166,9 @@ bool TablePage::UpdateTuple(const Tuple &new_tuple, Tuple &old_tuple,
                             const RID &rid, Transaction *txn,
                             LockManager *lock_manager,
                             LogManager *log_manager) {
+  if (GetLayout() == PageLayout::PAX)
+    return AsPaxPage()->UpdateTuple(new_tuple, old_tuple, rid, txn,
+                                    lock_manager, log_manager);
   int slot_num = rid.GetSlotNum();
   if (slot_num >= GetTupleCount()) {
     if (ENABLE_LOGGING) {
@@ -159,6 +187,9 @@ bool TablePage::UpdateTuple(const Tuple &new_tuple, Tuple &old_tuple,
     // should delete/insert because not enough space
     return false;
   }
+  if (GetContiguousFreeSpaceSize() < new_tuple.size_ - tuple_size) {
+    Compact();
+  }
 
   // copy out old value
   int32_t tuple_offset =
@@ -199,7 +230,7 @@ bool TablePage::UpdateTuple(const Tuple &new_tuple, Tuple &old_tuple,
   for (int i = 0; i < GetTupleCount();
        ++i) { // update tuple offsets (including the updated one)
     int32_t tuple_offset_i = GetTupleOffset(i);
-    if (GetTupleSize(i) > 0 && tuple_offset_i < tuple_offset + tuple_size) {
+    if (GetTupleSize(i) != 0 && tuple_offset_i < tuple_offset + tuple_size) {
       SetTupleOffset(i, tuple_offset_i + tuple_size - new_tuple.size_);
     }
   }
@@ -212,7 +243,9 @@ bool TablePage::UpdateTuple(const Tuple &new_tuple, Tuple &old_tuple,
  * This function is called when a transaction commits or when you undo insert
  */
 void TablePage::ApplyDelete(const RID &rid, Transaction *txn,
-                            LogManager *log_manager) {
+                            LogManager *log_manager, Tuple *deleted_tuple) {
+  if (GetLayout() == PageLayout::PAX)
+    return AsPaxPage()->ApplyDelete(rid, txn, log_manager, deleted_tuple);
   int slot_num = rid.GetSlotNum();
   assert(slot_num < GetTupleCount());
   // the tuple offset of the deleted tuple
@@ -229,6 +262,8 @@ void TablePage::ApplyDelete(const RID &rid, Transaction *txn,
   memcpy(delete_tuple.data_, GetData() + tuple_offset, delete_tuple.size_);
   delete_tuple.rid_ = rid;
   delete_tuple.allocated_ = true;
+  if (deleted_tuple != nullptr)
+    *deleted_tuple = delete_tuple;
 
   if (ENABLE_LOGGING) {
     // must already grab the exclusive lock
@@ -237,20 +272,17 @@ void TablePage::ApplyDelete(const RID &rid, Transaction *txn,
     // TODO: add your logging logic here
   }
 
-  int32_t free_space_pointer =
-      GetFreeSpacePointer(); // old pointer to the free space
-  assert(tuple_offset >= free_space_pointer);
-  memmove(GetData() + free_space_pointer + tuple_size,
-          GetData() + free_space_pointer, tuple_offset - free_space_pointer);
-  SetFreeSpacePointer(free_space_pointer + tuple_size);
-  SetTupleSize(slot_num, 0);
-  SetTupleOffset(slot_num, 0); // invalid offset
-  for (int i = 0; i < GetTupleCount(); ++i) {
-    int32_t tuple_offset_i = GetTupleOffset(i);
-    if (GetTupleSize(i) != 0 && tuple_offset_i < tuple_offset) {
-      SetTupleOffset(i, tuple_offset_i + tuple_size);
-    }
+  // the other tuples stay where they are, Compact reclaims the room later
+  assert(tuple_offset >= GetFreeSpacePointer());
+  if (tuple_offset == GetFreeSpacePointer()) {
+    SetFreeSpacePointer(tuple_offset + tuple_size);
+  } else {
+    SetFragmentedSize(GetFragmentedSize() + tuple_size);
   }
+  SetTupleSize(slot_num, 0);
+  // push the slot on the empty slot chain
+  SetTupleOffset(slot_num, GetFreeSlotHead());
+  SetFreeSlotHead(slot_num);
 }
 
 /*
@@ -261,6 +293,8 @@ void TablePage::ApplyDelete(const RID &rid, Transaction *txn,
  */
 void TablePage::RollbackDelete(const RID &rid, Transaction *txn,
                                LogManager *log_manager) {
+  if (GetLayout() == PageLayout::PAX)
+    return AsPaxPage()->RollbackDelete(rid, txn, log_manager);
   if (ENABLE_LOGGING) {
     // must have already grab the exclusive lock
     assert(txn->GetExclusiveLockSet()->find(rid) !=
@@ -280,6 +314,8 @@ void TablePage::RollbackDelete(const RID &rid, Transaction *txn,
 
 bool TablePage::GetTuple(const RID &rid, Tuple &tuple, Transaction *txn,
                          LockManager *lock_manager) {
+  if (GetLayout() == PageLayout::PAX)
+    return AsPaxPage()->GetTuple(rid, tuple, txn, lock_manager);
   int slot_num = rid.GetSlotNum();
   if (slot_num >= GetTupleCount()) {
     if (ENABLE_LOGGING)
@@ -314,10 +350,56 @@ bool TablePage::GetTuple(const RID &rid, Tuple &tuple, Transaction *txn,
   return true;
 }
 
+/*
+ * Tuples are moved from the highest offset down, each one only towards the
+ * end of the page, so none is overwritten before it is moved. Deleted tuples
+ * that are not applied yet (negative size) are moved like the others. The
+ * empty slot chain is rebuilt in slot order, lowest slot first.
+ */
+void TablePage::Compact() {
+  if (GetLayout() == PageLayout::PAX)
+    return AsPaxPage()->Compact();
+  std::vector<std::pair<int32_t, int>> tuples; // offset, slot
+  for (int i = 0; i < GetTupleCount(); ++i) {
+    if (GetTupleSize(i) != 0) {
+      tuples.emplace_back(GetTupleOffset(i), i);
+    }
+  }
+  std::sort(tuples.begin(), tuples.end(),
+            std::greater<std::pair<int32_t, int>>());
+  int32_t free_space_pointer = PAGE_SIZE;
+  for (auto &tuple : tuples) {
+    int32_t tuple_size = std::abs(GetTupleSize(tuple.second));
+    free_space_pointer -= tuple_size;
+    if (free_space_pointer != tuple.first) {
+      memmove(GetData() + free_space_pointer, GetData() + tuple.first,
+              tuple_size);
+      SetTupleOffset(tuple.second, free_space_pointer);
+    }
+  }
+  SetFreeSpacePointer(free_space_pointer);
+  SetFragmentedSize(0);
+
+  int tuple_count = GetTupleCount();
+  while (tuple_count > 0 && GetTupleSize(tuple_count - 1) == 0) {
+    --tuple_count;
+  }
+  SetTupleCount(tuple_count);
+  SetFreeSlotHead(INVALID_SLOT_NUM);
+  for (int i = tuple_count - 1; i >= 0; --i) {
+    if (GetTupleSize(i) == 0) {
+      SetTupleOffset(i, GetFreeSlotHead());
+      SetFreeSlotHead(i);
+    }
+  }
+}
+
 /**
  * Tuple iterator
  */
 bool TablePage::GetFirstTupleRid(RID &first_rid) {
+  if (GetLayout() == PageLayout::PAX)
+    return AsPaxPage()->GetFirstTupleRid(first_rid);
   for (int i = 0; i < GetTupleCount(); ++i) {
     if (GetTupleSize(i) > 0) { // valid tuple
       first_rid.Set(GetPageId(), i);
@@ -330,6 +412,8 @@ bool TablePage::GetFirstTupleRid(RID &first_rid) {
 }
 
 bool TablePage::GetNextTupleRid(const RID &cur_rid, RID &next_rid) {
+  if (GetLayout() == PageLayout::PAX)
+    return AsPaxPage()->GetNextTupleRid(cur_rid, next_rid);
   assert(cur_rid.GetPageId() == GetPageId());
   for (auto i = cur_rid.GetSlotNum() + 1; i < GetTupleCount(); ++i) {
     if (GetTupleSize(i) > 0) { // valid tuple
@@ -344,21 +428,59 @@ bool TablePage::GetNextTupleRid(const RID &cur_rid, RID &next_rid) {
  * helper functions
  */
 
+// slot_num is the head of the empty slot chain or the next new one, and the
+// tuple fits between the slot array and the tuples
+void TablePage::InsertTupleAt(int slot_num, const Tuple &tuple, RID &rid,
+                              Transaction *txn, LockManager *lock_manager,
+                              LogManager *log_manager) {
+  if (slot_num < GetTupleCount()) { // pop it off the empty slot chain
+    assert(slot_num == GetFreeSlotHead() && GetTupleSize(slot_num) == 0);
+    SetFreeSlotHead(GetTupleOffset(slot_num));
+  }
+  rid.Set(GetPageId(), slot_num);
+  if (ENABLE_LOGGING && slot_num < GetTupleCount()) {
+    assert(txn->GetSharedLockSet()->find(rid) ==
+               txn->GetSharedLockSet()->end() &&
+           txn->GetExclusiveLockSet()->find(rid) ==
+               txn->GetExclusiveLockSet()->end());
+  }
+
+  SetFreeSpacePointer(GetFreeSpacePointer() -
+                      tuple.size_); // update free space pointer first
+  memcpy(GetData() + GetFreeSpacePointer(), tuple.data_, tuple.size_);
+  SetTupleOffset(slot_num, GetFreeSpacePointer());
+  SetTupleSize(slot_num, tuple.size_);
+  if (slot_num == GetTupleCount()) {
+    SetTupleCount(GetTupleCount() + 1);
+  }
+  // write the log after set rid
+  if (ENABLE_LOGGING) {
+    // acquire the exclusive lock
+    assert(lock_manager->LockExclusive(txn, rid.Get()));
+    // TODO: add your logging logic here
+  }
+}
+
 // tuple slots
 int32_t TablePage::GetTupleOffset(int slot_num) {
-  return *reinterpret_cast<int32_t *>(GetData() + 24 + 8 * slot_num);
+  return *reinterpret_cast<int32_t *>(
+      GetData() + TABLE_PAGE_HEADER_SIZE + TABLE_PAGE_SLOT_SIZE * slot_num);
 }
 
 int32_t TablePage::GetTupleSize(int slot_num) {
-  return *reinterpret_cast<int32_t *>(GetData() + 28 + 8 * slot_num);
+  return *reinterpret_cast<int32_t *>(
+      GetData() + TABLE_PAGE_HEADER_SIZE + TABLE_PAGE_SLOT_SIZE * slot_num + 4);
 }
 
 void TablePage::SetTupleOffset(int slot_num, int32_t offset) {
-  memcpy(GetData() + 24 + 8 * slot_num, &offset, 4);
+  memcpy(GetData() + TABLE_PAGE_HEADER_SIZE + TABLE_PAGE_SLOT_SIZE * slot_num,
+         &offset, 4);
 }
 
 void TablePage::SetTupleSize(int slot_num, int32_t offset) {
-  memcpy(GetData() + 28 + 8 * slot_num, &offset, 4);
+  memcpy(GetData() + TABLE_PAGE_HEADER_SIZE + TABLE_PAGE_SLOT_SIZE * slot_num +
+             4,
+         &offset, 4);
 }
 
 // free space
@@ -379,8 +501,34 @@ void TablePage::SetTupleCount(int32_t tuple_count) {
   memcpy(GetData() + 20, &tuple_count, 4);
 }
 
+// empty slot chain
+int TablePage::GetFreeSlotHead() {
+  return *reinterpret_cast<int32_t *>(GetData() + 28);
+}
+
+void TablePage::SetFreeSlotHead(int slot_num) {
+  int32_t head = slot_num;
+  memcpy(GetData() + 28, &head, 4);
+}
+
+// fragments left by deletes
+int32_t TablePage::GetFragmentedSize() {
+  return *reinterpret_cast<int32_t *>(GetData() + 32);
+}
+
+void TablePage::SetFragmentedSize(int32_t fragmented_size) {
+  memcpy(GetData() + 32, &fragmented_size, 4);
+}
+
 // for free space calculation
+int32_t TablePage::GetContiguousFreeSpaceSize() {
+  return GetFreeSpacePointer() - TABLE_PAGE_HEADER_SIZE -
+         GetTupleCount() * TABLE_PAGE_SLOT_SIZE;
+}
+
 int32_t TablePage::GetFreeSpaceSize() {
-  return GetFreeSpacePointer() - 24 - GetTupleCount() * 8;
+  if (GetLayout() == PageLayout::PAX)
+    return AsPaxPage()->GetFreeSpaceSize();
+  return GetContiguousFreeSpaceSize() + GetFragmentedSize();
 }
 } // namespace scudb
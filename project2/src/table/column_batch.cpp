@@ -0,0 +1,55 @@
+/**
+ * column_batch.cpp
+ */
+
+#include <cassert>
+#include <cstring>
+
+#include "table/column_batch.h"
+#include "table/tuple.h"
+
+namespace scudb {
+
+Value ColumnVector::GetValue(int row) const {
+  return Value::DeserializeFrom(GetValueData(row), type_);
+}
+
+const char *ColumnVector::GetValueData(int row) const {
+  assert(row < size_);
+  if (is_inlined_)
+    return data_.data() + row * width_;
+  return data_.data() + offsets_[row];
+}
+
+void ColumnVector::Append(const char *value) {
+  if (is_inlined_) {
+    data_.insert(data_.end(), value, value + width_);
+  } else {
+    offsets_.push_back(data_.size());
+    data_.insert(data_.end(), value, value + GetVarlenSize(value));
+  }
+  size_++;
+}
+
+void ColumnVector::Append(const char *values, int count) {
+  assert(is_inlined_);
+  data_.insert(data_.end(), values, values + count * width_);
+  size_ += count;
+}
+
+void ColumnVector::Clear() {
+  data_.clear();
+  offsets_.clear();
+  size_ = 0;
+}
+
+// a null value has no bytes, one stored out of line its ToastPointer
+uint32_t ColumnVector::GetVarlenSize(const char *value) {
+  uint32_t length;
+  memcpy(&length, value, sizeof(uint32_t));
+  if (length == PELOTON_VALUE_NULL)
+    return sizeof(uint32_t);
+  return sizeof(uint32_t) + (length & ~TOAST_POINTER_FLAG);
+}
+
+} // namespace scudb
@@ -0,0 +1,110 @@
+/**
+ * column_iterator.cpp
+ */
+
+#include <cassert>
+#include <cstring>
+
+#include "table/table_heap.h"
+
+namespace scudb {
+
+static page_id_t NextTablePageId(Page *page) {
+  return static_cast<TablePage *>(page)->GetNextPageId();
+}
+
+ColumnIterator::ColumnIterator(TableHeap *table_heap,
+                               std::vector<int> column_ids, Transaction *txn,
+                               std::shared_ptr<BufferRing> ring)
+    : table_heap_(table_heap), column_ids_(std::move(column_ids)), txn_(txn),
+      ring_(std::move(ring)),
+      read_ahead_(table_heap->buffer_pool_manager_,
+                  table_heap->GetPageWindow()),
+      next_page_id_(table_heap->GetFirstPageId()) {
+  assert(table_heap_->schema_ != nullptr);
+}
+
+bool ColumnIterator::NextBatch(ColumnBatch &batch) {
+  Schema *schema = table_heap_->schema_;
+  batch.rids.clear();
+  batch.columns.clear();
+  for (int column : column_ids_)
+    batch.columns.emplace_back(schema->GetType(column),
+                               schema->IsInlined(column),
+                               schema->GetLength(column));
+
+  BufferPoolManager *buffer_pool_manager = table_heap_->buffer_pool_manager_;
+  while (batch.rids.empty() && next_page_id_ != INVALID_PAGE_ID) {
+    auto page = static_cast<TablePage *>(
+        buffer_pool_manager->FetchPage(next_page_id_, ring_.get()));
+    assert(page != nullptr); // all pages are pinned
+    page->RLatch();
+    if (page->GetLayout() == PageLayout::PAX)
+      page->AsPaxPage()->GetColumns(column_ids_, batch, txn_,
+                                    table_heap_->lock_manager_);
+    else
+      GetColumns(page, batch);
+    page_id_t page_id = next_page_id_;
+    next_page_id_ = page->GetNextPageId();
+    page->RUnlatch();
+    buffer_pool_manager->UnpinPage(page_id, false);
+    read_ahead_.Advance(next_page_id_, NextTablePageId, ring_);
+  }
+
+  for (auto &vector : batch.columns) {
+    if (!vector.IsInlined())
+      ReadToastedValues(vector);
+  }
+  if (batch.rids.empty()) {
+    ring_.reset(); // scan is over, give the ring frames back
+    return false;
+  }
+  return true;
+}
+
+void ColumnIterator::GetColumns(TablePage *page, ColumnBatch &batch) {
+  Schema *schema = table_heap_->schema_;
+  RID rid;
+  bool found = page->GetFirstTupleRid(rid);
+  while (found) {
+    Tuple tuple(rid);
+    if (page->GetTuple(rid, tuple, txn_, table_heap_->lock_manager_)) {
+      batch.rids.push_back(rid);
+      for (size_t i = 0; i < column_ids_.size(); i++) {
+        int column = column_ids_[i];
+        const char *value = tuple.GetData() + schema->GetOffset(column);
+        if (!schema->IsInlined(column))
+          value = tuple.GetData() + *reinterpret_cast<const int32_t *>(value);
+        batch.columns[i].Append(value);
+      }
+    }
+    found = page->GetNextTupleRid(rid, rid);
+  }
+}
+
+void ColumnIterator::ReadToastedValues(ColumnVector &vector) {
+  auto is_toasted = [&vector](int row) {
+    uint32_t length;
+    memcpy(&length, vector.GetValueData(row), sizeof(uint32_t));
+    return length != PELOTON_VALUE_NULL && (length & TOAST_POINTER_FLAG) != 0;
+  };
+  int row = 0;
+  while (row < vector.GetSize() && !is_toasted(row))
+    row++;
+  if (row == vector.GetSize())
+    return;
+
+  ColumnVector values(vector.GetType(), false, vector.GetWidth());
+  std::vector<char> buffer;
+  for (row = 0; row < vector.GetSize(); row++) {
+    if (is_toasted(row)) {
+      table_heap_->overflow_store_.ReadValue(vector.GetValueData(row), buffer);
+      values.Append(buffer.data());
+    } else {
+      values.Append(vector.GetValueData(row));
+    }
+  }
+  vector = std::move(values);
+}
+
+} // namespace scudb
@@ -0,0 +1,191 @@
+/**
+ * free_space_map.cpp
+ */
+
+#include <algorithm>
+#include <cassert>
+
+#include "table/free_space_map.h"
+
+namespace scudb {
+
+static int CategorySize() { return std::max(1, PAGE_SIZE / FSM_CATEGORIES); }
+
+uint8_t FreeSpaceMap::ToCategory(int free_space) {
+  return static_cast<uint8_t>(
+      std::min(FSM_CATEGORIES - 1, std::max(0, free_space) / CategorySize()));
+}
+
+// rounded up, any page of that category has room
+uint8_t FreeSpaceMap::ToRequiredCategory(int size) {
+  int category = (size + CategorySize() - 1) / CategorySize();
+  return static_cast<uint8_t>(std::min(FSM_CATEGORIES - 1, category));
+}
+
+bool FreeSpaceMap::Create() {
+  std::lock_guard<std::mutex> guard(latch_);
+  Page *page = buffer_pool_manager_->NewPage(first_page_id_);
+  if (page == nullptr)
+    return false;
+  reinterpret_cast<FreeSpaceMapPage *>(page->GetData())->Init(first_page_id_);
+  buffer_pool_manager_->UnpinPage(first_page_id_, true);
+  map_pages_.push_back(first_page_id_);
+  max_categories_.push_back(0);
+  return true;
+}
+
+void FreeSpaceMap::Open(page_id_t first_page_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  first_page_id_ = first_page_id;
+  page_id_t page_id = first_page_id;
+  while (page_id != INVALID_PAGE_ID) {
+    Page *page = buffer_pool_manager_->FetchPage(page_id);
+    assert(page != nullptr);
+    auto *map_page = reinterpret_cast<FreeSpaceMapPage *>(page->GetData());
+    // not a page of the map, the heap was not written out completely
+    if (map_page->GetPageId() != page_id ||
+        std::find(map_pages_.begin(), map_pages_.end(), page_id) !=
+            map_pages_.end()) {
+      buffer_pool_manager_->UnpinPage(page_id, false);
+      break;
+    }
+    if (map_pages_.empty())
+      free_page_id_ = map_page->GetFreePageId();
+    uint8_t max_category = 0;
+    for (int i = 0; i < map_page->GetSize(); i++) {
+      positions_[map_page->HeapPageIdAt(i)] = heap_pages_.size();
+      heap_pages_.push_back(map_page->HeapPageIdAt(i));
+      categories_.push_back(map_page->CategoryAt(i));
+      max_category = std::max(max_category, map_page->CategoryAt(i));
+    }
+    map_pages_.push_back(page_id);
+    max_categories_.push_back(max_category);
+    page_id_t next_page_id = map_page->GetNextPageId();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    page_id = next_page_id;
+  }
+}
+
+/*
+ * First fit, after the page found last time: map pages whose largest
+ * category is too small are skipped as a whole.
+ */
+page_id_t FreeSpaceMap::FindPage(int size) {
+  uint8_t required = ToRequiredCategory(size);
+  std::lock_guard<std::mutex> guard(latch_);
+  if (hint_ < categories_.size() && categories_[hint_] >= required)
+    return heap_pages_[hint_];
+  size_t per_page = FreeSpaceMapPage::GetMaxSize();
+  for (size_t i = 0; i < max_categories_.size(); i++) {
+    if (max_categories_[i] < required)
+      continue;
+    size_t end = std::min(categories_.size(), (i + 1) * per_page);
+    for (size_t j = i * per_page; j < end; j++) {
+      if (categories_[j] >= required) {
+        hint_ = j;
+        return heap_pages_[j];
+      }
+    }
+  }
+  return INVALID_PAGE_ID;
+}
+
+bool FreeSpaceMap::Update(page_id_t page_id, int free_space) {
+  uint8_t category = ToCategory(free_space);
+  std::lock_guard<std::mutex> guard(latch_);
+  auto position = positions_.find(page_id);
+  if (position == positions_.end())
+    return Append(page_id, category);
+  if (categories_[position->second] != category)
+    SetCategory(position->second, category);
+  return true;
+}
+
+page_id_t FreeSpaceMap::GetLastPageId() {
+  std::lock_guard<std::mutex> guard(latch_);
+  return heap_pages_.empty() ? INVALID_PAGE_ID : heap_pages_.back();
+}
+
+size_t FreeSpaceMap::GetPageCount() {
+  std::lock_guard<std::mutex> guard(latch_);
+  return heap_pages_.size();
+}
+
+bool FreeSpaceMap::GetPageIds(page_id_t page_id, size_t count,
+                              std::vector<page_id_t> &page_ids) {
+  std::lock_guard<std::mutex> guard(latch_);
+  auto position = positions_.find(page_id);
+  if (position == positions_.end())
+    return false;
+  size_t end = std::min(heap_pages_.size(), position->second + count);
+  page_ids.assign(heap_pages_.begin() + position->second,
+                  heap_pages_.begin() + end);
+  return true;
+}
+
+page_id_t FreeSpaceMap::GetFreePageId() {
+  std::lock_guard<std::mutex> guard(latch_);
+  return free_page_id_;
+}
+
+void FreeSpaceMap::SetFreePageId(page_id_t free_page_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  free_page_id_ = free_page_id;
+  Page *page = buffer_pool_manager_->FetchPage(map_pages_.front());
+  assert(page != nullptr);
+  reinterpret_cast<FreeSpaceMapPage *>(page->GetData())
+      ->SetFreePageId(free_page_id);
+  buffer_pool_manager_->UnpinPage(map_pages_.front(), true);
+}
+
+void FreeSpaceMap::SetCategory(size_t index, uint8_t category) {
+  size_t per_page = FreeSpaceMapPage::GetMaxSize();
+  size_t map_index = index / per_page;
+  uint8_t old_category = categories_[index];
+  categories_[index] = category;
+  uint8_t &max_category = max_categories_[map_index];
+  if (category > max_category) {
+    max_category = category;
+  } else if (old_category == max_category) {
+    size_t end = std::min(categories_.size(), (map_index + 1) * per_page);
+    max_category = *std::max_element(categories_.begin() + map_index * per_page,
+                                     categories_.begin() + end);
+  }
+
+  Page *page = buffer_pool_manager_->FetchPage(map_pages_[map_index]);
+  assert(page != nullptr);
+  reinterpret_cast<FreeSpaceMapPage *>(page->GetData())
+      ->SetCategory(static_cast<int>(index % per_page), category);
+  buffer_pool_manager_->UnpinPage(map_pages_[map_index], true);
+}
+
+bool FreeSpaceMap::Append(page_id_t page_id, uint8_t category) {
+  Page *page = buffer_pool_manager_->FetchPage(map_pages_.back());
+  if (page == nullptr)
+    return false;
+  auto *map_page = reinterpret_cast<FreeSpaceMapPage *>(page->GetData());
+  if (!map_page->Append(page_id, category)) {
+    page_id_t new_page_id;
+    Page *new_page = buffer_pool_manager_->NewPage(new_page_id);
+    if (new_page == nullptr) {
+      buffer_pool_manager_->UnpinPage(map_page->GetPageId(), false);
+      return false;
+    }
+    map_page->SetNextPageId(new_page_id);
+    buffer_pool_manager_->UnpinPage(map_page->GetPageId(), true);
+    map_page = reinterpret_cast<FreeSpaceMapPage *>(new_page->GetData());
+    map_page->Init(new_page_id);
+    map_page->Append(page_id, category);
+    map_pages_.push_back(new_page_id);
+    max_categories_.push_back(0);
+  }
+  buffer_pool_manager_->UnpinPage(map_page->GetPageId(), true);
+
+  positions_[page_id] = heap_pages_.size();
+  heap_pages_.push_back(page_id);
+  categories_.push_back(category);
+  max_categories_.back() = std::max(max_categories_.back(), category);
+  return true;
+}
+
+} // namespace scudb
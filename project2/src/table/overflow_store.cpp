@@ -0,0 +1,239 @@
+/**
+ * overflow_store.cpp
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+#include "common/compression.h"
+#include "table/overflow_store.h"
+
+namespace scudb {
+
+// bytes of the payload of a varchar value in a tuple, after its length
+static uint32_t PayloadLength(uint32_t length) {
+  if (length == PELOTON_VALUE_NULL)
+    return 0;
+  return length & ~TOAST_POINTER_FLAG;
+}
+
+bool OverflowStore::NeedsToast(const Tuple &tuple, Schema *schema) {
+  return tuple.size_ > TOAST_TUPLE_THRESHOLD &&
+         !schema->GetUnlinedColumns().empty();
+}
+
+/*
+ * The largest values are moved first, as long as the tuple is larger than
+ * the threshold and moving one saves room.
+ */
+bool OverflowStore::Toast(const Tuple &tuple, Schema *schema, Tuple &toasted) {
+  const std::vector<int> &columns = schema->GetUnlinedColumns();
+  std::vector<uint32_t> lengths;
+  int32_t size = schema->GetLength();
+  for (int column_id : columns) {
+    lengths.push_back(*reinterpret_cast<const uint32_t *>(
+        tuple.GetDataPtr(schema, column_id)));
+    size += sizeof(uint32_t) + PayloadLength(lengths.back());
+  }
+  std::vector<bool> moved(columns.size(), false);
+  while (size > TOAST_TUPLE_THRESHOLD) {
+    int largest = -1;
+    uint32_t largest_length = sizeof(ToastPointer);
+    for (size_t i = 0; i < columns.size(); i++) {
+      if (!moved[i] && lengths[i] != PELOTON_VALUE_NULL &&
+          (lengths[i] & TOAST_POINTER_FLAG) == 0 &&
+          lengths[i] > largest_length) {
+        largest = i;
+        largest_length = lengths[i];
+      }
+    }
+    if (largest < 0)
+      break;
+    moved[largest] = true;
+    size -= largest_length - sizeof(ToastPointer);
+  }
+
+  if (toasted.allocated_)
+    delete[] toasted.data_;
+  toasted.allocated_ = true;
+  toasted.rid_ = tuple.rid_;
+  toasted.size_ = size;
+  toasted.data_ = new char[size];
+  memcpy(toasted.data_, tuple.data_, schema->GetLength());
+  int32_t offset = schema->GetLength();
+  std::vector<page_id_t> chains;
+  for (size_t i = 0; i < columns.size(); i++) {
+    const char *value = tuple.GetDataPtr(schema, columns[i]);
+    *reinterpret_cast<int32_t *>(toasted.data_ +
+                                 schema->GetOffset(columns[i])) = offset;
+    if (!moved[i]) {
+      uint32_t stored = sizeof(uint32_t) + PayloadLength(lengths[i]);
+      memcpy(toasted.data_ + offset, value, stored);
+      offset += stored;
+      continue;
+    }
+    ToastPointer pointer;
+    if (!WriteValue(value + sizeof(uint32_t), lengths[i], pointer)) {
+      for (page_id_t chain : chains)
+        DeleteChain(chain);
+      return false;
+    }
+    chains.push_back(pointer.first_page_id);
+    uint32_t length = TOAST_POINTER_FLAG | sizeof(ToastPointer);
+    memcpy(toasted.data_ + offset, &length, sizeof(uint32_t));
+    memcpy(toasted.data_ + offset + sizeof(uint32_t), &pointer,
+           sizeof(ToastPointer));
+    offset += sizeof(uint32_t) + sizeof(ToastPointer);
+  }
+  assert(offset == size);
+  return true;
+}
+
+Value OverflowStore::GetValue(const Tuple &tuple, Schema *schema,
+                              int column_id) {
+  if (!tuple.IsToasted(schema, column_id))
+    return tuple.GetValue(schema, column_id);
+  std::vector<char> buffer;
+  ReadValue(tuple.GetDataPtr(schema, column_id), buffer);
+  return Value::DeserializeFrom(buffer.data(), schema->GetType(column_id));
+}
+
+void OverflowStore::ReadValue(const char *data, std::vector<char> &buffer) {
+  ToastPointer pointer;
+  memcpy(&pointer, data + sizeof(uint32_t), sizeof(ToastPointer));
+
+  buffer.resize(sizeof(uint32_t) + pointer.raw_length);
+  memcpy(buffer.data(), &pointer.raw_length, sizeof(uint32_t));
+  bool compressed = pointer.stored_length < pointer.raw_length;
+  std::vector<char> stored;
+  if (compressed)
+    stored.resize(pointer.stored_length);
+  char *chain_data =
+      compressed ? stored.data() : buffer.data() + sizeof(uint32_t);
+  uint32_t read = 0;
+  page_id_t page_id = pointer.first_page_id;
+  while (page_id != INVALID_PAGE_ID) {
+    Page *page = buffer_pool_manager_->FetchPage(page_id);
+    assert(page != nullptr);
+    page->RLatch();
+    auto *overflow_page = reinterpret_cast<OverflowPage *>(page->GetData());
+    assert(read + overflow_page->GetSize() <= pointer.stored_length);
+    memcpy(chain_data + read, overflow_page->GetData(),
+           overflow_page->GetSize());
+    read += overflow_page->GetSize();
+    page_id_t next_page_id = overflow_page->GetNextPageId();
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    page_id = next_page_id;
+  }
+  assert(read == pointer.stored_length);
+  if (compressed) {
+    bool decompressed =
+        LzDecompress(stored.data(), pointer.stored_length,
+                     buffer.data() + sizeof(uint32_t), pointer.raw_length);
+    assert(decompressed);
+    (void)decompressed;
+  }
+}
+
+void OverflowStore::Delete(const Tuple &tuple, Schema *schema) {
+  for (int column_id : schema->GetUnlinedColumns()) {
+    if (!tuple.IsToasted(schema, column_id))
+      continue;
+    ToastPointer pointer;
+    memcpy(&pointer, tuple.GetDataPtr(schema, column_id) + sizeof(uint32_t),
+           sizeof(ToastPointer));
+    DeleteChain(pointer.first_page_id);
+  }
+}
+
+// compressed only when that saves at least an eighth
+bool OverflowStore::WriteValue(const char *data, uint32_t length,
+                               ToastPointer &pointer) {
+  std::vector<char> compressed;
+  const char *stored = data;
+  uint32_t stored_length = length;
+  if (TOAST_COMPRESSION) {
+    compressed.resize(length);
+    int compressed_length =
+        LzCompress(data, length, compressed.data(), length - length / 8);
+    if (compressed_length > 0) {
+      stored = compressed.data();
+      stored_length = compressed_length;
+    }
+  }
+  pointer.raw_length = length;
+  pointer.stored_length = stored_length;
+  pointer.first_page_id = INVALID_PAGE_ID;
+
+  OverflowPage *prev_page = nullptr;
+  uint32_t written = 0;
+  do {
+    page_id_t page_id;
+    Page *page = NewPage(page_id);
+    if (page == nullptr) {
+      if (prev_page != nullptr) {
+        buffer_pool_manager_->UnpinPage(prev_page->GetPageId(), true);
+        DeleteChain(pointer.first_page_id);
+      }
+      return false;
+    }
+    auto *overflow_page = reinterpret_cast<OverflowPage *>(page->GetData());
+    overflow_page->Init(page_id);
+    uint32_t size = std::min<uint32_t>(OverflowPage::GetMaxSize(),
+                                       stored_length - written);
+    memcpy(overflow_page->GetData(), stored + written, size);
+    overflow_page->SetSize(size);
+    written += size;
+    if (prev_page == nullptr) {
+      pointer.first_page_id = page_id;
+    } else {
+      prev_page->SetNextPageId(page_id);
+      buffer_pool_manager_->UnpinPage(prev_page->GetPageId(), true);
+    }
+    prev_page = overflow_page;
+  } while (written < stored_length);
+  buffer_pool_manager_->UnpinPage(prev_page->GetPageId(), true);
+  return true;
+}
+
+// the pages of a free chain keep their next page ids, and link to the rest
+// of the free list from the last one
+Page *OverflowStore::NewPage(page_id_t &page_id) {
+  std::lock_guard<std::mutex> guard(free_latch_);
+  page_id_t free_page_id = free_space_map_->GetFreePageId();
+  if (free_page_id == INVALID_PAGE_ID)
+    return buffer_pool_manager_->NewPage(page_id);
+  Page *page = buffer_pool_manager_->FetchPage(free_page_id);
+  if (page == nullptr)
+    return nullptr;
+  free_space_map_->SetFreePageId(
+      reinterpret_cast<OverflowPage *>(page->GetData())->GetNextPageId());
+  page_id = free_page_id;
+  return page;
+}
+
+void OverflowStore::DeleteChain(page_id_t page_id) {
+  if (page_id == INVALID_PAGE_ID)
+    return;
+  page_id_t last_page_id = page_id;
+  Page *page;
+  while (true) {
+    page = buffer_pool_manager_->FetchPage(last_page_id);
+    assert(page != nullptr);
+    page_id_t next_page_id =
+        reinterpret_cast<OverflowPage *>(page->GetData())->GetNextPageId();
+    if (next_page_id == INVALID_PAGE_ID)
+      break;
+    buffer_pool_manager_->UnpinPage(last_page_id, false);
+    last_page_id = next_page_id;
+  }
+  std::lock_guard<std::mutex> guard(free_latch_);
+  reinterpret_cast<OverflowPage *>(page->GetData())
+      ->SetNextPageId(free_space_map_->GetFreePageId());
+  buffer_pool_manager_->UnpinPage(last_page_id, true);
+  free_space_map_->SetFreePageId(page_id);
+}
+
+} // namespace scudb
@@ -12,77 +12,267 @@ namespace scudb {
 // open table
 TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager,
                      LockManager *lock_manager, LogManager *log_manager,
-                     page_id_t first_page_id)
+                     page_id_t first_page_id, Schema *schema)
     : buffer_pool_manager_(buffer_pool_manager), lock_manager_(lock_manager),
-      log_manager_(log_manager), first_page_id_(first_page_id) {}
+      log_manager_(log_manager), first_page_id_(first_page_id),
+      free_space_map_(buffer_pool_manager), schema_(schema),
+      overflow_store_(buffer_pool_manager, &free_space_map_) {
+  auto first_page =
+      static_cast<TablePage *>(buffer_pool_manager_->FetchPage(first_page_id_));
+  assert(first_page != nullptr);
+  first_page->RLatch();
+  page_id_t fsm_page_id = first_page->GetFsmPageId();
+  layout_ = first_page->GetLayout();
+  first_page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(first_page_id_, false);
+  free_space_map_.Open(fsm_page_id);
+}
 
 // create table
 TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager,
                      LockManager *lock_manager, LogManager *log_manager,
-                     Transaction *txn)
+                     Transaction *txn, Schema *schema, PageLayout layout)
     : buffer_pool_manager_(buffer_pool_manager), lock_manager_(lock_manager),
-      log_manager_(log_manager) {
+      log_manager_(log_manager), free_space_map_(buffer_pool_manager),
+      schema_(schema), overflow_store_(buffer_pool_manager, &free_space_map_),
+      layout_(layout) {
+  assert(layout_ == PageLayout::ROW || schema_ != nullptr);
   auto first_page =
       static_cast<TablePage *>(buffer_pool_manager_->NewPage(first_page_id_));
   assert(first_page != nullptr); // todo: abort table creation?
   first_page->WLatch();
   LOG_DEBUG("new table page created %d", first_page_id_);
 
-  first_page->Init(first_page_id_, PAGE_SIZE, INVALID_LSN, log_manager_, txn);
+  InitPage(first_page, first_page_id_, INVALID_LSN, txn);
+  bool created = free_space_map_.Create() &&
+                 free_space_map_.Update(first_page_id_,
+                                        first_page->GetFreeSpaceSize());
+  assert(created);
+  (void)created;
+  first_page->SetFsmPageId(free_space_map_.GetFirstPageId());
   first_page->WUnlatch();
   buffer_pool_manager_->UnpinPage(first_page_id_, true);
 }
 
 bool TableHeap::InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn) {
-  if (tuple.size_ + 32 > PAGE_SIZE) { // larger than one page size
+  if (schema_ == nullptr || !OverflowStore::NeedsToast(tuple, schema_))
+    return StoreTuple(tuple, rid, txn);
+  Tuple toasted;
+  if (!overflow_store_.Toast(tuple, schema_, toasted)) {
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
+  if (StoreTuple(toasted, rid, txn))
+    return true;
+  overflow_store_.Delete(toasted, schema_);
+  return false;
+}
 
-  auto cur_page =
-      static_cast<TablePage *>(buffer_pool_manager_->FetchPage(first_page_id_));
-  if (cur_page == nullptr) {
+bool TableHeap::InsertTuples(const std::vector<Tuple> &tuples,
+                             std::vector<RID> &rids, Transaction *txn) {
+  bool toast = false;
+  for (auto &tuple : tuples)
+    toast = toast ||
+            (schema_ != nullptr && OverflowStore::NeedsToast(tuple, schema_));
+  if (!toast)
+    return StoreTuples(tuples, rids, txn) == tuples.size();
+
+  std::vector<Tuple> toasted(tuples.size());
+  for (size_t i = 0; i < tuples.size(); ++i) {
+    if (!OverflowStore::NeedsToast(tuples[i], schema_)) {
+      toasted[i] = tuples[i];
+    } else if (!overflow_store_.Toast(tuples[i], schema_, toasted[i])) {
+      for (size_t j = 0; j < i; ++j)
+        overflow_store_.Delete(toasted[j], schema_);
+      rids.assign(tuples.size(), RID());
+      txn->SetState(TransactionState::ABORTED);
+      return false;
+    }
+  }
+  // the values of the tuples inserted are deleted when the transaction
+  // rolls them back
+  size_t stored = StoreTuples(toasted, rids, txn);
+  for (size_t i = 0; i < toasted.size(); ++i) {
+    if (rids[i].GetPageId() == INVALID_PAGE_ID)
+      overflow_store_.Delete(toasted[i], schema_);
+  }
+  return stored == toasted.size();
+}
+
+bool TableHeap::StoreTuple(const Tuple &tuple, RID &rid, Transaction *txn) {
+  if (tuple.size_ + TABLE_PAGE_HEADER_SIZE + TABLE_PAGE_SLOT_SIZE >
+      PAGE_SIZE) { // larger than one page size
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
 
-  cur_page->WLatch();
-  while (!cur_page->InsertTuple(
-      tuple, rid, txn, lock_manager_,
-      log_manager_)) { // fail to insert due to not enough space
-    auto next_page_id = cur_page->GetNextPageId();
-    if (next_page_id != INVALID_PAGE_ID) { // valid next page
-      cur_page->WUnlatch();
-      buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), false);
-      cur_page = static_cast<TablePage *>(
-          buffer_pool_manager_->FetchPage(next_page_id));
-      cur_page->WLatch();
-    } else { // create new page
-      auto new_page =
-          static_cast<TablePage *>(buffer_pool_manager_->NewPage(next_page_id));
-      if (new_page == nullptr) {
-        cur_page->WUnlatch();
-        buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), false);
-        txn->SetState(TransactionState::ABORTED);
-        return false;
-      }
-      new_page->WLatch();
-      // std::cout << "new table page " << next_page_id << " created" <<
-      // std::endl;
-      cur_page->SetNextPageId(next_page_id);
-      new_page->Init(next_page_id, PAGE_SIZE, cur_page->GetPageId(),
-                     log_manager_, txn);
-      cur_page->WUnlatch();
-      buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), true);
-      cur_page = new_page;
+  bool inserted = false;
+  while (!inserted) {
+    // room for a new slot too, the page may have no empty one
+    page_id_t page_id = free_space_map_.FindPage(tuple.size_ + TABLE_PAGE_SLOT_SIZE);
+    TablePage *cur_page;
+    if (page_id == INVALID_PAGE_ID) {
+      cur_page = AppendPages(1, txn);
+    } else {
+      cur_page =
+          static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+      if (cur_page != nullptr)
+        cur_page->WLatch();
+    }
+    if (cur_page == nullptr) {
+      txn->SetState(TransactionState::ABORTED);
+      return false;
+    }
+    // fails when a concurrent insert took the room the map recorded, whose
+    // category is then lowered
+    inserted =
+        cur_page->InsertTuple(tuple, rid, txn, lock_manager_, log_manager_);
+    free_space_map_.Update(cur_page->GetPageId(),
+                           cur_page->GetFreeSpaceSize());
+    cur_page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(cur_page->GetPageId(),
+                                    inserted || page_id == INVALID_PAGE_ID);
+    if (!inserted && page_id == INVALID_PAGE_ID) { // not even an empty page
+      txn->SetState(TransactionState::ABORTED);
+      return false;
     }
   }
-  cur_page->WUnlatch();
-  buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), true);
   txn->GetWriteSet()->emplace_back(rid, WType::INSERT, Tuple{}, this);
   return true;
 }
 
+static bool FitsInPage(const Tuple &tuple) {
+  return tuple.GetLength() + TABLE_PAGE_HEADER_SIZE + TABLE_PAGE_SLOT_SIZE <=
+         PAGE_SIZE;
+}
+
+/*
+ * A tuple larger than a page is refused on its own, as StoreTuple does, and
+ * the tuples around it are stored in the runs between such tuples
+ */
+size_t TableHeap::StoreTuples(const std::vector<Tuple> &tuples,
+                              std::vector<RID> &rids, Transaction *txn) {
+  rids.assign(tuples.size(), RID());
+  size_t stored = 0;
+  size_t done = 0;
+  while (done < tuples.size()) {
+    if (!FitsInPage(tuples[done])) { // larger than one page size
+      txn->SetState(TransactionState::ABORTED);
+      done++;
+      continue;
+    }
+    size_t end = done + 1;
+    while (end < tuples.size() && FitsInPage(tuples[end]))
+      end++;
+
+    page_id_t page_id =
+        free_space_map_.FindPage(tuples[done].size_ + TABLE_PAGE_SLOT_SIZE);
+    TablePage *cur_page;
+    if (page_id == INVALID_PAGE_ID) {
+      // pages for the rest of the run, at least one
+      int pages = 1;
+      int32_t room = PAGE_SIZE - TABLE_PAGE_HEADER_SIZE;
+      for (size_t i = done; i < end; ++i) {
+        room -= tuples[i].size_ + TABLE_PAGE_SLOT_SIZE;
+        if (room < 0) {
+          if (++pages == TABLE_HEAP_EXTEND_PAGES)
+            break;
+          room = PAGE_SIZE - TABLE_PAGE_HEADER_SIZE - tuples[i].size_ -
+                 TABLE_PAGE_SLOT_SIZE;
+        }
+      }
+      cur_page = AppendPages(pages, txn);
+    } else {
+      cur_page =
+          static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+      if (cur_page != nullptr)
+        cur_page->WLatch();
+    }
+    if (cur_page == nullptr) {
+      txn->SetState(TransactionState::ABORTED);
+      return stored;
+    }
+    int inserted =
+        cur_page->InsertTuples(&tuples[done], end - done, &rids[done], txn,
+                               lock_manager_, log_manager_);
+    free_space_map_.Update(cur_page->GetPageId(),
+                           cur_page->GetFreeSpaceSize());
+    cur_page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(cur_page->GetPageId(),
+                                    inserted > 0 || page_id == INVALID_PAGE_ID);
+    if (inserted == 0 && page_id == INVALID_PAGE_ID) {
+      txn->SetState(TransactionState::ABORTED);
+      return stored;
+    }
+    for (int i = 0; i < inserted; ++i) {
+      txn->GetWriteSet()->emplace_back(rids[done + i], WType::INSERT, Tuple{},
+                                       this);
+    }
+    stored += inserted;
+    done += inserted;
+  }
+  return stored;
+}
+
+/*
+ * The new pages are linked to each other and go into the free space map
+ * while they are write latched, and are linked to the heap last. The last
+ * page of the map is always the end of the heap.
+ */
+TablePage *TableHeap::AppendPages(int count, Transaction *txn) {
+  std::lock_guard<std::mutex> guard(append_latch_);
+  page_id_t last_page_id = free_space_map_.GetLastPageId();
+  auto last_page =
+      static_cast<TablePage *>(buffer_pool_manager_->FetchPage(last_page_id));
+  if (last_page == nullptr)
+    return nullptr;
+
+  std::vector<TablePage *> new_pages;
+  while (static_cast<int>(new_pages.size()) < count) {
+    page_id_t new_page_id;
+    auto new_page =
+        static_cast<TablePage *>(buffer_pool_manager_->NewPage(new_page_id));
+    if (new_page == nullptr)
+      break;
+    new_page->WLatch();
+    page_id_t prev_page_id =
+        new_pages.empty() ? last_page_id : new_pages.back()->GetPageId();
+    InitPage(new_page, new_page_id, prev_page_id, txn);
+    if (!free_space_map_.Update(new_page_id, new_page->GetFreeSpaceSize())) {
+      new_page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(new_page_id, false);
+      buffer_pool_manager_->DeletePage(new_page_id);
+      break;
+    }
+    if (!new_pages.empty())
+      new_pages.back()->SetNextPageId(new_page_id);
+    new_pages.push_back(new_page);
+  }
+  if (new_pages.empty()) {
+    buffer_pool_manager_->UnpinPage(last_page_id, false);
+    return nullptr;
+  }
+
+  last_page->WLatch();
+  last_page->SetNextPageId(new_pages[0]->GetPageId());
+  last_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(last_page_id, true);
+  for (size_t i = 1; i < new_pages.size(); ++i) {
+    new_pages[i]->WUnlatch();
+    buffer_pool_manager_->UnpinPage(new_pages[i]->GetPageId(), true);
+  }
+  return new_pages[0];
+}
+
+void TableHeap::InitPage(TablePage *page, page_id_t page_id,
+                         page_id_t prev_page_id, Transaction *txn) {
+  if (layout_ == PageLayout::PAX)
+    page->AsPaxPage()->Init(page_id, PAGE_SIZE, prev_page_id, schema_,
+                            log_manager_, txn);
+  else
+    page->Init(page_id, PAGE_SIZE, prev_page_id, log_manager_, txn);
+}
+
 bool TableHeap::MarkDelete(const RID &rid, Transaction *txn) {
   // todo: remove empty page
   auto page = reinterpret_cast<TablePage *>(
@@ -99,22 +289,42 @@ bool TableHeap::MarkDelete(const RID &rid, Transaction *txn) {
   return true;
 }
 
+/*
+ * The old version keeps its overflow pages until the update commits. When
+ * the update is rolled back, the version it replaces is the one this
+ * transaction wrote, whose pages are freed right away.
+ */
 bool TableHeap::UpdateTuple(const Tuple &tuple, const RID &rid,
                             Transaction *txn) {
+  Tuple toasted;
+  bool toast = schema_ != nullptr && OverflowStore::NeedsToast(tuple, schema_);
+  if (toast && !overflow_store_.Toast(tuple, schema_, toasted)) {
+    txn->SetState(TransactionState::ABORTED);
+    return false;
+  }
+  const Tuple &new_tuple = toast ? toasted : tuple;
   auto page = reinterpret_cast<TablePage *>(
       buffer_pool_manager_->FetchPage(rid.GetPageId()));
   if (page == nullptr) {
+    if (toast)
+      overflow_store_.Delete(toasted, schema_);
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
   Tuple old_tuple;
   page->WLatch();
-  bool is_updated = page->UpdateTuple(tuple, old_tuple, rid, txn, lock_manager_,
-                                      log_manager_);
+  bool is_updated = page->UpdateTuple(new_tuple, old_tuple, rid, txn,
+                                      lock_manager_, log_manager_);
+  if (is_updated)
+    free_space_map_.Update(page->GetPageId(), page->GetFreeSpaceSize());
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetPageId(), is_updated);
+  if (!is_updated && toast)
+    overflow_store_.Delete(toasted, schema_);
   if (is_updated && txn->GetState() != TransactionState::ABORTED)
     txn->GetWriteSet()->emplace_back(rid, WType::UPDATE, old_tuple, this);
+  else if (is_updated && schema_ != nullptr) // rollback
+    overflow_store_.Delete(old_tuple, schema_);
   return is_updated;
 }
 
@@ -122,11 +332,17 @@ void TableHeap::ApplyDelete(const RID &rid, Transaction *txn) {
   auto page = reinterpret_cast<TablePage *>(
       buffer_pool_manager_->FetchPage(rid.GetPageId()));
   assert(page != nullptr);
+  Tuple deleted_tuple;
   page->WLatch();
-  page->ApplyDelete(rid, txn, log_manager_);
+  page->ApplyDelete(rid, txn, log_manager_,
+                    schema_ != nullptr ? &deleted_tuple : nullptr);
+  // the room of the deleted tuple is free, once the page is compacted
+  free_space_map_.Update(page->GetPageId(), page->GetFreeSpaceSize());
   lock_manager_->Unlock(txn, rid);
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+  if (schema_ != nullptr)
+    overflow_store_.Delete(deleted_tuple, schema_);
 }
 
 void TableHeap::RollbackDelete(const RID &rid, Transaction *txn) {
@@ -139,10 +355,16 @@ void TableHeap::RollbackDelete(const RID &rid, Transaction *txn) {
   buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
 }
 
+void TableHeap::ApplyUpdate(const Tuple &old_tuple, Transaction *txn) {
+  if (schema_ != nullptr)
+    overflow_store_.Delete(old_tuple, schema_);
+}
+
 // called by tuple iterator
-bool TableHeap::GetTuple(const RID &rid, Tuple &tuple, Transaction *txn) {
+bool TableHeap::GetTuple(const RID &rid, Tuple &tuple, Transaction *txn,
+                         BufferRing *ring) {
   auto page = static_cast<TablePage *>(
-      buffer_pool_manager_->FetchPage(rid.GetPageId()));
+      buffer_pool_manager_->FetchPage(rid.GetPageId(), ring));
   if (page == nullptr) {
     txn->SetState(TransactionState::ABORTED);
     return false;
@@ -154,11 +376,22 @@ bool TableHeap::GetTuple(const RID &rid, Tuple &tuple, Transaction *txn) {
   return res;
 }
 
+Value TableHeap::GetValue(const Tuple &tuple, Schema *schema, int column_id) {
+  return overflow_store_.GetValue(tuple, schema, column_id);
+}
+
 bool TableHeap::DeleteTableHeap() {
   // todo: real delete
   return true;
 }
 
+PageWindowFn TableHeap::GetPageWindow() {
+  return [this](page_id_t page_id, size_t count,
+                std::vector<page_id_t> &page_ids) {
+    return free_space_map_.GetPageIds(page_id, count, page_ids);
+  };
+}
+
 TableIterator TableHeap::begin(Transaction *txn) {
   auto page =
       static_cast<TablePage *>(buffer_pool_manager_->FetchPage(first_page_id_));
@@ -169,11 +402,19 @@ TableIterator TableHeap::begin(Transaction *txn) {
   page->GetFirstTupleRid(rid);
   page->RUnlatch();
   buffer_pool_manager_->UnpinPage(first_page_id_, false);
-  return TableIterator(this, rid, txn);
+  return TableIterator(this, rid, txn,
+                       std::make_shared<BufferRing>(buffer_pool_manager_));
 }
 
 TableIterator TableHeap::end() {
   return TableIterator(this, RID(INVALID_PAGE_ID, -1), nullptr);
 }
 
+std::unique_ptr<ColumnIterator>
+TableHeap::ScanColumns(const std::vector<int> &column_ids, Transaction *txn) {
+  return std::unique_ptr<ColumnIterator>(new ColumnIterator(
+      this, column_ids, txn,
+      std::make_shared<BufferRing>(buffer_pool_manager_)));
+}
+
 } // namespace scudb
@@ -8,10 +8,18 @@
 
 namespace scudb {
 
-TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn)
-    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn) {
+static page_id_t NextTablePageId(Page *page) {
+  return static_cast<TablePage *>(page)->GetNextPageId();
+}
+
+TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn,
+                             std::shared_ptr<BufferRing> ring)
+    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn),
+      ring_(std::move(ring)),
+      read_ahead_(table_heap->buffer_pool_manager_,
+                  table_heap->GetPageWindow()) {
   if (rid.GetPageId() != INVALID_PAGE_ID) {
-    table_heap_->GetTuple(tuple_->rid_, *tuple_, txn_);
+    table_heap_->GetTuple(tuple_->rid_, *tuple_, txn_, ring_.get());
   }
 };
 
@@ -28,7 +36,7 @@ Tuple *TableIterator::operator->() {
 TableIterator &TableIterator::operator++() {
   BufferPoolManager *buffer_pool_manager = table_heap_->buffer_pool_manager_;
   auto cur_page = static_cast<TablePage *>(
-      buffer_pool_manager->FetchPage(tuple_->rid_.GetPageId()));
+      buffer_pool_manager->FetchPage(tuple_->rid_.GetPageId(), ring_.get()));
   cur_page->RLatch();
   assert(cur_page != nullptr); // all pages are pinned
 
@@ -37,11 +45,12 @@ TableIterator &TableIterator::operator++() {
                                  next_tuple_rid)) { // end of this page
     while (cur_page->GetNextPageId() != INVALID_PAGE_ID) {
       auto next_page = static_cast<TablePage *>(
-          buffer_pool_manager->FetchPage(cur_page->GetNextPageId()));
+          buffer_pool_manager->FetchPage(cur_page->GetNextPageId(), ring_.get()));
       cur_page->RUnlatch();
       buffer_pool_manager->UnpinPage(cur_page->GetPageId(), false);
       cur_page = next_page;
       cur_page->RLatch();
+      read_ahead_.Advance(cur_page->GetNextPageId(), NextTablePageId, ring_);
       if (cur_page->GetFirstTupleRid(next_tuple_rid))
         break;
     }
@@ -49,11 +58,14 @@ TableIterator &TableIterator::operator++() {
   tuple_->rid_ = next_tuple_rid;
 
   if (*this != table_heap_->end()) {
-    table_heap_->GetTuple(tuple_->rid_, *tuple_, txn_);
+    table_heap_->GetTuple(tuple_->rid_, *tuple_, txn_, ring_.get());
   }
   // release until copy the tuple
   cur_page->RUnlatch();
   buffer_pool_manager->UnpinPage(cur_page->GetPageId(), false);
+  if (*this == table_heap_->end()) {
+    ring_.reset(); // scan is over, give the ring frames back
+  }
   return *this;
 }
 
@@ -75,10 +75,19 @@ Value Tuple::GetValue(Schema *schema, const int column_id) const {
   assert(data_);
   const TypeId column_type = schema->GetType(column_id);
   const char *data_ptr = GetDataPtr(schema, column_id);
+  assert(!IsToasted(schema, column_id));
   // the third parameter "is_inlined" is unused
   return Value::DeserializeFrom(data_ptr, column_type);
 }
 
+bool Tuple::IsToasted(Schema *schema, const int column_id) const {
+  if (schema->IsInlined(column_id))
+    return false;
+  uint32_t length =
+      *reinterpret_cast<const uint32_t *>(GetDataPtr(schema, column_id));
+  return length != PELOTON_VALUE_NULL && (length & TOAST_POINTER_FLAG) != 0;
+}
+
 const char *Tuple::GetDataPtr(Schema *schema, const int column_id) const {
   assert(schema);
   assert(data_);
@@ -2,9 +2,12 @@
  * virtual_table.cpp
  */
 #include <algorithm>
+#include <cmath>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <sys/stat.h>
+#include <unordered_map>
 #include <vector>
 
 #include "common/exception.h"
@@ -17,6 +20,9 @@ namespace scudb {
 
 SQLITE_EXTENSION_INIT1
 
+// the tables connected, whose index entries a rollback has to undo
+static std::vector<VirtualTable *> open_tables;
+
 /* API implementation */
 int VtabCreate(sqlite3 *db, void *pAux, int argc, const char *const *argv,
                sqlite3_vtab **ppVtab, char **pzErr) {
@@ -36,19 +42,20 @@ int VtabCreate(sqlite3 *db, void *pAux, int argc, const char *const *argv,
   schema_string = schema_string.substr(1, (schema_string.size() - 2));
   Schema *schema = ParseCreateStatement(schema_string);
 
-  // parse arg[4](string that defines table index)
+  // parse arg[4](string that defines table index) and the layout
+  std::string index_string;
+  PageLayout layout = ParseTableOptions(argc, argv, index_string);
   Index *index = nullptr;
-  if (argc > 4) {
-    std::string index_string(argv[4]);
-    index_string = index_string.substr(1, (index_string.size() - 2));
+  if (!index_string.empty()) {
     // create index object, allocate memory space
     IndexMetadata *index_metadata =
         ParseIndexStatement(index_string, std::string(argv[2]), schema);
     index = ConstructIndex(index_metadata, buffer_pool_manager);
   }
   // create table object, allocate memory space
-  VirtualTable *table = new VirtualTable(schema, buffer_pool_manager,
-                                         lock_manager, log_manager, index);
+  VirtualTable *table =
+      new VirtualTable(schema, buffer_pool_manager, lock_manager, log_manager,
+                       index, INVALID_PAGE_ID, layout);
 
   // insert table root page info into header page
   header_page->InsertRecord(std::string(argv[2]), table->GetFirstPageId());
@@ -58,6 +65,7 @@ int VtabCreate(sqlite3 *db, void *pAux, int argc, const char *const *argv,
   schema_string = "CREATE TABLE X(" + schema_string + ");";
   assert(sqlite3_declare_vtab(db, schema_string.c_str()) == SQLITE_OK);
 
+  open_tables.push_back(table);
   *ppVtab = reinterpret_cast<sqlite3_vtab *>(table);
   return SQLITE_OK;
 }
@@ -81,47 +89,210 @@ int VtabConnect(sqlite3 *db, void *pAux, int argc, const char *const *argv,
       static_cast<HeaderPage *>(buffer_pool_manager->FetchPage(HEADER_PAGE_ID));
   page_id_t table_root_id;
   header_page->GetRootId(std::string(argv[2]), table_root_id);
-  // parse arg[4](string that defines table index)
+  // parse arg[4](string that defines table index), the table heap keeps its
+  // layout itself
+  std::string index_string;
+  ParseTableOptions(argc, argv, index_string);
   Index *index = nullptr;
-  if (argc > 4) {
-    std::string index_string(argv[4]);
-    index_string = index_string.substr(1, (index_string.size() - 2));
+  bool build_index = false;
+  if (!index_string.empty()) {
     // create index object, allocate memory space
     IndexMetadata *index_metadata =
         ParseIndexStatement(index_string, std::string(argv[2]), schema);
     // Retrieve index root page info from header page
-    page_id_t index_root_id;
-    header_page->GetRootId(index_metadata->GetName(), index_root_id);
+    page_id_t index_root_id = INVALID_PAGE_ID;
+    build_index =
+        !header_page->GetRootId(index_metadata->GetName(), index_root_id);
     index = ConstructIndex(index_metadata, buffer_pool_manager, index_root_id);
   }
   VirtualTable *table =
       new VirtualTable(schema, buffer_pool_manager, lock_manager, log_manager,
                        index, table_root_id);
+  // the index is new to an existing table, build it from the table's tuples
+  if (build_index)
+    table->BuildIndex();
 
   // register virtual table within sqlite system
   schema_string = "CREATE TABLE X(" + schema_string + ");";
   assert(sqlite3_declare_vtab(db, schema_string.c_str()) == SQLITE_OK);
 
+  open_tables.push_back(table);
   *ppVtab = reinterpret_cast<sqlite3_vtab *>(table);
   buffer_pool_manager->UnpinPage(HEADER_PAGE_ID, false);
   return SQLITE_OK;
 }
 
+// idxNum of a range scan, with flags for the bounds it has
+static const int RANGE_SCAN = 2;
+static const int RANGE_HAS_LOW = 4;
+static const int RANGE_LOW_INCLUSIVE = 8;
+static const int RANGE_HAS_HIGH = 16;
+static const int RANGE_HIGH_INCLUSIVE = 32;
+
+/*
+ * Plan a range scan of a single column index for the first lower bound
+ * (> or >=) and the first upper bound (< or <=) on the column. BETWEEN comes
+ * as a >= and a <= constraint. The bounds are passed to VtabFilter in that
+ * order. sqlite still checks the constraints on the returned rows.
+ */
+static void BestRangeIndex(const std::vector<int> &key_attrs,
+                           sqlite3_index_info *pIdxInfo) {
+  for (int i = 0; i < pIdxInfo->nConstraint; i++)
+    pIdxInfo->aConstraintUsage[i].argvIndex = 0;
+  if (key_attrs.size() != 1)
+    return;
+  int low = -1, high = -1;
+  int flags = RANGE_SCAN;
+  for (int i = 0; i < pIdxInfo->nConstraint; i++) {
+    const auto &constraint = pIdxInfo->aConstraint[i];
+    if (constraint.usable == 0 || constraint.iColumn != key_attrs[0])
+      continue;
+    unsigned char op = constraint.op;
+    if (low == -1 && (op == SQLITE_INDEX_CONSTRAINT_GT ||
+                      op == SQLITE_INDEX_CONSTRAINT_GE)) {
+      low = i;
+      flags |= RANGE_HAS_LOW;
+      if (op == SQLITE_INDEX_CONSTRAINT_GE)
+        flags |= RANGE_LOW_INCLUSIVE;
+    } else if (high == -1 && (op == SQLITE_INDEX_CONSTRAINT_LT ||
+                              op == SQLITE_INDEX_CONSTRAINT_LE)) {
+      high = i;
+      flags |= RANGE_HAS_HIGH;
+      if (op == SQLITE_INDEX_CONSTRAINT_LE)
+        flags |= RANGE_HIGH_INCLUSIVE;
+    }
+  }
+  if (low == -1 && high == -1)
+    return;
+  int argv_index = 1;
+  if (low != -1)
+    pIdxInfo->aConstraintUsage[low].argvIndex = argv_index++;
+  if (high != -1)
+    pIdxInfo->aConstraintUsage[high].argvIndex = argv_index;
+  pIdxInfo->idxNum = flags;
+  // cheaper than a full scan, the more so with both bounds
+  pIdxInfo->estimatedCost = (low != -1 && high != -1) ? 100.0 : 1000.0;
+}
+
+// range of the values of an integer column, NULL left out
+static void GetIntegerRange(TypeId type, int64_t &min, int64_t &max) {
+  switch (type) {
+  case TypeId::BOOLEAN:
+    min = PELOTON_BOOLEAN_MIN, max = PELOTON_BOOLEAN_MAX;
+    break;
+  case TypeId::TINYINT:
+    min = PELOTON_INT8_MIN, max = PELOTON_INT8_MAX;
+    break;
+  case TypeId::SMALLINT:
+    min = PELOTON_INT16_MIN, max = PELOTON_INT16_MAX;
+    break;
+  case TypeId::INTEGER:
+    min = PELOTON_INT32_MIN, max = PELOTON_INT32_MAX;
+    break;
+  default:
+    min = PELOTON_INT64_MIN, max = PELOTON_INT64_MAX;
+    break;
+  }
+}
+
+/*
+ * Bound of a range scan from the value sqlite compares the index column
+ * with. Unlike ConstructTuple it does not cut the value to the column type:
+ * a fraction is rounded outwards and the bound made inclusive, and a value
+ * the column cannot hold (or of another kind, such as text for a number)
+ * gives no bound, the scan is open on that end. sqlite rechecks the rows.
+ */
+static bool ConstructBound(Schema *key_schema, sqlite3_value *arg, bool is_low,
+                           bool &inclusive, Tuple &bound) {
+  TypeId type = key_schema->GetType(0);
+  int arg_type = sqlite3_value_type(arg);
+  Value v(TypeId::INVALID);
+  switch (type) {
+  case TypeId::BOOLEAN:
+  case TypeId::TINYINT:
+  case TypeId::SMALLINT:
+  case TypeId::INTEGER:
+  case TypeId::BIGINT: {
+    int64_t integer;
+    if (arg_type == SQLITE_INTEGER) {
+      integer = sqlite3_value_int64(arg);
+    } else if (arg_type == SQLITE_FLOAT) {
+      double d = sqlite3_value_double(arg);
+      double rounded = is_low ? std::floor(d) : std::ceil(d);
+      // false for NaN too
+      if (!(rounded >= -9223372036854775808.0 &&
+            rounded < 9223372036854775808.0))
+        return false;
+      if (rounded != d)
+        inclusive = true;
+      integer = static_cast<int64_t>(rounded);
+    } else {
+      return false;
+    }
+    int64_t min, max;
+    GetIntegerRange(type, min, max);
+    if (integer < min || integer > max)
+      return false;
+    if (type == TypeId::BIGINT)
+      v = Value(type, integer);
+    else
+      v = Value(type, static_cast<int32_t>(integer));
+    break;
+  }
+  case TypeId::DECIMAL:
+    if (arg_type == SQLITE_INTEGER) {
+      int64_t integer = sqlite3_value_int64(arg);
+      double d = static_cast<double>(integer);
+      // not every large integer is a double
+      if (d >= 9223372036854775808.0 || static_cast<int64_t>(d) != integer)
+        inclusive = true;
+      v = Value(type, d);
+    } else if (arg_type == SQLITE_FLOAT) {
+      v = Value(type, sqlite3_value_double(arg));
+    } else {
+      return false;
+    }
+    break;
+  case TypeId::VARCHAR:
+    if (arg_type != SQLITE_TEXT)
+      return false;
+    v = Value(type, std::string(reinterpret_cast<const char *>(
+                        sqlite3_value_text(arg))));
+    break;
+  default:
+    return false;
+  }
+  bound = Tuple(std::vector<Value>{v}, key_schema);
+  return true;
+}
+
 /*
  * we only support
  * (1) equlity check. e.g select * from foo where a = 1
  * (2) indexed column == predicated column
+ * (3) range check on a single column index, e.g. select * from foo where
+ *     a > 1 and a <= 5, see BestRangeIndex
  */
 int VtabBestIndex(sqlite3_vtab *tab, sqlite3_index_info *pIdxInfo) {
   // LOG_DEBUG("VtabBestIndex");
   VirtualTable *table = reinterpret_cast<VirtualTable *>(tab);
+  // the columns a full scan of a columnar table reads
+  if (table->IsColumnar()) {
+    sqlite3_uint64 columns = ~static_cast<sqlite3_uint64>(0);
+    if (sqlite3_libversion_number() >= 3010000) // colUsed is newer
+      columns = pIdxInfo->colUsed;
+    pIdxInfo->idxStr = sqlite3_mprintf("%llu", columns);
+    pIdxInfo->needToFreeIdxStr = 1;
+  }
   if (table->GetIndex() == nullptr)
     return SQLITE_OK;
   const std::vector<int> key_attrs = table->GetIndex()->GetKeyAttrs();
   // make sure indexed column == predicate column
   // e.g select * from foo where a = 1 and b =2; indexed column must be {a,b}
-  if (pIdxInfo->nConstraint != (int)(key_attrs.size()))
+  if (pIdxInfo->nConstraint != (int)(key_attrs.size())) {
+    BestRangeIndex(key_attrs, pIdxInfo);
     return SQLITE_OK;
+  }
 
   int counter = 0;
   bool is_index_scan = true;
@@ -144,12 +315,39 @@ int VtabBestIndex(sqlite3_vtab *tab, sqlite3_index_info *pIdxInfo) {
 
   if (counter == (int)key_attrs.size() && is_index_scan) {
     pIdxInfo->idxNum = 1;
+  } else {
+    BestRangeIndex(key_attrs, pIdxInfo);
   }
   return SQLITE_OK;
 }
 
+/*
+ * Rows VtabUpdate inserts are buffered by their table and go into it in
+ * batches. The buffers are emptied before a table is read, and before the
+ * transaction commits (in VtabSync, which can still fail it). A row that
+ * could not be inserted fails the statement that emptied the buffer.
+ */
+static std::vector<VirtualTable *> tables_with_inserts;
+
+static bool FlushInserts() {
+  bool inserted = true;
+  for (auto *table : tables_with_inserts)
+    inserted = table->FlushInserts() && inserted;
+  tables_with_inserts.clear();
+  return inserted;
+}
+
 int VtabDisconnect(sqlite3_vtab *pVtab) {
   VirtualTable *virtual_table = reinterpret_cast<VirtualTable *>(pVtab);
+  if (GetTransaction() != nullptr)
+    virtual_table->FlushInserts();
+  tables_with_inserts.erase(std::remove(tables_with_inserts.begin(),
+                                        tables_with_inserts.end(),
+                                        virtual_table),
+                            tables_with_inserts.end());
+  open_tables.erase(
+      std::remove(open_tables.begin(), open_tables.end(), virtual_table),
+      open_tables.end());
   delete virtual_table;
   // delete all the global managers
   delete storage_engine_;
@@ -162,6 +360,8 @@ int VtabOpen(sqlite3_vtab *pVtab, sqlite3_vtab_cursor **ppCursor) {
   if (global_transaction_ == nullptr) {
     VtabBegin(pVtab);
   }
+  if (!FlushInserts())
+    return SQLITE_ERROR;
   VirtualTable *virtual_table = reinterpret_cast<VirtualTable *>(pVtab);
   Cursor *cursor = new Cursor(virtual_table);
   *ppCursor = reinterpret_cast<sqlite3_vtab_cursor *>(cursor);
@@ -196,6 +396,33 @@ int VtabFilter(sqlite3_vtab_cursor *pVtabCursor, int idxNum, const char *idxStr,
     key_schema = cursor->GetKeySchema();
     Tuple scan_tuple = ConstructTuple(key_schema, argv);
     cursor->ScanKey(scan_tuple);
+  } else if (idxNum & RANGE_SCAN) {
+    cursor->SetScanFlag(true);
+    key_schema = cursor->GetKeySchema();
+    int arg = 0;
+    bool low_inclusive = (idxNum & RANGE_LOW_INCLUSIVE) != 0;
+    bool high_inclusive = (idxNum & RANGE_HIGH_INCLUSIVE) != 0;
+    Tuple low, high;
+    bool has_low = false, has_high = false;
+    if (idxNum & RANGE_HAS_LOW)
+      has_low = ConstructBound(key_schema, argv[arg++], true, low_inclusive,
+                               low);
+    if (idxNum & RANGE_HAS_HIGH)
+      has_high = ConstructBound(key_schema, argv[arg], false, high_inclusive,
+                                high);
+    cursor->ScanRange(has_low ? &low : nullptr, low_inclusive,
+                      has_high ? &high : nullptr, high_inclusive);
+  } else if (cursor->GetVirtualTable()->IsColumnar()) {
+    // bit i of the mask is column i, bit 63 the columns from 63 on
+    uint64_t columns =
+        idxStr != nullptr ? strtoull(idxStr, nullptr, 10) : UINT64_MAX;
+    std::vector<int> column_ids;
+    int column_count = cursor->GetVirtualTable()->GetSchema()->GetColumnCount();
+    for (int i = 0; i < column_count; i++) {
+      if (columns & (static_cast<uint64_t>(1) << std::min(i, 63)))
+        column_ids.push_back(i);
+    }
+    cursor->ScanColumns(column_ids);
   }
   return SQLITE_OK;
 }
@@ -272,11 +499,12 @@ int VtabUpdate(sqlite3_vtab *pVTab, int argc, sqlite3_value **argv,
   else if (argc > 1 && sqlite3_value_type(argv[0]) == SQLITE_NULL) {
     Schema *schema = table->GetSchema();
     Tuple tuple = ConstructTuple(schema, (argv + 2));
-    // insert into table heap
-    RID rid;
-    table->InsertTuple(tuple, rid);
-    // insert into index
-    table->InsertEntry(tuple, rid);
+    // insert into table heap and index, in a batch with the next rows
+    if (std::find(tables_with_inserts.begin(), tables_with_inserts.end(),
+                  table) == tables_with_inserts.end())
+      tables_with_inserts.push_back(table);
+    if (!table->BufferInsert(tuple))
+      return SQLITE_ERROR;
   }
   // The row with rowid argv[0] is updated with new values in argv[2] and
   // following parameters.
@@ -292,7 +520,8 @@ int VtabUpdate(sqlite3_vtab *pVTab, int argc, sqlite3_value **argv,
     if (table->UpdateTuple(tuple, rid) == false) {
       table->DeleteTuple(rid);
       // rid should be different
-      table->InsertTuple(tuple, rid);
+      if (!table->InsertTuple(tuple, rid))
+        return SQLITE_ERROR;
     }
     table->InsertEntry(tuple, rid);
   }
@@ -306,11 +535,19 @@ int VtabBegin(sqlite3_vtab *pVTab) {
   return SQLITE_OK;
 }
 
+// insert the rows still buffered, a failure rolls the transaction back
+int VtabSync(sqlite3_vtab *pVTab) {
+  if (GetTransaction() == nullptr)
+    return SQLITE_OK;
+  return FlushInserts() ? SQLITE_OK : SQLITE_ERROR;
+}
+
 int VtabCommit(sqlite3_vtab *pVTab) {
   // LOG_DEBUG("VtabCommit");
   auto transaction = GetTransaction();
   if (transaction == nullptr)
     return SQLITE_OK;
+  FlushInserts();
   // get global txn manager
   auto transaction_manager = storage_engine_->transaction_manager_;
   // invoke transaction manager to commit(this txn can't fail)
@@ -322,6 +559,46 @@ int VtabCommit(sqlite3_vtab *pVTab) {
   return SQLITE_OK;
 }
 
+/*
+ * The transaction manager rolls back the table heaps but knows nothing of
+ * the indexes. Before, the entries of the rows the transaction inserted or
+ * updated are taken out; after, those of the rows it deleted or updated are
+ * put back for the tuples restored. A row it deleted lost its entry already,
+ * and a row it inserted is gone after.
+ */
+int VtabRollback(sqlite3_vtab *pVTab) {
+  auto transaction = GetTransaction();
+  if (transaction == nullptr)
+    return SQLITE_OK;
+  for (auto *table : tables_with_inserts)
+    table->DiscardInserts();
+  tables_with_inserts.clear();
+
+  std::vector<std::pair<VirtualTable *, RID>> restored;
+  for (auto *table : open_tables) {
+    if (table->GetIndex() == nullptr)
+      continue;
+    // bit 1 << WType of every write to a row
+    std::unordered_map<RID, int> writes;
+    for (auto &record : *transaction->GetWriteSet()) {
+      if (record.table_ == table->GetTableHeap())
+        writes[record.rid_] |= 1 << static_cast<int>(record.wtype_);
+    }
+    for (auto &write : writes) {
+      if ((write.second & (1 << static_cast<int>(WType::DELETE))) == 0)
+        table->DeleteEntry(write.first);
+      if ((write.second & (1 << static_cast<int>(WType::INSERT))) == 0)
+        restored.emplace_back(table, write.first);
+    }
+  }
+  storage_engine_->transaction_manager_->Abort(transaction);
+  for (auto &row : restored)
+    row.first->InsertEntry(row.second);
+  delete transaction;
+  global_transaction_ = nullptr;
+  return SQLITE_OK;
+}
+
 sqlite3_module VtableModule = {
     0,              /* iVersion */
     VtabCreate,     /* xCreate */
@@ -338,9 +615,9 @@ sqlite3_module VtableModule = {
     VtabRowid,      /* xRowid - read data */
     VtabUpdate,     /* xUpdate */
     VtabBegin,      /* xBegin */
-    0,              /* xSync */
+    VtabSync,       /* xSync */
     VtabCommit,     /* xCommit */
-    0,              /* xRollback */
+    VtabRollback,   /* xRollback */
     0,              /* xFindMethod */
     0,              /* xRename */
     0,              /* xSavepoint */
@@ -357,17 +634,25 @@ __declspec(dllexport)
   std::string db_file_name = "vtable.db";
   struct stat buffer;
   bool is_file_exist = (stat(db_file_name.c_str(), &buffer) == 0);
+  // page size of a new db file and buffer pool size
+  int page_size = DEFAULT_PAGE_SIZE;
+  if (const char *env = getenv("SCUDB_PAGE_SIZE"))
+    page_size = atoi(env);
+  if (const char *env = getenv("SCUDB_BUFFER_POOL_SIZE"))
+    BUFFER_POOL_SIZE = std::max(1, atoi(env));
 
   // init storage engine
-  storage_engine_ = new StorageEngine(db_file_name);
+  storage_engine_ = new StorageEngine(db_file_name, page_size);
   // start the logging
   storage_engine_->log_manager_->RunFlushThread();
   // create header page from BufferPoolManager if necessary
   if (!is_file_exist) {
     page_id_t header_page_id;
-    storage_engine_->buffer_pool_manager_->NewPage(header_page_id);
+    auto header_page = static_cast<HeaderPage *>(
+        storage_engine_->buffer_pool_manager_->NewPage(header_page_id));
 
     assert(header_page_id == HEADER_PAGE_ID);
+    header_page->Init();
     storage_engine_->buffer_pool_manager_->UnpinPage(header_page_id, true);
   }
 
@@ -443,8 +728,14 @@ IndexMetadata *ParseIndexStatement(std::string &sql,
   std::string index_name;
   std::vector<int> key_attrs;
   int column_id = -1;
+  bool is_unique = true;
   // prepocess, transform sql string into lower case
   std::transform(sql.begin(), sql.end(), sql.begin(), ::tolower);
+  // an index with more than one tuple per key: 'nonunique index_name columns'
+  if (sql.compare(0, 10, "nonunique ") == 0) {
+    is_unique = false;
+    sql = sql.substr(10);
+  }
   n = sql.find_first_of(' ');
   // NOTE: must use whitespace to seperate index name and indexed column names
   assert(n != std::string::npos);
@@ -463,12 +754,27 @@ IndexMetadata *ParseIndexStatement(std::string &sql,
     throw Exception(EXCEPTION_TYPE_INDEX, "can't create index, format error");
 
   IndexMetadata *metadata =
-      new IndexMetadata(index_name, table_name, schema, key_attrs);
+      new IndexMetadata(index_name, table_name, schema, key_attrs, is_unique);
 
   // LOG_DEBUG("%s", metadata->ToString().c_str());
   return metadata;
 }
 
+PageLayout ParseTableOptions(int argc, const char *const *argv,
+                             std::string &index_string) {
+  PageLayout layout = PageLayout::ROW;
+  for (int i = 4; i < argc; i++) {
+    std::string option(argv[i]);
+    // remove the very first and last character
+    option = option.substr(1, (option.size() - 2));
+    if (option == "pax")
+      layout = PageLayout::PAX;
+    else
+      index_string = option;
+  }
+  return layout;
+}
+
 Tuple ConstructTuple(Schema *schema, sqlite3_value **argv) {
   int column_count = schema->GetColumnCount();
   Value v(TypeId::INVALID);
@@ -510,9 +816,16 @@ Index *ConstructIndex(IndexMetadata *metadata,
                       page_id_t root_id) {
   // The size of the key in bytes
   Schema *key_schema = metadata->GetKeySchema();
-  int key_size = key_schema->GetLength();
-  // for each varchar attribute, we assume the largest size is 16 bytes
-  key_size += 16 * key_schema->GetUnlinedColumnCount();
+  int key_size;
+  if (KeyEncoder::IsEncodable(key_schema)) {
+    // stored in the order preserving encoding, varchars cut to
+    // KeyEncoder::VARCHAR_LENGTH bytes
+    key_size = KeyEncoder::GetEncodedLength(key_schema);
+  } else {
+    key_size = key_schema->GetLength();
+    // for each varchar attribute, we assume the largest size is 16 bytes
+    key_size += 16 * key_schema->GetUnlinedColumnCount();
+  }
 
   if (key_size <= 4) {
     return new BPlusTreeIndex<GenericKey<4>, RID, GenericComparator<4>>(
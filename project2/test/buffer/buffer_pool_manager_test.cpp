@@ -2,7 +2,18 @@
  * buffer_pool_manager_test.cpp
  */
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <random>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
 #include "gtest/gtest.h"
@@ -98,5 +109,666 @@ namespace scudb {
         remove("test.db");
     }
 
+    TEST(BufferPoolManagerTest, BackgroundWriterTest) {
+        page_id_t temp_page_id;
+
+        DiskManager *disk_manager = new DiskManager("test.db");
+        BufferPoolManager bpm(10, disk_manager);
+
+        // fill the pool with dirty, unpinned pages
+        for (int i = 0; i < 10; ++i) {
+            Page *page = bpm.NewPage(temp_page_id);
+            ASSERT_NE(nullptr, page);
+            snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+            EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, true));
+        }
+
+        // a single round stops at the batch size, and at the target once
+        // enough frames are clean
+        bpm.SetWriterTargetCleanRatio(0.5);
+        bpm.SetWriterBatchSize(3);
+        EXPECT_EQ(3, bpm.WriterRound());
+        EXPECT_EQ(2, bpm.WriterRound());
+        EXPECT_EQ(0, bpm.WriterRound());
+        EXPECT_EQ(5, bpm.GetWriterStats().pages_written_);
+
+        // the thread cleans the rest of the pool
+        bpm.SetWriterTargetCleanRatio(1.0);
+        bpm.SetWriterInterval(std::chrono::milliseconds(1));
+        bpm.RunWriterThread();
+        for (int i = 0; i < 1000 && bpm.GetWriterStats().pages_written_ < 10; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        bpm.StopWriterThread();
+        EXPECT_EQ(10, bpm.GetWriterStats().pages_written_);
+        EXPECT_LE(3, bpm.GetWriterStats().rounds_);
+
+        // so evicting all of them needs no write-back on the miss path
+        for (int i = 0; i < 10; ++i) {
+            EXPECT_NE(nullptr, bpm.NewPage(temp_page_id));
+            EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, false));
+        }
+        EXPECT_EQ(0, bpm.GetWriterStats().victim_writes_);
+
+        // and the content made it to disk
+        char data[PAGE_SIZE];
+        for (int i = 0; i < 10; ++i) {
+            Page *page = bpm.FetchPage(i);
+            ASSERT_NE(nullptr, page);
+            snprintf(data, PAGE_SIZE, "page %d", i);
+            EXPECT_EQ(0, strcmp(page->GetData(), data));
+            EXPECT_EQ(true, bpm.UnpinPage(i, false));
+        }
+
+        delete disk_manager;
+        remove("test.db");
+        remove("test.log");
+    }
+
+    TEST(BufferPoolManagerTest, CheckpointTest) {
+        page_id_t temp_page_id;
+
+        DiskManager *disk_manager = new DiskManager("test.db");
+        BufferPoolManager bpm(20, disk_manager, nullptr, 4);
+
+        // write every page, the last five stay pinned and are not dirty yet
+        for (int i = 0; i < 20; ++i) {
+            Page *page = bpm.NewPage(temp_page_id);
+            ASSERT_NE(nullptr, page);
+            snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+            if (i < 15) {
+                EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, true));
+            }
+        }
+        EXPECT_EQ(15, bpm.Checkpoint());
+        EXPECT_EQ(0, bpm.Checkpoint());
+
+        // dirty pages that are still pinned are written as well
+        for (int i = 15; i < 20; ++i) {
+            snprintf(bpm.FetchPage(i)->GetData(), PAGE_SIZE, "again %d", i);
+            EXPECT_EQ(true, bpm.UnpinPage(i, true));
+        }
+        EXPECT_EQ(5, bpm.FlushAllPages());
+        EXPECT_EQ(0, bpm.FlushAllPages());
+        for (int i = 15; i < 20; ++i) {
+            EXPECT_EQ(true, bpm.UnpinPage(i, false));
+        }
+
+        // read the file behind the pool's back
+        DiskManager *reader = new DiskManager("test.db");
+        char data[PAGE_SIZE];
+        char expected[PAGE_SIZE];
+        for (int i = 0; i < 20; ++i) {
+            reader->ReadPage(i, data);
+            snprintf(expected, PAGE_SIZE, i < 15 ? "page %d" : "again %d", i);
+            EXPECT_EQ(0, strcmp(data, expected));
+        }
+
+        delete reader;
+        delete disk_manager;
+        remove("test.db");
+        remove("test.log");
+    }
+
+    // threads update disjoint page counters through a partitioned pool that is
+    // a quarter of the data, then the counters are checked against the updates
+    static void ConcurrentUpdateTest(DiskIOMode io_mode) {
+        const int num_threads = 8;
+        const int num_pages = 256;
+        DiskManager *disk_manager = new DiskManager("test.db", io_mode);
+        BufferPoolManager bpm(64, disk_manager, nullptr, 4);
+        EXPECT_EQ(4, bpm.GetNumInstances());
+
+        page_id_t temp_page_id;
+        for (int i = 0; i < num_pages; ++i) {
+            Page *page = bpm.NewPage(temp_page_id);
+            ASSERT_NE(nullptr, page);
+            EXPECT_EQ(i, temp_page_id);
+            snprintf(page->GetData(), PAGE_SIZE, "page-%d", i);
+            bpm.UnpinPage(temp_page_id, true);
+        }
+
+        // every thread only updates the counters of its own pages, while all
+        // of them read every page, so misses keep evicting across instances
+        // every instance has more frames than there are threads, so no fetch fails
+        std::atomic<int> updates(0);
+        std::vector<std::thread> threads;
+        for (int tid = 0; tid < num_threads; ++tid) {
+            threads.push_back(std::thread([tid, &bpm, &updates]() {
+                std::mt19937 rng(tid);
+                for (int round = 0; round < 500; ++round) {
+                    page_id_t page_id = rng() % num_pages;
+                    Page *page = bpm.FetchPage(page_id);
+                    ASSERT_NE(nullptr, page);
+                    char expected[32];
+                    snprintf(expected, sizeof(expected), "page-%d", page_id);
+                    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+                    bool is_dirty = (page_id % num_threads == tid);
+                    if (is_dirty) {
+                        page->WLatch();
+                        (*reinterpret_cast<int *>(page->GetData() + 64))++;
+                        page->WUnlatch();
+                        updates++;
+                    }
+                    EXPECT_EQ(true, bpm.UnpinPage(page_id, is_dirty));
+                }
+            }));
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+
+        int total = 0;
+        for (int i = 0; i < num_pages; ++i) {
+            Page *page = bpm.FetchPage(i);
+            ASSERT_NE(nullptr, page);
+            total += *reinterpret_cast<int *>(page->GetData() + 64);
+            bpm.UnpinPage(i, false);
+        }
+        // no update may be lost by a write-back racing with a re-read
+        EXPECT_EQ(updates.load(), total);
+
+        delete disk_manager;
+        remove("test.db");
+        remove("test.log");
+    }
+
+    TEST(BufferPoolManagerTest, PartitionedConcurrentTest) {
+        ConcurrentUpdateTest(DiskIOMode::STREAM);
+    }
+
+    // same with pread/pwrite, where reads and write-backs really overlap
+    TEST(BufferPoolManagerTest, PositionalIOConcurrentTest) {
+        ConcurrentUpdateTest(DiskIOMode::POSITIONAL);
+    }
+
+    // and with O_DIRECT, frames are read and written in place
+    TEST(BufferPoolManagerTest, DirectIOConcurrentTest) {
+        ConcurrentUpdateTest(DiskIOMode::DIRECT);
+    }
+
+    // a new page goes to any instance with a frame, and the ids of failed
+    // tries are handed out later rather than lost
+    TEST(BufferPoolManagerTest, PartitionedNewPageTest) {
+        DiskManager *disk_manager = new DiskManager("test.db");
+        BufferPoolManager bpm(4, disk_manager, nullptr, 2);
+        page_id_t temp_page_id;
+        for (int i = 0; i < 4; ++i) {
+            ASSERT_NE(nullptr, bpm.NewPage(temp_page_id));
+            EXPECT_EQ(i, temp_page_id);
+        }
+        // only the instance of odd page ids has a victim
+        EXPECT_EQ(true, bpm.UnpinPage(1, false));
+        ASSERT_NE(nullptr, bpm.NewPage(temp_page_id));
+        EXPECT_EQ(5, temp_page_id);
+        for (int i = 0; i < 3; ++i) {
+            EXPECT_EQ(nullptr, bpm.NewPage(temp_page_id));
+        }
+
+        EXPECT_EQ(true, bpm.UnpinPage(0, false));
+        ASSERT_NE(nullptr, bpm.NewPage(temp_page_id));
+        EXPECT_EQ(4, temp_page_id);
+        for (page_id_t page_id : {2, 3, 4, 5}) {
+            EXPECT_EQ(true, bpm.UnpinPage(page_id, false));
+        }
+        for (int i = 6; i < 10; ++i) {
+            ASSERT_NE(nullptr, bpm.NewPage(temp_page_id));
+            EXPECT_EQ(i, temp_page_id);
+        }
+
+        delete disk_manager;
+        remove("test.db");
+        remove("test.log");
+    }
+
+    // several misses read together, including ids repeated in the batch and
+    // dirty victims written back first
+    static void FetchPagesTest(DiskIOMode io_mode) {
+        DiskManager *disk_manager = new DiskManager("test.db", io_mode);
+        BufferPoolManager bpm(10, disk_manager, nullptr, 2);
+        page_id_t temp_page_id;
+        for (int i = 0; i < 40; ++i) {
+            Page *page = bpm.NewPage(temp_page_id);
+            ASSERT_NE(nullptr, page);
+            snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+            EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, true));
+        }
+
+        std::vector<page_id_t> page_ids{0, 1, 2, 3, 2, 4, 5, 0};
+        std::vector<Page *> pages;
+        EXPECT_EQ(true, bpm.FetchPages(page_ids, pages));
+        char expected[PAGE_SIZE];
+        for (size_t i = 0; i < page_ids.size(); ++i) {
+            ASSERT_NE(nullptr, pages[i]);
+            EXPECT_EQ(page_ids[i], pages[i]->GetPageId());
+            snprintf(expected, PAGE_SIZE, "page %d", page_ids[i]);
+            EXPECT_EQ(0, strcmp(pages[i]->GetData(), expected));
+        }
+        EXPECT_EQ(pages[0], pages[7]);
+        EXPECT_EQ(2, pages[0]->GetPinCount());
+        for (size_t i = 0; i < page_ids.size(); ++i) {
+            snprintf(pages[i]->GetData(), PAGE_SIZE, "again %d", page_ids[i]);
+            EXPECT_EQ(true, bpm.UnpinPage(page_ids[i], true));
+        }
+
+        // evicts the dirty pages just written
+        page_ids = {10, 11, 12, 13, 14, 15, 16, 17, 18, 19};
+        EXPECT_EQ(true, bpm.FetchPages(page_ids, pages));
+        for (size_t i = 0; i < page_ids.size(); ++i) {
+            snprintf(expected, PAGE_SIZE, "page %d", page_ids[i]);
+            EXPECT_EQ(0, strcmp(pages[i]->GetData(), expected));
+            EXPECT_EQ(true, bpm.UnpinPage(page_ids[i], false));
+        }
+        for (page_id_t page_id = 0; page_id < 6; ++page_id) {
+            Page *page = bpm.FetchPage(page_id);
+            snprintf(expected, PAGE_SIZE, "again %d", page_id);
+            EXPECT_EQ(0, strcmp(page->GetData(), expected));
+            EXPECT_EQ(true, bpm.UnpinPage(page_id, false));
+        }
+
+        // an instance only has 5 frames
+        page_ids = {20, 22, 24, 26, 28, 30};
+        EXPECT_EQ(false, bpm.FetchPages(page_ids, pages));
+        EXPECT_EQ(nullptr, pages[5]);
+        for (size_t i = 0; i < 5; ++i) {
+            EXPECT_EQ(true, bpm.UnpinPage(page_ids[i], false));
+        }
+
+        delete disk_manager;
+        remove("test.db");
+        remove("test.log");
+    }
+
+    TEST(BufferPoolManagerTest, FetchPagesTest) {
+        FetchPagesTest(DiskIOMode::STREAM);
+        FetchPagesTest(DiskIOMode::POSITIONAL);
+        FetchPagesTest(DiskIOMode::DIRECT);
+    }
+
+    // two threads fetch the same batches of misses in opposite orders, each
+    // one has to wait for pages the other claimed without holding up its own
+    TEST(BufferPoolManagerTest, ConcurrentFetchPagesTest) {
+        const int num_pages = 64;
+        const int batch_size = 8;
+        DiskManager *disk_manager = new DiskManager("test.db", DiskIOMode::POSITIONAL);
+        BufferPoolManager bpm(2 * batch_size, disk_manager);
+        page_id_t temp_page_id;
+        for (int i = 0; i < num_pages; ++i) {
+            Page *page = bpm.NewPage(temp_page_id);
+            ASSERT_NE(nullptr, page);
+            snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+            EXPECT_EQ(true, bpm.UnpinPage(temp_page_id, true));
+        }
+
+        std::vector<std::thread> threads;
+        for (int tid = 0; tid < 2; ++tid) {
+            threads.push_back(std::thread([tid, &bpm]() {
+                std::vector<page_id_t> page_ids(batch_size);
+                std::vector<Page *> pages;
+                char expected[PAGE_SIZE];
+                for (int round = 0; round < 200; ++round) {
+                    int first = round * batch_size % num_pages;
+                    for (int i = 0; i < batch_size; ++i) {
+                        page_ids[i] = first + (tid == 0 ? i : batch_size - 1 - i);
+                    }
+                    EXPECT_EQ(true, bpm.FetchPages(page_ids, pages));
+                    for (int i = 0; i < batch_size; ++i) {
+                        ASSERT_NE(nullptr, pages[i]);
+                        snprintf(expected, PAGE_SIZE, "page %d", page_ids[i]);
+                        EXPECT_EQ(0, strcmp(pages[i]->GetData(), expected));
+                        EXPECT_EQ(true, bpm.UnpinPage(page_ids[i], false));
+                    }
+                }
+            }));
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+
+        delete disk_manager;
+        remove("test.db");
+        remove("test.log");
+    }
+
+    /*
+     * Fetch throughput of a single global pool versus a partitioned one.
+     * Run with --gtest_also_run_disabled_tests
+     */
+    TEST(BufferPoolManagerTest, DISABLED_ConcurrentFetchBenchmark) {
+        const int pool_size = 512;
+        const int num_pages = 1024;
+        const int ops_per_thread = 200000;
+
+        for (size_t num_instances : {1, 16}) {
+            DiskManager *disk_manager = new DiskManager("test.db");
+            BufferPoolManager bpm(pool_size, disk_manager, nullptr, num_instances);
+            page_id_t temp_page_id;
+            for (int i = 0; i < num_pages; ++i) {
+                bpm.NewPage(temp_page_id);
+                bpm.UnpinPage(temp_page_id, true);
+            }
+
+            for (int num_threads : {1, 2, 4, 8, 16, 32}) {
+                std::vector<std::thread> threads;
+                auto start = std::chrono::steady_clock::now();
+                for (int tid = 0; tid < num_threads; ++tid) {
+                    threads.push_back(std::thread([tid, &bpm]() {
+                        std::mt19937 rng(tid);
+                        // 90% of the fetches go to the hot half of the pool
+                        for (int i = 0; i < ops_per_thread; ++i) {
+                            page_id_t page_id = (rng() % 10 != 0)
+                                                ? rng() % (pool_size / 2)
+                                                : rng() % num_pages;
+                            if (bpm.FetchPage(page_id) != nullptr) {
+                                bpm.UnpinPage(page_id, false);
+                            }
+                        }
+                    }));
+                }
+                for (auto &thread : threads) {
+                    thread.join();
+                }
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                std::cout << "instances " << num_instances << " threads " << num_threads
+                          << ": " << static_cast<long>(num_threads * ops_per_thread / elapsed.count())
+                          << " fetches/sec" << std::endl;
+            }
+            delete disk_manager;
+            remove("test.db");
+            remove("test.log");
+        }
+    }
+
+    // drives every replacement policy with a point-heavy trace (90% of the
+    // fetches hit a hot set of half the pool) and a scan-heavy trace (every
+    // other fetch continues a sequential scan over four times the pool)
+    TEST(BufferPoolManagerTest, DISABLED_ReplacerBenchmark) {
+        const int pool_size = 256;
+        const int num_pages = 4 * pool_size;
+        const int hot_pages = pool_size / 2;
+        const int num_ops = 200000;
+        const char *policy_names[] = {"LRU", "CLOCK", "LRU_K"};
+        const ReplacerType policies[] = {ReplacerType::LRU, ReplacerType::CLOCK,
+                                         ReplacerType::LRU_K};
+
+        // bare replacer cost: evict the coldest frame and release it again
+        for (int p = 0; p < 3; ++p) {
+            Page *frames = new Page[pool_size];
+            Replacer<Page *> *replacer;
+            if (policies[p] == ReplacerType::CLOCK) {
+                replacer = new ClockReplacer(frames, pool_size);
+            } else if (policies[p] == ReplacerType::LRU_K) {
+                replacer = new LRUKReplacer(frames, pool_size);
+            } else {
+                replacer = new LRUReplacer<Page *>;
+            }
+            for (int i = 0; i < pool_size; ++i) {
+                replacer->Insert(&frames[i]);
+            }
+            std::mt19937 rng(0);
+            Page *victim = nullptr;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < num_ops; ++i) {
+                Page *hot = &frames[rng() % pool_size];
+                if (replacer->Erase(hot)) {
+                    replacer->Insert(hot);
+                }
+                replacer->Victim(victim);
+                replacer->Insert(victim);
+            }
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            std::cout << policy_names[p] << " replacer: "
+                      << static_cast<long>(num_ops / elapsed.count()) << " ops/sec" << std::endl;
+            delete replacer;
+            delete[] frames;
+        }
+
+        for (int scan_heavy = 0; scan_heavy < 2; ++scan_heavy) {
+            for (int p = 0; p < 3; ++p) {
+                DiskManager *disk_manager = new DiskManager("test.db");
+                BufferPoolManager bpm(pool_size, disk_manager, nullptr, 1, policies[p]);
+                page_id_t temp_page_id;
+                for (int i = 0; i < num_pages; ++i) {
+                    bpm.NewPage(temp_page_id);
+                    bpm.UnpinPage(temp_page_id, true);
+                }
+
+                std::mt19937 rng(0);
+                page_id_t scan_cursor = 0;
+                size_t hits = bpm.GetHitCount();
+                size_t misses = bpm.GetMissCount();
+                auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < num_ops; ++i) {
+                    page_id_t page_id;
+                    if (scan_heavy && i % 2 == 0) {
+                        page_id = scan_cursor;
+                        scan_cursor = (scan_cursor + 1) % num_pages;
+                    } else {
+                        page_id = (rng() % 10 != 0) ? rng() % hot_pages : rng() % num_pages;
+                    }
+                    if (bpm.FetchPage(page_id) != nullptr) {
+                        bpm.UnpinPage(page_id, false);
+                    }
+                }
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                hits = bpm.GetHitCount() - hits;
+                misses = bpm.GetMissCount() - misses;
+                std::cout << (scan_heavy ? "scan-heavy " : "point-heavy ") << policy_names[p]
+                          << ": " << static_cast<long>(num_ops / elapsed.count())
+                          << " fetches/sec, hit rate " << 100.0 * hits / (hits + misses)
+                          << "%" << std::endl;
+                delete disk_manager;
+                remove("test.db");
+                remove("test.log");
+            }
+        }
+    }
+
+    // dirty the whole pool in random order, then write it back page by page
+    // with FlushPage in that order, or with one sorted Checkpoint
+    // next page id of the chain used by PrefetchChainTest, kept in the first
+    // bytes of the page
+    static page_id_t NextTestPageId(Page *page) {
+        return *reinterpret_cast<page_id_t *>(page->GetData());
+    }
+
+    // the prefetcher follows the links of a chain that jumps around the file
+    TEST(BufferPoolManagerTest, PrefetchChainTest) {
+        const int num_pages = 40;
+        DiskManager *disk_manager = new DiskManager("test.db");
+        BufferPoolManager *bpm = new BufferPoolManager(20, disk_manager);
+        page_id_t temp_page_id;
+        for (int i = 0; i < num_pages; ++i) {
+            Page *page = bpm->NewPage(temp_page_id);
+            ASSERT_NE(nullptr, page);
+            // 0 -> 7 -> 14 -> ... -> 35 -> 2 -> ...
+            *reinterpret_cast<page_id_t *>(page->GetData()) = (i + 7) % num_pages;
+            EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+        }
+        bpm->FlushAllPages();
+        delete bpm;
+
+        bpm = new BufferPoolManager(20, disk_manager);
+        bpm->PrefetchChain(0, 10, NextTestPageId);
+        bpm->WaitForPrefetch();
+        EXPECT_EQ(10, bpm->GetPrefetchCount());
+        EXPECT_EQ(0, bpm->GetHitCount() + bpm->GetMissCount());
+        page_id_t page_id = 0;
+        for (int i = 0; i < 10; ++i) {
+            Page *page = bpm->FetchPage(page_id);
+            ASSERT_NE(nullptr, page);
+            EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+            page_id = NextTestPageId(page);
+        }
+        EXPECT_EQ(10, bpm->GetHitCount());
+        EXPECT_EQ(0, bpm->GetMissCount());
+
+        // cached pages are walked over, not read again
+        bpm->PrefetchChain(0, 12, NextTestPageId);
+        bpm->WaitForPrefetch();
+        EXPECT_EQ(12, bpm->GetPrefetchCount());
+
+        delete bpm;
+        delete disk_manager;
+        remove("test.db");
+        remove("test.log");
+    }
+
+    // named pages are read as one batch, the cached ones are left alone
+    TEST(BufferPoolManagerTest, PrefetchPagesTest) {
+        DiskManager *disk_manager = new DiskManager("test.db", DiskIOMode::POSITIONAL);
+        BufferPoolManager *bpm = new BufferPoolManager(20, disk_manager, nullptr, 2);
+        page_id_t temp_page_id;
+        for (int i = 0; i < 40; ++i) {
+            Page *page = bpm->NewPage(temp_page_id);
+            ASSERT_NE(nullptr, page);
+            snprintf(page->GetData(), PAGE_SIZE, "page %d", i);
+            EXPECT_EQ(true, bpm->UnpinPage(temp_page_id, true));
+        }
+        bpm->FlushAllPages();
+        delete bpm;
+
+        bpm = new BufferPoolManager(20, disk_manager, nullptr, 2);
+        Page *page = bpm->FetchPage(5);
+        ASSERT_NE(nullptr, page);
+        EXPECT_EQ(true, bpm->UnpinPage(5, false));
+        std::vector<page_id_t> page_ids{3, 4, 5, 6, 7, 30, 31, 32};
+        bpm->PrefetchPages(page_ids);
+        bpm->WaitForPrefetch();
+        EXPECT_EQ(7, bpm->GetPrefetchCount());
+        char expected[PAGE_SIZE];
+        for (page_id_t page_id : page_ids) {
+            page = bpm->FetchPage(page_id);
+            ASSERT_NE(nullptr, page);
+            snprintf(expected, PAGE_SIZE, "page %d", page_id);
+            EXPECT_EQ(0, strcmp(page->GetData(), expected));
+            EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+        }
+        EXPECT_EQ(8, bpm->GetHitCount());
+        EXPECT_EQ(1, bpm->GetMissCount());
+
+        delete bpm;
+        delete disk_manager;
+        remove("test.db");
+        remove("test.log");
+    }
+
+    TEST(BufferPoolManagerTest, DISABLED_CheckpointBenchmark) {
+        const int pool_size = 8192;
+
+        for (int use_checkpoint = 0; use_checkpoint < 2; ++use_checkpoint) {
+            DiskManager *disk_manager = new DiskManager("test.db");
+            BufferPoolManager bpm(pool_size, disk_manager, nullptr, 8);
+            std::vector<page_id_t> page_ids(pool_size);
+            for (int i = 0; i < pool_size; ++i) {
+                bpm.NewPage(page_ids[i]);
+                bpm.UnpinPage(page_ids[i], false);
+            }
+            std::shuffle(page_ids.begin(), page_ids.end(), std::mt19937(0));
+            for (page_id_t page_id : page_ids) {
+                snprintf(bpm.FetchPage(page_id)->GetData(), PAGE_SIZE, "page %d", page_id);
+                bpm.UnpinPage(page_id, true);
+            }
+
+            size_t written = 0;
+            auto start = std::chrono::steady_clock::now();
+            if (use_checkpoint) {
+                written = bpm.Checkpoint();
+            } else {
+                for (page_id_t page_id : page_ids) {
+                    written += bpm.FlushPage(page_id) ? 1 : 0;
+                }
+            }
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            std::cout << (use_checkpoint ? "Checkpoint" : "FlushPage loop") << ": "
+                      << written << " pages in " << elapsed.count() * 1000 << " ms, "
+                      << static_cast<long>(written / elapsed.count()) << " pages/sec"
+                      << std::endl;
+            delete disk_manager;
+            remove("test.db");
+            remove("test.log");
+        }
+    }
+
+    // resident set size of this process in bytes
+    static long ResidentBytes() {
+        long total = 0, resident = 0;
+        std::ifstream statm("/proc/self/statm");
+        statm >> total >> resident;
+        return resident * sysconf(_SC_PAGESIZE);
+    }
+
+    // bytes of file_name the kernel holds in its page cache
+    static long PageCacheBytes(const char *file_name) {
+        int fd = open(file_name, O_RDONLY);
+        off_t size = lseek(fd, 0, SEEK_END);
+        long page = sysconf(_SC_PAGESIZE);
+        void *map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        std::vector<unsigned char> in_core((size + page - 1) / page);
+        mincore(map, size, in_core.data());
+        long cached = 0;
+        for (unsigned char c : in_core) {
+            cached += (c & 1) ? page : 0;
+        }
+        munmap(map, size);
+        close(fd);
+        return cached;
+    }
+
+    /*
+     * Random fetches (one in ten dirtying the page) over a db four times
+     * larger than the pool, buffered pread/pwrite versus O_DIRECT with the
+     * same pool size. With buffered I/O the pages are cached a second time by
+     * the kernel, O_DIRECT leaves the page cache alone. Every mode runs in a
+     * child process, so the resident sizes do not mix.
+     * Run with --gtest_also_run_disabled_tests
+     */
+    TEST(BufferPoolManagerTest, DISABLED_DirectIOBenchmark) {
+        const int pool_size = 8192;
+        const int num_pages = pool_size * 4;
+        const int num_fetches = 200000;
+
+        for (DiskIOMode io_mode : {DiskIOMode::POSITIONAL, DiskIOMode::DIRECT}) {
+            {
+                // start from a db file that is not cached
+                DiskManager disk_manager("test.db", DiskIOMode::POSITIONAL);
+                PageBuffer data(num_pages);
+                disk_manager.WritePages(0, data.GetData(), num_pages);
+                int fd = open("test.db", O_RDONLY);
+                fsync(fd);
+                posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+                close(fd);
+            }
+            pid_t pid = fork();
+            if (pid != 0) {
+                waitpid(pid, nullptr, 0);
+                remove("test.db");
+                remove("test.log");
+                continue;
+            }
+            DiskManager *disk_manager = new DiskManager("test.db", io_mode);
+            BufferPoolManager bpm(pool_size, disk_manager, nullptr, 8);
+            std::mt19937 rng(0);
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < num_fetches; ++i) {
+                page_id_t page_id = rng() % num_pages;
+                Page *page = bpm.FetchPage(page_id);
+                bool is_dirty = (i % 10 == 0);
+                if (is_dirty) {
+                    page->GetData()[0]++;
+                }
+                bpm.UnpinPage(page_id, is_dirty);
+            }
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            std::cout << (disk_manager->GetIOMode() == DiskIOMode::DIRECT ? "direct" : "buffered")
+                      << ": " << static_cast<long>(num_fetches / elapsed.count())
+                      << " fetches/sec, hit rate "
+                      << bpm.GetHitCount() * 100 / num_fetches << "%, RSS "
+                      << ResidentBytes() / 1024 << " KB, page cache "
+                      << PageCacheBytes("test.db") / 1024 << " KB" << std::endl;
+            delete disk_manager;
+            _exit(0);
+        }
+    }
 
 } // namespace cmudb
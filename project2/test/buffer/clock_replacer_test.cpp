@@ -0,0 +1,49 @@
+/**
+ * clock_replacer_test.cpp
+ */
+
+#include <cstdio>
+
+#include "buffer/clock_replacer.h"
+#include "gtest/gtest.h"
+
+namespace scudb {
+
+    TEST(ClockReplacerTest, SampleTest) {
+        Page frames[6];
+        ClockReplacer clock_replacer(frames, 6);
+
+        // push frames into replacer, inserting twice does not count twice
+        for (int i = 0; i < 6; i++) {
+            clock_replacer.Insert(&frames[i]);
+        }
+        clock_replacer.Insert(&frames[0]);
+        EXPECT_EQ(6, clock_replacer.Size());
+
+        // every frame has its reference bit set, so the first sweep only
+        // clears them and the hand stops at frame 0 on the second turn
+        Page *value = nullptr;
+        EXPECT_EQ(true, clock_replacer.Victim(value));
+        EXPECT_EQ(&frames[0], value);
+        EXPECT_EQ(true, clock_replacer.Victim(value));
+        EXPECT_EQ(&frames[1], value);
+
+        // a frame referenced again gets a second chance
+        clock_replacer.Insert(&frames[2]);
+        EXPECT_EQ(true, clock_replacer.Victim(value));
+        EXPECT_EQ(&frames[3], value);
+
+        // remove frames from replacer
+        EXPECT_EQ(false, clock_replacer.Erase(&frames[3]));
+        EXPECT_EQ(true, clock_replacer.Erase(&frames[4]));
+        EXPECT_EQ(2, clock_replacer.Size());
+
+        EXPECT_EQ(true, clock_replacer.Victim(value));
+        EXPECT_EQ(&frames[5], value);
+        EXPECT_EQ(true, clock_replacer.Victim(value));
+        EXPECT_EQ(&frames[2], value);
+        EXPECT_EQ(0, clock_replacer.Size());
+        EXPECT_EQ(false, clock_replacer.Victim(value));
+    }
+
+} // namespace scudb
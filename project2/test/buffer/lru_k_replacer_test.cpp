@@ -0,0 +1,57 @@
+/**
+ * lru_k_replacer_test.cpp
+ */
+
+#include <cstdio>
+
+#include "buffer/lru_k_replacer.h"
+#include "gtest/gtest.h"
+
+namespace scudb {
+
+    TEST(LRUKReplacerTest, SampleTest) {
+        Page frames[6];
+        LRUKReplacer lru_k_replacer(frames, 6, 2);
+
+        // frames 0..3 are accessed once, frames 4 and 5 twice
+        for (int i = 0; i < 6; i++) {
+            lru_k_replacer.Insert(&frames[i]);
+        }
+        lru_k_replacer.Insert(&frames[5]);
+        lru_k_replacer.Insert(&frames[4]);
+        EXPECT_EQ(6, lru_k_replacer.Size());
+
+        // frames with a single access go first, oldest first
+        Page *value = nullptr;
+        EXPECT_EQ(true, lru_k_replacer.Victim(value));
+        EXPECT_EQ(&frames[0], value);
+        EXPECT_EQ(true, lru_k_replacer.Victim(value));
+        EXPECT_EQ(&frames[1], value);
+
+        // pinning a frame takes it out, releasing it again counts as an access
+        EXPECT_EQ(true, lru_k_replacer.Erase(&frames[2]));
+        EXPECT_EQ(false, lru_k_replacer.Erase(&frames[2]));
+        lru_k_replacer.Insert(&frames[2]);
+        EXPECT_EQ(4, lru_k_replacer.Size());
+
+        EXPECT_EQ(true, lru_k_replacer.Victim(value));
+        EXPECT_EQ(&frames[3], value);
+
+        // all remaining frames have two accesses: the one whose second most
+        // recent access is the oldest goes first (5: ts 6, 4: ts 5, 2: ts 3)
+        EXPECT_EQ(true, lru_k_replacer.Victim(value));
+        EXPECT_EQ(&frames[2], value);
+        EXPECT_EQ(true, lru_k_replacer.Victim(value));
+        EXPECT_EQ(&frames[4], value);
+
+        // an evicted frame starts over with an empty history
+        lru_k_replacer.Insert(&frames[0]);
+        EXPECT_EQ(true, lru_k_replacer.Victim(value));
+        EXPECT_EQ(&frames[0], value);
+        EXPECT_EQ(true, lru_k_replacer.Victim(value));
+        EXPECT_EQ(&frames[5], value);
+        EXPECT_EQ(0, lru_k_replacer.Size());
+        EXPECT_EQ(false, lru_k_replacer.Victim(value));
+    }
+
+} // namespace scudb
@@ -0,0 +1,70 @@
+/**
+ * compression_test.cpp
+ */
+
+#include <string>
+#include <vector>
+
+#include "common/compression.h"
+#include "gtest/gtest.h"
+
+namespace scudb {
+
+static std::string RoundTrip(const std::string &raw, int &compressed_size) {
+  // incompressible input grows by a control byte per 8 bytes
+  std::vector<char> compressed(raw.size() + raw.size() / 8 + 32);
+  compressed_size = LzCompress(raw.data(), raw.size(), compressed.data(),
+                               compressed.size());
+  EXPECT_GT(compressed_size, 0);
+  std::string decompressed(raw.size(), '\0');
+  EXPECT_TRUE(LzDecompress(compressed.data(), compressed_size,
+                           &decompressed[0], raw.size()));
+  return decompressed;
+}
+
+TEST(CompressionTest, RoundTripTest) {
+  int size;
+  // runs, matches overlapping what they copy
+  std::string run(5000, 'a');
+  EXPECT_TRUE(run == RoundTrip(run, size));
+  EXPECT_LT(size, 5000 / 50);
+
+  std::string text;
+  for (int i = 0; i < 300; i++)
+    text += "row " + std::to_string(i) + " of the table; ";
+  EXPECT_TRUE(text == RoundTrip(text, size));
+  EXPECT_LT(size, static_cast<int>(text.size()) / 2);
+
+  std::string noise;
+  unsigned seed = 7;
+  for (int i = 0; i < 5000; i++) {
+    seed = seed * 1103515245 + 12345;
+    noise += static_cast<char>(seed >> 16);
+  }
+  EXPECT_TRUE(noise == RoundTrip(noise, size));
+  // does not fit unless it gets smaller
+  std::vector<char> compressed(noise.size());
+  EXPECT_EQ(-1, LzCompress(noise.data(), noise.size(), compressed.data(),
+                           noise.size() - 1));
+
+  std::string tiny = "ab";
+  EXPECT_TRUE(tiny == RoundTrip(tiny, size));
+}
+
+TEST(CompressionTest, CorruptTest) {
+  std::string raw(1000, 'x');
+  std::vector<char> compressed(raw.size());
+  int size = LzCompress(raw.data(), raw.size(), compressed.data(),
+                        compressed.size());
+  ASSERT_GT(size, 0);
+  std::vector<char> out(raw.size() + 1);
+  // a size other than the one compressed, a truncated input, or a match
+  // reaching before the start
+  EXPECT_FALSE(LzDecompress(compressed.data(), size, out.data(), 999));
+  EXPECT_FALSE(LzDecompress(compressed.data(), size, out.data(), 1001));
+  EXPECT_FALSE(LzDecompress(compressed.data(), size - 1, out.data(), 1000));
+  char bad[] = {1, 0x10, 0x00};
+  EXPECT_FALSE(LzDecompress(bad, sizeof(bad), out.data(), 10));
+}
+
+} // namespace scudb
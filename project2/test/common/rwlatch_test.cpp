@@ -0,0 +1,130 @@
+/**
+ * rwlatch_test.cpp
+ */
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "common/rwlatch.h"
+#include "common/rwmutex.h"
+#include "gtest/gtest.h"
+
+namespace scudb {
+
+TEST(RWLatchTest, BasicTest) {
+  RWLatch latch;
+  int count = 0;
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < 8; tid++) {
+    threads.emplace_back([tid, &latch, &count]() {
+      for (int i = 0; i < 20000; i++) {
+        if ((tid + i) % 4 == 0) {
+          latch.WLock();
+          count++;
+          latch.WUnlock();
+        } else {
+          latch.RLock();
+          EXPECT_LE(0, count);
+          latch.RUnlock();
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(8 * 20000 / 4, count);
+}
+
+TEST(RWLatchTest, TryLockTest) {
+  RWLatch latch;
+  EXPECT_TRUE(latch.TryRLock());
+  EXPECT_TRUE(latch.TryRLock());
+  EXPECT_FALSE(latch.TryWLock());
+  latch.RUnlock();
+  latch.RUnlock();
+  EXPECT_TRUE(latch.TryWLock());
+  EXPECT_FALSE(latch.TryRLock());
+  EXPECT_FALSE(latch.TryWLock());
+  latch.WUnlock();
+  EXPECT_TRUE(latch.TryRLock());
+  latch.RUnlock();
+}
+
+// once a writer waits for the readers, new readers wait for the writer
+TEST(RWLatchTest, WriterPreferenceTest) {
+  RWLatch latch;
+  std::atomic<bool> written(false);
+  latch.RLock();
+  std::thread writer([&]() {
+    latch.WLock();
+    written = true;
+    latch.WUnlock();
+  });
+  while (latch.TryRLock()) {
+    latch.RUnlock();
+    std::this_thread::yield();
+  }
+  EXPECT_FALSE(written);
+  std::thread reader([&]() {
+    latch.RLock();
+    EXPECT_TRUE(written);
+    latch.RUnlock();
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  latch.RUnlock();
+  writer.join();
+  reader.join();
+}
+
+template <typename Latch>
+static void LatchBenchmark(const char *name, int write_percent) {
+  for (int num_threads : {1, 2, 4, 8}) {
+    Latch latch;
+    int64_t value = 0;
+    std::atomic<int64_t> ops(0);
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> threads;
+    for (int tid = 0; tid < num_threads; tid++) {
+      threads.emplace_back([&]() {
+        int64_t count = 0;
+        for (; !stop; count++) {
+          if (count % 100 < write_percent) {
+            latch.WLock();
+            value++;
+            latch.WUnlock();
+          } else {
+            latch.RLock();
+            EXPECT_LE(0, value);
+            latch.RUnlock();
+          }
+        }
+        ops += count;
+      });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    stop = true;
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    std::cout << name << ", " << write_percent << "% writes, " << num_threads
+              << " threads: " << ops.load() * 2 / 1000000 << "M ops/s"
+              << std::endl;
+  }
+}
+
+/*
+ * Lock and unlock pairs per second on one latch, RWMutex against RWLatch.
+ * Run with --gtest_also_run_disabled_tests
+ */
+TEST(RWLatchTest, DISABLED_ContentionBenchmark) {
+  for (int write_percent : {0, 10}) {
+    LatchBenchmark<RWMutex>("RWMutex", write_percent);
+    LatchBenchmark<RWLatch>("RWLatch", write_percent);
+  }
+}
+
+} // namespace scudb
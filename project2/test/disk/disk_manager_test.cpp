@@ -0,0 +1,163 @@
+/**
+ * disk_manager_test.cpp
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "disk/disk_manager.h"
+#include "disk/page_buffer.h"
+#include "page/header_page.h"
+#include "gtest/gtest.h"
+
+namespace scudb {
+
+// write a batch asynchronously, read it back synchronously, then read it
+// asynchronously and collect the completions by polling
+static void AsyncIOTest(DiskIOMode io_mode) {
+  const int num_pages = 100;
+  DiskManager *disk_manager = new DiskManager("test.db", io_mode);
+  PageBuffer out_buffer(num_pages);
+  PageBuffer in_buffer(num_pages);
+  char *out = out_buffer.GetData();
+  char *in = in_buffer.GetData();
+  std::vector<AsyncIORequest> requests;
+  for (int i = 0; i < num_pages; ++i) {
+    snprintf(&out[i * PAGE_SIZE], PAGE_SIZE, "page %d", i);
+    requests.push_back({true, i, &out[i * PAGE_SIZE], 0});
+  }
+  disk_manager->SubmitBatch(requests);
+  std::vector<uint64_t> tags;
+  for (auto &request : requests) {
+    tags.push_back(request.tag_);
+  }
+  disk_manager->WaitFor(tags);
+
+  for (int i = 0; i < num_pages; ++i) {
+    disk_manager->ReadPage(i, &in[i * PAGE_SIZE]);
+    EXPECT_EQ(0, memcmp(&out[i * PAGE_SIZE], &in[i * PAGE_SIZE], PAGE_SIZE));
+  }
+
+  // read them back in reverse order
+  memset(in, 0, num_pages * PAGE_SIZE);
+  for (int i = 0; i < num_pages; ++i) {
+    disk_manager->SubmitRead(num_pages - 1 - i, &in[i * PAGE_SIZE]);
+  }
+  tags.clear();
+  while (tags.size() < num_pages) {
+    disk_manager->PollCompletions(tags, 1);
+  }
+  EXPECT_EQ(num_pages, tags.size());
+  for (int i = 0; i < num_pages; ++i) {
+    EXPECT_EQ(0, memcmp(&out[(num_pages - 1 - i) * PAGE_SIZE],
+                        &in[i * PAGE_SIZE], PAGE_SIZE));
+  }
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// a STREAM disk manager has no file descriptor for io_uring
+TEST(DiskManagerTest, StreamAsyncIOTest) {
+  AsyncIOTest(DiskIOMode::STREAM);
+  DiskManager disk_manager("test.db", DiskIOMode::STREAM);
+  EXPECT_STREQ("thread pool", disk_manager.GetAsyncIOEngineName());
+  remove("test.db");
+  remove("test.log");
+}
+
+// io_uring where the kernel has it, the thread pool otherwise
+TEST(DiskManagerTest, PositionalAsyncIOTest) {
+  AsyncIOTest(DiskIOMode::POSITIONAL);
+  DiskManager disk_manager("test.db", DiskIOMode::POSITIONAL);
+  std::string engine = disk_manager.GetAsyncIOEngineName();
+  EXPECT_TRUE(engine == "io_uring" || engine == "thread pool") << engine;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(DiskManagerTest, DirectAsyncIOTest) { AsyncIOTest(DiskIOMode::DIRECT); }
+
+// unaligned buffers still work in DIRECT mode, through an aligned copy. A
+// file system without O_DIRECT falls back to POSITIONAL
+TEST(DiskManagerTest, DirectIOUnalignedTest) {
+  DiskManager disk_manager("test.db", DiskIOMode::DIRECT);
+  EXPECT_TRUE(disk_manager.GetIOMode() == DiskIOMode::DIRECT ||
+              disk_manager.GetIOMode() == DiskIOMode::POSITIONAL);
+  std::vector<char> out(PAGE_SIZE * 3 + 1);
+  std::vector<char> in(PAGE_SIZE + 1);
+  for (size_t i = 0; i < out.size(); ++i) {
+    out[i] = static_cast<char>(i * 7);
+  }
+  disk_manager.WritePages(0, &out[1], 3);
+  for (int i = 0; i < 3; ++i) {
+    disk_manager.ReadPage(i, &in[1]);
+    EXPECT_EQ(0, memcmp(&out[1 + i * PAGE_SIZE], &in[1], PAGE_SIZE));
+  }
+  remove("test.db");
+  remove("test.log");
+}
+
+// the page size a db file is created with is kept in its header page and
+// used again when the file is reopened
+TEST(DiskManagerTest, PageSizeTest) {
+  DiskManager *disk_manager =
+      new DiskManager("test.db", DiskIOMode::STREAM, 16384);
+  EXPECT_EQ(16384, PAGE_SIZE);
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager);
+  page_id_t header_page_id;
+  auto header_page = static_cast<HeaderPage *>(bpm->NewPage(header_page_id));
+  ASSERT_NE(nullptr, header_page);
+  header_page->Init();
+  // 16K hold far more records than 4K
+  int num_records = 0;
+  while (header_page->InsertRecord(std::to_string(num_records), 1)) {
+    num_records++;
+  }
+  EXPECT_EQ((16384 - 16) / 36, num_records);
+  bpm->UnpinPage(header_page_id, true);
+  bpm->FlushAllPages();
+  delete bpm;
+  delete disk_manager;
+
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(16384, PAGE_SIZE);
+  bpm = new BufferPoolManager(10, disk_manager);
+  header_page = static_cast<HeaderPage *>(bpm->FetchPage(HEADER_PAGE_ID));
+  EXPECT_EQ(num_records, header_page->GetRecordCount());
+  page_id_t root_id;
+  EXPECT_TRUE(header_page->GetRootId(std::to_string(num_records - 1), root_id));
+  EXPECT_EQ(1, root_id);
+  bpm->UnpinPage(HEADER_PAGE_ID, false);
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+
+  // not a power of two
+  disk_manager = new DiskManager("test.db", DiskIOMode::STREAM, 3000);
+  EXPECT_EQ(DEFAULT_PAGE_SIZE, PAGE_SIZE);
+  EXPECT_TRUE(disk_manager->IsOpen());
+
+  // the open file keeps PAGE_SIZE, another page size is refused
+  DiskManager *other =
+      new DiskManager("other.db", DiskIOMode::POSITIONAL, 8192);
+  EXPECT_FALSE(other->IsOpen());
+  EXPECT_EQ(DEFAULT_PAGE_SIZE, PAGE_SIZE);
+  delete other;
+  delete disk_manager;
+  other = new DiskManager("other.db", DiskIOMode::POSITIONAL, 8192);
+  EXPECT_TRUE(other->IsOpen());
+  EXPECT_EQ(8192, PAGE_SIZE);
+  delete other;
+  remove("test.db");
+  remove("test.log");
+  remove("other.db");
+  remove("other.log");
+}
+
+} // namespace scudb
@@ -6,6 +6,7 @@
 #include <chrono>
 #include <cstdio>
 #include <functional>
+#include <atomic>
 #include <iostream>
 #include <thread>
 #include <random>
@@ -823,4 +824,195 @@ TEST(BPlusTreeConcurrentTest, MixTest3) {
   remove("test.log");
 }
 
+// helper function to look up keys that stay in the tree until stop is set
+void GetUntilStopHelper(
+    BPlusTree<GenericKey<16>, RID, GenericComparator<16>> &tree,
+    const std::vector<int64_t> &keys, const std::atomic<bool> &stop,
+    std::atomic<int64_t> &lookups, uint64_t thread_itr = 0) {
+  GenericKey<16> index_key;
+  std::vector<RID> rids;
+  int64_t count = 0;
+  for (size_t i = thread_itr; !stop; i = (i + 7) % keys.size(), count++) {
+    rids.clear();
+    index_key.SetFromInteger(keys[i]);
+    bool getSuc = tree.GetValue(index_key, rids);
+    EXPECT_EQ(getSuc, true);
+    EXPECT_EQ(rids[0].GetSlotNum(), keys[i]);
+  }
+  lookups += count;
+}
+
+/*
+ * Readers going down the tree without latches while writers split and merge
+ * the pages under them must still find every key that stays in the tree.
+ */
+TEST(BPlusTreeConcurrentTest, OptimisticReadTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<16> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(100, disk_manager);
+  BPlusTree<GenericKey<16>, RID, GenericComparator<16>> tree("foo_pk", bpm,
+                                                             comparator);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(page_id);
+  (void) header_page;
+
+  // the even keys stay, the odd ones come and go
+  std::vector<int64_t> stable_keys, changing_keys;
+  for (int64_t key = 1; key <= 4000; ++key) {
+    (key % 2 == 0 ? stable_keys : changing_keys).push_back(key);
+  }
+  std::random_shuffle(stable_keys.begin(), stable_keys.end());
+  InsertHelper(tree, stable_keys);
+
+  std::atomic<bool> stop(false);
+  std::atomic<int64_t> lookups(0);
+  std::vector<std::thread> readers;
+  for (uint64_t i = 0; i < 3; i++) {
+    readers.emplace_back(GetUntilStopHelper, std::ref(tree),
+                         std::ref(stable_keys), std::ref(stop),
+                         std::ref(lookups), i);
+  }
+  for (int round = 0; round < 5; round++) {
+    LaunchParallelTest(2, InsertHelperSplit, std::ref(tree),
+                       std::ref(changing_keys), 2);
+    LaunchParallelTest(2, DeleteHelperSplit, std::ref(tree),
+                       std::ref(changing_keys), 2);
+  }
+  stop = true;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  EXPECT_LT(0, lookups);
+  EXPECT_TRUE(tree.Check(true));
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete key_schema;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+/*
+ * Lookups per second of 1 to 8 reader threads, alone and next to a writer
+ * that keeps inserting and deleting keys, with latched and optimistic reads.
+ * Run with --gtest_also_run_disabled_tests
+ */
+TEST(BPlusTreeConcurrentTest, DISABLED_ReadScalingBenchmark) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<16> comparator(key_schema);
+  std::vector<int64_t> stable_keys, changing_keys;
+  for (int64_t key = 1; key <= 200000; ++key) {
+    (key % 2 == 0 ? stable_keys : changing_keys).push_back(key);
+  }
+  std::random_shuffle(stable_keys.begin(), stable_keys.end());
+
+  for (bool optimistic : {false, true}) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *bpm = new BufferPoolManager(4096, disk_manager);
+    BPlusTree<GenericKey<16>, RID, GenericComparator<16>> tree(
+        "foo_pk", bpm, comparator);
+    tree.SetOptimisticReads(optimistic);
+    page_id_t page_id;
+    bpm->NewPage(page_id);
+    InsertHelper(tree, stable_keys);
+
+    for (bool with_writer : {false, true}) {
+      for (uint64_t num_threads : {1, 2, 4, 8}) {
+        std::atomic<bool> stop(false);
+        std::atomic<int64_t> lookups(0);
+        std::vector<std::thread> readers;
+        for (uint64_t i = 0; i < num_threads; i++) {
+          readers.emplace_back(GetUntilStopHelper, std::ref(tree),
+                               std::ref(stable_keys), std::ref(stop),
+                               std::ref(lookups), i);
+        }
+        std::thread writer([&] {
+          while (with_writer && !stop) {
+            InsertHelper(tree, changing_keys);
+            DeleteHelper(tree, changing_keys);
+          }
+        });
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        stop = true;
+        for (auto &reader : readers) {
+          reader.join();
+        }
+        writer.join();
+        std::cout << (optimistic ? "optimistic" : "latched") << ", "
+                  << num_threads << " readers"
+                  << (with_writer ? " + writer" : "") << ": "
+                  << lookups.load() / 1000 << "K lookups/s" << std::endl;
+      }
+    }
+
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    delete disk_manager;
+    delete bpm;
+    remove("test.db");
+    remove("test.log");
+  }
+  delete key_schema;
+}
+
+/*
+ * Inserts per second of 1 to 8 threads filling a tree with 200K shuffled
+ * keys, then deletes per second of the same threads emptying half of it,
+ * with write latches from the root and on the leaf only.
+ * Run with --gtest_also_run_disabled_tests
+ */
+TEST(BPlusTreeConcurrentTest, DISABLED_WriteScalingBenchmark) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<16> comparator(key_schema);
+  std::vector<int64_t> keys, remove_keys;
+  for (int64_t key = 1; key <= 200000; ++key) {
+    keys.push_back(key);
+    if (key % 2 == 0)
+      remove_keys.push_back(key);
+  }
+  std::random_shuffle(keys.begin(), keys.end());
+  std::random_shuffle(remove_keys.begin(), remove_keys.end());
+
+  for (bool optimistic : {false, true}) {
+    for (uint64_t num_threads : {1, 2, 4, 8}) {
+      DiskManager *disk_manager = new DiskManager("test.db");
+      BufferPoolManager *bpm = new BufferPoolManager(4096, disk_manager);
+      BPlusTree<GenericKey<16>, RID, GenericComparator<16>> tree(
+          "foo_pk", bpm, comparator);
+      tree.SetOptimisticWrites(optimistic);
+      page_id_t page_id;
+      bpm->NewPage(page_id);
+
+      auto start = std::chrono::steady_clock::now();
+      LaunchParallelTest(num_threads, InsertHelperSplit, std::ref(tree),
+                         std::ref(keys), num_threads);
+      std::chrono::duration<double> insert_time =
+          std::chrono::steady_clock::now() - start;
+      start = std::chrono::steady_clock::now();
+      LaunchParallelTest(num_threads, DeleteHelperSplit, std::ref(tree),
+                         std::ref(remove_keys), num_threads);
+      std::chrono::duration<double> delete_time =
+          std::chrono::steady_clock::now() - start;
+      EXPECT_TRUE(tree.Check(true));
+
+      std::cout << (optimistic ? "leaf latch" : "root latch") << ", "
+                << num_threads << " threads: "
+                << static_cast<int>(keys.size() / insert_time.count() / 1000)
+                << "K inserts/s, "
+                << static_cast<int>(remove_keys.size() / delete_time.count() /
+                                    1000)
+                << "K deletes/s" << std::endl;
+
+      bpm->UnpinPage(HEADER_PAGE_ID, true);
+      delete disk_manager;
+      delete bpm;
+      remove("test.db");
+      remove("test.log");
+    }
+  }
+  delete key_schema;
+}
+
 } // namespace scudb
@@ -2,12 +2,18 @@
  * b_plus_tree_page_test.cpp
  */
 
+#include <chrono>
 #include <cstdio>
+#include <iostream>
+#include <random>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "buffer/buffer_pool_manager.h"
 #include "common/logger.h"
 #include "common/config.h"
+#include "index/key_search.h"
+#include "page/b_plus_tree_internal_page.h"
 #include "page/b_plus_tree_leaf_page.h"
 #include "vtable/virtual_table.h"
 
@@ -181,4 +187,93 @@ TEST(BPlusTreePageTests, testLeafPage) {
   delete key_schema;
 }
 
+// key of one integer column, int32 for 4 byte keys and int64 for 8 byte ones
+template <size_t KeySize>
+static GenericKey<KeySize> IntegerKey(int64_t k, Schema *key_schema) {
+  std::vector<Value> values;
+  if (KeySize == sizeof(int32_t))
+    values.emplace_back(TypeId::INTEGER, static_cast<int32_t>(k));
+  else
+    values.emplace_back(TypeId::BIGINT, k);
+  GenericKey<KeySize> key;
+  key.SetFromKey(Tuple(values, key_schema));
+  return key;
+}
+
+/*
+ * Fill a leaf and an internal page with the even numbers from 0, then search
+ * random keys in them: binary search with the comparator in the key & value
+ * pair format, and the scalar and the SIMD search in the key array format.
+ */
+template <size_t KeySize>
+static void KeySearchBenchmark(const std::string &create_stmt) {
+  typedef BPlusTreeLeafPage<GenericKey<KeySize>, RID,
+                            GenericComparator<KeySize>> LeafPage;
+  typedef BPlusTreeInternalPage<GenericKey<KeySize>, page_id_t,
+                                GenericComparator<KeySize>> InternalPage;
+  const int searches = 2000000;
+  Schema *key_schema = ParseCreateStatement(create_stmt);
+  GenericComparator<KeySize> comparator(key_schema);
+  std::vector<char> leaf_data(PAGE_SIZE), internal_data(PAGE_SIZE);
+  auto *leaf = reinterpret_cast<LeafPage *>(leaf_data.data());
+  auto *internal = reinterpret_cast<InternalPage *>(internal_data.data());
+
+  for (int mode = 0; mode < 3; mode++) {
+    IndexKeyFormat format =
+        mode == 0 ? IndexKeyFormat::PAIRS : IndexKeyFormat::KEY_ARRAY;
+    KeySearch::EnableSimd(mode == 2);
+    leaf->Init(1, INVALID_PAGE_ID, format);
+    for (int i = 0; i < leaf->GetMaxSize(); i++) {
+      leaf->Insert(IntegerKey<KeySize>(2 * i, key_schema), RID(0, i),
+                   comparator);
+    }
+    internal->Init(2, INVALID_PAGE_ID, format);
+    internal->PopulateNewRoot(0, IntegerKey<KeySize>(2, key_schema), 1);
+    for (int i = 1; i < internal->GetMaxSize(); i++) {
+      internal->InsertNodeAfter(i, IntegerKey<KeySize>(2 * i + 2, key_schema),
+                                i + 1);
+    }
+
+    std::mt19937 gen(0);
+    std::vector<GenericKey<KeySize>> keys;
+    for (int i = 0; i < 1024; i++) {
+      keys.push_back(IntegerKey<KeySize>(gen() % (2 * leaf->GetSize()),
+                                         key_schema));
+    }
+    int64_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < searches; i++) {
+      sum += leaf->KeyIndex(keys[i & 1023], comparator);
+    }
+    std::chrono::duration<double> leaf_elapsed =
+        std::chrono::steady_clock::now() - start;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < searches; i++) {
+      sum += internal->Lookup(keys[i & 1023], comparator);
+    }
+    std::chrono::duration<double> internal_elapsed =
+        std::chrono::steady_clock::now() - start;
+    EXPECT_GT(sum, 0);
+
+    const char *names[] = {"binary search", "key array, scalar",
+                           "key array, SIMD"};
+    std::cout << create_stmt << ", " << names[mode] << ": leaf ("
+              << leaf->GetSize() << " keys) "
+              << leaf_elapsed.count() * 1e9 / searches << " ns, internal ("
+              << internal->GetSize() << " keys) "
+              << internal_elapsed.count() * 1e9 / searches << " ns"
+              << std::endl;
+  }
+  KeySearch::EnableSimd(true);
+  delete key_schema;
+}
+
+/*
+ * Run with --gtest_also_run_disabled_tests
+ */
+TEST(BPlusTreePageTests, DISABLED_KeySearchBenchmark) {
+  KeySearchBenchmark<4>("a integer");
+  KeySearchBenchmark<8>("a bigint");
+}
+
 }
\ No newline at end of file
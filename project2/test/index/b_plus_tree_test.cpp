@@ -3,13 +3,19 @@
  */
 
 #include <algorithm>
+#include <chrono>
 #include <cstdio>
+#include <functional>
 #include <iostream>
+#include <random>
 #include <sstream>
 
 #include "buffer/buffer_pool_manager.h"
 #include "common/logger.h"
 #include "index/b_plus_tree.h"
+#include "index/b_plus_tree_index.h"
+#include "index/external_sort.h"
+#include "page/header_page.h"
 #include "vtable/virtual_table.h"
 #include "gtest/gtest.h"
 
@@ -183,4 +189,1138 @@ TEST(BPlusTreeTests, RandomTest) {
   remove("test.db");
   remove("test.log");
 }
+
+/*
+ * Insert and look up random keys with 4K to 64K pages and the same amount of
+ * buffer pool memory. Larger pages give a larger fan-out, so the tree is
+ * lower and a lookup touches fewer pages.
+ * Run with --gtest_also_run_disabled_tests
+ */
+TEST(BPlusTreeTests, DISABLED_PageSizeBenchmark) {
+  const size_t pool_bytes = 4 << 20;
+  const int64_t scale = 200000;
+  std::vector<int64_t> keys;
+  for (int64_t key = 1; key <= scale; key++) {
+    keys.push_back(key);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(0));
+
+  for (int page_size : {4096, 8192, 16384, 65536}) {
+    Schema *key_schema = ParseCreateStatement("a bigint");
+    GenericComparator<8> comparator(key_schema);
+    DiskManager *disk_manager =
+        new DiskManager("test.db", DiskIOMode::POSITIONAL, page_size);
+    BufferPoolManager *bpm =
+        new BufferPoolManager(pool_bytes / page_size, disk_manager);
+    BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
+                                                             comparator);
+    GenericKey<8> index_key;
+    RID rid;
+    Transaction *transaction = new Transaction(0);
+    page_id_t page_id;
+    bpm->NewPage(page_id);
+    tree.openCheck = false;
+
+    auto start = std::chrono::steady_clock::now();
+    for (auto key : keys) {
+      rid.Set((int32_t)(key >> 32), key & 0xFFFFFFFF);
+      index_key.SetFromInteger(key);
+      tree.Insert(index_key, rid, transaction);
+    }
+    std::chrono::duration<double> insert_time =
+        std::chrono::steady_clock::now() - start;
+
+    size_t fetches = bpm->GetHitCount() + bpm->GetMissCount();
+    size_t misses = bpm->GetMissCount();
+    std::vector<RID> rids;
+    start = std::chrono::steady_clock::now();
+    for (auto key : keys) {
+      rids.clear();
+      index_key.SetFromInteger(key);
+      tree.GetValue(index_key, rids);
+      EXPECT_EQ(1, rids.size());
+    }
+    std::chrono::duration<double> lookup_time =
+        std::chrono::steady_clock::now() - start;
+    fetches = bpm->GetHitCount() + bpm->GetMissCount() - fetches;
+    misses = bpm->GetMissCount() - misses;
+
+    std::cout << page_size / 1024 << "K pages, " << bpm->GetPoolSize()
+              << " frames: " << static_cast<long>(scale / insert_time.count())
+              << " inserts/sec, "
+              << static_cast<long>(scale / lookup_time.count())
+              << " lookups/sec, " << static_cast<double>(fetches) / scale
+              << " pages and " << static_cast<double>(misses) / scale
+              << " reads per lookup" << std::endl;
+
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    delete transaction;
+    delete bpm;
+    delete disk_manager;
+    delete key_schema;
+    remove("test.db");
+    remove("test.log");
+  }
+}
+/*
+ * Full scan of the leaf chain of a tree built from random keys, read from a
+ * cold db file with O_DIRECT, without and with read-ahead.
+ * Run with --gtest_also_run_disabled_tests
+ */
+TEST(BPlusTreeTests, DISABLED_ReadAheadBenchmark) {
+  const int64_t scale = 200000;
+  std::vector<int64_t> keys;
+  for (int64_t key = 1; key <= scale; key++) {
+    keys.push_back(key);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(0));
+
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  DiskManager *disk_manager = new DiskManager("test.db", DiskIOMode::DIRECT);
+  BufferPoolManager *bpm = new BufferPoolManager(1024, disk_manager);
+  page_id_t root_page_id;
+  {
+    BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
+                                                             comparator);
+    GenericKey<8> index_key;
+    RID rid;
+    Transaction transaction(0);
+    page_id_t page_id;
+    auto header_page = static_cast<HeaderPage *>(bpm->NewPage(page_id));
+    tree.openCheck = false;
+    for (auto key : keys) {
+      rid.Set((int32_t)(key >> 32), key & 0xFFFFFFFF);
+      index_key.SetFromInteger(key);
+      tree.Insert(index_key, rid, &transaction);
+    }
+    header_page->GetRootId("foo_pk", root_page_id);
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    bpm->FlushAllPages();
+  }
+  delete bpm;
+
+  for (size_t depth : {0, PREFETCH_DEPTH, 4 * PREFETCH_DEPTH}) {
+    bpm = new BufferPoolManager(256, disk_manager);
+    bpm->SetPrefetchDepth(depth);
+    BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree(
+        "foo_pk", bpm, comparator, root_page_id);
+    int64_t count = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (auto iterator = tree.Begin(); !iterator.isEnd(); ++iterator) {
+      count++;
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    EXPECT_EQ(scale, count);
+    bpm->WaitForPrefetch();
+    std::cout << "read-ahead depth " << depth << ": "
+              << elapsed.count() * 1000 << " ms, "
+              << static_cast<long>(scale / elapsed.count()) << " keys/sec, "
+              << bpm->GetMissCount() << " reads while scanning, "
+              << bpm->GetPrefetchCount() << " read ahead" << std::endl;
+    delete bpm;
+  }
+  delete disk_manager;
+  delete key_schema;
+  remove("test.db");
+  remove("test.log");
+}
+/*
+ * Point lookups of random keys in a fully cached tree, with the comparator
+ * specialized for the key schema and with the Value based one.
+ * Run with --gtest_also_run_disabled_tests
+ */
+TEST(BPlusTreeTests, DISABLED_ComparatorBenchmark) {
+  const int64_t scale = 200000;
+  std::vector<int64_t> keys;
+  for (int64_t key = 1; key <= scale; key++) {
+    keys.push_back(key);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(0));
+
+  for (bool specialize : {false, true}) {
+    Schema *key_schema = ParseCreateStatement("a bigint");
+    GenericComparator<8> comparator(key_schema, specialize);
+    DiskManager *disk_manager =
+        new DiskManager("test.db", DiskIOMode::POSITIONAL);
+    BufferPoolManager *bpm = new BufferPoolManager(4096, disk_manager);
+    BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
+                                                             comparator);
+    GenericKey<8> index_key;
+    RID rid;
+    Transaction transaction(0);
+    page_id_t page_id;
+    bpm->NewPage(page_id);
+    tree.openCheck = false;
+    for (auto key : keys) {
+      rid.Set((int32_t)(key >> 32), key & 0xFFFFFFFF);
+      index_key.SetFromInteger(key);
+      tree.Insert(index_key, rid, &transaction);
+    }
+
+    std::vector<RID> rids;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < 5; round++) {
+      for (auto key : keys) {
+        rids.clear();
+        index_key.SetFromInteger(key);
+        tree.GetValue(index_key, rids);
+      }
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    EXPECT_EQ(1, rids.size());
+
+    std::cout << (specialize ? "specialized" : "Value based")
+              << " comparator: "
+              << static_cast<long>(5 * scale / elapsed.count())
+              << " lookups/sec, " << elapsed.count() * 1e9 / (5 * scale)
+              << " ns per lookup" << std::endl;
+
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    delete bpm;
+    delete disk_manager;
+    delete key_schema;
+    remove("test.db");
+    remove("test.log");
+  }
+}
+
+// normalized key of ("user_<id / 4>", id % 4)
+static Tuple UserKey(int64_t id, Schema *key_schema) {
+  char name[32];
+  snprintf(name, sizeof(name), "user_%06d", static_cast<int>(id / 4));
+  std::vector<Value> values;
+  values.emplace_back(TypeId::VARCHAR, std::string(name));
+  values.emplace_back(TypeId::INTEGER, static_cast<int32_t>(id % 4));
+  return Tuple(values, key_schema);
+}
+
+/*
+ * Insert, look up, scan and delete normalized composite keys in a tree whose
+ * pages keep only the key suffixes after their common prefix.
+ */
+TEST(BPlusTreeTests, KeyCompressionTest) {
+  Schema *key_schema = ParseCreateStatement("a varchar, b integer");
+  GenericComparator<32> comparator =
+      GenericComparator<32>::Normalized(key_schema);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(100, disk_manager);
+  BPlusTree<GenericKey<32>, RID, GenericComparator<32>> tree("foo_pk", bpm,
+                                                             comparator);
+  GenericKey<32> index_key;
+  RID rid;
+  Transaction *transaction = new Transaction(0);
+  page_id_t page_id;
+  bpm->NewPage(page_id);
+  tree.openCheck = false;
+
+  const int64_t scale = 20000;
+  std::vector<int64_t> keys;
+  for (int64_t key = 0; key < scale; key++) {
+    keys.push_back(key);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(0));
+  for (auto key : keys) {
+    rid.Set(0, key);
+    index_key.SetFromNormalizedKey(UserKey(key, key_schema), key_schema);
+    EXPECT_TRUE(tree.Insert(index_key, rid, transaction));
+  }
+  ASSERT_TRUE(tree.Check(true));
+
+  index_key.SetFromNormalizedKey(UserKey(scale / 2, key_schema), key_schema);
+  auto leaf = tree.FindLeafPage(index_key);
+  EXPECT_TRUE(leaf->IsCompressed());
+  EXPECT_GT(leaf->GetPrefixSize(), 0);
+  bpm->FetchPage(leaf->GetPageId())->RUnlatch();
+  bpm->UnpinPage(leaf->GetPageId(), false);
+  bpm->UnpinPage(leaf->GetPageId(), false);
+
+  std::vector<RID> rids;
+  for (auto key : keys) {
+    rids.clear();
+    index_key.SetFromNormalizedKey(UserKey(key, key_schema), key_schema);
+    tree.GetValue(index_key, rids);
+    ASSERT_EQ(1, rids.size());
+    EXPECT_EQ(key, rids[0].GetSlotNum());
+  }
+
+  // delete every key but the multiples of 10
+  std::vector<int64_t> remove_keys;
+  for (auto key : keys) {
+    if (key % 10 != 0)
+      remove_keys.push_back(key);
+  }
+  for (auto key : remove_keys) {
+    index_key.SetFromNormalizedKey(UserKey(key, key_schema), key_schema);
+    tree.Remove(index_key, transaction);
+  }
+  ASSERT_TRUE(tree.Check(true));
+
+  int64_t current_key = 0;
+  for (auto iterator = tree.Begin(); !iterator.isEnd(); ++iterator) {
+    EXPECT_EQ(current_key, (*iterator).second.GetSlotNum());
+    index_key.SetFromNormalizedKey(UserKey(current_key, key_schema),
+                                   key_schema);
+    EXPECT_EQ(0, comparator((*iterator).first, index_key));
+    current_key += 10;
+  }
+  EXPECT_EQ(scale, current_key);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete bpm;
+  delete disk_manager;
+  delete key_schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+/*
+ * Insert, look up, scan and delete int32 keys, negative ones included, in a
+ * tree whose pages keep their keys in an array of their own.
+ */
+TEST(BPlusTreeTests, KeyArrayTest) {
+  Schema *key_schema = ParseCreateStatement("a integer");
+  GenericComparator<4> comparator(key_schema);
+  ASSERT_TRUE(comparator.IsIntegerKey());
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(100, disk_manager);
+  BPlusTree<GenericKey<4>, RID, GenericComparator<4>> tree("foo_pk", bpm,
+                                                           comparator);
+  auto set_key = [&](int32_t key, GenericKey<4> &index_key) {
+    std::vector<Value> values{Value(TypeId::INTEGER, key)};
+    index_key.SetFromKey(Tuple(values, key_schema));
+  };
+  GenericKey<4> index_key;
+  RID rid;
+  Transaction *transaction = new Transaction(0);
+  page_id_t page_id;
+  bpm->NewPage(page_id);
+  tree.openCheck = false;
+
+  const int32_t scale = 20000;
+  std::vector<int32_t> keys;
+  for (int32_t key = -scale / 2; key < scale / 2; key++) {
+    keys.push_back(key);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(0));
+  for (auto key : keys) {
+    rid.Set(0, key);
+    set_key(key, index_key);
+    EXPECT_TRUE(tree.Insert(index_key, rid, transaction));
+  }
+  ASSERT_TRUE(tree.Check(true));
+
+  set_key(0, index_key);
+  auto leaf = tree.FindLeafPage(index_key);
+  EXPECT_TRUE(leaf->IsKeyArray());
+  bpm->FetchPage(leaf->GetPageId())->RUnlatch();
+  bpm->UnpinPage(leaf->GetPageId(), false);
+  bpm->UnpinPage(leaf->GetPageId(), false);
+
+  std::vector<RID> rids;
+  for (auto key : keys) {
+    rids.clear();
+    set_key(key, index_key);
+    tree.GetValue(index_key, rids);
+    ASSERT_EQ(1, rids.size());
+    EXPECT_EQ(key, static_cast<int32_t>(rids[0].GetSlotNum()));
+  }
+
+  // delete every key but the multiples of 10
+  for (auto key : keys) {
+    if (key % 10 != 0) {
+      set_key(key, index_key);
+      tree.Remove(index_key, transaction);
+    }
+  }
+  ASSERT_TRUE(tree.Check(true));
+
+  int32_t current_key = -scale / 2;
+  for (auto iterator = tree.Begin(); !iterator.isEnd(); ++iterator) {
+    EXPECT_EQ(current_key, static_cast<int32_t>((*iterator).second.GetSlotNum()));
+    current_key += 10;
+  }
+  EXPECT_EQ(scale / 2, current_key);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete bpm;
+  delete disk_manager;
+  delete key_schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+// height and page count of the tree under root_page_id
+template <size_t KeySize>
+static void TreeShape(BufferPoolManager *bpm, page_id_t root_page_id,
+                      int &height, int &pages) {
+  typedef BPlusTreeInternalPage<GenericKey<KeySize>, page_id_t,
+                                GenericComparator<KeySize>> InternalPage;
+  std::vector<page_id_t> level{root_page_id};
+  height = 0;
+  pages = 0;
+  while (!level.empty()) {
+    std::vector<page_id_t> next_level;
+    for (auto id : level) {
+      auto node = reinterpret_cast<BPlusTreePage *>(bpm->FetchPage(id)->GetData());
+      if (!node->IsLeafPage()) {
+        auto internal = reinterpret_cast<InternalPage *>(node);
+        for (int i = 0; i < internal->GetSize(); i++) {
+          next_level.push_back(internal->ValueAt(i));
+        }
+      }
+      bpm->UnpinPage(id, false);
+    }
+    height++;
+    pages += level.size();
+    level.swap(next_level);
+  }
+}
+
+template <size_t KeySize>
+static void KeyCompressionBenchmark(
+    const std::string &create_stmt,
+    const std::function<Tuple(int64_t, Schema *)> &make_key) {
+  const int64_t scale = 200000;
+  std::vector<int64_t> keys;
+  for (int64_t key = 0; key < scale; key++) {
+    keys.push_back(key);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(0));
+
+  Schema *key_schema = ParseCreateStatement(create_stmt);
+  GenericComparator<KeySize> comparator =
+      GenericComparator<KeySize>::Normalized(key_schema);
+  std::vector<GenericKey<KeySize>> index_keys(scale);
+  for (int64_t key = 0; key < scale; key++) {
+    index_keys[key].SetFromNormalizedKey(make_key(key, key_schema), key_schema);
+  }
+  for (bool compress : {false, true}) {
+    DiskManager *disk_manager =
+        new DiskManager("test.db", DiskIOMode::POSITIONAL);
+    BufferPoolManager *bpm = new BufferPoolManager(8192, disk_manager);
+    BPlusTree<GenericKey<KeySize>, RID, GenericComparator<KeySize>> tree(
+        "foo_pk", bpm, comparator);
+    tree.SetKeyFormat(compress ? IndexKeyFormat::PREFIX_COMPRESSED
+                               : IndexKeyFormat::PAIRS);
+    RID rid;
+    Transaction transaction(0);
+    page_id_t page_id;
+    auto header_page = static_cast<HeaderPage *>(bpm->NewPage(page_id));
+    tree.openCheck = false;
+    for (auto key : keys) {
+      rid.Set(0, key);
+      tree.Insert(index_keys[key], rid, &transaction);
+    }
+    page_id_t root_page_id;
+    header_page->GetRootId("foo_pk", root_page_id);
+    int height, pages;
+    TreeShape<KeySize>(bpm, root_page_id, height, pages);
+
+    std::vector<RID> rids;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < 5; round++) {
+      for (auto key : keys) {
+        rids.clear();
+        tree.GetValue(index_keys[key], rids);
+      }
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    EXPECT_EQ(keys.back(), rids[0].GetSlotNum());
+
+    std::cout << create_stmt << (compress ? ", compressed" : ", plain")
+              << ": height " << height << ", " << pages << " pages, "
+              << elapsed.count() * 1e9 / (5 * scale) << " ns per lookup"
+              << std::endl;
+
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    delete bpm;
+    delete disk_manager;
+    remove("test.db");
+    remove("test.log");
+  }
+  delete key_schema;
+}
+
+/*
+ * Tree shape and point lookup latency of normalized keys, with plain pages
+ * and with prefix compressed ones.
+ * Run with --gtest_also_run_disabled_tests
+ */
+TEST(BPlusTreeTests, DISABLED_KeyCompressionBenchmark) {
+  KeyCompressionBenchmark<8>("a bigint", [](int64_t id, Schema *key_schema) {
+    std::vector<Value> values{Value(TypeId::BIGINT, id)};
+    return Tuple(values, key_schema);
+  });
+  KeyCompressionBenchmark<32>("a varchar, b integer", UserKey);
+}
+
+/*
+ * Bulk load the even keys [0, 2 * scale) into a tree with pages of the given
+ * key format, then check the tree, look up and scan every key, and keep
+ * inserting the odd keys and deleting some of the even ones.
+ */
+static void CheckBulkLoad(IndexKeyFormat key_format, int64_t scale,
+                          double fill_factor) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator =
+      key_format == IndexKeyFormat::PREFIX_COMPRESSED
+          ? GenericComparator<8>::Normalized(key_schema)
+          : GenericComparator<8>(key_schema);
+  auto set_key = [&](int64_t key, GenericKey<8> &index_key) {
+    std::vector<Value> values{Value(TypeId::BIGINT, key)};
+    if (comparator.IsNormalized())
+      index_key.SetFromNormalizedKey(Tuple(values, key_schema), key_schema);
+    else
+      index_key.SetFromKey(Tuple(values, key_schema));
+  };
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(100, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
+                                                           comparator);
+  tree.SetKeyFormat(key_format);
+  GenericKey<8> index_key;
+  RID rid;
+  Transaction *transaction = new Transaction(0);
+  page_id_t page_id;
+  auto header_page = static_cast<HeaderPage *>(bpm->NewPage(page_id));
+  tree.openCheck = false;
+
+  // every key comes twice, the second one is skipped
+  int64_t next_key = 0;
+  ASSERT_TRUE(tree.BulkLoad(
+      [&](GenericKey<8> &key, RID &value) {
+        if (next_key >= 4 * scale)
+          return false;
+        set_key(next_key / 4 * 2, key);
+        value.Set(static_cast<int32_t>(next_key % 2), next_key / 4 * 2);
+        next_key++;
+        return true;
+      },
+      fill_factor));
+  ASSERT_TRUE(tree.Check(true));
+  EXPECT_EQ(scale == 0, tree.IsEmpty());
+  page_id_t root_page_id = INVALID_PAGE_ID;
+  EXPECT_EQ(scale != 0, header_page->GetRootId("foo_pk", root_page_id));
+  if (scale == 0) {
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    delete transaction;
+    delete bpm;
+    delete disk_manager;
+    delete key_schema;
+    remove("test.db");
+    remove("test.log");
+    return;
+  }
+
+  auto root = reinterpret_cast<BPlusTreePage *>(
+      bpm->FetchPage(root_page_id)->GetData());
+  EXPECT_EQ(key_format, root->GetKeyFormat());
+  bpm->UnpinPage(root_page_id, false);
+
+  std::vector<RID> rids;
+  for (int64_t key = 0; key < 2 * scale; key++) {
+    rids.clear();
+    set_key(key, index_key);
+    if (key % 2 == 0) {
+      ASSERT_TRUE(tree.GetValue(index_key, rids));
+      ASSERT_EQ(1, rids.size());
+      EXPECT_EQ(0, rids[0].GetPageId());
+      EXPECT_EQ(key, rids[0].GetSlotNum());
+    } else {
+      EXPECT_FALSE(tree.GetValue(index_key, rids));
+    }
+  }
+  int64_t current_key = 0;
+  for (auto iterator = tree.Begin(); !iterator.isEnd(); ++iterator) {
+    EXPECT_EQ(current_key, (*iterator).second.GetSlotNum());
+    current_key += 2;
+  }
+  EXPECT_EQ(2 * scale, current_key);
+
+  // the bulk loaded tree keeps working as usual
+  for (int64_t key = 1; key < 2 * scale; key += 2) {
+    rid.Set(0, key);
+    set_key(key, index_key);
+    EXPECT_TRUE(tree.Insert(index_key, rid, transaction));
+  }
+  for (int64_t key = 0; key < 2 * scale; key += 6) {
+    set_key(key, index_key);
+    tree.Remove(index_key, transaction);
+  }
+  ASSERT_TRUE(tree.Check(true));
+  current_key = 0;
+  for (auto iterator = tree.Begin(); !iterator.isEnd(); ++iterator) {
+    if (current_key % 6 == 0)
+      current_key++;
+    EXPECT_EQ(current_key, (*iterator).second.GetSlotNum());
+    current_key++;
+  }
+  EXPECT_EQ(2 * scale, current_key);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete bpm;
+  delete disk_manager;
+  delete key_schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeTests, BulkLoadTest) {
+  for (auto key_format : {IndexKeyFormat::PAIRS, IndexKeyFormat::KEY_ARRAY,
+                          IndexKeyFormat::PREFIX_COMPRESSED}) {
+    for (int64_t scale : {0, 1, 2, 3, 100, 1000, 10000}) {
+      for (double fill_factor : {0.0, 0.7, 1.0}) {
+        CheckBulkLoad(key_format, scale, fill_factor);
+      }
+    }
+  }
+}
+
+/*
+ * Build time and shape of a tree of random bigint keys, inserted one by one
+ * and bulk loaded after an external sort.
+ * Run with --gtest_also_run_disabled_tests
+ */
+TEST(BPlusTreeTests, DISABLED_BulkLoadBenchmark) {
+  const int64_t scale = 1000000;
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  std::vector<GenericKey<8>> index_keys(scale);
+  std::vector<int64_t> keys;
+  for (int64_t key = 0; key < scale; key++) {
+    std::vector<Value> values{Value(TypeId::BIGINT, key)};
+    index_keys[key].SetFromKey(Tuple(values, key_schema));
+    keys.push_back(key);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(0));
+
+  for (bool bulk_load : {false, true}) {
+    DiskManager *disk_manager =
+        new DiskManager("test.db", DiskIOMode::POSITIONAL);
+    BufferPoolManager *bpm = new BufferPoolManager(8192, disk_manager);
+    BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
+                                                             comparator);
+    RID rid;
+    Transaction transaction(0);
+    page_id_t page_id;
+    auto header_page = static_cast<HeaderPage *>(bpm->NewPage(page_id));
+    tree.openCheck = false;
+
+    auto start = std::chrono::steady_clock::now();
+    if (bulk_load) {
+      // 1MB of sort memory, the keys are sorted in 16 runs
+      ExternalSort<GenericKey<8>, RID, GenericComparator<8>> sorter(
+          comparator, 1 << 20);
+      for (auto key : keys) {
+        rid.Set(0, key);
+        sorter.Add(index_keys[key], rid);
+      }
+      sorter.Sort();
+      tree.BulkLoad([&sorter](GenericKey<8> &key, RID &value) {
+        return sorter.Next(key, value);
+      });
+    } else {
+      for (auto key : keys) {
+        rid.Set(0, key);
+        tree.Insert(index_keys[key], rid, &transaction);
+      }
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    page_id_t root_page_id;
+    header_page->GetRootId("foo_pk", root_page_id);
+    int height, pages;
+    TreeShape<8>(bpm, root_page_id, height, pages);
+    std::vector<RID> rids;
+    tree.GetValue(index_keys[keys.back()], rids);
+    EXPECT_EQ(keys.back(), rids[0].GetSlotNum());
+
+    std::cout << (bulk_load ? "bulk load" : "insert") << ": "
+              << elapsed.count() * 1000 << " ms, height " << height << ", "
+              << pages << " pages" << std::endl;
+
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    delete bpm;
+    delete disk_manager;
+    remove("test.db");
+    remove("test.log");
+  }
+  delete key_schema;
+}
+
+/*
+ * Build an index over the tuples already in a table, through a sort small
+ * enough to spill runs to disk.
+ */
+TEST(BPlusTreeTests, BulkLoadIndexTest) {
+  Schema *schema = ParseCreateStatement("a integer, b varchar");
+  IndexMetadata *index_metadata =
+      new IndexMetadata("foo_pk", "foo", schema, std::vector<int>{0});
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(100, disk_manager);
+  LockManager *lock_manager = new LockManager(true);
+  LogManager *log_manager = new LogManager(disk_manager);
+  Transaction *transaction = new Transaction(0);
+  page_id_t page_id;
+  bpm->NewPage(page_id);
+  TableHeap *table = new TableHeap(bpm, lock_manager, log_manager,
+                                   transaction);
+  BPlusTreeIndex<GenericKey<8>, RID, GenericComparator<8>> index(
+      index_metadata, bpm);
+
+  const int32_t scale = 20000;
+  std::vector<int32_t> keys;
+  for (int32_t key = 0; key < scale; key++) {
+    keys.push_back(key);
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(0));
+  std::map<int32_t, RID> rids;
+  for (auto key : keys) {
+    std::vector<Value> values{Value(TypeId::INTEGER, key),
+                              Value(TypeId::VARCHAR, std::to_string(key))};
+    RID rid;
+    ASSERT_TRUE(table->InsertTuple(Tuple(values, schema), rid, transaction));
+    rids[key] = rid;
+  }
+  ASSERT_TRUE(index.BulkLoad(table, schema, transaction));
+  // the index is not empty any more
+  EXPECT_FALSE(index.BulkLoad(table, schema, transaction));
+
+  std::vector<RID> result;
+  for (int32_t key = -1; key <= scale; key++) {
+    result.clear();
+    std::vector<Value> values{Value(TypeId::INTEGER, key)};
+    index.ScanKey(Tuple(values, index_metadata->GetKeySchema()), result,
+                  transaction);
+    if (key < 0 || key == scale) {
+      EXPECT_EQ(INVALID_PAGE_ID, result[0].GetPageId());
+    } else {
+      ASSERT_EQ(1, result.size());
+      EXPECT_EQ(rids[key], result[0]);
+    }
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete table;
+  delete transaction;
+  delete log_manager;
+  delete lock_manager;
+  delete bpm;
+  delete disk_manager;
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+/*
+ * Keys with one to four values, and a hot key whose posting list takes a few
+ * pages, inserted in random order and removed value by value.
+ */
+static void CheckNonUnique(IndexKeyFormat key_format) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator =
+      key_format == IndexKeyFormat::PREFIX_COMPRESSED
+          ? GenericComparator<8>::Normalized(key_schema)
+          : GenericComparator<8>(key_schema);
+  auto set_key = [&](int64_t key, GenericKey<8> &index_key) {
+    std::vector<Value> values{Value(TypeId::BIGINT, key)};
+    if (comparator.IsNormalized())
+      index_key.SetFromNormalizedKey(Tuple(values, key_schema), key_schema);
+    else
+      index_key.SetFromKey(Tuple(values, key_schema));
+  };
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(100, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree(
+      "foo_idx", bpm, comparator, INVALID_PAGE_ID, false);
+  tree.SetKeyFormat(key_format);
+  EXPECT_FALSE(tree.IsUnique());
+  GenericKey<8> index_key;
+  Transaction *transaction = new Transaction(0);
+  page_id_t page_id;
+  bpm->NewPage(page_id);
+  tree.openCheck = false;
+
+  const int64_t scale = 2000, hot_values = 3000;
+  std::map<int64_t, std::vector<RID>> expected;
+  std::vector<std::pair<int64_t, RID>> pairs;
+  for (int64_t key = 1; key < scale; key++) {
+    for (int i = 0; i <= key % 4; i++) {
+      pairs.emplace_back(key, RID(i, static_cast<int>(key)));
+    }
+  }
+  for (int i = 0; i < hot_values; i++) {
+    pairs.emplace_back(0, RID(i / 100, i % 100));
+  }
+  std::shuffle(pairs.begin(), pairs.end(), std::mt19937(0));
+  for (auto &pair : pairs) {
+    set_key(pair.first, index_key);
+    ASSERT_TRUE(tree.Insert(index_key, pair.second, transaction));
+    expected[pair.first].push_back(pair.second);
+  }
+  for (auto &entry : expected) {
+    std::sort(entry.second.begin(), entry.second.end(),
+              BPlusTreePostingPage::RidLess);
+  }
+  // a pair is there only once
+  set_key(0, index_key);
+  EXPECT_FALSE(tree.Insert(index_key, RID(1, 1), transaction));
+  set_key(3, index_key);
+  EXPECT_FALSE(tree.Insert(index_key, RID(3, 3), transaction));
+  ASSERT_TRUE(tree.Check(true));
+
+  auto check = [&]() {
+    std::vector<RID> rids;
+    for (int64_t key = 0; key <= scale; key++) {
+      set_key(key, index_key);
+      bool found = tree.GetValue(index_key, rids);
+      auto it = expected.find(key);
+      ASSERT_EQ(it != expected.end(), found);
+      if (found)
+        ASSERT_EQ(it->second, rids);
+      else
+        ASSERT_TRUE(rids.empty());
+    }
+    // the iterator returns each key & value pair, in key and value order
+    auto it = expected.begin();
+    size_t i = 0;
+    for (auto iterator = tree.Begin(); !iterator.isEnd(); ++iterator) {
+      ASSERT_NE(expected.end(), it);
+      ASSERT_EQ(it->second[i], (*iterator).second);
+      if (++i == it->second.size()) {
+        ++it;
+        i = 0;
+      }
+    }
+    EXPECT_EQ(expected.end(), it);
+  };
+  check();
+
+  // every other value, the hot key keeps half of its posting list
+  for (auto &entry : expected) {
+    std::vector<RID> kept;
+    set_key(entry.first, index_key);
+    for (size_t i = 0; i < entry.second.size(); i++) {
+      if (i % 2 == 0) {
+        tree.Remove(index_key, entry.second[i], transaction);
+      } else {
+        kept.push_back(entry.second[i]);
+      }
+    }
+    // not a value of the key
+    tree.Remove(index_key, RID(-5, 5), transaction);
+    entry.second = kept;
+  }
+  for (auto it = expected.begin(); it != expected.end();) {
+    it = it->second.empty() ? expected.erase(it) : std::next(it);
+  }
+  ASSERT_TRUE(tree.Check(true));
+  check();
+
+  // all values of a key at once
+  for (int64_t key = 0; key < scale; key += 3) {
+    set_key(key, index_key);
+    tree.Remove(index_key, transaction);
+    expected.erase(key);
+  }
+  ASSERT_TRUE(tree.Check(true));
+  check();
+  for (auto &entry : expected) {
+    set_key(entry.first, index_key);
+    for (auto &rid : entry.second)
+      tree.Remove(index_key, rid, transaction);
+  }
+  expected.clear();
+  EXPECT_TRUE(tree.IsEmpty());
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete bpm;
+  delete disk_manager;
+  delete key_schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+/*
+ * Scan random ranges of even keys, with open, inclusive and exclusive bounds
+ * and limits, batch by batch, and compare with the keys in the range.
+ */
+static void CheckScanRange(IndexKeyFormat key_format, bool unique) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator =
+      key_format == IndexKeyFormat::PREFIX_COMPRESSED
+          ? GenericComparator<8>::Normalized(key_schema)
+          : GenericComparator<8>(key_schema);
+  auto set_key = [&](int64_t key, GenericKey<8> &index_key) {
+    std::vector<Value> values{Value(TypeId::BIGINT, key)};
+    if (comparator.IsNormalized())
+      index_key.SetFromNormalizedKey(Tuple(values, key_schema), key_schema);
+    else
+      index_key.SetFromKey(Tuple(values, key_schema));
+  };
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(100, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree(
+      "foo_idx", bpm, comparator, INVALID_PAGE_ID, unique);
+  tree.SetKeyFormat(key_format);
+  GenericKey<8> index_key;
+  Transaction *transaction = new Transaction(0);
+  page_id_t page_id;
+  bpm->NewPage(page_id);
+  tree.openCheck = false;
+
+  // key 2 * i has i % 3 + 1 values in a non-unique tree
+  const int64_t scale = 3000;
+  std::vector<int64_t> keys;
+  for (int64_t i = 0; i < scale; i++)
+    keys.push_back(i);
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(0));
+  for (auto i : keys) {
+    set_key(2 * i, index_key);
+    for (int j = 0; j <= (unique ? 0 : i % 3); j++)
+      ASSERT_TRUE(tree.Insert(index_key, RID(j, static_cast<int>(i)),
+                              transaction));
+  }
+
+  std::mt19937 gen(1);
+  std::uniform_int_distribution<int64_t> bound(-5, 2 * scale + 5);
+  std::vector<RID> batch;
+  for (int round = 0; round < 300; round++) {
+    KeyRange<GenericKey<8>> range;
+    int64_t low = bound(gen), high = bound(gen);
+    range.has_low = gen() % 4 != 0;
+    range.low_inclusive = gen() % 2 == 0;
+    range.has_high = gen() % 4 != 0;
+    range.high_inclusive = gen() % 2 == 0;
+    set_key(low, range.low);
+    set_key(high, range.high);
+    size_t limits[] = {SIZE_MAX, 0, 1, 37};
+    size_t limit = limits[gen() % 4];
+
+    std::vector<RID> expected;
+    for (int64_t i = 0; i < scale && expected.size() < limit; i++) {
+      int64_t key = 2 * i;
+      if (range.has_low && (key < low || (key == low && !range.low_inclusive)))
+        continue;
+      if (range.has_high &&
+          (key > high || (key == high && !range.high_inclusive)))
+        break;
+      for (int j = 0; j <= (unique ? 0 : i % 3) && expected.size() < limit;
+           j++)
+        expected.push_back(RID(j, static_cast<int>(i)));
+    }
+
+    std::vector<RID> result;
+    bool more = true;
+    while (more) {
+      more = tree.ScanRange(range, batch, limit - result.size());
+      // a batch holds the keys of a leaf
+      ASSERT_TRUE(!more || !batch.empty());
+      ASSERT_LE(batch.size(), static_cast<size_t>(3 * PAGE_SIZE / 12));
+      result.insert(result.end(), batch.begin(), batch.end());
+    }
+    ASSERT_EQ(expected, result);
+  }
+  ASSERT_TRUE(tree.Check(true));
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete bpm;
+  delete disk_manager;
+  delete key_schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeTests, ScanRangeTest) {
+  for (auto key_format : {IndexKeyFormat::PAIRS, IndexKeyFormat::KEY_ARRAY,
+                          IndexKeyFormat::PREFIX_COMPRESSED}) {
+    CheckScanRange(key_format, true);
+    CheckScanRange(key_format, false);
+  }
+}
+
+TEST(BPlusTreeTests, NonUniqueTest) {
+  for (auto key_format : {IndexKeyFormat::PAIRS, IndexKeyFormat::KEY_ARRAY,
+                          IndexKeyFormat::PREFIX_COMPRESSED}) {
+    CheckNonUnique(key_format);
+  }
+}
+
+/*
+ * A non-unique index on a low cardinality column, bulk loaded and built one
+ * entry at a time, returns every tuple of a key.
+ */
+TEST(BPlusTreeTests, NonUniqueIndexTest) {
+  Schema *schema = ParseCreateStatement("a integer, b varchar");
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(100, disk_manager);
+  LockManager *lock_manager = new LockManager(true);
+  LogManager *log_manager = new LogManager(disk_manager);
+  Transaction *transaction = new Transaction(0);
+  page_id_t page_id;
+  bpm->NewPage(page_id);
+  TableHeap *table = new TableHeap(bpm, lock_manager, log_manager,
+                                   transaction);
+  BPlusTreeIndex<GenericKey<8>, RID, GenericComparator<8>> loaded(
+      new IndexMetadata("foo_idx1", "foo", schema, std::vector<int>{0}, false),
+      bpm);
+  BPlusTreeIndex<GenericKey<8>, RID, GenericComparator<8>> inserted(
+      new IndexMetadata("foo_idx2", "foo", schema, std::vector<int>{0}, false),
+      bpm);
+
+  const int32_t scale = 20000, keys = 10;
+  std::map<int32_t, std::vector<RID>> rids;
+  for (int32_t i = 0; i < scale; i++) {
+    std::vector<Value> values{Value(TypeId::INTEGER, i % keys),
+                              Value(TypeId::VARCHAR, std::to_string(i))};
+    RID rid;
+    ASSERT_TRUE(table->InsertTuple(Tuple(values, schema), rid, transaction));
+    rids[i % keys].push_back(rid);
+    std::vector<Value> key_values{Value(TypeId::INTEGER, i % keys)};
+    inserted.InsertEntry(Tuple(key_values, inserted.GetKeySchema()), rid,
+                         transaction);
+  }
+  ASSERT_TRUE(loaded.BulkLoad(table, schema, transaction));
+
+  // keys 3 and 4 of a range scan, in key and rid order
+  std::vector<Value> three{Value(TypeId::INTEGER, 3)};
+  std::vector<Value> five{Value(TypeId::INTEGER, 5)};
+  Tuple low(three, loaded.GetKeySchema()), high(five, loaded.GetKeySchema());
+  std::vector<RID> expected = rids[3], result, batch;
+  expected.insert(expected.end(), rids[4].begin(), rids[4].end());
+  auto scan = loaded.ScanRange(&low, true, &high, false);
+  while (scan->NextBatch(batch))
+    result.insert(result.end(), batch.begin(), batch.end());
+  EXPECT_EQ(expected, result);
+
+  for (auto *index : {&loaded, &inserted}) {
+    for (int32_t key = -1; key <= keys; key++) {
+      std::vector<Value> values{Value(TypeId::INTEGER, key)};
+      Tuple key_tuple(values, index->GetKeySchema());
+      index->ScanKey(key_tuple, result, transaction);
+      if (key < 0 || key == keys) {
+        EXPECT_TRUE(result.empty());
+        continue;
+      }
+      std::sort(result.begin(), result.end(), BPlusTreePostingPage::RidLess);
+      EXPECT_EQ(rids[key], result);
+      // deleting a tuple takes it off its key only
+      index->DeleteEntry(key_tuple, rids[key].front(), transaction);
+      index->ScanKey(key_tuple, result, transaction);
+      EXPECT_EQ(rids[key].size() - 1, result.size());
+    }
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete table;
+  delete transaction;
+  delete log_manager;
+  delete lock_manager;
+  delete bpm;
+  delete disk_manager;
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+}
+/*
+ * Insert batches of sorted keys, some of them in the tree already, into a
+ * tree of every third key, and compare with one insert at a time.
+ */
+static void CheckInsertBatch(IndexKeyFormat key_format, bool unique) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator =
+      key_format == IndexKeyFormat::PREFIX_COMPRESSED
+          ? GenericComparator<8>::Normalized(key_schema)
+          : GenericComparator<8>(key_schema);
+  auto set_key = [&](int64_t key, GenericKey<8> &index_key) {
+    std::vector<Value> values{Value(TypeId::BIGINT, key)};
+    if (comparator.IsNormalized())
+      index_key.SetFromNormalizedKey(Tuple(values, key_schema), key_schema);
+    else
+      index_key.SetFromKey(Tuple(values, key_schema));
+  };
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(100, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree(
+      "foo_idx", bpm, comparator, INVALID_PAGE_ID, unique);
+  tree.SetKeyFormat(key_format);
+  Transaction *transaction = new Transaction(0);
+  page_id_t page_id;
+  bpm->NewPage(page_id);
+  tree.openCheck = false;
+
+  const int64_t scale = 6000;
+  std::map<int64_t, std::vector<RID>> expected;
+  std::vector<std::pair<GenericKey<8>, RID>> entries;
+  GenericKey<8> index_key;
+  for (int64_t key = 0; key < scale; key += 3) {
+    set_key(key, index_key);
+    entries.emplace_back(index_key, RID(0, static_cast<int>(key + 50)));
+    expected[key].push_back(RID(0, static_cast<int>(key + 50)));
+  }
+  // an empty tree starts with a batch too
+  EXPECT_EQ(entries.size(), tree.InsertBatch(entries, transaction));
+
+  std::mt19937 gen(0);
+  // slot numbers stay positive, unlike posting references
+  for (int round = 1; round <= 20; round++) {
+    std::vector<int64_t> keys;
+    for (int i = 0; i < 500; i++)
+      keys.push_back(static_cast<int64_t>(gen() % (scale + 100)) - 50);
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    entries.clear();
+    size_t new_pairs = 0;
+    for (auto key : keys) {
+      set_key(key, index_key);
+      RID rid(round, static_cast<int>(key + 50));
+      entries.emplace_back(index_key, rid);
+      if (!unique || expected[key].empty()) {
+        expected[key].push_back(rid);
+        new_pairs++;
+      }
+    }
+    ASSERT_EQ(new_pairs, tree.InsertBatch(entries, transaction));
+  }
+  ASSERT_TRUE(tree.Check(true));
+
+  std::vector<RID> result;
+  for (auto &entry : expected) {
+    set_key(entry.first, index_key);
+    result.clear();
+    bool found = tree.GetValue(index_key, result, transaction);
+    if (entry.second.empty()) {
+      EXPECT_FALSE(found);
+      continue;
+    }
+    EXPECT_TRUE(found);
+    EXPECT_EQ(entry.second, result);
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete bpm;
+  delete disk_manager;
+  delete key_schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeTests, InsertBatchTest) {
+  for (auto key_format : {IndexKeyFormat::PAIRS, IndexKeyFormat::KEY_ARRAY,
+                          IndexKeyFormat::PREFIX_COMPRESSED}) {
+    CheckInsertBatch(key_format, true);
+    CheckInsertBatch(key_format, false);
+  }
+}
 } // namespace scudb
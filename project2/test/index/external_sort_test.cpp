@@ -0,0 +1,65 @@
+/**
+ * external_sort_test.cpp
+ */
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "common/rid.h"
+#include "index/external_sort.h"
+#include "index/generic_key.h"
+#include "vtable/virtual_table.h"
+#include "gtest/gtest.h"
+
+namespace scudb {
+
+/*
+ * Sort keys with many duplicates, in memory and with a memory limit small
+ * enough to spill several runs, and compare with std::stable_sort.
+ */
+TEST(ExternalSortTests, SortTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int64_t> dist(-1000, 1000);
+  std::vector<std::pair<int64_t, RID>> pairs;
+  for (int32_t i = 0; i < 50000; i++) {
+    pairs.emplace_back(dist(gen), RID(0, i));
+  }
+  std::vector<std::pair<int64_t, RID>> sorted = pairs;
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [](const std::pair<int64_t, RID> &lhs,
+                      const std::pair<int64_t, RID> &rhs) {
+                     return lhs.first < rhs.first;
+                   });
+
+  const size_t pair_size = sizeof(std::pair<GenericKey<8>, RID>);
+  for (size_t memory_limit : {1000 * pair_size, 10000 * pair_size,
+                              size_t(16 << 20)}) {
+    ExternalSort<GenericKey<8>, RID, GenericComparator<8>> sorter(comparator,
+                                                                 memory_limit);
+    GenericKey<8> index_key;
+    for (auto &pair : pairs) {
+      std::vector<Value> values{Value(TypeId::BIGINT, pair.first)};
+      index_key.SetFromKey(Tuple(values, key_schema));
+      sorter.Add(index_key, pair.second);
+    }
+    sorter.Sort();
+    if (memory_limit == 16 << 20)
+      EXPECT_EQ(0, sorter.GetRunCount());
+    else
+      EXPECT_LT(1, sorter.GetRunCount());
+
+    RID rid;
+    for (auto &pair : sorted) {
+      ASSERT_TRUE(sorter.Next(index_key, rid));
+      EXPECT_EQ(pair.first, index_key.ToString());
+      EXPECT_EQ(pair.second, rid);
+    }
+    EXPECT_FALSE(sorter.Next(index_key, rid));
+  }
+  delete key_schema;
+}
+
+} // namespace scudb
@@ -0,0 +1,213 @@
+/**
+ * generic_key_test.cpp
+ */
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "index/b_plus_tree_index.h"
+#include "index/generic_key.h"
+#include "vtable/virtual_table.h"
+#include "gtest/gtest.h"
+
+namespace scudb {
+
+static int Sign(int cmp) { return (cmp > 0) - (cmp < 0); }
+
+/*
+ * Build keys with small random values (negatives, duplicates and NULLs
+ * included) and check the specialized comparator orders every pair of them
+ * the same way as the Value based one.
+ */
+template <size_t KeySize>
+static void CheckSpecializedComparator(const std::string &create_stmt) {
+  Schema *key_schema = ParseCreateStatement(create_stmt);
+  GenericComparator<KeySize> specialized(key_schema);
+  GenericComparator<KeySize> generic(key_schema, false);
+  EXPECT_TRUE(specialized.IsSpecialized());
+  EXPECT_FALSE(generic.IsSpecialized());
+
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int> dist(-4, 4);
+  std::vector<GenericKey<KeySize>> keys(200);
+  for (auto &key : keys) {
+    std::vector<Value> values;
+    for (int i = 0; i < key_schema->GetColumnCount(); i++) {
+      int v = dist(gen);
+      switch (key_schema->GetType(i)) {
+      case TypeId::TINYINT:
+        values.emplace_back(TypeId::TINYINT, v == 4 ? PELOTON_INT8_NULL
+                                                    : static_cast<int8_t>(v));
+        break;
+      case TypeId::SMALLINT:
+        values.emplace_back(TypeId::SMALLINT, static_cast<int16_t>(v * 1000));
+        break;
+      case TypeId::INTEGER:
+        values.emplace_back(TypeId::INTEGER,
+                            v == 4 ? PELOTON_INT32_NULL : v * 100000);
+        break;
+      default:
+        values.emplace_back(TypeId::BIGINT, static_cast<int64_t>(v) << 40);
+        break;
+      }
+    }
+    key.SetFromKey(Tuple(values, key_schema));
+  }
+
+  for (auto &lhs : keys) {
+    for (auto &rhs : keys) {
+      EXPECT_EQ(Sign(generic(lhs, rhs)), Sign(specialized(lhs, rhs)));
+    }
+  }
+  delete key_schema;
+}
+
+TEST(GenericKeyTests, IntegerComparatorTest) {
+  CheckSpecializedComparator<4>("a integer");
+  CheckSpecializedComparator<8>("a bigint");
+}
+
+TEST(GenericKeyTests, CompositeComparatorTest) {
+  CheckSpecializedComparator<8>("a smallint, b integer");
+  CheckSpecializedComparator<16>("a tinyint, b bigint, c integer");
+  CheckSpecializedComparator<32>("a integer, b integer, c bigint, d smallint");
+}
+
+TEST(GenericKeyTests, FallbackComparatorTest) {
+  Schema *key_schema = ParseCreateStatement("a integer, b varchar");
+  GenericComparator<32> comparator(key_schema);
+  EXPECT_FALSE(comparator.IsSpecialized());
+  delete key_schema;
+
+  // does not fit the key
+  key_schema = ParseCreateStatement("a integer, b bigint");
+  GenericComparator<8> small_comparator(key_schema);
+  EXPECT_FALSE(small_comparator.IsSpecialized());
+  delete key_schema;
+}
+
+/*
+ * Encoded keys must memcmp in the order the Value comparisons give, for
+ * every column type the encoder handles.
+ */
+TEST(GenericKeyTests, NormalizedKeyTest) {
+  Schema *key_schema = ParseCreateStatement(
+      "a varchar, b integer, c double, d smallint, e bigint, f tinyint");
+  ASSERT_TRUE(KeyEncoder::IsEncodable(key_schema));
+  ASSERT_EQ(17 + 4 + 8 + 2 + 8 + 1, KeyEncoder::GetEncodedLength(key_schema));
+  GenericComparator<64> generic(key_schema, false);
+  GenericComparator<64> normalized =
+      GenericComparator<64>::Normalized(key_schema);
+
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int> dist(-3, 3);
+  const std::string strings[] = {"", "a", "ab", "abc", "b", "ba",
+                                 "\xff", "0123456789abcdef"};
+  std::vector<GenericKey<64>> raw_keys(200), encoded_keys(200);
+  for (size_t k = 0; k < raw_keys.size(); k++) {
+    std::vector<Value> values;
+    values.emplace_back(TypeId::VARCHAR, strings[dist(gen) + 3]);
+    values.emplace_back(TypeId::INTEGER, dist(gen) * 70000);
+    values.emplace_back(TypeId::DECIMAL, dist(gen) * 0.25);
+    values.emplace_back(TypeId::SMALLINT,
+                        static_cast<int16_t>(dist(gen) * 300));
+    values.emplace_back(TypeId::BIGINT, static_cast<int64_t>(dist(gen)) << 35);
+    values.emplace_back(TypeId::TINYINT, static_cast<int8_t>(dist(gen)));
+    Tuple tuple(values, key_schema);
+    raw_keys[k].SetFromKey(tuple);
+    encoded_keys[k].SetFromNormalizedKey(tuple, key_schema);
+  }
+
+  for (size_t i = 0; i < raw_keys.size(); i++) {
+    for (size_t j = 0; j < raw_keys.size(); j++) {
+      EXPECT_EQ(Sign(generic(raw_keys[i], raw_keys[j])),
+                Sign(normalized(encoded_keys[i], encoded_keys[j])));
+    }
+  }
+  delete key_schema;
+}
+
+TEST(GenericKeyTests, NormalizedNullAndLongKeyTest) {
+  Schema *key_schema = ParseCreateStatement("a varchar, b integer");
+  GenericComparator<32> comparator =
+      GenericComparator<32>::Normalized(key_schema);
+  auto make_key = [&](const Value &a, const Value &b) {
+    GenericKey<32> key;
+    key.SetFromNormalizedKey(Tuple({a, b}, key_schema), key_schema);
+    return key;
+  };
+  Value null_str(TypeId::VARCHAR, nullptr, 0, false);
+  Value empty(TypeId::VARCHAR, std::string(""));
+  Value one(TypeId::INTEGER, 1);
+  Value null_int(TypeId::INTEGER, PELOTON_INT32_NULL);
+
+  // NULLs sort first
+  EXPECT_LT(comparator(make_key(null_str, one), make_key(empty, one)), 0);
+  EXPECT_LT(comparator(make_key(empty, null_int), make_key(empty, one)), 0);
+  EXPECT_EQ(0,
+            comparator(make_key(empty, null_int), make_key(empty, null_int)));
+
+  // strings past KeyEncoder::VARCHAR_LENGTH keep their order against
+  // shorter ones and collide on their common prefix
+  std::string prefix(KeyEncoder::VARCHAR_LENGTH, 'x');
+  Value full(TypeId::VARCHAR, prefix);
+  Value longer(TypeId::VARCHAR, prefix + "a");
+  Value longest(TypeId::VARCHAR, prefix + "b");
+  EXPECT_LT(comparator(make_key(full, one), make_key(longer, one)), 0);
+  EXPECT_EQ(0, comparator(make_key(longer, one), make_key(longest, one)));
+  GenericKey<32> key;
+  EXPECT_TRUE(key.SetFromNormalizedKey(Tuple({full, one}, key_schema),
+                                       key_schema));
+  EXPECT_FALSE(key.SetFromNormalizedKey(Tuple({longer, one}, key_schema),
+                                        key_schema));
+  delete key_schema;
+}
+
+/*
+ * A composite index built through BPlusTreeIndex stores encoded keys
+ */
+TEST(GenericKeyTests, NormalizedIndexTest) {
+  Schema *schema = ParseCreateStatement("a varchar, b integer, c bigint");
+  IndexMetadata *metadata =
+      new IndexMetadata("foo_idx", "foo", schema, std::vector<int>{0, 1});
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  page_id_t page_id;
+  bpm->NewPage(page_id);
+  BPlusTreeIndex<GenericKey<32>, RID, GenericComparator<32>> index(metadata,
+                                                                   bpm);
+  Transaction transaction(0);
+
+  // the same integer under every name, so lookups depend on both columns
+  const std::string names[] = {"ann", "bob", "carl", "dave"};
+  for (int i = 0; i < 100; i++) {
+    for (int n = 0; n < 4; n++) {
+      Tuple key({Value(TypeId::VARCHAR, names[n]), Value(TypeId::INTEGER, i)},
+                metadata->GetKeySchema());
+      index.InsertEntry(key, RID(i, n), &transaction);
+    }
+  }
+  std::vector<RID> result;
+  for (int i = 0; i < 100; i++) {
+    for (int n = 0; n < 4; n++) {
+      result.clear();
+      Tuple key({Value(TypeId::VARCHAR, names[n]), Value(TypeId::INTEGER, i)},
+                metadata->GetKeySchema());
+      index.ScanKey(key, result, &transaction);
+      ASSERT_EQ(1, result.size());
+      EXPECT_EQ(RID(i, n), result[0]);
+    }
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete bpm;
+  delete disk_manager;
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+} // namespace scudb
@@ -0,0 +1,63 @@
+/**
+ * key_search_test.cpp
+ */
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "index/key_search.h"
+#include "gtest/gtest.h"
+
+namespace scudb {
+
+/*
+ * Search sorted arrays of every length up to a few pages worth of keys, with
+ * duplicates and the extreme values, and compare the counts with
+ * std::lower_bound and std::upper_bound.
+ */
+template <typename T> static void CheckCountLess() {
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int> dist(-50, 50);
+  for (int n = 0; n <= 600; n++) {
+    std::vector<T> keys(n);
+    for (auto &key : keys)
+      key = static_cast<T>(dist(gen)) * 3;
+    if (n > 2) {
+      keys[0] = std::numeric_limits<T>::min();
+      keys[n - 1] = std::numeric_limits<T>::max();
+    }
+    std::sort(keys.begin(), keys.end());
+
+    std::vector<T> needles{std::numeric_limits<T>::min(),
+                           std::numeric_limits<T>::max()};
+    for (int i = -152; i <= 152; i += 7)
+      needles.push_back(static_cast<T>(i));
+    for (auto needle : needles) {
+      int less = static_cast<int>(
+          std::lower_bound(keys.begin(), keys.end(), needle) - keys.begin());
+      int less_equal = static_cast<int>(
+          std::upper_bound(keys.begin(), keys.end(), needle) - keys.begin());
+      ASSERT_EQ(less, KeySearch::CountLess(keys.data(), n, needle));
+      ASSERT_EQ(less, KeySearch::ScalarCountLess(keys.data(), n, needle));
+      ASSERT_EQ(less_equal, KeySearch::CountLessEqual(keys.data(), n, needle));
+    }
+  }
+}
+
+TEST(KeySearchTests, Int32Test) {
+  CheckCountLess<int32_t>();
+  KeySearch::EnableSimd(false);
+  CheckCountLess<int32_t>();
+  KeySearch::EnableSimd(true);
+}
+
+TEST(KeySearchTests, Int64Test) {
+  CheckCountLess<int64_t>();
+  KeySearch::EnableSimd(false);
+  CheckCountLess<int64_t>();
+  KeySearch::EnableSimd(true);
+}
+
+} // namespace scudb
@@ -0,0 +1,685 @@
+/**
+ * table_heap_test.cpp
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "index/b_plus_tree_index.h"
+#include "logging/common.h"
+#include "table/table_heap.h"
+#include "vtable/virtual_table.h"
+#include "gtest/gtest.h"
+
+namespace scudb {
+
+TEST(TableHeapTest, FreeSpaceMapCategoryTest) {
+  int unit = PAGE_SIZE / FSM_CATEGORIES;
+  EXPECT_EQ(0, FreeSpaceMap::ToCategory(0));
+  EXPECT_EQ(0, FreeSpaceMap::ToCategory(unit - 1));
+  EXPECT_EQ(1, FreeSpaceMap::ToCategory(unit));
+  EXPECT_EQ(FSM_CATEGORIES - 1, FreeSpaceMap::ToCategory(PAGE_SIZE));
+  EXPECT_EQ(0, FreeSpaceMap::ToRequiredCategory(0));
+  EXPECT_EQ(1, FreeSpaceMap::ToRequiredCategory(1));
+  EXPECT_EQ(1, FreeSpaceMap::ToRequiredCategory(unit));
+  EXPECT_EQ(2, FreeSpaceMap::ToRequiredCategory(unit + 1));
+  // a page of the category a size requires has room for it
+  for (int size = 1; size < PAGE_SIZE - unit; size += 7) {
+    int category = FreeSpaceMap::ToRequiredCategory(size);
+    EXPECT_GE(category * unit, size);
+    EXPECT_EQ(category - 1, FreeSpaceMap::ToCategory(category * unit - 1));
+  }
+}
+
+/*
+ * Rows freed in the middle of a heap are reused by the next inserts, also
+ * after the heap is opened again, and the heap only grows once they are
+ * taken. The heap spans more than one page of its free space map.
+ */
+TEST(TableHeapTest, FreeSpaceMapTest) {
+  Schema *schema = ParseCreateStatement("a integer, b varchar(256)");
+  Tuple tuple({Value(TypeId::INTEGER, 1),
+               Value(TypeId::VARCHAR, std::string(250, 'b'))},
+              schema);
+  Transaction *transaction = new Transaction(0);
+  DiskManager *disk_manager =
+      new DiskManager("test.db", DiskIOMode::STREAM, MIN_PAGE_SIZE);
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(64, disk_manager);
+  LockManager *lock_manager = new LockManager(true);
+  LogManager *log_manager = new LogManager(disk_manager);
+  TableHeap *table = new TableHeap(buffer_pool_manager, lock_manager,
+                                   log_manager, transaction);
+  page_id_t first_page_id = table->GetFirstPageId();
+
+  // one tuple per page
+  ASSERT_GT(2 * (tuple.GetLength() + TABLE_PAGE_SLOT_SIZE),
+            PAGE_SIZE - TABLE_PAGE_HEADER_SIZE);
+  int num_pages = FreeSpaceMapPage::GetMaxSize() * 3 / 2;
+  std::vector<RID> rids;
+  std::set<page_id_t> pages;
+  RID rid;
+  for (int i = 0; i < num_pages; ++i) {
+    ASSERT_TRUE(table->InsertTuple(tuple, rid, transaction));
+    rids.push_back(rid);
+    pages.insert(rid.GetPageId());
+  }
+  ASSERT_EQ(static_cast<size_t>(num_pages), pages.size());
+
+  // free a page in each map page
+  std::set<page_id_t> freed;
+  for (int i : {10, num_pages - 10}) {
+    ASSERT_TRUE(table->MarkDelete(rids[i], transaction));
+    table->ApplyDelete(rids[i], transaction);
+    freed.insert(rids[i].GetPageId());
+  }
+  ASSERT_TRUE(table->InsertTuple(tuple, rid, transaction));
+  EXPECT_EQ(1, freed.erase(rid.GetPageId()));
+
+  // the map is persisted with the heap
+  buffer_pool_manager->FlushAllPages();
+  delete table;
+  delete buffer_pool_manager;
+  buffer_pool_manager = new BufferPoolManager(64, disk_manager);
+  table = new TableHeap(buffer_pool_manager, lock_manager, log_manager,
+                        first_page_id);
+  ASSERT_TRUE(table->InsertTuple(tuple, rid, transaction));
+  EXPECT_EQ(1, freed.erase(rid.GetPageId()));
+  ASSERT_TRUE(table->InsertTuple(tuple, rid, transaction));
+  EXPECT_EQ(0, pages.count(rid.GetPageId()));
+
+  int scanned = 0;
+  for (auto itr = table->begin(transaction); itr != table->end(); ++itr)
+    ++scanned;
+  EXPECT_EQ(num_pages + 1, scanned);
+
+  remove("test.db");
+  remove("test.log");
+  delete schema;
+  delete table;
+  delete buffer_pool_manager;
+  delete log_manager;
+  delete lock_manager;
+  delete transaction;
+  delete disk_manager;
+}
+
+/*
+ * A batch of tuples of different sizes fills the room freed in the heap and
+ * then new pages, several tuples per page, and reads back like tuples
+ * inserted one at a time.
+ */
+TEST(TableHeapTest, InsertTuplesTest) {
+  Schema *schema = ParseCreateStatement("a integer, b varchar(256)");
+  auto make_tuple = [schema](int i) {
+    std::vector<Value> values{
+        Value(TypeId::INTEGER, i),
+        Value(TypeId::VARCHAR, std::string(1 + i % 150, 'a' + i % 26))};
+    return Tuple(values, schema);
+  };
+  Transaction *transaction = new Transaction(0);
+  DiskManager *disk_manager =
+      new DiskManager("test.db", DiskIOMode::STREAM, MIN_PAGE_SIZE);
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(64, disk_manager);
+  LockManager *lock_manager = new LockManager(true);
+  LogManager *log_manager = new LogManager(disk_manager);
+  TableHeap *table = new TableHeap(buffer_pool_manager, lock_manager,
+                                   log_manager, transaction);
+
+  RID rid;
+  std::vector<RID> rids;
+  for (int i = 0; i < 200; ++i) {
+    ASSERT_TRUE(table->InsertTuple(make_tuple(i), rid, transaction));
+    rids.push_back(rid);
+  }
+  std::set<page_id_t> freed;
+  for (int i = 0; i < 200; i += 10) {
+    ASSERT_TRUE(table->MarkDelete(rids[i], transaction));
+    table->ApplyDelete(rids[i], transaction);
+    freed.insert(rids[i].GetPageId());
+  }
+
+  const int batch_size = 3000;
+  std::vector<Tuple> batch;
+  for (int i = 0; i < batch_size; ++i)
+    batch.push_back(make_tuple(1000 + i));
+  size_t write_set = transaction->GetWriteSet()->size();
+  ASSERT_TRUE(table->InsertTuples(batch, rids, transaction));
+  ASSERT_EQ(static_cast<size_t>(batch_size), rids.size());
+  EXPECT_EQ(write_set + batch_size, transaction->GetWriteSet()->size());
+
+  std::set<RID, bool (*)(const RID &, const RID &)> distinct(
+      BPlusTreePostingPage::RidLess);
+  std::set<page_id_t> pages;
+  int reused = 0;
+  for (int i = 0; i < batch_size; ++i) {
+    EXPECT_TRUE(distinct.insert(rids[i]).second);
+    pages.insert(rids[i].GetPageId());
+    reused += freed.count(rids[i].GetPageId());
+    Tuple tuple(rids[i]);
+    ASSERT_TRUE(table->GetTuple(rids[i], tuple, transaction));
+    EXPECT_EQ(batch[i].GetLength(), tuple.GetLength());
+    EXPECT_EQ(0, memcmp(batch[i].GetData(), tuple.GetData(),
+                        tuple.GetLength()));
+  }
+  EXPECT_GT(reused, 0);
+  EXPECT_LT(pages.size() * 2, static_cast<size_t>(batch_size));
+
+  int scanned = 0;
+  for (auto itr = table->begin(transaction); itr != table->end(); ++itr)
+    ++scanned;
+  EXPECT_EQ(180 + batch_size, scanned);
+
+  // a tuple too large for a page is refused alone, the others are stored
+  batch = {make_tuple(1),
+           Tuple({Value(TypeId::INTEGER, 0),
+                  Value(TypeId::VARCHAR, std::string(PAGE_SIZE, 'a'))},
+                 schema),
+           make_tuple(2)};
+  write_set = transaction->GetWriteSet()->size();
+  EXPECT_FALSE(table->InsertTuples(batch, rids, transaction));
+  EXPECT_EQ(TransactionState::ABORTED, transaction->GetState());
+  ASSERT_EQ(3u, rids.size());
+  EXPECT_EQ(INVALID_PAGE_ID, rids[1].GetPageId());
+  for (int i : {0, 2}) {
+    Tuple tuple(rids[i]);
+    ASSERT_TRUE(table->GetTuple(rids[i], tuple, transaction));
+    EXPECT_EQ(0, memcmp(batch[i].GetData(), tuple.GetData(),
+                        tuple.GetLength()));
+  }
+  EXPECT_EQ(write_set + 2, transaction->GetWriteSet()->size());
+
+  remove("test.db");
+  remove("test.log");
+  delete schema;
+  delete table;
+  delete buffer_pool_manager;
+  delete log_manager;
+  delete lock_manager;
+  delete transaction;
+  delete disk_manager;
+}
+
+/*
+ * Rounds of deletes, updates and inserts of rows of different lengths. The
+ * room of deleted rows is taken again by compacting the pages, with rows
+ * marked deleted but not applied yet among them, and the heap doesn't grow.
+ */
+TEST(TableHeapTest, CompactTest) {
+  Schema *schema = ParseCreateStatement("a integer, b varchar(256)");
+  auto make_tuple = [schema](int i) {
+    std::vector<Value> values{
+        Value(TypeId::INTEGER, i),
+        Value(TypeId::VARCHAR, std::string(1 + i * 7 % 150, 'a' + i % 26))};
+    return Tuple(values, schema);
+  };
+  Transaction *transaction = new Transaction(0);
+  DiskManager *disk_manager =
+      new DiskManager("test.db", DiskIOMode::STREAM, MIN_PAGE_SIZE);
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(64, disk_manager);
+  LockManager *lock_manager = new LockManager(true);
+  LogManager *log_manager = new LogManager(disk_manager);
+  TableHeap *table = new TableHeap(buffer_pool_manager, lock_manager,
+                                   log_manager, transaction);
+  auto count_pages = [&]() {
+    std::set<page_id_t> pages;
+    for (auto itr = table->begin(transaction); itr != table->end(); ++itr)
+      pages.insert(itr->GetRid().GetPageId());
+    return pages.size();
+  };
+
+  std::vector<std::pair<RID, int>> rows; // rid, value of the row
+  RID rid;
+  int next = 0;
+  for (; next < 300; ++next) {
+    ASSERT_TRUE(table->InsertTuple(make_tuple(next), rid, transaction));
+    rows.emplace_back(rid, next);
+  }
+  size_t pages = count_pages();
+
+  for (int round = 0; round < 10; ++round) {
+    std::vector<std::pair<RID, int>> kept, pending;
+    for (size_t i = 0; i < rows.size(); ++i) {
+      if ((i + round) % 3 == 0) {
+        ASSERT_TRUE(table->MarkDelete(rows[i].first, transaction));
+        table->ApplyDelete(rows[i].first, transaction);
+      } else if ((i + round) % 7 == 1) {
+        ASSERT_TRUE(table->MarkDelete(rows[i].first, transaction));
+        pending.push_back(rows[i]);
+      } else if ((i + round) % 5 == 2) {
+        // grows or shrinks in place, when the page has room
+        if (table->UpdateTuple(make_tuple(rows[i].second + 1), rows[i].first,
+                               transaction))
+          rows[i].second++;
+        kept.push_back(rows[i]);
+      } else {
+        kept.push_back(rows[i]);
+      }
+    }
+    while (kept.size() + pending.size() < 300) {
+      ASSERT_TRUE(table->InsertTuple(make_tuple(next), rid, transaction));
+      kept.emplace_back(rid, next++);
+    }
+    for (auto &row : pending) {
+      table->RollbackDelete(row.first, transaction);
+      kept.push_back(row);
+    }
+    rows.swap(kept);
+
+    std::set<RID, bool (*)(const RID &, const RID &)> distinct(
+        BPlusTreePostingPage::RidLess);
+    for (auto &row : rows) {
+      EXPECT_TRUE(distinct.insert(row.first).second);
+      Tuple expected = make_tuple(row.second);
+      Tuple tuple(row.first);
+      ASSERT_TRUE(table->GetTuple(row.first, tuple, transaction));
+      ASSERT_EQ(expected.GetLength(), tuple.GetLength());
+      EXPECT_EQ(0, memcmp(expected.GetData(), tuple.GetData(),
+                          tuple.GetLength()));
+    }
+    transaction->GetWriteSet()->clear();
+  }
+  // rows change length from round to round
+  EXPECT_LE(count_pages(), pages + pages / 10);
+
+  remove("test.db");
+  remove("test.log");
+  delete schema;
+  delete table;
+  delete buffer_pool_manager;
+  delete log_manager;
+  delete lock_manager;
+  delete transaction;
+  delete disk_manager;
+}
+
+/*
+ * Rows much larger than a page keep their long varchar values in overflow
+ * pages, compressed or not, through inserts, updates and their rollback.
+ * Pages of values no longer stored are reused.
+ */
+TEST(TableHeapTest, OverflowTest) {
+  Schema *schema =
+      ParseCreateStatement("a integer, b varchar(5000), c varchar(5000)");
+  auto noise = [](int i, size_t length) {
+    std::string value;
+    unsigned seed = i;
+    while (value.size() < length) {
+      seed = seed * 1103515245 + 12345;
+      value += static_cast<char>('a' + (seed >> 16) % 26);
+    }
+    return value;
+  };
+  // b compresses, c does not
+  auto make_tuple = [&](int i) {
+    std::vector<Value> values{
+        Value(TypeId::INTEGER, i),
+        Value(TypeId::VARCHAR, std::string(1000 + i * 37, 'a' + i % 26)),
+        Value(TypeId::VARCHAR, noise(i, 600 + i * 13))};
+    return Tuple(values, schema);
+  };
+  DiskManager *disk_manager =
+      new DiskManager("test.db", DiskIOMode::STREAM, MIN_PAGE_SIZE);
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(64, disk_manager);
+  LockManager *lock_manager = new LockManager(true);
+  LogManager *log_manager = new LogManager(disk_manager);
+  TransactionManager *transaction_manager =
+      new TransactionManager(lock_manager, log_manager);
+  Transaction *transaction = transaction_manager->Begin();
+  TableHeap *table = new TableHeap(buffer_pool_manager, lock_manager,
+                                   log_manager, transaction, schema);
+  auto check = [&](const RID &rid, int i) {
+    Tuple expected = make_tuple(i);
+    Tuple tuple(rid);
+    ASSERT_TRUE(table->GetTuple(rid, tuple, transaction));
+    EXPECT_LE(tuple.GetLength(), TOAST_TUPLE_THRESHOLD);
+    EXPECT_FALSE(tuple.IsToasted(schema, 0));
+    EXPECT_TRUE(tuple.IsToasted(schema, 1));
+    EXPECT_TRUE(tuple.IsToasted(schema, 2));
+    for (int column = 0; column < 3; ++column) {
+      Value value = table->GetValue(tuple, schema, column);
+      EXPECT_EQ(CMP_TRUE,
+                value.CompareEquals(expected.GetValue(schema, column)));
+    }
+  };
+
+  RID rid;
+  std::vector<RID> rids;
+  for (int i = 0; i < 20; ++i) {
+    ASSERT_TRUE(table->InsertTuple(make_tuple(i), rid, transaction));
+    rids.push_back(rid);
+  }
+  std::vector<Tuple> batch;
+  for (int i = 20; i < 40; ++i)
+    batch.push_back(make_tuple(i));
+  std::vector<RID> batch_rids;
+  ASSERT_TRUE(table->InsertTuples(batch, batch_rids, transaction));
+  rids.insert(rids.end(), batch_rids.begin(), batch_rids.end());
+  transaction_manager->Commit(transaction);
+  delete transaction;
+  for (int i = 0; i < 40; ++i)
+    check(rids[i], i);
+
+  // a rolled back update leaves the old values, a committed one the new
+  transaction = transaction_manager->Begin();
+  for (int i = 0; i < 10; ++i)
+    ASSERT_TRUE(table->UpdateTuple(make_tuple(i + 100), rids[i], transaction));
+  check(rids[5], 105);
+  transaction_manager->Abort(transaction);
+  delete transaction;
+  transaction = transaction_manager->Begin();
+  for (int i = 0; i < 10; ++i)
+    check(rids[i], i);
+  for (int i = 10; i < 20; ++i)
+    ASSERT_TRUE(table->UpdateTuple(make_tuple(i + 100), rids[i], transaction));
+  for (int i = 20; i < 30; ++i)
+    ASSERT_TRUE(table->MarkDelete(rids[i], transaction));
+  transaction_manager->Commit(transaction);
+  delete transaction;
+
+  transaction = transaction_manager->Begin();
+  int scanned = 0;
+  for (auto itr = table->begin(transaction); itr != table->end(); ++itr) {
+    int i = table->GetValue(*itr, schema, 0).GetAs<int32_t>();
+    EXPECT_TRUE(i < 10 || (i >= 110 && i < 120) || (i >= 30 && i < 40));
+    check(itr->GetRid(), i);
+    ++scanned;
+  }
+  EXPECT_EQ(30, scanned);
+  transaction_manager->Commit(transaction);
+  delete transaction;
+
+  // the same rows again fit in the pages the deletes and updates freed
+  page_id_t page_id;
+  ASSERT_NE(nullptr, buffer_pool_manager->NewPage(page_id));
+  buffer_pool_manager->UnpinPage(page_id, false);
+  page_id_t next_page_id = page_id + 1;
+  transaction = transaction_manager->Begin();
+  for (int i = 20; i < 30; ++i) {
+    ASSERT_TRUE(table->InsertTuple(make_tuple(i), rid, transaction));
+    rids[i] = rid;
+  }
+  transaction_manager->Commit(transaction);
+  for (int i = 20; i < 30; ++i)
+    check(rids[i], i);
+  ASSERT_NE(nullptr, buffer_pool_manager->NewPage(page_id));
+  buffer_pool_manager->UnpinPage(page_id, false);
+  EXPECT_EQ(next_page_id, page_id);
+
+  remove("test.db");
+  remove("test.log");
+  delete schema;
+  delete table;
+  delete transaction;
+  delete transaction_manager;
+  delete buffer_pool_manager;
+  delete log_manager;
+  delete lock_manager;
+  delete disk_manager;
+}
+
+/*
+ * The same inserts, deletes and updates on a heap of each layout, read back
+ * by rid, by a full scan and by a columnar scan. Some b values are stored
+ * out of line.
+ */
+TEST(TableHeapTest, PaxTest) {
+  Schema *schema =
+      ParseCreateStatement("a integer, b varchar(1000), c bigint");
+  auto make_tuple = [&](int i) {
+    size_t length = i % 50 == 0 ? 600 : i % 37;
+    std::vector<Value> values{
+        Value(TypeId::INTEGER, i),
+        Value(TypeId::VARCHAR, std::string(length, 'a' + i % 26)),
+        Value(TypeId::BIGINT, int64_t(i) * 1000)};
+    return Tuple(values, schema);
+  };
+  for (PageLayout layout : {PageLayout::ROW, PageLayout::PAX}) {
+    DiskManager *disk_manager =
+        new DiskManager("test.db", DiskIOMode::STREAM, MIN_PAGE_SIZE);
+    BufferPoolManager *buffer_pool_manager =
+        new BufferPoolManager(64, disk_manager);
+    LockManager *lock_manager = new LockManager(true);
+    LogManager *log_manager = new LogManager(disk_manager);
+    TransactionManager *transaction_manager =
+        new TransactionManager(lock_manager, log_manager);
+    Transaction *transaction = transaction_manager->Begin();
+    TableHeap *table = new TableHeap(buffer_pool_manager, lock_manager,
+                                     log_manager, transaction, schema, layout);
+    // the i of the tuple at each rid
+    std::map<int64_t, int> rows;
+    auto check = [&](TableHeap *heap) {
+      Tuple tuple;
+      for (auto &row : rows) {
+        Tuple expected = make_tuple(row.second);
+        ASSERT_TRUE(heap->GetTuple(RID(row.first), tuple, transaction));
+        for (int column = 0; column < 3; ++column) {
+          EXPECT_EQ(CMP_TRUE, heap->GetValue(tuple, schema, column)
+                                  .CompareEquals(expected.GetValue(schema,
+                                                                   column)));
+        }
+      }
+      size_t scanned = 0;
+      for (auto itr = heap->begin(transaction); itr != heap->end(); ++itr) {
+        EXPECT_EQ(rows[itr->GetRid().Get()],
+                  heap->GetValue(*itr, schema, 0).GetAs<int32_t>());
+        ++scanned;
+      }
+      EXPECT_EQ(rows.size(), scanned);
+
+      // c and b, in that order
+      auto scan = heap->ScanColumns(std::vector<int>{2, 1}, transaction);
+      ColumnBatch batch;
+      scanned = 0;
+      while (scan->NextBatch(batch)) {
+        ASSERT_EQ(2u, batch.columns.size());
+        ASSERT_EQ(static_cast<int>(batch.rids.size()),
+                  batch.columns[0].GetSize());
+        auto c = reinterpret_cast<const int64_t *>(batch.columns[0].GetData());
+        for (size_t row = 0; row < batch.rids.size(); ++row) {
+          int i = rows[batch.rids[row].Get()];
+          Tuple expected = make_tuple(i);
+          EXPECT_EQ(int64_t(i) * 1000, c[row]);
+          EXPECT_EQ(CMP_TRUE, batch.columns[1].GetValue(row).CompareEquals(
+                                  expected.GetValue(schema, 1)));
+          ++scanned;
+        }
+      }
+      EXPECT_EQ(rows.size(), scanned);
+    };
+
+    RID rid;
+    for (int i = 0; i < 300; ++i) {
+      ASSERT_TRUE(table->InsertTuple(make_tuple(i), rid, transaction));
+      rows[rid.Get()] = i;
+    }
+    std::vector<Tuple> batch;
+    std::vector<RID> rids;
+    for (int i = 300; i < 600; ++i)
+      batch.push_back(make_tuple(i));
+    ASSERT_TRUE(table->InsertTuples(batch, rids, transaction));
+    for (int i = 300; i < 600; ++i)
+      rows[rids[i - 300].Get()] = i;
+    transaction_manager->Commit(transaction);
+    delete transaction;
+    transaction = transaction_manager->Begin();
+    check(table);
+
+    // deleted rows are reused, the varlen values of updated ones compacted
+    int i = 0, updated = 0;
+    for (auto row = rows.begin(); row != rows.end(); ++i) {
+      if (i % 3 == 0) {
+        ASSERT_TRUE(table->MarkDelete(RID(row->first), transaction));
+        row = rows.erase(row);
+        continue;
+      }
+      if (i % 5 == 0 &&
+          table->UpdateTuple(make_tuple(row->second + 1000), RID(row->first),
+                             transaction)) {
+        row->second += 1000;
+        ++updated;
+      }
+      ++row;
+    }
+    EXPECT_LT(0, updated);
+    transaction_manager->Commit(transaction);
+    delete transaction;
+    transaction = transaction_manager->Begin();
+    auto count_pages = [&]() {
+      std::set<page_id_t> pages;
+      for (auto itr = table->begin(transaction); itr != table->end(); ++itr)
+        pages.insert(itr->GetRid().GetPageId());
+      return pages.size();
+    };
+    size_t pages = count_pages();
+    for (int i = 2000; i < 2200; ++i) {
+      ASSERT_TRUE(table->InsertTuple(make_tuple(i), rid, transaction));
+      rows[rid.Get()] = i;
+    }
+    EXPECT_LE(count_pages(), pages + pages / 10);
+    check(table);
+
+    TableHeap *reopened =
+        new TableHeap(buffer_pool_manager, lock_manager, log_manager,
+                      table->GetFirstPageId(), schema);
+    EXPECT_TRUE(reopened->GetLayout() == layout);
+    check(reopened);
+    transaction_manager->Commit(transaction);
+
+    remove("test.db");
+    remove("test.log");
+    delete reopened;
+    delete table;
+    delete transaction;
+    delete transaction_manager;
+    delete buffer_pool_manager;
+    delete log_manager;
+    delete lock_manager;
+    delete disk_manager;
+  }
+  delete schema;
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST(TableHeapTest, DISABLED_InsertBenchmark) {
+  Schema *schema = ParseCreateStatement("a bigint, b integer");
+  Tuple tuple = ConstructTuple(schema);
+  for (int rows : {1000, 100000, 10000000}) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *buffer_pool_manager =
+        new BufferPoolManager(1024, disk_manager);
+    LockManager *lock_manager = new LockManager(true);
+    LogManager *log_manager = new LogManager(disk_manager);
+    Transaction *transaction = new Transaction(0);
+    TableHeap *table = new TableHeap(buffer_pool_manager, lock_manager,
+                                     log_manager, transaction);
+    RID rid;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rows; ++i) {
+      table->InsertTuple(tuple, rid, transaction);
+      // the write set of one transaction would hold every row
+      if (transaction->GetWriteSet()->size() == 100000)
+        transaction->GetWriteSet()->clear();
+    }
+    std::chrono::duration<double> seconds =
+        std::chrono::steady_clock::now() - start;
+    std::cout << rows << " rows: " << seconds.count() << " s, "
+              << seconds.count() * 1e9 / rows << " ns/row" << std::endl;
+
+    delete table;
+    delete buffer_pool_manager;
+    delete log_manager;
+    delete lock_manager;
+    delete transaction;
+    delete disk_manager;
+    remove("test.db");
+    remove("test.log");
+  }
+  delete schema;
+}
+
+/*
+ * Load rows into a table with an index on its first column, one row at a
+ * time and in batches, as the virtual table does.
+ * Run with --gtest_also_run_disabled_tests
+ */
+TEST(TableHeapTest, DISABLED_BatchInsertBenchmark) {
+  Schema *schema = ParseCreateStatement("a bigint, b integer");
+  const int rows = 10000000;
+  for (bool batched : {false, true}) {
+    for (bool indexed : {false, true}) {
+      DiskManager *disk_manager = new DiskManager("test.db");
+      BufferPoolManager *buffer_pool_manager =
+          new BufferPoolManager(4096, disk_manager);
+      LockManager *lock_manager = new LockManager(true);
+      LogManager *log_manager = new LogManager(disk_manager);
+      Transaction *transaction = new Transaction(0);
+      page_id_t header_page_id;
+      buffer_pool_manager->NewPage(header_page_id);
+      TableHeap *table = new TableHeap(buffer_pool_manager, lock_manager,
+                                       log_manager, transaction);
+      BPlusTreeIndex<GenericKey<8>, RID, GenericComparator<8>> index(
+          new IndexMetadata("foo_idx", "foo", schema, std::vector<int>{0}),
+          buffer_pool_manager);
+
+      std::vector<Tuple> batch, keys;
+      std::vector<RID> rids;
+      RID rid;
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < rows; ++i) {
+        std::vector<Value> values{Value(TypeId::BIGINT, int64_t(i)),
+                                  Value(TypeId::INTEGER, i)};
+        Tuple tuple(values, schema);
+        std::vector<Value> key_values{Value(TypeId::BIGINT, int64_t(i))};
+        Tuple key(key_values, index.GetKeySchema());
+        if (!batched) {
+          table->InsertTuple(tuple, rid, transaction);
+          if (indexed)
+            index.InsertEntry(key, rid, transaction);
+        } else {
+          batch.push_back(tuple);
+          keys.push_back(key);
+          if (batch.size() == VTAB_INSERT_BATCH_SIZE || i == rows - 1) {
+            table->InsertTuples(batch, rids, transaction);
+            if (indexed)
+              index.InsertEntries(keys, rids, transaction);
+            batch.clear();
+            keys.clear();
+          }
+        }
+        // the write set of one transaction would hold every row
+        if (transaction->GetWriteSet()->size() >= 100000)
+          transaction->GetWriteSet()->clear();
+      }
+      std::chrono::duration<double> seconds =
+          std::chrono::steady_clock::now() - start;
+      std::cout << (batched ? "batched" : "per row") << ", "
+                << (indexed ? "indexed" : "no index") << ": "
+                << seconds.count() << " s, "
+                << seconds.count() * 1e9 / rows << " ns/row" << std::endl;
+
+      buffer_pool_manager->UnpinPage(header_page_id, true);
+      delete table;
+      delete buffer_pool_manager;
+      delete log_manager;
+      delete lock_manager;
+      delete transaction;
+      delete disk_manager;
+      remove("test.db");
+      remove("test.log");
+    }
+  }
+  delete schema;
+}
+
+} // namespace scudb
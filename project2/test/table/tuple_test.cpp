@@ -3,9 +3,11 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <cstdio>
 #include <iostream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "buffer/buffer_pool_manager.h"
@@ -61,4 +63,142 @@ TEST(TupleTest, TableHeapTest) {
   delete disk_manager;
 }
 
+// point lookups on a small hot set keep hitting the pool while another
+// thread runs a full table scan through a ring many times the pool size
+TEST(TupleTest, ScanRingKeepsHotPagesTest) {
+  std::string createStmt =
+      "a varchar, b smallint, c bigint, d bool, e varchar(16)";
+  Schema *schema = ParseCreateStatement(createStmt);
+  Tuple tuple = ConstructTuple(schema);
+
+  Transaction *transaction = new Transaction(0);
+  // small pages, so that 5000 tuples span many times the pool
+  DiskManager *disk_manager =
+      new DiskManager("test.db", DiskIOMode::STREAM, MIN_PAGE_SIZE);
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(64, disk_manager);
+  LockManager *lock_manager = new LockManager(true);
+  LogManager *log_manager = new LogManager(disk_manager);
+  TableHeap *table = new TableHeap(buffer_pool_manager, lock_manager,
+                                   log_manager, transaction);
+
+  RID rid;
+  std::vector<RID> hot_rids;
+  page_id_t last_page_id = INVALID_PAGE_ID;
+  int num_pages = 0;
+  for (int i = 0; i < 5000; ++i) {
+    table->InsertTuple(tuple, rid, transaction);
+    if (rid.GetPageId() != last_page_id) {
+      last_page_id = rid.GetPageId();
+      // one tuple of every 32nd page is looked up over and over
+      if (num_pages++ % 32 == 0 && hot_rids.size() < 16) {
+        hot_rids.push_back(rid);
+      }
+    }
+  }
+  ASSERT_GT(num_pages, 4 * 64);
+
+  Tuple result;
+  auto point_lookups = [&](int rounds) {
+    for (int r = 0; r < rounds; ++r) {
+      for (auto &hot_rid : hot_rids) {
+        EXPECT_TRUE(table->GetTuple(hot_rid, result, transaction));
+      }
+    }
+    return rounds * hot_rids.size();
+  };
+  // warm up, then the hot set is entirely served from the pool
+  point_lookups(2);
+  size_t misses = buffer_pool_manager->GetMissCount();
+  point_lookups(10);
+  EXPECT_EQ(misses, buffer_pool_manager->GetMissCount());
+
+  RID first_rid = table->begin(transaction)->GetRid();
+  auto ring = std::make_shared<BufferRing>(buffer_pool_manager);
+  size_t hits = buffer_pool_manager->GetHitCount();
+  misses = buffer_pool_manager->GetMissCount();
+  std::atomic<bool> scan_done(false);
+  int scanned = 0;
+  std::thread scanner([&]() {
+    Transaction scan_txn(1);
+    TableIterator itr(table, first_rid, &scan_txn, ring);
+    while (itr != table->end()) {
+      ++scanned;
+      ++itr;
+    }
+    scan_done = true;
+  });
+  size_t lookups = 0;
+  while (!scan_done || lookups < 2000) {
+    lookups += point_lookups(1);
+  }
+  scanner.join();
+  EXPECT_EQ(5000, scanned);
+
+  // everything but the ring's own fetches comes from the point lookups
+  size_t point_hits = buffer_pool_manager->GetHitCount() - hits -
+                      ring->GetHitCount();
+  size_t point_misses = buffer_pool_manager->GetMissCount() - misses -
+                        ring->GetMissCount();
+  EXPECT_EQ(lookups, point_hits + point_misses);
+  EXPECT_GE(point_hits, lookups * 99 / 100);
+  EXPECT_GT(ring->GetMissCount(), 0);
+  ring.reset();
+
+  remove("test.db"); // remove db file
+  remove("test.log");
+  delete schema;
+  delete table;
+  delete buffer_pool_manager;
+  delete disk_manager;
+}
+
+// a full scan over a table that is not cached reads the pages ahead of itself
+TEST(TupleTest, ReadAheadScanTest) {
+  std::string createStmt =
+      "a varchar, b smallint, c bigint, d bool, e varchar(16)";
+  Schema *schema = ParseCreateStatement(createStmt);
+  Tuple tuple = ConstructTuple(schema);
+
+  Transaction *transaction = new Transaction(0);
+  DiskManager *disk_manager =
+      new DiskManager("test.db", DiskIOMode::STREAM, MIN_PAGE_SIZE);
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(64, disk_manager);
+  LockManager *lock_manager = new LockManager(true);
+  LogManager *log_manager = new LogManager(disk_manager);
+  TableHeap *table = new TableHeap(buffer_pool_manager, lock_manager,
+                                   log_manager, transaction);
+  RID rid;
+  for (int i = 0; i < 2000; ++i) {
+    table->InsertTuple(tuple, rid, transaction);
+  }
+  page_id_t first_page_id = table->begin(transaction)->GetRid().GetPageId();
+  buffer_pool_manager->FlushAllPages();
+  delete table;
+  delete buffer_pool_manager;
+
+  buffer_pool_manager = new BufferPoolManager(64, disk_manager);
+  table = new TableHeap(buffer_pool_manager, lock_manager, log_manager,
+                        first_page_id);
+  int scanned = 0;
+  for (auto itr = table->begin(transaction); itr != table->end(); ++itr) {
+    EXPECT_EQ(tuple.GetLength(), itr->GetLength());
+    ++scanned;
+  }
+  EXPECT_EQ(2000, scanned);
+  buffer_pool_manager->WaitForPrefetch();
+  EXPECT_GT(buffer_pool_manager->GetPrefetchCount(), 0);
+
+  remove("test.db");
+  remove("test.log");
+  delete schema;
+  delete table;
+  delete buffer_pool_manager;
+  delete log_manager;
+  delete lock_manager;
+  delete transaction;
+  delete disk_manager;
+}
+
 } // namespace scudb
@@ -44,4 +44,333 @@ TEST(VtableTest, CreateTest) {
   remove("vtable.db");
   return;
 }
+
+// count the rows of a query, or keep its last column when text is given
+static int CountCallback(void *count, int argc, char **argv, char **) {
+  ++*static_cast<int *>(count);
+  (void)argc;
+  (void)argv;
+  return 0;
+}
+
+static int DetailCallback(void *detail, int argc, char **argv, char **) {
+  *static_cast<std::string *>(detail) += argv[argc - 1];
+  return 0;
+}
+
+/*
+ * Range predicates on a non-unique index are answered by index range scans
+ */
+TEST(VtableTest, RangeScanTest) {
+  std::string db_file = "sqlite.db";
+  remove(db_file.c_str());
+  remove("vtable.db");
+  sqlite3 *db;
+  int rc = sqlite3_open(db_file.c_str(), &db);
+  EXPECT_EQ(rc, SQLITE_OK);
+  rc = sqlite3_enable_load_extension(db, 1);
+  EXPECT_EQ(rc, SQLITE_OK);
+  char *zErrMsg = 0;
+  rc = sqlite3_load_extension(db, "libvtable", 0, &zErrMsg);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  EXPECT_TRUE(ExecSQL(db, "CREATE VIRTUAL TABLE foo2 USING vtable ('a INT, "
+                          "b varchar', 'nonunique foo2_idx a')"));
+  // keys 0 to 19, five rows each
+  for (int i = 0; i < 100; i++) {
+    EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo2 VALUES(" + std::to_string(i % 20) +
+                                ", 'row " + std::to_string(i) + "')"));
+  }
+  auto count = [db](const std::string &sql) {
+    int rows = 0;
+    EXPECT_EQ(SQLITE_OK,
+              sqlite3_exec(db, sql.c_str(), CountCallback, &rows, nullptr));
+    return rows;
+  };
+  EXPECT_EQ(25, count("SELECT * FROM foo2 WHERE a >= 5 AND a < 10"));
+  EXPECT_EQ(20, count("SELECT * FROM foo2 WHERE a > 15"));
+  EXPECT_EQ(15, count("SELECT * FROM foo2 WHERE a <= 2"));
+  EXPECT_EQ(10, count("SELECT * FROM foo2 WHERE a BETWEEN 3 AND 4"));
+  EXPECT_EQ(5, count("SELECT * FROM foo2 WHERE a = 7"));
+  EXPECT_EQ(0, count("SELECT * FROM foo2 WHERE a > 7 AND a < 8"));
+  // bounds the INT column cannot hold are not cut to it
+  EXPECT_EQ(10, count("SELECT * FROM foo2 WHERE a < 1.5"));
+  EXPECT_EQ(5, count("SELECT * FROM foo2 WHERE a > 18.5"));
+  EXPECT_EQ(5, count("SELECT * FROM foo2 WHERE a > 2.5 AND a <= 3"));
+  EXPECT_EQ(100, count("SELECT * FROM foo2 WHERE a < 4294967297"));
+  EXPECT_EQ(0, count("SELECT * FROM foo2 WHERE a > 4294967297"));
+  EXPECT_EQ(100, count("SELECT * FROM foo2 WHERE a > -4294967297"));
+
+  std::string detail;
+  EXPECT_EQ(SQLITE_OK,
+            sqlite3_exec(db, "EXPLAIN QUERY PLAN SELECT * FROM foo2 WHERE a > 15",
+                         DetailCallback, &detail, nullptr));
+  EXPECT_NE(std::string::npos, detail.find("INDEX"));
+  EXPECT_EQ(std::string::npos, detail.find("INDEX 0:"));
+
+  EXPECT_TRUE(ExecSQL(db, "DELETE FROM foo2 WHERE a < 5"));
+  EXPECT_EQ(75, count("SELECT * FROM foo2"));
+  EXPECT_EQ(0, count("SELECT * FROM foo2 WHERE a <= 4"));
+  EXPECT_TRUE(ExecSQL(db, "DROP TABLE foo2"));
+
+  rc = sqlite3_close(db);
+  EXPECT_EQ(rc, SQLITE_OK);
+  remove(db_file.c_str());
+  remove("vtable.db");
+}
+/*
+ * Varchar keys that share the prefix an index key keeps are told apart,
+ * for lookups and range scans
+ */
+TEST(VtableTest, LongKeyTest) {
+  std::string db_file = "sqlite.db";
+  remove(db_file.c_str());
+  remove("vtable.db");
+  sqlite3 *db;
+  int rc = sqlite3_open(db_file.c_str(), &db);
+  EXPECT_EQ(rc, SQLITE_OK);
+  rc = sqlite3_enable_load_extension(db, 1);
+  EXPECT_EQ(rc, SQLITE_OK);
+  char *zErrMsg = 0;
+  rc = sqlite3_load_extension(db, "libvtable", 0, &zErrMsg);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  EXPECT_TRUE(ExecSQL(db, "CREATE VIRTUAL TABLE s USING vtable ('id int, "
+                          "name varchar', 's_pk name')"));
+  EXPECT_TRUE(
+      ExecSQL(db, "INSERT INTO s VALUES(1, 'abcdefghijklmnopqrstu_one')"));
+  EXPECT_TRUE(
+      ExecSQL(db, "INSERT INTO s VALUES(2, 'abcdefghijklmnopqrstu_two')"));
+  EXPECT_TRUE(ExecSQL(db, "INSERT INTO s VALUES(3, 'abcdefghijklmnop')"));
+  auto query = [db](const std::string &sql) {
+    std::string result;
+    EXPECT_EQ(SQLITE_OK,
+              sqlite3_exec(db, sql.c_str(), DetailCallback, &result, nullptr));
+    return result;
+  };
+  EXPECT_EQ("2", query("SELECT id FROM s WHERE name = "
+                       "'abcdefghijklmnopqrstu_two'"));
+  EXPECT_EQ("1", query("SELECT id FROM s WHERE name = "
+                       "'abcdefghijklmnopqrstu_one'"));
+  EXPECT_EQ("3", query("SELECT count(*) FROM s WHERE name < "
+                       "'abcdefghijklmnopqrstu_zzz'"));
+  EXPECT_EQ("2", query("SELECT count(*) FROM s WHERE name > "
+                       "'abcdefghijklmnopqrstu_a'"));
+  EXPECT_EQ("1", query("SELECT count(*) FROM s WHERE name > "
+                       "'abcdefghijklmnopqrstu_one'"));
+  EXPECT_EQ("3", query("SELECT id FROM s WHERE name < "
+                       "'abcdefghijklmnopqrstu_one'"));
+  EXPECT_TRUE(ExecSQL(db, "DELETE FROM s WHERE id = 1"));
+  EXPECT_EQ("2", query("SELECT id FROM s WHERE name = "
+                       "'abcdefghijklmnopqrstu_two'"));
+  EXPECT_EQ("", query("SELECT id FROM s WHERE name = "
+                      "'abcdefghijklmnopqrstu_one'"));
+  EXPECT_TRUE(ExecSQL(db, "DROP TABLE s"));
+
+  rc = sqlite3_close(db);
+  EXPECT_EQ(rc, SQLITE_OK);
+  remove(db_file.c_str());
+  remove("vtable.db");
+}
+/*
+ * Rows inserted in a transaction go in batches into the table and its
+ * index, and are there for the reads of the same transaction
+ */
+TEST(VtableTest, BatchInsertTest) {
+  std::string db_file = "sqlite.db";
+  remove(db_file.c_str());
+  remove("vtable.db");
+  sqlite3 *db;
+  int rc = sqlite3_open(db_file.c_str(), &db);
+  EXPECT_EQ(rc, SQLITE_OK);
+  rc = sqlite3_enable_load_extension(db, 1);
+  EXPECT_EQ(rc, SQLITE_OK);
+  char *zErrMsg = 0;
+  rc = sqlite3_load_extension(db, "libvtable", 0, &zErrMsg);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  EXPECT_TRUE(ExecSQL(db, "CREATE VIRTUAL TABLE foo3 USING vtable ('a INT, "
+                          "b varchar', 'foo3_pk a')"));
+  auto count = [db](const std::string &sql) {
+    int rows = 0;
+    EXPECT_EQ(SQLITE_OK,
+              sqlite3_exec(db, sql.c_str(), CountCallback, &rows, nullptr));
+    return rows;
+  };
+  // more rows than a batch, in one statement
+  EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo3 WITH RECURSIVE n(x) AS (SELECT 0 "
+                          "UNION ALL SELECT x + 1 FROM n WHERE x < 2999) "
+                          "SELECT x, 'row ' || x FROM n"));
+  EXPECT_EQ(3000, count("SELECT * FROM foo3"));
+  EXPECT_EQ(1, count("SELECT * FROM foo3 WHERE a = 2500"));
+  EXPECT_EQ(100, count("SELECT * FROM foo3 WHERE a >= 1000 AND a < 1100"));
+
+  // read before the transaction commits
+  EXPECT_TRUE(ExecSQL(db, "BEGIN"));
+  for (int i = 3000; i < 3010; i++) {
+    EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo3 VALUES(" + std::to_string(i) +
+                                ", 'row')"));
+  }
+  EXPECT_EQ(1, count("SELECT * FROM foo3 WHERE a = 3005"));
+  EXPECT_TRUE(ExecSQL(db, "COMMIT"));
+  EXPECT_EQ(3010, count("SELECT * FROM foo3"));
+  EXPECT_TRUE(ExecSQL(db, "DROP TABLE foo3"));
+
+  rc = sqlite3_close(db);
+  EXPECT_EQ(rc, SQLITE_OK);
+  remove(db_file.c_str());
+  remove("vtable.db");
+}
+/*
+ * Values larger than a page are stored out of line and read back whole,
+ * through updates and deletes
+ */
+TEST(VtableTest, OverflowTest) {
+  std::string db_file = "sqlite.db";
+  remove(db_file.c_str());
+  remove("vtable.db");
+  sqlite3 *db;
+  int rc = sqlite3_open(db_file.c_str(), &db);
+  EXPECT_EQ(rc, SQLITE_OK);
+  rc = sqlite3_enable_load_extension(db, 1);
+  EXPECT_EQ(rc, SQLITE_OK);
+  char *zErrMsg = 0;
+  rc = sqlite3_load_extension(db, "libvtable", 0, &zErrMsg);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  EXPECT_TRUE(ExecSQL(db, "CREATE VIRTUAL TABLE foo4 USING vtable ('a INT, "
+                          "b varchar, c varchar', 'foo4_pk a')"));
+  // b repeats and is compressed, c is random
+  EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo4 WITH RECURSIVE n(x) AS (SELECT 0 "
+                          "UNION ALL SELECT x + 1 FROM n WHERE x < 49) "
+                          "SELECT x, replace(hex(zeroblob(5000 + x)), '0', "
+                          "'ab'), hex(randomblob(3000)) FROM n"));
+  auto query = [db](const std::string &sql) {
+    std::string result;
+    EXPECT_EQ(SQLITE_OK,
+              sqlite3_exec(db, sql.c_str(), DetailCallback, &result, nullptr));
+    return result;
+  };
+  EXPECT_EQ("50", query("SELECT count(a) FROM foo4"));
+  EXPECT_EQ("20028", query("SELECT length(b) FROM foo4 WHERE a = 7"));
+  EXPECT_EQ("6000", query("SELECT length(c) FROM foo4 WHERE a = 7"));
+  EXPECT_EQ("0", query("SELECT count(*) FROM foo4 WHERE b <> replace("
+                       "hex(zeroblob(5000 + a)), '0', 'ab')"));
+
+  EXPECT_TRUE(ExecSQL(db, "UPDATE foo4 SET b = replace(hex(zeroblob(8000)), "
+                          "'0', 'cd') WHERE a < 10"));
+  EXPECT_EQ("32000", query("SELECT length(b) FROM foo4 WHERE a = 3"));
+  EXPECT_EQ("20060", query("SELECT length(b) FROM foo4 WHERE a = 15"));
+  EXPECT_TRUE(ExecSQL(db, "DELETE FROM foo4 WHERE a >= 40"));
+  EXPECT_EQ("40", query("SELECT count(a) FROM foo4"));
+  EXPECT_EQ("6000", query("SELECT length(c) FROM foo4 WHERE a = 39"));
+  EXPECT_TRUE(ExecSQL(db, "DROP TABLE foo4"));
+
+  rc = sqlite3_close(db);
+  EXPECT_EQ(rc, SQLITE_OK);
+  remove(db_file.c_str());
+  remove("vtable.db");
+}
+
+// a table with the columnar page layout, scanned a column batch at a time
+TEST(VtableTest, PaxTest) {
+  std::string db_file = "sqlite.db";
+  remove(db_file.c_str());
+  remove("vtable.db");
+  sqlite3 *db;
+  int rc = sqlite3_open(db_file.c_str(), &db);
+  EXPECT_EQ(rc, SQLITE_OK);
+  rc = sqlite3_enable_load_extension(db, 1);
+  EXPECT_EQ(rc, SQLITE_OK);
+  char *zErrMsg = 0;
+  rc = sqlite3_load_extension(db, "libvtable", 0, &zErrMsg);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  EXPECT_TRUE(ExecSQL(db, "CREATE VIRTUAL TABLE foo5 USING vtable ('a INT, "
+                          "b varchar, c BIGINT', 'foo5_pk a', 'pax')"));
+  EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo5 WITH RECURSIVE n(x) AS (SELECT 0 "
+                          "UNION ALL SELECT x + 1 FROM n WHERE x < 999) "
+                          "SELECT x, substr('abcdefghij', 1, x % 11), x * 2 "
+                          "FROM n"));
+  auto query = [db](const std::string &sql) {
+    std::string result;
+    EXPECT_EQ(SQLITE_OK,
+              sqlite3_exec(db, sql.c_str(), DetailCallback, &result, nullptr));
+    return result;
+  };
+  EXPECT_EQ("999000", query("SELECT sum(c) FROM foo5"));
+  EXPECT_EQ("1000", query("SELECT count(*) FROM foo5"));
+  EXPECT_EQ("4995", query("SELECT sum(length(b)) FROM foo5"));
+  EXPECT_EQ("abcdefg", query("SELECT b FROM foo5 WHERE a = 7"));
+  EXPECT_EQ("90", query("SELECT count(*) FROM foo5 WHERE b = 'abcdefghij'"));
+
+  EXPECT_TRUE(ExecSQL(db, "UPDATE foo5 SET b = 'a much longer value', c = 0 "
+                          "WHERE a < 100"));
+  EXPECT_TRUE(ExecSQL(db, "DELETE FROM foo5 WHERE a % 2 = 1"));
+  EXPECT_EQ("500", query("SELECT count(*) FROM foo5"));
+  EXPECT_EQ("494100", query("SELECT sum(c) FROM foo5"));
+  EXPECT_EQ("a much longer value", query("SELECT b FROM foo5 WHERE a = 8"));
+  EXPECT_EQ("50", query("SELECT count(*) FROM foo5 WHERE b = 'a much longer "
+                        "value'"));
+  EXPECT_TRUE(ExecSQL(db, "DROP TABLE foo5"));
+
+  rc = sqlite3_close(db);
+  EXPECT_EQ(rc, SQLITE_OK);
+  remove(db_file.c_str());
+  remove("vtable.db");
+}
+
+/*
+ * A row too large for a page even with its values out of line fails the
+ * statement, and the rows inserted with it are rolled back from the table
+ * and its index
+ */
+TEST(VtableTest, OversizedRowTest) {
+  std::string db_file = "sqlite.db";
+  remove(db_file.c_str());
+  remove("vtable.db");
+  sqlite3 *db;
+  int rc = sqlite3_open(db_file.c_str(), &db);
+  EXPECT_EQ(rc, SQLITE_OK);
+  rc = sqlite3_enable_load_extension(db, 1);
+  EXPECT_EQ(rc, SQLITE_OK);
+  char *zErrMsg = 0;
+  rc = sqlite3_load_extension(db, "libvtable", 0, &zErrMsg);
+  EXPECT_EQ(rc, SQLITE_OK);
+
+  // every value out of line still leaves a pointer in the row
+  std::string columns = "a INT";
+  std::string short_row = "";
+  std::string long_row = "";
+  for (int i = 0; i < 400; i++) {
+    columns += ", c" + std::to_string(i) + " varchar";
+    short_row += ", 'a'";
+    long_row += ", '" + std::string(20, 'a' + i % 26) + "'";
+  }
+  EXPECT_TRUE(ExecSQL(db, "CREATE VIRTUAL TABLE foo6 USING vtable ('" +
+                              columns + "', 'foo6_pk a')"));
+  auto count = [db](const std::string &sql) {
+    int rows = 0;
+    EXPECT_EQ(SQLITE_OK,
+              sqlite3_exec(db, sql.c_str(), CountCallback, &rows, nullptr));
+    return rows;
+  };
+  EXPECT_FALSE(ExecSQL(db, "INSERT INTO foo6 VALUES (1" + short_row +
+                               "), (2" + long_row + "), (3" + short_row +
+                               ")"));
+  EXPECT_EQ(0, count("SELECT a FROM foo6"));
+  EXPECT_EQ(0, count("SELECT a FROM foo6 WHERE a = 1"));
+
+  EXPECT_TRUE(ExecSQL(db, "INSERT INTO foo6 VALUES (1" + short_row +
+                              "), (3" + short_row + ")"));
+  EXPECT_EQ(2, count("SELECT a FROM foo6"));
+  EXPECT_EQ(1, count("SELECT a FROM foo6 WHERE a = 1"));
+  EXPECT_EQ(1, count("SELECT a FROM foo6 WHERE a = 3"));
+  EXPECT_TRUE(ExecSQL(db, "DROP TABLE foo6"));
+
+  rc = sqlite3_close(db);
+  EXPECT_EQ(rc, SQLITE_OK);
+  remove(db_file.c_str());
+  remove("vtable.db");
+}
 } // namespace scudb